@@ -2,14 +2,14 @@
 # This script handles conan install, cmake configure, and ninja build
 #
 # Usage:
-#   .\build-rippled.ps1                     # Build with defaults (Release, -j8)
+#   .\build-rippled.ps1                     # Build with defaults (Release, -j = logical CPUs)
 #   .\build-rippled.ps1 -Parallel 4         # Use 4 parallel jobs
 #   .\build-rippled.ps1 -BuildType Debug    # Debug build
 #   .\build-rippled.ps1 -Clean              # Clean and rebuild
 #   .\build-rippled.ps1 -ToolkitPath C:\... # Specify toolkit location
 
 param(
-    [int]$Parallel = 8,
+    [int]$Parallel = 0,                 # 0 = one job per logical CPU, the governor caps memory
     [string]$BuildType = "Release",
     [switch]$Clean,
     [string]$ToolkitPath = ""
@@ -17,6 +17,13 @@ param(
 
 $ErrorActionPreference = "Stop"
 
+# Launch one job per CPU and let the governor hold back the excess by memory:
+# with more jobs waiting than tokens, it grants the heaviest TUs first (from
+# compile history) instead of whatever order ninja happened to start them.
+if ($Parallel -le 0) {
+    $Parallel = [Environment]::ProcessorCount
+}
+
 # Auto-detect toolkit path if not specified
 if (-not $ToolkitPath) {
     # Check common locations
@@ -273,6 +280,30 @@ if ($govProc) {
     Write-Host "    CPU Time:     $([math]::Round($govProc.CPU, 2)) seconds"
 }
 
+# Heaviest translation units from the governor's compile history (saved
+# within a second of the build going idle)
+$historyPath = if ($env:GOV_HISTORY_PATH) { $env:GOV_HISTORY_PATH } else { "$env:LOCALAPPDATA\BuildGovernor\compile-history.json" }
+Start-Sleep -Seconds 1
+if (Test-Path $historyPath) {
+    try {
+        $history = Get-Content $historyPath -Raw | ConvertFrom-Json
+        $heaviest = $history.records.PSObject.Properties |
+            Sort-Object { $_.Value.durationMs } -Descending |
+            Select-Object -First 10
+        if ($heaviest) {
+            Write-Host ""
+            Write-Host "  Heaviest Translation Units:" -ForegroundColor Cyan
+            foreach ($tu in $heaviest) {
+                $secs = [math]::Round($tu.Value.durationMs / 1000, 1)
+                $peakGb = [math]::Round($tu.Value.peakCommitBytes / 1GB, 2)
+                Write-Host ("    {0,7}s {1,6} GB  {2}" -f $secs, $peakGb, (Split-Path $tu.Name -Leaf))
+            }
+        }
+    } catch {
+        Write-Host "  (compile history unreadable: $historyPath)" -ForegroundColor Gray
+    }
+}
+
 # Check for output binary (xrpld.exe in newer versions, rippled.exe in older)
 $outputBinary = $null
 if (Test-Path "xrpld.exe") {
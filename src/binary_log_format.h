@@ -0,0 +1,185 @@
+/**
+ * @file binary_log_format.h
+ * @brief Record layout for LogFormat::BINARY and the shared printf-spec parser
+ *
+ * Binary logging stores a call-site ID, a raw QPC timestamp, tid, cid and the
+ * packed printf arguments; the format string itself is written once per call
+ * site. Formatting is deferred to the offline decoder
+ * (tools/log-decoder/decode_log.cpp), which includes this header too, so it
+ * is deliberately portable (no Windows dependencies).
+ *
+ * Stream layout (all integers little-endian, no padding):
+ *
+ *   'H' magic[4]="RDBL" version:u16 pointerSize:u8 reserved:u8
+ *       qpcFrequency:u64 qpcOrigin:u64 wallOrigin:u64 pid:u32
+ *         wallOrigin is local time as a FILETIME (100ns since 1601) taken
+ *         at qpcOrigin. A stream may contain several headers (appends).
+ *   'S' id:u32 line:u32 argCount:u8 argTypes[argCount]
+ *       level:str file:str fmt:str
+ *         Call site definition. Emitted at least once per header, possibly
+ *         after the first 'L' that references it (decoders must pre-scan).
+ *   'L' id:u32 qpc:u64 tid:u32 cid:u64 payloadLen:u16 payload
+ *         Packed arguments in argTypes order (see ArgType).
+ *   'M' qpc:u64 tid:u32 cid:u64 line:u32 level:str file:str msg:str
+ *         Already-formatted message (no call site, or unsupported format).
+ *   'R' length:u32 bytes
+ *         Raw text (banners, boxes), written verbatim by the decoder.
+ *
+ *   str = length:u16 followed by that many bytes (no terminator).
+ *
+ * Minidumps written while the flight recorder is on carry a complete stream
+ * (header, sites, records) as a user stream of type kFlightRecorderStreamType.
+ */
+
+#ifndef RIPPLED_WINDOWS_DEBUG_BINARY_LOG_FORMAT_H
+#define RIPPLED_WINDOWS_DEBUG_BINARY_LOG_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace rippled_debug {
+namespace binlog {
+
+constexpr char kMagic[4] = {'R', 'D', 'B', 'L'};
+constexpr uint16_t kVersion = 1;
+constexpr int kMaxArgs = 16;
+
+// Minidump user stream type ("RDFL"), above LastReservedStream
+constexpr uint32_t kFlightRecorderStreamType = 0x4C464452;
+
+enum RecordTag : uint8_t {
+    TAG_HEADER  = 'H',
+    TAG_SITE    = 'S',
+    TAG_LOG     = 'L',
+    TAG_MESSAGE = 'M',
+    TAG_TEXT    = 'R'
+};
+
+// How one printf argument is stored in an 'L' payload
+enum ArgType : uint8_t {
+    ARG_INT32,      // 4 bytes (int, long on Windows, char/short after promotion)
+    ARG_INT64,      // 8 bytes (long long, size_t/ptrdiff_t on 64-bit)
+    ARG_DOUBLE,     // 8 bytes
+    ARG_POINTER,    // 8 bytes regardless of pointer size
+    ARG_STRING      // length:u16 + bytes
+};
+
+// One parsed conversion specification (the part after '%')
+struct FormatSpec {
+    int starCount;      // Number of '*' width/precision arguments (0-2)
+    ArgType type;       // Storage class of the value argument
+    char conversion;    // d, u, x, s, f, p, ...
+    bool isSigned;      // d/i: sign-extend when rendering
+    bool supported;     // false for %n, wide strings, long double, ...
+};
+
+/**
+ * Parse the conversion spec starting right after a '%'.
+ * Returns a pointer just past the spec. A literal "%%" yields conversion '%'.
+ * Integer sizes follow the *current* compiler's type sizes, which is why the
+ * encoder records the resulting ArgTypes in the 'S' record.
+ */
+inline const char* parseFormatSpec(const char* p, FormatSpec& spec) {
+    spec.starCount = 0;
+    spec.type = ARG_INT32;
+    spec.conversion = 0;
+    spec.isSigned = false;
+    spec.supported = true;
+
+    if (*p == '%') {
+        spec.conversion = '%';
+        return p + 1;
+    }
+
+    // Flags
+    while (*p && strchr("-+ #0'", *p)) p++;
+
+    // Width
+    if (*p == '*') { spec.starCount++; p++; }
+    else while (*p >= '0' && *p <= '9') p++;
+
+    // Precision
+    if (*p == '.') {
+        p++;
+        if (*p == '*') { spec.starCount++; p++; }
+        else while (*p >= '0' && *p <= '9') p++;
+    }
+
+    // Length modifier
+    int bits = 0;       // 0 = default int
+    bool wide = false;
+    bool longDouble = false;
+    if (p[0] == 'h' && p[1] == 'h') { p += 2; }
+    else if (p[0] == 'h') { p += 1; }
+    else if (p[0] == 'l' && p[1] == 'l') { bits = 64; p += 2; }
+    else if (p[0] == 'l') { bits = (int)sizeof(long) * 8; wide = true; p += 1; }
+    else if (p[0] == 'j') { bits = (int)sizeof(intmax_t) * 8; p += 1; }
+    else if (p[0] == 'z') { bits = (int)sizeof(size_t) * 8; p += 1; }
+    else if (p[0] == 't') { bits = (int)sizeof(ptrdiff_t) * 8; p += 1; }
+    else if (p[0] == 'L') { longDouble = true; p += 1; }
+    else if (p[0] == 'I' && p[1] == '6' && p[2] == '4') { bits = 64; p += 3; }
+    else if (p[0] == 'I' && p[1] == '3' && p[2] == '2') { bits = 32; p += 3; }
+    else if (p[0] == 'I') { bits = (int)sizeof(size_t) * 8; p += 1; }
+    else if (p[0] == 'w') { wide = true; p += 1; }
+
+    spec.conversion = *p;
+    if (*p) p++;
+
+    switch (spec.conversion) {
+        case 'd': case 'i':
+            spec.isSigned = true;
+            spec.type = (bits == 64) ? ARG_INT64 : ARG_INT32;
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            spec.type = (bits == 64) ? ARG_INT64 : ARG_INT32;
+            break;
+        case 'c':
+            spec.type = ARG_INT32;
+            spec.supported = !wide;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec.type = ARG_DOUBLE;
+            spec.supported = !longDouble || sizeof(long double) == sizeof(double);
+            break;
+        case 'p':
+            spec.type = ARG_POINTER;
+            break;
+        case 's':
+            spec.type = ARG_STRING;
+            spec.supported = !wide;
+            break;
+        default:
+            // %n, %S, %C, %Z and anything we don't recognise
+            spec.supported = false;
+            break;
+    }
+    return p;
+}
+
+/**
+ * Compute the argument storage types for a format string.
+ * Returns the number of arguments (including '*' ints), or -1 if the format
+ * can't be packed and must be formatted eagerly.
+ */
+inline int classifyFormat(const char* fmt, uint8_t* types, int maxTypes) {
+    int count = 0;
+    for (const char* p = fmt; *p; ) {
+        if (*p++ != '%') continue;
+
+        FormatSpec spec;
+        p = parseFormatSpec(p, spec);
+        if (spec.conversion == '%') continue;
+        if (!spec.supported) return -1;
+        if (count + spec.starCount + 1 > maxTypes) return -1;
+
+        for (int i = 0; i < spec.starCount; i++) types[count++] = ARG_INT32;
+        types[count++] = spec.type;
+    }
+    return count;
+}
+
+} // namespace binlog
+} // namespace rippled_debug
+
+#endif // RIPPLED_WINDOWS_DEBUG_BINARY_LOG_FORMAT_H
@@ -10,6 +10,10 @@
  * - CPU information
  * - System specs
  *
+ * The runtime lookups (RtlGetVersion, registry, CPUID, token membership)
+ * are captured once into an immutable SystemInfo, on a background thread
+ * when started by initAll() / installVerboseCrashHandlers().
+ *
  * Usage:
  *   #include "build_info.h"
  *   rippled_debug::printBuildInfo();
@@ -22,7 +26,10 @@
 
 #include <windows.h>
 #include <intrin.h>
+#include <atomic>
+#include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 
@@ -325,75 +332,205 @@ inline bool isWow64() {
 }
 
 // ============================================================================
-// Print Functions
+// Cached System Information
 // ============================================================================
+//
+// Everything above that does not change while the process runs, captured
+// once. Fixed-size fields, so once filled the struct is read without the
+// heap or a lock - the crash path uses trySystemInfo(), which never waits.
+
+struct SystemInfo {
+    char windowsVersion[128];
+    char windowsBuild[256];
+    char cpu[64];
+    int physicalCores;
+    int logicalCores;
+    double totalMemoryGB;
+    char computerName[MAX_COMPUTERNAME_LENGTH + 1];
+    char userName[256];
+    bool admin;
+    bool wow64;
+};
+
+enum SystemInfoState {
+    SYSINFO_NONE,
+    SYSINFO_CAPTURING,
+    SYSINFO_READY
+};
+
+struct SystemInfoCache {
+    std::atomic<int> state{SYSINFO_NONE};
+    FILE* printTo = nullptr;        // printBuildInfo() here once captured...
+    DWORD printThreadId = 0;        // ...reporting the thread that asked
+    SystemInfo info = {};
+};
+
+inline SystemInfoCache& systemInfoCache() {
+    static SystemInfoCache cache;
+    return cache;
+}
+
+inline void copySystemString(char* out, size_t size, const std::string& value) {
+    snprintf(out, size, "%s", value.c_str());
+}
+
+inline void printBuildInfoFor(FILE* output, DWORD threadId);
+
+inline DWORD WINAPI systemInfoThreadMain(LPVOID) {
+    SystemInfoCache& cache = systemInfoCache();
+    SystemInfo& info = cache.info;
+
+    copySystemString(info.windowsVersion, sizeof(info.windowsVersion), getWindowsVersion());
+    copySystemString(info.windowsBuild, sizeof(info.windowsBuild), getWindowsBuildDetails());
+    copySystemString(info.cpu, sizeof(info.cpu), getCpuInfo());
+    getCpuCores(info.physicalCores, info.logicalCores);
+    double availableGB = 0;
+    getSystemMemory(info.totalMemoryGB, availableGB);
+    copySystemString(info.computerName, sizeof(info.computerName), getComputerName());
+    copySystemString(info.userName, sizeof(info.userName), getUserName());
+    info.admin = isRunningAsAdmin();
+    info.wow64 = isWow64();
+
+    cache.state.store(SYSINFO_READY, std::memory_order_release);
+    if (cache.printTo) printBuildInfoFor(cache.printTo, cache.printThreadId);
+    return 0;
+}
 
 /**
- * Print all build information.
+ * Capture the system information once. With background=true this returns
+ * immediately and the work runs on a low-priority thread.
+ * @param printTo Print the full build info there once captured (optional)
  */
-inline void printBuildInfo(FILE* output = stderr) {
-    fprintf(output, "\n");
-    fprintf(output, "================================================================================\n");
-    fprintf(output, "                        rippled-windows-debug v%s\n", RIPPLED_DEBUG_VERSION_STRING);
-    fprintf(output, "================================================================================\n");
-    fprintf(output, "\n");
+inline void startSystemInfoCapture(bool background = true, FILE* printTo = nullptr) {
+    SystemInfoCache& cache = systemInfoCache();
+    int expected = SYSINFO_NONE;
+    if (!cache.state.compare_exchange_strong(expected, SYSINFO_CAPTURING)) {
+        if (printTo) printBuildInfoFor(printTo, GetCurrentThreadId());
+        return;
+    }
+    cache.printTo = printTo;
+    cache.printThreadId = GetCurrentThreadId();
+
+    HANDLE thread = background
+        ? CreateThread(nullptr, 0, systemInfoThreadMain, nullptr, 0, nullptr)
+        : nullptr;
+    if (thread) {
+        SetThreadPriority(thread, THREAD_PRIORITY_BELOW_NORMAL);
+        CloseHandle(thread);
+    } else {
+        systemInfoThreadMain(nullptr);
+    }
+}
+
+/**
+ * The captured information, or null while it is still being captured
+ * (or was never started). Never blocks.
+ */
+inline const SystemInfo* trySystemInfo() {
+    SystemInfoCache& cache = systemInfoCache();
+    return cache.state.load(std::memory_order_acquire) == SYSINFO_READY ? &cache.info : nullptr;
+}
+
+/**
+ * The captured information, capturing it on this thread if nobody has
+ * started, else waiting for the background capture.
+ */
+inline const SystemInfo& systemInfo() {
+    SystemInfoCache& cache = systemInfoCache();
+    startSystemInfoCapture(false);
+    while (cache.state.load(std::memory_order_acquire) != SYSINFO_READY) {
+        Sleep(1);
+    }
+    return cache.info;
+}
+
+// ============================================================================
+// Print Functions
+// ============================================================================
+
+inline void appendBuildInfo(std::string& out, const char* fmt, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len > 0) out.append(line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+}
+
+// The block is written with one call, so it stays together when printed
+// from the capture thread
+inline void printBuildInfoFor(FILE* output, DWORD threadId) {
+    const SystemInfo& info = systemInfo();
+    std::string text;
+
+    appendBuildInfo(text, "\n");
+    appendBuildInfo(text, "================================================================================\n");
+    appendBuildInfo(text, "                        rippled-windows-debug v%s\n", RIPPLED_DEBUG_VERSION_STRING);
+    appendBuildInfo(text, "================================================================================\n");
+    appendBuildInfo(text, "\n");
 
     // Toolkit info
-    fprintf(output, "--- Toolkit ---\n");
-    fprintf(output, "Version:          %d.%d.%d\n",
+    appendBuildInfo(text, "--- Toolkit ---\n");
+    appendBuildInfo(text, "Version:          %d.%d.%d\n",
         RIPPLED_DEBUG_VERSION_MAJOR, RIPPLED_DEBUG_VERSION_MINOR, RIPPLED_DEBUG_VERSION_PATCH);
-    fprintf(output, "Repository:       https://github.com/mcp-tool-shop-org/rippled-windows-debug\n");
-    fprintf(output, "\n");
+    appendBuildInfo(text, "Repository:       https://github.com/mcp-tool-shop-org/rippled-windows-debug\n");
+    appendBuildInfo(text, "\n");
 
     // Git info
-    fprintf(output, "--- Git (at build time) ---\n");
-    fprintf(output, "Commit:           %s%s\n", GIT_COMMIT_HASH, GIT_DIRTY ? " (dirty)" : "");
-    fprintf(output, "Branch:           %s\n", GIT_BRANCH);
-    fprintf(output, "Describe:         %s\n", GIT_DESCRIBE);
-    fprintf(output, "Commit Date:      %s\n", GIT_COMMIT_DATE);
-    fprintf(output, "\n");
+    appendBuildInfo(text, "--- Git (at build time) ---\n");
+    appendBuildInfo(text, "Commit:           %s%s\n", GIT_COMMIT_HASH, GIT_DIRTY ? " (dirty)" : "");
+    appendBuildInfo(text, "Branch:           %s\n", GIT_BRANCH);
+    appendBuildInfo(text, "Describe:         %s\n", GIT_DESCRIBE);
+    appendBuildInfo(text, "Commit Date:      %s\n", GIT_COMMIT_DATE);
+    appendBuildInfo(text, "\n");
 
     // Build info
-    fprintf(output, "--- Build ---\n");
-    fprintf(output, "Date:             %s %s\n", BUILD_DATE, BUILD_TIME);
-    fprintf(output, "Compiler:         %s %s\n", COMPILER_NAME, COMPILER_VERSION_STRING);
-    fprintf(output, "Architecture:     %s\n", BUILD_ARCH);
-    fprintf(output, "Configuration:    %s\n", BUILD_CONFIG);
-    fprintf(output, "Process:          %s%s\n", getProcessBitness(), isWow64() ? " (WoW64)" : "");
-    fprintf(output, "\n");
+    appendBuildInfo(text, "--- Build ---\n");
+    appendBuildInfo(text, "Date:             %s %s\n", BUILD_DATE, BUILD_TIME);
+    appendBuildInfo(text, "Compiler:         %s %s\n", COMPILER_NAME, COMPILER_VERSION_STRING);
+    appendBuildInfo(text, "Architecture:     %s\n", BUILD_ARCH);
+    appendBuildInfo(text, "Configuration:    %s\n", BUILD_CONFIG);
+    appendBuildInfo(text, "Process:          %s%s\n", getProcessBitness(), info.wow64 ? " (WoW64)" : "");
+    appendBuildInfo(text, "\n");
 
     // Windows info
-    fprintf(output, "--- Windows ---\n");
-    fprintf(output, "Version:          %s\n", getWindowsVersion().c_str());
-    fprintf(output, "Edition:          %s\n", getWindowsBuildDetails().c_str());
-    fprintf(output, "\n");
-
-    // Hardware info
-    int physCores, logCores;
-    getCpuCores(physCores, logCores);
+    appendBuildInfo(text, "--- Windows ---\n");
+    appendBuildInfo(text, "Version:          %s\n", info.windowsVersion);
+    appendBuildInfo(text, "Edition:          %s\n", info.windowsBuild);
+    appendBuildInfo(text, "\n");
+
+    // Hardware info (available memory is current, not cached)
     double totalMem, availMem;
     getSystemMemory(totalMem, availMem);
 
-    fprintf(output, "--- Hardware ---\n");
-    fprintf(output, "Computer:         %s\n", getComputerName().c_str());
-    fprintf(output, "CPU:              %s\n", getCpuInfo().c_str());
-    fprintf(output, "Cores:            %d physical, %d logical\n", physCores, logCores);
-    fprintf(output, "Memory:           %.1f GB total, %.1f GB available\n", totalMem, availMem);
-    fprintf(output, "\n");
+    appendBuildInfo(text, "--- Hardware ---\n");
+    appendBuildInfo(text, "Computer:         %s\n", info.computerName);
+    appendBuildInfo(text, "CPU:              %s\n", info.cpu);
+    appendBuildInfo(text, "Cores:            %d physical, %d logical\n", info.physicalCores, info.logicalCores);
+    appendBuildInfo(text, "Memory:           %.1f GB total, %.1f GB available\n", totalMem, availMem);
+    appendBuildInfo(text, "\n");
 
     // Runtime info
-    fprintf(output, "--- Runtime ---\n");
-    fprintf(output, "User:             %s%s\n", getUserName().c_str(), isRunningAsAdmin() ? " (Administrator)" : "");
-    fprintf(output, "Process ID:       %lu\n", GetCurrentProcessId());
-    fprintf(output, "Thread ID:        %lu\n", GetCurrentThreadId());
-    fprintf(output, "\n");
+    appendBuildInfo(text, "--- Runtime ---\n");
+    appendBuildInfo(text, "User:             %s%s\n", info.userName, info.admin ? " (Administrator)" : "");
+    appendBuildInfo(text, "Process ID:       %lu\n", GetCurrentProcessId());
+    appendBuildInfo(text, "Thread ID:        %lu\n", threadId);
+    appendBuildInfo(text, "\n");
 
-    fprintf(output, "================================================================================\n");
-    fprintf(output, "\n");
+    appendBuildInfo(text, "================================================================================\n");
+    appendBuildInfo(text, "\n");
 
+    fwrite(text.data(), 1, text.size(), output);
     fflush(output);
 }
 
+/**
+ * Print all build information.
+ */
+inline void printBuildInfo(FILE* output = stderr) {
+    printBuildInfoFor(output, GetCurrentThreadId());
+}
+
 /**
  * Print compact single-line version info.
  */
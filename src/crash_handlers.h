@@ -5,14 +5,21 @@
  * Single-header crash handler that captures:
  * - Actual exception type and message (not just STATUS_STACK_BUFFER_OVERRUN)
  * - Full stack trace with symbol resolution
+ * - Every other thread's stack, deduplicated (also as an on-demand stall report)
+ * - The flight recorder's last log records, when enabled (debug_log.h)
  * - System context (memory, CPU, process info)
  * - Signal information
  *
+ * The report is formatted into a static buffer and written with WriteFile,
+ * without the heap, CRT formatting or iostream locks, so it still comes
+ * out after bad_alloc or heap corruption.
+ *
  * Usage:
  *   #include "crash_handlers.h"
  *   int main() {
  *       installVerboseCrashHandlers();
  *       // ... your code ...
+ *       printStallReport("ledger close took 30s");  // all threads, on demand
  *   }
  *
  * Developed for XRPLF/rippled Windows debugging.
@@ -28,13 +35,16 @@
 #include <dbghelp.h>
 #include <psapi.h>
 #include <intrin.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
 #include <csignal>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <exception>
 #include <typeinfo>
 #include <ctime>
-#include <iomanip>
-#include <sstream>
 
 #pragma comment(lib, "dbghelp.lib")
 #pragma comment(lib, "psapi.lib")
@@ -42,48 +52,334 @@
 // Include build info for version strings (if available)
 #include "build_info.h"
 
+// Async log queue must be drained before the report is written
+#include "debug_log.h"
+
 namespace rippled_debug {
 
 // ============================================================================
-// System Information Gathering
+// Crash Report Writer
 // ============================================================================
+//
+// The report is written at the worst moment: after bad_alloc, with the heap
+// corrupt, or with another thread holding the CRT or iostream locks. So it
+// is built in a static buffer by a small printf subset of our own - no CRT
+// formatting, no heap, no locks - and written with WriteFile to the stderr
+// handle captured at install time. System information (Windows version,
+// registry, CPU brand) comes from the SystemInfo captured in the background
+// at install time (build_info.h) and is only read at crash time.
+
+constexpr size_t kCrashReportBufferSize = 64 * 1024;
+constexpr DWORD kCrashReportWaitMs = 5000;      // A second crashing thread waits this long
+
+// Digits of value in base 10 or 16; out needs 21 bytes
+inline size_t formatReportNumber(uint64_t value, unsigned base, bool upper, char* out) {
+    const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char reversed[24];
+    size_t len = 0;
+    do {
+        reversed[len++] = digits[value % base];
+        value /= base;
+    } while (value);
+    for (size_t i = 0; i < len; i++) out[i] = reversed[len - 1 - i];
+    out[len] = '\0';
+    return len;
+}
 
 /**
- * Get current timestamp as string.
+ * Fixed buffer with a printf subset: %d %i %u %x %X %c %s %p %%, the '-'
+ * and '0' flags, a width, and the l / ll / z / I64 length modifiers.
+ * With an output handle a full buffer is written out and reused; without
+ * one, text past the capacity is dropped.
  */
-inline std::string getCrashTimestamp() {
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    localtime_s(&timeinfo, &now);
+struct ReportBuffer {
+    char* data;
+    size_t capacity;
+    size_t length = 0;
+    HANDLE output = nullptr;
+
+    ReportBuffer(char* buffer, size_t size, HANDLE out = nullptr)
+        : data(buffer), capacity(size), output(out) {
+        if (capacity) data[0] = '\0';
+    }
+
+    bool hasOutput() const {
+        return output && output != INVALID_HANDLE_VALUE;
+    }
+
+    // Write everything buffered with WriteFile; a failed write drops it
+    void flush() {
+        if (!hasOutput()) return;
+        size_t done = 0;
+        while (done < length) {
+            DWORD written = 0;
+            if (!WriteFile(output, data + done, (DWORD)(length - done), &written, NULL) || written == 0) {
+                break;
+            }
+            done += written;
+        }
+        length = 0;
+        data[0] = '\0';
+    }
+
+    void append(const char* str, size_t len) {
+        while (len > 0) {
+            if (length + 1 >= capacity) {
+                if (!hasOutput()) break;
+                flush();
+            }
+            size_t room = capacity - 1 - length;
+            size_t take = len < room ? len : room;
+            memcpy(data + length, str, take);
+            length += take;
+            str += take;
+            len -= take;
+        }
+        if (capacity) data[length] = '\0';
+    }
+
+    void append(const char* str) {
+        append(str, strlen(str));
+    }
+
+    void repeat(char c, size_t count) {
+        for (size_t i = 0; i < count; i++) append(&c, 1);
+    }
+
+    void appendv(const char* fmt, va_list args);
+
+    void appendf(const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        appendv(fmt, args);
+        va_end(args);
+    }
+};
+
+inline void ReportBuffer::appendv(const char* fmt, va_list args) {
+    const char* p = fmt;
+    while (*p) {
+        if (*p != '%') {
+            const char* run = p;
+            while (*p && *p != '%') p++;
+            append(run, (size_t)(p - run));
+            continue;
+        }
+        p++;
 
-    char buffer[64];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
-    return std::string(buffer);
+        bool left = false, zero = false;
+        for (;; p++) {
+            if (*p == '-') left = true;
+            else if (*p == '0') zero = true;
+            else break;
+        }
+        size_t width = 0;
+        while (*p >= '0' && *p <= '9') width = width * 10 + (size_t)(*p++ - '0');
+
+        // Only 64-bit arguments need their own va_arg; int and long are 32 bits on Windows
+        bool wide = false;
+        if (p[0] == 'l' && p[1] == 'l') { wide = true; p += 2; }
+        else if (p[0] == 'l') { wide = sizeof(long) == 8; p++; }
+        else if (p[0] == 'z') { wide = sizeof(size_t) == 8; p++; }
+        else if (p[0] == 'I' && p[1] == '6' && p[2] == '4') { wide = true; p += 3; }
+
+        char number[24];
+        const char* text = number;
+        size_t len = 0;
+        char conversion = *p ? *p++ : '\0';
+        switch (conversion) {
+            case 'd':
+            case 'i': {
+                int64_t value = wide ? va_arg(args, long long) : va_arg(args, int);
+                uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+                if (value < 0) number[len++] = '-';
+                len += formatReportNumber(magnitude, 10, false, number + len);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X': {
+                uint64_t value = wide ? va_arg(args, unsigned long long) : va_arg(args, unsigned int);
+                len = formatReportNumber(value, conversion == 'u' ? 10 : 16, conversion == 'X', number);
+                break;
+            }
+            case 'p':
+                len = formatReportNumber((uint64_t)(uintptr_t)va_arg(args, void*), 16, true, number);
+                zero = true;
+                if (width < sizeof(void*) * 2) width = sizeof(void*) * 2;
+                break;
+            case 'c':
+                number[len++] = (char)va_arg(args, int);
+                break;
+            case 's':
+                text = va_arg(args, const char*);
+                if (!text) text = "(null)";
+                len = strlen(text);
+                zero = false;
+                break;
+            case '%':
+                number[len++] = '%';
+                break;
+            default:
+                number[len++] = '%';
+                if (conversion) number[len++] = conversion;
+                break;
+        }
+
+        size_t pad = width > len ? width - len : 0;
+        if (!left) {
+            if (zero && len && text[0] == '-') {
+                append(text, 1);
+                text++;
+                len--;
+            }
+            repeat(zero ? '0' : ' ', pad);
+        }
+        append(text, len);
+        if (left) repeat(' ', pad);
+    }
+}
+
+struct CrashReportState {
+    char buffer[kCrashReportBufferSize];
+    ReportBuffer out{buffer, sizeof(buffer)};
+    volatile LONG owner = 0;                    // Thread writing a report, 0 = none
+};
+
+inline CrashReportState& crashReportState() {
+    static CrashReportState state;
+    return state;
+}
+
+inline ReportBuffer& crashReport() {
+    return crashReportState().out;
+}
+
+inline void reportf(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    crashReport().appendv(fmt, args);
+    va_end(args);
+}
+
+inline void writeCrashReport(const char* data, size_t length) {
+    crashReport().append(data, length);
 }
 
+/**
+ * Send report text to a different handle (e.g. a file opened at startup).
+ * The default is stderr, captured by installVerboseCrashHandlers().
+ */
+inline void setCrashReportOutput(HANDLE output) {
+    crashReport().flush();
+    crashReport().output = output;
+}
+
+/**
+ * Take the report buffer for this thread. A report started inside another
+ * report on the same thread (a crash in the crash handler, abort() from
+ * terminate) continues in place; another thread waits kCrashReportWaitMs
+ * for the first report, then writes anyway.
+ * @return true if the caller now owns the buffer and must pass it to endCrashReport
+ */
+inline bool beginCrashReport() {
+    CrashReportState& state = crashReportState();
+    if (!state.out.output) state.out.output = GetStdHandle(STD_ERROR_HANDLE);
+
+    LONG self = (LONG)GetCurrentThreadId();
+    ULONGLONG deadline = GetTickCount64() + kCrashReportWaitMs;
+    for (;;) {
+        LONG owner = InterlockedCompareExchange(&state.owner, self, 0);
+        if (owner == 0) return true;
+        if (owner == self || GetTickCount64() >= deadline) return false;
+        Sleep(10);
+    }
+}
+
+inline void endCrashReport(bool owned) {
+    CrashReportState& state = crashReportState();
+    state.out.flush();
+    if (owned) InterlockedExchange(&state.owner, 0);
+}
+
+inline void reportTimestamp() {
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    reportf("Timestamp: %04u-%02u-%02u %02u:%02u:%02u\n",
+            st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+}
+
+/**
+ * Undecorate an MSVC type descriptor name (".?AVbad_alloc@std@@" ->
+ * "std::bad_alloc") in place of UnDecorateSymbolName, which allocates.
+ * Only plain class and struct names are handled; templates and anything
+ * else are copied as they are.
+ */
+inline void undecorateTypeName(const char* raw, char* out, size_t size) {
+    ReportBuffer name(out, size);
+    size_t len = strlen(raw);
+    bool plainClass = len > 6 && raw[0] == '.' && raw[1] == '?' && raw[2] == 'A' &&
+                      (raw[3] == 'V' || raw[3] == 'U') && strcmp(raw + len - 2, "@@") == 0 &&
+                      !strpbrk(raw + 4, "?$");
+    if (!plainClass) {
+        name.append(raw);
+        return;
+    }
+
+    // Components are innermost first: "bad_alloc@std@@" -> "std::bad_alloc"
+    const char* body = raw + 4;
+    const char* end = raw + len - 2;
+    while (end > body) {
+        const char* start = end;
+        while (start > body && start[-1] != '@') start--;
+        name.append(start, (size_t)(end - start));
+        if (start == body) break;
+        name.append("::");
+        end = start - 1;
+    }
+}
+
+/**
+ * Readable name of an exception's type without allocating. MSVC's
+ * type_info::name() undecorates into a heap-allocated cache; raw_name() is
+ * the decorated string already in the image.
+ */
+inline void exceptionTypeName(const std::type_info& type, char* out, size_t size) {
+#ifdef _MSC_VER
+    undecorateTypeName(type.raw_name(), out, size);
+#else
+    ReportBuffer(out, size).append(type.name());
+#endif
+}
+
+// ============================================================================
+// System Information Gathering
+// ============================================================================
+
 /**
  * Get process memory usage information.
  */
 inline void printMemoryInfo() {
     PROCESS_MEMORY_COUNTERS_EX pmc;
     if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
-        std::cerr << "\n--- Process Memory ---\n";
-        std::cerr << "Working Set:        " << (pmc.WorkingSetSize / 1024 / 1024) << " MB\n";
-        std::cerr << "Peak Working Set:   " << (pmc.PeakWorkingSetSize / 1024 / 1024) << " MB\n";
-        std::cerr << "Private Bytes:      " << (pmc.PrivateUsage / 1024 / 1024) << " MB\n";
-        std::cerr << "Page Faults:        " << pmc.PageFaultCount << "\n";
+        reportf("\n--- Process Memory ---\n");
+        reportf("Working Set:        %zu MB\n", (size_t)(pmc.WorkingSetSize / 1024 / 1024));
+        reportf("Peak Working Set:   %zu MB\n", (size_t)(pmc.PeakWorkingSetSize / 1024 / 1024));
+        reportf("Private Bytes:      %zu MB\n", (size_t)(pmc.PrivateUsage / 1024 / 1024));
+        reportf("Page Faults:        %lu\n", (unsigned long)pmc.PageFaultCount);
     }
 
     MEMORYSTATUSEX memStatus;
     memStatus.dwLength = sizeof(memStatus);
     if (GlobalMemoryStatusEx(&memStatus)) {
-        std::cerr << "\n--- System Memory ---\n";
-        std::cerr << "Total Physical:     " << (memStatus.ullTotalPhys / 1024 / 1024) << " MB\n";
-        std::cerr << "Available Physical: " << (memStatus.ullAvailPhys / 1024 / 1024) << " MB\n";
-        std::cerr << "Memory Load:        " << memStatus.dwMemoryLoad << "%\n";
-        std::cerr << "Total Virtual:      " << (memStatus.ullTotalVirtual / 1024 / 1024 / 1024) << " GB\n";
-        std::cerr << "Available Virtual:  " << (memStatus.ullAvailVirtual / 1024 / 1024 / 1024) << " GB\n";
+        reportf("\n--- System Memory ---\n");
+        reportf("Total Physical:     %llu MB\n", (unsigned long long)(memStatus.ullTotalPhys / 1024 / 1024));
+        reportf("Available Physical: %llu MB\n", (unsigned long long)(memStatus.ullAvailPhys / 1024 / 1024));
+        reportf("Memory Load:        %lu%%\n", (unsigned long)memStatus.dwMemoryLoad);
+        reportf("Total Virtual:      %llu GB\n", (unsigned long long)(memStatus.ullTotalVirtual / 1024 / 1024 / 1024));
+        reportf("Available Virtual:  %llu GB\n", (unsigned long long)(memStatus.ullAvailVirtual / 1024 / 1024 / 1024));
     }
+    crashReport().flush();
 }
 
 /**
@@ -95,7 +391,7 @@ inline void printModuleInfo() {
 
     if (EnumProcessModules(GetCurrentProcess(), modules, sizeof(modules), &cbNeeded)) {
         int count = cbNeeded / sizeof(HMODULE);
-        std::cerr << "\n--- Loaded Modules (" << count << " total, showing first 10) ---\n";
+        reportf("\n--- Loaded Modules (%d total, showing first 10) ---\n", count);
 
         for (int i = 0; i < count && i < 10; i++) {
             char moduleName[MAX_PATH];
@@ -108,25 +404,26 @@ inline void printModuleInfo() {
 
                 MODULEINFO modInfo;
                 if (GetModuleInformation(GetCurrentProcess(), modules[i], &modInfo, sizeof(modInfo))) {
-                    std::cerr << "  " << std::left << std::setw(30) << filename
-                              << " @ 0x" << std::hex << (uintptr_t)modInfo.lpBaseOfDll << std::dec
-                              << " (" << (modInfo.SizeOfImage / 1024) << " KB)\n";
+                    reportf("  %-30s @ 0x%llx (%lu KB)\n", filename,
+                            (unsigned long long)(uintptr_t)modInfo.lpBaseOfDll,
+                            (unsigned long)(modInfo.SizeOfImage / 1024));
                 }
             }
         }
         if (count > 10) {
-            std::cerr << "  ... and " << (count - 10) << " more modules\n";
+            reportf("  ... and %d more modules\n", count - 10);
         }
     }
+    crashReport().flush();
 }
 
 /**
  * Get thread information.
  */
 inline void printThreadInfo() {
-    std::cerr << "\n--- Thread Info ---\n";
-    std::cerr << "Current Thread ID:  " << GetCurrentThreadId() << "\n";
-    std::cerr << "Process ID:         " << GetCurrentProcessId() << "\n";
+    reportf("\n--- Thread Info ---\n");
+    reportf("Current Thread ID:  %lu\n", (unsigned long)GetCurrentThreadId());
+    reportf("Process ID:         %lu\n", (unsigned long)GetCurrentProcessId());
 
     // Get thread count
     HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
@@ -145,33 +442,226 @@ inline void printThreadInfo() {
             } while (Thread32Next(snapshot, &te));
         }
         CloseHandle(snapshot);
-        std::cerr << "Thread Count:       " << threadCount << "\n";
+        reportf("Thread Count:       %d\n", threadCount);
     }
+    crashReport().flush();
 }
 
+// ============================================================================
+// Symbol Session
+// ============================================================================
+//
+// SymInitialize with invade-process enumerates every module and can take
+// seconds on a large binary with PDBs, which is the worst moment to do it:
+// the heap may be corrupt and the service is waiting to restart. Instead the
+// session is initialized once, on a background thread, when the handlers are
+// installed. Resolved frames are cached in static storage and crash-time
+// lookups only touch preallocated buffers. DbgHelp is single-threaded, so
+// every call into it goes through the session lock.
+
 /**
- * Print stack trace to stderr using DbgHelp.
- * Works best with PDB files available.
+ * How crash-time stack frames are symbolized.
  */
-inline void printStackTrace()
-{
-    std::cerr << "\n========== STACK TRACE ==========\n";
+enum class CrashSymbolization {
+    RESOLVE,    // Function names and lines via DbgHelp (default)
+    RAW         // module+offset only, no DbgHelp; symbolize offline
+};
+
+enum SymbolSessionState {
+    SYMBOLS_NONE,
+    SYMBOLS_LOADING,
+    SYMBOLS_READY,
+    SYMBOLS_FAILED
+};
+
+constexpr int kMaxStackFrames = 64;
+constexpr size_t kSymbolCacheSize = 1024;       // Power of two
+constexpr int kSymbolCacheProbe = 8;
+constexpr DWORD kSymbolWaitMs = 3000;           // Crash path waits this long for a loading session
+constexpr DWORD kSymbolLockWaitMs = 500;        // ...and this long for another thread's lookup
+
+struct SymbolCacheEntry {
+    DWORD64 address;        // 0 = empty slot
+    DWORD line;             // 0 = no line info
+    char name[112];         // Empty = address did not resolve (cached miss)
+    char file[56];
+};
+
+struct SymbolSession {
+    std::atomic<int> state{SYMBOLS_NONE};
+    std::atomic<int> mode{(int)CrashSymbolization::RESOLVE};
+    std::atomic<DWORD> initMs{0};
+    SRWLOCK lock = SRWLOCK_INIT;
+
+    // Everything below is only touched with the lock held
+    SymbolCacheEntry cache[kSymbolCacheSize];
+    DWORD64 symbolStorage[(sizeof(SYMBOL_INFO) + MAX_SYM_NAME) / sizeof(DWORD64) + 1];
+};
+
+inline SymbolSession& symbolSession() {
+    static SymbolSession session;
+    return session;
+}
+
+/**
+ * Select crash-time symbolization. RAW skips DbgHelp entirely and prints
+ * module+offset plus the preferred-base address, for llvm-symbolizer or ln.
+ */
+inline void setCrashSymbolization(CrashSymbolization mode) {
+    symbolSession().mode.store((int)mode, std::memory_order_relaxed);
+}
+
+inline CrashSymbolization crashSymbolization() {
+    return (CrashSymbolization)symbolSession().mode.load(std::memory_order_relaxed);
+}
+
+// Bounded wait so a crash inside DbgHelp (lock already held) falls back to raw frames
+inline bool lockSymbolSession(DWORD timeoutMs) {
+    SymbolSession& session = symbolSession();
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    while (!TryAcquireSRWLockExclusive(&session.lock)) {
+        if (GetTickCount64() >= deadline) return false;
+        Sleep(1);
+    }
+    return true;
+}
+
+inline void unlockSymbolSession() {
+    ReleaseSRWLockExclusive(&symbolSession().lock);
+}
+
+// Lookup (insert=false) or slot to fill (insert=true); caller holds the lock
+inline SymbolCacheEntry* symbolCacheSlot(DWORD64 address, bool insert) {
+    SymbolSession& session = symbolSession();
+    size_t home = (size_t)((address * 0x9E3779B97F4A7C15ull) >> 32) & (kSymbolCacheSize - 1);
+    for (int i = 0; i < kSymbolCacheProbe; i++) {
+        SymbolCacheEntry& entry = session.cache[(home + i) & (kSymbolCacheSize - 1)];
+        if (entry.address == address) return &entry;
+        if (entry.address == 0) return insert ? &entry : nullptr;
+    }
+    // Probe window full: evict the home slot
+    return insert ? &session.cache[home] : nullptr;
+}
+
+/**
+ * Resolve an address through the cache, falling back to DbgHelp.
+ * Caller holds the session lock and the session is ready. Never allocates.
+ */
+inline const SymbolCacheEntry* resolveSymbolLocked(DWORD64 address) {
+    if (SymbolCacheEntry* cached = symbolCacheSlot(address, false)) {
+        return cached;
+    }
+
+    SymbolCacheEntry* entry = symbolCacheSlot(address, true);
+    entry->address = address;
+    entry->line = 0;
+    entry->name[0] = '\0';
+    entry->file[0] = '\0';
 
     HANDLE process = GetCurrentProcess();
-    HANDLE thread = GetCurrentThread();
+    PSYMBOL_INFO symbol = (PSYMBOL_INFO)symbolSession().symbolStorage;
+    memset(symbol, 0, sizeof(SYMBOL_INFO));
+    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+    symbol->MaxNameLen = MAX_SYM_NAME;
 
-    SymSetOptions(SYMOPT_LOAD_LINES | SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
-    if (!SymInitialize(process, NULL, TRUE))
-    {
-        DWORD err = GetLastError();
-        std::cerr << "Failed to initialize symbols. Error: " << err << "\n";
-        std::cerr << "Hint: Ensure PDB files are in the same directory as the executable.\n";
+    DWORD64 displacement64 = 0;
+    if (SymFromAddr(process, address, &displacement64, symbol)) {
+        ReportBuffer(entry->name, sizeof(entry->name)).append(symbol->Name);
+
+        IMAGEHLP_LINE64 line;
+        memset(&line, 0, sizeof(line));
+        line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+        DWORD displacement = 0;
+        if (SymGetLineFromAddr64(process, address, &displacement, &line)) {
+            // Extract just filename from path
+            const char* filename = line.FileName;
+            for (const char* p = line.FileName; *p; ++p) {
+                if (*p == '\\' || *p == '/') filename = p + 1;
+            }
+            ReportBuffer(entry->file, sizeof(entry->file)).append(filename);
+            entry->line = line.LineNumber;
+        }
+    }
+    return entry;
+}
+
+inline DWORD WINAPI symbolInitThreadMain(LPVOID) {
+    SymbolSession& session = symbolSession();
+    ULONGLONG start = GetTickCount64();
+
+    AcquireSRWLockExclusive(&session.lock);
+    HANDLE process = GetCurrentProcess();
+    SymSetOptions(SYMOPT_LOAD_LINES | SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS |
+                  SYMOPT_FAIL_CRITICAL_ERRORS | SYMOPT_NO_PROMPTS);
+    bool ok = SymInitialize(process, NULL, TRUE) != FALSE;
+    if (ok) {
+        // Deferred loading would otherwise read the main PDB at crash time
+        resolveSymbolLocked((DWORD64)(uintptr_t)&symbolInitThreadMain);
+    }
+    session.initMs.store((DWORD)(GetTickCount64() - start), std::memory_order_relaxed);
+    session.state.store(ok ? SYMBOLS_READY : SYMBOLS_FAILED, std::memory_order_release);
+    ReleaseSRWLockExclusive(&session.lock);
+    return 0;
+}
+
+/**
+ * Initialize the DbgHelp session once. With background=true this returns
+ * immediately and the work runs on a low-priority thread.
+ */
+inline void startSymbolInitialization(bool background = true) {
+    SymbolSession& session = symbolSession();
+    int expected = SYMBOLS_NONE;
+    if (!session.state.compare_exchange_strong(expected, SYMBOLS_LOADING)) {
         return;
     }
 
-    CONTEXT context;
-    RtlCaptureContext(&context);
+    HANDLE thread = background
+        ? CreateThread(nullptr, 0, symbolInitThreadMain, nullptr, 0, nullptr)
+        : nullptr;
+    if (thread) {
+        SetThreadPriority(thread, THREAD_PRIORITY_BELOW_NORMAL);
+        CloseHandle(thread);
+    } else {
+        symbolInitThreadMain(nullptr);
+    }
+}
+
+/**
+ * Wait for a background initialization to finish.
+ * @return true if the session is ready for lookups
+ */
+inline bool waitForSymbols(DWORD timeoutMs) {
+    SymbolSession& session = symbolSession();
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    while (session.state.load(std::memory_order_acquire) == SYMBOLS_LOADING &&
+           GetTickCount64() < deadline) {
+        Sleep(5);
+    }
+    return session.state.load(std::memory_order_acquire) == SYMBOLS_READY;
+}
 
+/**
+ * Resolve an address outside the crash path (copies the cached entry).
+ * @return false if the session is not ready or the address has no symbol
+ */
+inline bool resolveSymbol(DWORD64 address, SymbolCacheEntry& out) {
+    if (symbolSession().state.load(std::memory_order_acquire) != SYMBOLS_READY) return false;
+    AcquireSRWLockExclusive(&symbolSession().lock);
+    out = *resolveSymbolLocked(address);
+    unlockSymbolSession();
+    return out.name[0] != '\0';
+}
+
+// ============================================================================
+// Stack Walking
+// ============================================================================
+
+/**
+ * Walk a stack from a captured context with StackWalk64.
+ * Caller holds the session lock (DbgHelp function table access).
+ * @return number of frames written
+ */
+inline int walkStackLocked(HANDLE thread, CONTEXT& context, DWORD64* frames, int maxFrames) {
     STACKFRAME64 stackFrame;
     memset(&stackFrame, 0, sizeof(stackFrame));
 
@@ -203,148 +693,880 @@ inline void printStackTrace()
     #error "Unsupported architecture"
 #endif
 
-    char symbolBuffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(TCHAR)];
-    PSYMBOL_INFO symbol = (PSYMBOL_INFO)symbolBuffer;
-    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
-    symbol->MaxNameLen = MAX_SYM_NAME;
-
-    IMAGEHLP_LINE64 line;
-    line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
-
-    int frameNum = 0;
-    bool hasSymbols = false;
-
-    while (StackWalk64(
+    int count = 0;
+    while (count < maxFrames && StackWalk64(
         machineType,
-        process,
+        GetCurrentProcess(),
         thread,
         &stackFrame,
         &context,
         NULL,
         SymFunctionTableAccess64,
         SymGetModuleBase64,
-        NULL) && frameNum < 50)
+        NULL))
     {
-        DWORD64 address = stackFrame.AddrPC.Offset;
-        DWORD64 displacement64 = 0;
-        DWORD displacement = 0;
+        if (stackFrame.AddrPC.Offset == 0) break;
+        frames[count++] = stackFrame.AddrPC.Offset;
+    }
+    return count;
+}
 
-        std::cerr << "[" << std::setw(2) << frameNum << "] 0x"
-                  << std::hex << std::setw(16) << std::setfill('0') << address
-                  << std::dec << std::setfill(' ') << " ";
+/**
+ * Module-relative location of an address without DbgHelp.
+ * preferredVa is the address at the image's link-time base, which is what
+ * llvm-symbolizer --obj=<module> expects.
+ */
+inline bool describeModuleAddress(DWORD64 address, char* moduleName, size_t nameLen,
+                                  DWORD64& offset, DWORD64& preferredVa) {
+    HMODULE module = nullptr;
+    if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                            GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                            (LPCSTR)(uintptr_t)address, &module)) {
+        return false;
+    }
 
-        if (SymFromAddr(process, address, &displacement64, symbol))
-        {
-            hasSymbols = true;
-            std::cerr << symbol->Name;
-
-            if (SymGetLineFromAddr64(process, address, &displacement, &line))
-            {
-                // Extract just filename from path
-                const char* filename = line.FileName;
-                for (const char* p = line.FileName; *p; ++p) {
-                    if (*p == '\\' || *p == '/') filename = p + 1;
-                }
-                std::cerr << " (" << filename << ":" << line.LineNumber << ")";
+    char path[MAX_PATH];
+    DWORD len = GetModuleFileNameA(module, path, sizeof(path));
+    const char* filename = len ? path : "?";
+    if (len) {
+        path[len < sizeof(path) ? len : sizeof(path) - 1] = '\0';
+        for (const char* p = path; *p; ++p) {
+            if (*p == '\\' || *p == '/') filename = p + 1;
+        }
+    }
+    ReportBuffer(moduleName, nameLen).append(filename);
+
+    offset = address - (DWORD64)(uintptr_t)module;
+    preferredVa = offset;
+    const IMAGE_DOS_HEADER* dos = (const IMAGE_DOS_HEADER*)module;
+    if (dos->e_magic == IMAGE_DOS_SIGNATURE) {
+        const IMAGE_NT_HEADERS* nt = (const IMAGE_NT_HEADERS*)((const BYTE*)module + dos->e_lfanew);
+        if (nt->Signature == IMAGE_NT_SIGNATURE) {
+            preferredVa = nt->OptionalHeader.ImageBase + offset;
+        }
+    }
+    return true;
+}
+
+/**
+ * Print one frame. sym may be null (raw mode / session unavailable).
+ * @return true if the frame resolved to a symbol
+ */
+inline bool printStackFrame(int index, DWORD64 address, const SymbolCacheEntry* sym) {
+    reportf("[%2d] 0x%016llx ", index, (unsigned long long)address);
+
+    bool resolved = sym && sym->name[0];
+    if (resolved) {
+        if (sym->line) {
+            reportf("%s (%s:%lu)\n", sym->name, sym->file, (unsigned long)sym->line);
+        } else {
+            reportf("%s\n", sym->name);
+        }
+    } else {
+        char module[64];
+        DWORD64 offset = 0, preferredVa = 0;
+        if (describeModuleAddress(address, module, sizeof(module), offset, preferredVa)) {
+            reportf("<%s+0x%llx> (va 0x%llx)\n",
+                module, (unsigned long long)offset, (unsigned long long)preferredVa);
+        } else {
+            reportf("<unknown>\n");
+        }
+    }
+    return resolved;
+}
+
+/**
+ * Print stack trace to the crash report using DbgHelp.
+ * Works best with PDB files available.
+ *
+ * Uses the pre-initialized session from installVerboseCrashHandlers();
+ * if it is unavailable, or CrashSymbolization::RAW is set, frames are
+ * captured with RtlCaptureStackBackTrace and printed as module+offset.
+ */
+inline void printStackTrace()
+{
+    reportf("\n========== STACK TRACE ==========\n");
+
+    bool resolve = crashSymbolization() == CrashSymbolization::RESOLVE;
+    bool locked = false;
+
+    if (resolve) {
+        // Handlers installed without the background session: do it now
+        startSymbolInitialization(false);
+        if (waitForSymbols(kSymbolWaitMs)) {
+            locked = lockSymbolSession(kSymbolLockWaitMs);
+        }
+        if (!locked) {
+            reportf("[!] Symbol session unavailable; printing raw frames.\n");
+        }
+    }
+
+    DWORD64 frames[kMaxStackFrames];
+    int frameCount = 0;
+
+    if (locked) {
+        CONTEXT context;
+        RtlCaptureContext(&context);
+        frameCount = walkStackLocked(GetCurrentThread(), context, frames, 50);
+    } else {
+        void* addresses[kMaxStackFrames];
+        frameCount = RtlCaptureStackBackTrace(0, 50, addresses, nullptr);
+        for (int i = 0; i < frameCount; i++) {
+            frames[i] = (DWORD64)(uintptr_t)addresses[i];
+        }
+    }
+
+    bool hasSymbols = false;
+    for (int i = 0; i < frameCount; i++) {
+        const SymbolCacheEntry* sym = locked ? resolveSymbolLocked(frames[i]) : nullptr;
+        hasSymbols |= printStackFrame(i, frames[i], sym);
+    }
+    if (locked) {
+        unlockSymbolSession();
+    }
+
+    if (!resolve) {
+        reportf("\n[i] Raw frames. Symbolize offline with the matching PDB:\n");
+        reportf("    llvm-symbolizer --obj=rippled.exe <va>   or   WinDbg: ln rippled+<offset>\n");
+    } else if (!hasSymbols) {
+        reportf("\n[!] No symbols resolved. For better stack traces:\n");
+        reportf("    1. Build with /Zi (debug info)\n");
+        reportf("    2. Keep PDB files with the executable\n");
+        reportf("    3. Use RelWithDebInfo build type\n");
+    }
+
+    reportf("========== END STACK TRACE (%d frames) ==========\n", frameCount);
+    crashReport().flush();
+}
+
+// ============================================================================
+// All-Thread Stacks
+// ============================================================================
+//
+// For deadlocks and stalls the interesting stacks are the other threads'.
+// Each thread is suspended only long enough to copy its context and the top
+// of its stack with a plain memcpy - no calls that take a lock the thread
+// might hold (heap, loader, function tables) - and is resumed before
+// anything else happens. The copy is then unwound from the image's unwind
+// tables, with stack pointers remapped into it. Symbols are resolved
+// afterwards, once per unique stack. Stacks, copies and the grouping live in
+// static storage, so none of this touches the heap. The stall report
+// spreads capture over a few workers; the crash path captures on the
+// crashing thread alone rather than start new threads.
+
+constexpr int kMaxCaptureWorkers = 4;
+constexpr int kThreadsPerCaptureWorker = 16;
+constexpr int kMaxListedThreadIds = 12;
+constexpr size_t kMaxReportedThreads = 512;
+
+// Bytes of each stack copied from the stack pointer up; frames deeper than
+// this are dropped. The zeroed slack past the copy stops an unwind that
+// runs off its end with a null return address.
+constexpr size_t kStackCopyBytes = 128 * 1024;
+constexpr size_t kStackCopySlack = 16 * 1024;
+
+struct ThreadStack {
+    DWORD threadId;
+    int frameCount;                 // 0 = could not be captured
+    DWORD64 frames[kMaxStackFrames];
+};
+
+// One stack copy per capture worker
+struct StackCopyBuffers {
+    alignas(16) uint8_t bytes[kMaxCaptureWorkers][kStackCopyBytes + kStackCopySlack];
+};
+
+inline StackCopyBuffers& stackCopyBuffers() {
+    static StackCopyBuffers buffers;
+    return buffers;
+}
+
+// A stack copied while its thread was suspended
+struct StackCopy {
+    uint8_t* buffer;        // Copy of [base, base + size)
+    DWORD64 base;           // Original address of buffer[0]
+    size_t size;
+};
+
+inline DWORD64 remapToCopy(const StackCopy& copy, DWORD64 value) {
+    return (value >= copy.base && value - copy.base < copy.size)
+        ? (DWORD64)(uintptr_t)copy.buffer + (value - copy.base)
+        : value;
+}
+
+/**
+ * Point the context and every saved frame pointer on the copied stack at
+ * the copy instead of the live stack, so unwinding reads only the copy.
+ */
+inline void remapContextToCopy(const StackCopy& copy, CONTEXT& context) {
+    DWORD64* slots = (DWORD64*)copy.buffer;
+    for (size_t i = 0; i < copy.size / sizeof(DWORD64); i++) {
+        slots[i] = remapToCopy(copy, slots[i]);
+    }
+#if defined(_M_X64)
+    DWORD64* registers[] = {
+        &context.Rax, &context.Rcx, &context.Rdx, &context.Rbx, &context.Rsp,
+        &context.Rbp, &context.Rsi, &context.Rdi, &context.R8, &context.R9,
+        &context.R10, &context.R11, &context.R12, &context.R13, &context.R14,
+        &context.R15};
+    for (DWORD64* reg : registers) *reg = remapToCopy(copy, *reg);
+#elif defined(_M_ARM64)
+    for (DWORD64& reg : context.X) reg = remapToCopy(copy, reg);
+    context.Sp = remapToCopy(copy, context.Sp);
+#endif
+}
+
+/**
+ * Unwind a copied stack with RtlVirtualUnwind. Runs with the thread
+ * resumed: RtlLookupFunctionEntry may take the function table lock, and
+ * all stack reads stay inside the copy (the walk stops at its end).
+ * @return number of frames written
+ */
+inline int unwindStackCopy(const StackCopy& copy, CONTEXT& context, DWORD64* frames, int maxFrames) {
+#if defined(_M_X64) || defined(_M_ARM64)
+    const DWORD64 copyStart = (DWORD64)(uintptr_t)copy.buffer;
+    const DWORD64 copyEnd = copyStart + copy.size;
+    int count = 0;
+    while (count < maxFrames) {
+#ifdef _M_X64
+        DWORD64 pc = context.Rip;
+        DWORD64 sp = context.Rsp;
+#else
+        DWORD64 pc = context.Pc;
+        DWORD64 sp = context.Sp;
+#endif
+        if (pc == 0) break;
+        frames[count++] = pc;
+        if (sp < copyStart || sp >= copyEnd) break;
+
+        DWORD64 imageBase = 0;
+        PRUNTIME_FUNCTION function = RtlLookupFunctionEntry(pc, &imageBase, NULL);
+        if (!function) {
+            // Leaf function: the return address is on top of the stack / in LR
+#ifdef _M_X64
+            if (copyEnd - sp < sizeof(DWORD64)) break;
+            memcpy(&context.Rip, (const void*)(uintptr_t)sp, sizeof(DWORD64));
+            context.Rsp += sizeof(DWORD64);
+#else
+            if (context.Lr == pc) break;
+            context.Pc = context.Lr;
+#endif
+            continue;
+        }
+
+        PVOID handlerData = NULL;
+        DWORD64 establisherFrame = 0;
+        RtlVirtualUnwind(UNW_FLAG_NHANDLER, imageBase, pc, function, &context,
+                         &handlerData, &establisherFrame, NULL);
+    }
+    return count;
+#else
+    // No unwind tables on x86: report where the thread is
+    (void)copy;
+    if (maxFrames < 1) return 0;
+    frames[0] = context.Eip;
+    return 1;
+#endif
+}
+
+/**
+ * Suspend, copy the context and the top of the stack, resume, then unwind
+ * the copy. While the thread is suspended only GetThreadContext,
+ * VirtualQuery (a system call) and memcpy run.
+ * @param buffer kStackCopyBytes + kStackCopySlack bytes owned by the caller
+ */
+inline void captureThreadStack(ThreadStack& stack, uint8_t* buffer) {
+    stack.frameCount = 0;
+    HANDLE thread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT |
+                               THREAD_QUERY_INFORMATION, FALSE, stack.threadId);
+    if (!thread) return;
+
+    CONTEXT context;
+    memset(&context, 0, sizeof(context));
+    context.ContextFlags = CONTEXT_FULL;
+    StackCopy copy = {buffer, 0, 0};
+    bool captured = false;
+
+    if (SuspendThread(thread) != (DWORD)-1) {
+        if (GetThreadContext(thread, &context)) {
+            captured = true;
+#if defined(_M_X64)
+            DWORD64 sp = context.Rsp;
+#elif defined(_M_ARM64)
+            DWORD64 sp = context.Sp;
+#else
+            DWORD64 sp = 0;
+#endif
+            // The committed stack above the stack pointer is one region.
+            // Start 16-byte aligned (same page) so the copy keeps alignment.
+            MEMORY_BASIC_INFORMATION mbi;
+            if (sp && VirtualQuery((LPCVOID)(uintptr_t)sp, &mbi, sizeof(mbi)) &&
+                mbi.State == MEM_COMMIT) {
+                copy.base = sp & ~(DWORD64)15;
+                DWORD64 top = (DWORD64)(uintptr_t)mbi.BaseAddress + mbi.RegionSize;
+                copy.size = (size_t)(std::min)(top - copy.base, (DWORD64)kStackCopyBytes);
+                memcpy(buffer, (const void*)(uintptr_t)copy.base, copy.size);
             }
         }
-        else
-        {
-            // Try to get module name at least
-            DWORD64 moduleBase = SymGetModuleBase64(process, address);
-            if (moduleBase) {
-                char moduleName[MAX_PATH];
-                if (GetModuleFileNameA((HMODULE)moduleBase, moduleName, sizeof(moduleName))) {
-                    const char* filename = moduleName;
-                    for (const char* p = moduleName; *p; ++p) {
-                        if (*p == '\\' || *p == '/') filename = p + 1;
-                    }
-                    std::cerr << "<" << filename << "+0x" << std::hex
-                              << (address - moduleBase) << std::dec << ">";
-                } else {
-                    std::cerr << "<unknown>";
+        ResumeThread(thread);
+    }
+    CloseHandle(thread);
+
+    if (!captured) return;
+    memset(buffer + copy.size, 0, kStackCopySlack);
+    remapContextToCopy(copy, context);
+    stack.frameCount = unwindStackCopy(copy, context, stack.frames, kMaxStackFrames);
+}
+
+struct StackCaptureJob {
+    ThreadStack* stacks;
+    LONG count;
+    volatile LONG next;
+    volatile LONG workers;          // Hands out stack copy buffers
+};
+
+inline DWORD WINAPI stackCaptureWorker(LPVOID param) {
+    StackCaptureJob* job = (StackCaptureJob*)param;
+    LONG worker = InterlockedIncrement(&job->workers) - 1;
+    uint8_t* buffer = stackCopyBuffers().bytes[worker];
+    for (;;) {
+        LONG index = InterlockedIncrement(&job->next) - 1;
+        if (index >= job->count) break;
+        captureThreadStack(job->stacks[index], buffer);
+    }
+    return 0;
+}
+
+struct ThreadStackReport {
+    ThreadStack stacks[kMaxReportedThreads];
+    size_t count;
+    size_t omitted;                             // Threads past kMaxReportedThreads
+
+    // Grouping, filled by printThreadStacks()
+    uint32_t groupOf[kMaxReportedThreads];      // Stack -> group
+    uint32_t groupFirst[kMaxReportedThreads];   // Group -> its first stack
+    uint32_t groupSize[kMaxReportedThreads];
+    uint32_t order[kMaxReportedThreads];        // Groups, largest first
+    size_t groupCount;
+};
+
+inline ThreadStackReport& threadStackReport() {
+    static ThreadStackReport report;
+    return report;
+}
+
+/**
+ * Capture the stack of every thread in the process except the caller.
+ * @param workers Threads to spread the capture over (1 = caller only)
+ */
+inline void captureAllThreadStacks(ThreadStackReport& report, int workers = 1) {
+    report.count = 0;
+    report.omitted = 0;
+
+    DWORD pid = GetCurrentProcessId();
+    DWORD self = GetCurrentThreadId();
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) return;
+
+    THREADENTRY32 te;
+    te.dwSize = sizeof(te);
+    if (Thread32First(snapshot, &te)) {
+        do {
+            if (te.th32OwnerProcessID == pid && te.th32ThreadID != self) {
+                if (report.count == kMaxReportedThreads) {
+                    report.omitted++;
+                    continue;
                 }
-            } else {
-                std::cerr << "<unknown>";
+                ThreadStack& stack = report.stacks[report.count++];
+                stack.threadId = te.th32ThreadID;
+                stack.frameCount = 0;
             }
+        } while (Thread32Next(snapshot, &te));
+    }
+    CloseHandle(snapshot);
+
+    StackCaptureJob job;
+    job.stacks = report.stacks;
+    job.count = (LONG)report.count;
+    job.next = 0;
+    job.workers = 0;
+
+    workers = (std::min)(workers, (std::min)(kMaxCaptureWorkers, (int)job.count / kThreadsPerCaptureWorker + 1));
+    HANDLE helpers[kMaxCaptureWorkers];
+    int started = 0;
+    for (int i = 1; i < workers; i++) {
+        HANDLE helper = CreateThread(NULL, 0, stackCaptureWorker, &job, 0, NULL);
+        if (helper) helpers[started++] = helper;
+    }
+
+    stackCaptureWorker(&job);
+
+    if (started) {
+        WaitForMultipleObjects((DWORD)started, helpers, TRUE, INFINITE);
+        for (int i = 0; i < started; i++) CloseHandle(helpers[i]);
+    }
+}
+
+// Is this address inside the executable (as opposed to ntdll, the CRT, ...)?
+inline bool isMainModuleAddress(DWORD64 address) {
+    HMODULE module = nullptr;
+    return GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                              GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                              (LPCSTR)(uintptr_t)address, &module) &&
+           module == GetModuleHandleA(NULL);
+}
+
+/**
+ * One-line description of where a stack is: the innermost frame in the
+ * executable (past the wait / lock frames in system DLLs), else frame 0.
+ * Caller holds the session lock if locked is true.
+ */
+inline void describeStack(const ThreadStack& stack, bool locked, char* out, size_t size) {
+    if (stack.frameCount == 0) {
+        ReportBuffer(out, size).append("<stack not captured>");
+        return;
+    }
+
+    int chosen = 0;
+    for (int i = 0; i < stack.frameCount; i++) {
+        if (isMainModuleAddress(stack.frames[i])) {
+            chosen = i;
+            break;
         }
+    }
 
-        std::cerr << "\n";
-        frameNum++;
+    ReportBuffer text(out, size);
+    const SymbolCacheEntry* sym = locked ? resolveSymbolLocked(stack.frames[chosen]) : nullptr;
+    if (sym && sym->name[0]) {
+        text.append(sym->name);
+        return;
     }
 
-    if (!hasSymbols) {
-        std::cerr << "\n[!] No symbols resolved. For better stack traces:\n";
-        std::cerr << "    1. Build with /Zi (debug info)\n";
-        std::cerr << "    2. Keep PDB files with the executable\n";
-        std::cerr << "    3. Use RelWithDebInfo build type\n";
+    char module[64];
+    DWORD64 offset = 0, preferredVa = 0;
+    if (describeModuleAddress(stack.frames[chosen], module, sizeof(module), offset, preferredVa)) {
+        text.appendf("%s+0x%llx", module, (unsigned long long)offset);
+    } else {
+        text.appendf("0x%016llx", (unsigned long long)stack.frames[chosen]);
     }
+}
 
-    std::cerr << "========== END STACK TRACE (" << frameNum << " frames) ==========\n";
-    SymCleanup(process);
+// Group identical stacks; order[] lists groups largest first, ties in capture order
+inline void groupThreadStacks(ThreadStackReport& report) {
+    report.groupCount = 0;
+    for (size_t i = 0; i < report.count; i++) {
+        const ThreadStack& stack = report.stacks[i];
+        size_t group = 0;
+        for (; group < report.groupCount; group++) {
+            const ThreadStack& other = report.stacks[report.groupFirst[group]];
+            if (other.frameCount == stack.frameCount &&
+                memcmp(other.frames, stack.frames, stack.frameCount * sizeof(DWORD64)) == 0) {
+                break;
+            }
+        }
+        if (group == report.groupCount) {
+            report.groupFirst[group] = (uint32_t)i;
+            report.groupSize[group] = 0;
+            report.groupCount++;
+        }
+        report.groupOf[i] = (uint32_t)group;
+        report.groupSize[group]++;
+    }
+
+    for (size_t i = 0; i < report.groupCount; i++) {
+        uint32_t group = (uint32_t)i;
+        size_t j = i;
+        while (j > 0 && report.groupSize[report.order[j - 1]] < report.groupSize[group]) {
+            report.order[j] = report.order[j - 1];
+            j--;
+        }
+        report.order[j] = group;
+    }
+}
+
+/**
+ * Print captured stacks grouped by identical frames, largest group first.
+ */
+inline void printThreadStacks(ThreadStackReport& report) {
+    groupThreadStacks(report);
+
+    reportf("\n========== ALL THREADS (%zu threads, %zu unique stacks) ==========\n",
+            report.count, report.groupCount);
+    if (report.omitted) {
+        reportf("[!] %zu more threads not captured (limit %zu)\n", report.omitted, kMaxReportedThreads);
+    }
+
+    bool locked = false;
+    if (crashSymbolization() == CrashSymbolization::RESOLVE) {
+        startSymbolInitialization(false);
+        locked = waitForSymbols(kSymbolWaitMs) && lockSymbolSession(kSymbolLockWaitMs);
+        if (!locked) {
+            reportf("[!] Symbol session unavailable; printing raw frames.\n");
+        }
+    }
+
+    for (size_t g = 0; g < report.groupCount; g++) {
+        uint32_t group = report.order[g];
+        uint32_t size = report.groupSize[group];
+        const ThreadStack& stack = report.stacks[report.groupFirst[group]];
+
+        char where[160];
+        describeStack(stack, locked, where, sizeof(where));
+        reportf("\n--- %u thread%s in %s ---\n", size, size == 1 ? "" : "s", where);
+
+        reportf("Thread IDs:");
+        uint32_t listed = 0;
+        for (size_t i = report.groupFirst[group]; i < report.count && listed < (uint32_t)kMaxListedThreadIds; i++) {
+            if (report.groupOf[i] != group) continue;
+            reportf("%s %lu", listed ? "," : "", (unsigned long)report.stacks[i].threadId);
+            listed++;
+        }
+        if (listed < size) {
+            reportf(" (+%u more)", size - listed);
+        }
+        reportf("\n");
+
+        for (int i = 0; i < stack.frameCount; i++) {
+            const SymbolCacheEntry* sym = locked ? resolveSymbolLocked(stack.frames[i]) : nullptr;
+            printStackFrame(i, stack.frames[i], sym);
+        }
+    }
+    if (locked) {
+        unlockSymbolSession();
+    }
+
+    reportf("========== END ALL THREADS ==========\n");
+    crashReport().flush();
+}
+
+/**
+ * Print every other thread's stack, deduplicated.
+ * @param workers Capture threads (1 on the crash path)
+ */
+inline void printAllThreadStacks(int workers = 1) {
+    // The capture storage is shared: one report at a time
+    bool owned = beginCrashReport();
+    ThreadStackReport& report = threadStackReport();
+    captureAllThreadStacks(report, workers);
+    printThreadStacks(report);
+    endCrashReport(owned);
 }
 
 /**
  * Print diagnostic summary for common exceptions.
  */
 inline void printExceptionDiagnostics(const char* exceptionType) {
-    std::cerr << "\n--- Diagnostic Hints ---\n";
+    reportf("\n--- Diagnostic Hints ---\n");
 
     if (strcmp(exceptionType, "std::bad_alloc") == 0) {
-        std::cerr << "MEMORY ALLOCATION FAILURE detected.\n";
-        std::cerr << "Common causes:\n";
-        std::cerr << "  1. Requesting impossibly large allocation (SIZE_MAX, negative size cast to size_t)\n";
-        std::cerr << "  2. System out of memory (check Available Physical above)\n";
-        std::cerr << "  3. Memory fragmentation (process can't find contiguous block)\n";
-        std::cerr << "  4. Memory leak exhausting address space\n";
-        std::cerr << "\n";
-        std::cerr << "This often appears as STATUS_STACK_BUFFER_OVERRUN (0xC0000409) because:\n";
-        std::cerr << "  bad_alloc -> terminate() -> abort() -> /GS security check\n";
+        reportf("MEMORY ALLOCATION FAILURE detected.\n");
+        reportf("Common causes:\n");
+        reportf("  1. Requesting impossibly large allocation (SIZE_MAX, negative size cast to size_t)\n");
+        reportf("  2. System out of memory (check Available Physical above)\n");
+        reportf("  3. Memory fragmentation (process can't find contiguous block)\n");
+        reportf("  4. Memory leak exhausting address space\n");
+        reportf("\n");
+        reportf("This often appears as STATUS_STACK_BUFFER_OVERRUN (0xC0000409) because:\n");
+        reportf("  bad_alloc -> terminate() -> abort() -> /GS security check\n");
     }
     else if (strstr(exceptionType, "runtime_error") || strstr(exceptionType, "logic_error")) {
-        std::cerr << "Standard library exception thrown but not caught.\n";
-        std::cerr << "Check the exception message above for details.\n";
+        reportf("Standard library exception thrown but not caught.\n");
+        reportf("Check the exception message above for details.\n");
     }
     else if (strstr(exceptionType, "out_of_range")) {
-        std::cerr << "OUT OF RANGE access detected.\n";
-        std::cerr << "Common causes:\n";
-        std::cerr << "  1. Vector/string index >= size()\n";
-        std::cerr << "  2. std::stoi/stol on invalid string\n";
-        std::cerr << "  3. map::at() with non-existent key\n";
+        reportf("OUT OF RANGE access detected.\n");
+        reportf("Common causes:\n");
+        reportf("  1. Vector/string index >= size()\n");
+        reportf("  2. std::stoi/stol on invalid string\n");
+        reportf("  3. map::at() with non-existent key\n");
     }
     else if (strstr(exceptionType, "invalid_argument")) {
-        std::cerr << "INVALID ARGUMENT passed to function.\n";
-        std::cerr << "Check function parameters in the stack trace.\n";
+        reportf("INVALID ARGUMENT passed to function.\n");
+        reportf("Check function parameters in the stack trace.\n");
+    }
+}
+
+// ============================================================================
+// Flight Recorder and Queued Log Lines
+// ============================================================================
+//
+// printFlightRecorder() and drainAsyncLog() format with vsnprintf and write
+// through stdio and the log sinks, whose locks a crashed thread may hold.
+// The crash handlers use these instead: records are rendered with
+// ReportBuffer's printf subset and go only to the report's handle.
+
+// Local "HH:MM:SS.mmm" of a log timestamp (ms since the clock origin)
+inline void appendReportWallClock(ReportBuffer& out, double timestampMs) {
+    uint64_t wall = wallClockOrigin() + (uint64_t)(int64_t)(timestampMs * 10000.0);
+    FILETIME utc, local;
+    utc.dwLowDateTime = (DWORD)(wall & 0xFFFFFFFF);
+    utc.dwHighDateTime = (DWORD)(wall >> 32);
+    SYSTEMTIME st;
+    if (!FileTimeToLocalFileTime(&utc, &local) || !FileTimeToSystemTime(&local, &st)) {
+        out.append("??:??:??.???");
+        return;
+    }
+    out.appendf("%02u:%02u:%02u.%03u", st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
+}
+
+// Fixed point with 0-9 decimals; ReportBuffer has no floating point conversions
+inline void appendReportDouble(ReportBuffer& out, double value, int decimals = 3) {
+    if (value != value) {
+        out.append("nan");
+        return;
+    }
+    if (value < 0) {
+        out.append("-");
+        value = -value;
     }
+    if (value >= 1.8e19) {
+        out.append("inf");
+        return;
+    }
+    if (decimals < 0) decimals = 0;
+    if (decimals > 9) decimals = 9;
+    uint64_t scale = 1;
+    for (int i = 0; i < decimals; i++) scale *= 10;
+
+    uint64_t whole = (uint64_t)value;
+    uint64_t fraction = (uint64_t)((value - (double)whole) * (double)scale + 0.5);
+    if (fraction >= scale) {
+        whole++;
+        fraction -= scale;
+    }
+    out.appendf("%llu", (unsigned long long)whole);
+    if (decimals == 0) return;
+
+    char digits[10];
+    for (int i = decimals - 1; i >= 0; i--) {
+        digits[i] = (char)('0' + fraction % 10);
+        fraction /= 10;
+    }
+    out.append(".");
+    out.append(digits, (size_t)decimals);
+}
+
+// Can ReportBuffer::appendf take this conversion spec ("%-8s", "%llx", ...) as written?
+inline bool reportBufferSupportsSpec(const char* spec) {
+    const char* p = spec + 1;
+    while (*p == '-' || *p == '0') p++;
+    while (*p >= '0' && *p <= '9') p++;
+    if (p[0] == 'l' && p[1] == 'l') p += 2;
+    else if (p[0] == 'l' || p[0] == 'z') p++;
+    else if (p[0] == 'I' && p[1] == '6' && p[2] == '4') p += 3;
+    return *p && strchr("diuxXcsp", *p) && p[1] == '\0';
+}
+
+// Precision of a spec, from the digits or the last '*' argument; -1 if none
+inline int specPrecision(const char* spec, int starCount, const int* stars) {
+    const char* dot = strchr(spec, '.');
+    if (!dot) return -1;
+    if (dot[1] == '*') return starCount > 0 ? stars[starCount - 1] : -1;
+    int precision = 0;
+    for (const char* p = dot + 1; *p >= '0' && *p <= '9'; p++) precision = precision * 10 + (*p - '0');
+    return precision;
 }
 
 /**
- * Print build and system information for crash report.
+ * Crash-safe formatFlightMessage: each argument goes through the spec as
+ * written when ReportBuffer supports it, otherwise in its plain form
+ * (widths, '+' and the like are dropped, string precision is kept).
  */
-inline void printCrashBuildInfo() {
-    std::cerr << "\n--- Build & System Info ---\n";
+inline void appendFlightMessage(ReportBuffer& out, const LogSite& site,
+                                const char* payload, size_t length) {
+    size_t pos = 0;
+    int argIndex = 0;
+    auto take = [&](void* dst, size_t len) {
+        if (len > length - pos) return false;
+        memcpy(dst, payload + pos, len);
+        pos += len;
+        return true;
+    };
+
+    for (const char* p = site.fmt; *p; ) {
+        if (*p != '%') {
+            const char* run = p;
+            while (*p && *p != '%') p++;
+            out.append(run, (size_t)(p - run));
+            continue;
+        }
 
-    // Toolkit version
-    std::cerr << "Toolkit:          rippled-windows-debug v" << RIPPLED_DEBUG_VERSION_STRING << "\n";
-    std::cerr << "Git:              " << GIT_BRANCH << " @ " << GIT_COMMIT_HASH;
-    if (GIT_DIRTY) std::cerr << " (dirty)";
-    std::cerr << "\n";
-    std::cerr << "Built:            " << BUILD_DATE << " " << BUILD_TIME << "\n";
-    std::cerr << "Compiler:         " << COMPILER_NAME << " " << COMPILER_VERSION_STRING << "\n";
-    std::cerr << "Architecture:     " << BUILD_ARCH << " " << getProcessBitness() << "\n";
+        const char* specStart = p++;
+        binlog::FormatSpec spec;
+        p = binlog::parseFormatSpec(p, spec);
+        if (spec.conversion == '%') {
+            out.append("%");
+            continue;
+        }
+
+        char conversion[32];
+        size_t specLen = (size_t)(p - specStart);
+        int stars[2] = {0, 0};
+        bool ok = specLen < sizeof(conversion);
+        for (int i = 0; i < spec.starCount && ok; i++) {
+            int32_t v = 0;
+            ok = argIndex < site.argCount && take(&v, sizeof(v));
+            stars[i] = v;
+            argIndex++;
+        }
+        if (!ok || argIndex >= site.argCount) {
+            out.append("<?>");
+            continue;
+        }
+        memcpy(conversion, specStart, specLen);
+        conversion[specLen] = '\0';
+        bool asWritten = spec.starCount == 0 && reportBufferSupportsSpec(conversion);
+
+        bool taken = false;
+        switch (site.argTypes[argIndex++]) {
+            case binlog::ARG_INT32: {
+                int32_t v;
+                if ((taken = take(&v, sizeof(v)))) {
+                    if (asWritten) out.appendf(conversion, (int)v);
+                    else out.appendf(spec.isSigned ? "%d" : "%u", (int)v);
+                }
+                break;
+            }
+            case binlog::ARG_INT64: {
+                int64_t v;
+                if ((taken = take(&v, sizeof(v)))) {
+                    if (asWritten) out.appendf(conversion, (long long)v);
+                    else out.appendf(spec.isSigned ? "%lld" : "%llu", (long long)v);
+                }
+                break;
+            }
+            case binlog::ARG_DOUBLE: {
+                double v;
+                if ((taken = take(&v, sizeof(v)))) {
+                    int precision = specPrecision(conversion, spec.starCount, stars);
+                    appendReportDouble(out, v, precision >= 0 ? precision : 6);
+                }
+                break;
+            }
+            case binlog::ARG_POINTER: {
+                uint64_t v;
+                if ((taken = take(&v, sizeof(v)))) out.appendf("%p", (void*)(uintptr_t)v);
+                break;
+            }
+            case binlog::ARG_STRING: {
+                uint16_t len;
+                char text[kFlightPayloadSize + 1];
+                if (take(&len, sizeof(len)) && len <= kFlightPayloadSize && take(text, len)) {
+                    taken = true;
+                    text[len] = '\0';
+                    int precision = specPrecision(conversion, spec.starCount, stars);
+                    if (asWritten) out.appendf(conversion, text);
+                    else out.append(text, (precision >= 0 && (size_t)precision < len) ? (size_t)precision : len);
+                }
+                break;
+            }
+        }
+        if (!taken) out.append("<?>");
+    }
+}
+
+inline void reportFlightEntry(const FlightEntry& e) {
+    const LogSite* site = e.site;
+    const char* level = site ? site->levelName : e.level;
+    int line = site ? site->line : e.line;
+    const char* basename = site ? site->fileName : (e.file ? fileBasename(e.file) : "?");
+
+    ReportBuffer& out = crashReport();
+    out.append("  [");
+    appendReportWallClock(out, rawTimestampToMs(e.rawTime));
+    out.appendf("] [tid %5lu] %-8s ", (unsigned long)e.tid, level ? level : "?");
+
+    if (e.kind == FLIGHT_PACKED) {
+        appendFlightMessage(out, *site, e.payload, e.length);
+    } else {
+        if (e.kind == FLIGHT_FORMAT_ONLY) out.append("(arguments not recorded) ");
+        out.append(e.payload, e.length);
+    }
+    out.appendf("    %s:%d\n", basename, line);
+}
+
+/**
+ * The flight recorder section of a crash report: printFlightRecorder's
+ * output, rendered without vsnprintf or stdio.
+ */
+inline void reportFlightRecorder(size_t maxRecords = 128) {
+    FlightRecorderState& fr = flightRecorder();
+    if (fr.ringCount.load(std::memory_order_acquire) == 0) return;
+    if (!acquireFlightReader(fr)) {
+        reportf("[rippled_debug] Flight recorder is being read by another thread\n");
+        return;
+    }
+
+    size_t selected = 0;
+    uint64_t total = 0;
+    uint32_t count = selectFlightRecords(fr, maxRecords, selected, total);
+    reportf("\n--- Flight Recorder (last %zu of %llu records, %u threads) ---\n",
+            selected, (unsigned long long)total, count);
+
+    FlightEntry entry;
+    while (popFlightRecord(fr, count, false, entry)) reportFlightEntry(entry);
+    releaseFlightReader(fr);
+}
+
+/**
+ * Move records still queued for the async writer into the report, ahead of
+ * it. Cells are claimed lock-free, so this cannot block on the writer; the
+ * lines go to the report's handle only - the log file and sinks are not
+ * touched, since a crashed thread may hold their locks.
+ */
+inline void reportQueuedLog() {
+    if (!asyncState().cells) return;
+
+    ReportBuffer& out = crashReport();
+    size_t count = 0;
+    while (asyncTryConsume([&](LogRecord& rec) {
+        if (count++ == 0) reportf("\n--- Queued Log Lines (not yet written) ---\n");
+        if (rec.kind == RecordKind::TEXT) {
+            out.append(rec.text, rec.length);
+            return;
+        }
+        // OVERSIZE messages are left allocated: the heap may be corrupt
+        const char* message = recordMessage(rec);
+        size_t len = rec.kind == RecordKind::OVERSIZE
+            ? rec.length : strnlen(message, kLogRecordTextSize);
+        const LogEvent& ev = rec.event;
+        out.append("[");
+        appendReportWallClock(out, ev.timestamp);
+        out.appendf("] %-8s ", ev.level ? ev.level : "?");
+        out.append(message, len);
+        out.appendf("    %s:%d\n", ev.fileName ? ev.fileName : "?", ev.line);
+    })) {
+    }
 
-    // Windows version
-    std::cerr << "Windows:          " << getWindowsVersion() << "\n";
-    std::cerr << "Edition:          " << getWindowsBuildDetails() << "\n";
+    uint64_t dropped = asyncDroppedCount();
+    if (dropped) reportf("[i] %llu log records dropped (async queue full)\n", (unsigned long long)dropped);
+}
 
-    // CPU
-    std::cerr << "CPU:              " << getCpuInfo() << "\n";
+/**
+ * Print build and system information for crash report.
+ * Compile-time values plus the SystemInfo captured at install time.
+ */
+inline void printCrashBuildInfo() {
+    reportf("\n--- Build & System Info ---\n");
 
-    // Computer
-    std::cerr << "Computer:         " << getComputerName() << "\n";
-    std::cerr << "User:             " << getUserName();
-    if (isRunningAsAdmin()) std::cerr << " (Administrator)";
-    std::cerr << "\n";
+    // Toolkit version
+    reportf("Toolkit:          rippled-windows-debug v%s\n", RIPPLED_DEBUG_VERSION_STRING);
+    reportf("Git:              %s @ %s%s\n", GIT_BRANCH, GIT_COMMIT_HASH, GIT_DIRTY ? " (dirty)" : "");
+    reportf("Built:            %s %s\n", BUILD_DATE, BUILD_TIME);
+    reportf("Compiler:         %s %s\n", COMPILER_NAME, COMPILER_VERSION_STRING);
+    reportf("Architecture:     %s %s\n", BUILD_ARCH, getProcessBitness());
+
+    // Windows, CPU, computer: captured at install, only read here
+    const SystemInfo* info = trySystemInfo();
+    if (info) {
+        reportf("Windows:          %s\n", info->windowsVersion);
+        reportf("Edition:          %s\n", info->windowsBuild);
+        reportf("CPU:              %s\n", info->cpu);
+        reportf("Computer:         %s\n", info->computerName);
+        reportf("User:             %s%s\n", info->userName, info->admin ? " (Administrator)" : "");
+    } else {
+        reportf("System:           not captured yet\n");
+    }
 }
 
 /**
@@ -352,18 +1574,23 @@ inline void printCrashBuildInfo() {
  */
 inline void verboseTerminateHandler()
 {
-    std::cerr << "\n";
-    std::cerr << "################################################################################\n";
-    std::cerr << "###                     VERBOSE CRASH HANDLER                                ###\n";
-    std::cerr << "###                      terminate() called                                  ###\n";
-    std::cerr << "################################################################################\n";
-    std::cerr << "\n";
-    std::cerr << "Timestamp: " << getCrashTimestamp() << "\n";
+    // Queued log lines first, so they precede the report
+    bool owned = beginCrashReport();
+    reportQueuedLog();
+
+    reportf("\n");
+    reportf("################################################################################\n");
+    reportf("###                     VERBOSE CRASH HANDLER                                ###\n");
+    reportf("###                      terminate() called                                  ###\n");
+    reportf("################################################################################\n");
+    reportf("\n");
+    reportTimestamp();
 
     // Print build info right after timestamp
     printCrashBuildInfo();
 
     const char* exceptionType = "unknown";
+    char typeName[160];
 
     if (auto eptr = std::current_exception())
     {
@@ -374,44 +1601,47 @@ inline void verboseTerminateHandler()
         catch (const std::bad_alloc& e)
         {
             exceptionType = "std::bad_alloc";
-            std::cerr << "\n--- Exception Details ---\n";
-            std::cerr << "Type:    std::bad_alloc\n";
-            std::cerr << "Message: " << e.what() << "\n";
+            reportf("\n--- Exception Details ---\n");
+            reportf("Type:    std::bad_alloc\n");
+            reportf("Message: %s\n", e.what());
         }
         catch (const std::exception& e)
         {
-            exceptionType = typeid(e).name();
-            std::cerr << "\n--- Exception Details ---\n";
-            std::cerr << "Type:    " << typeid(e).name() << "\n";
-            std::cerr << "Message: " << e.what() << "\n";
+            exceptionTypeName(typeid(e), typeName, sizeof(typeName));
+            exceptionType = typeName;
+            reportf("\n--- Exception Details ---\n");
+            reportf("Type:    %s\n", typeName);
+            reportf("Message: %s\n", e.what());
         }
         catch (...)
         {
-            std::cerr << "\n--- Exception Details ---\n";
-            std::cerr << "Type:    <unknown non-std::exception type>\n";
+            reportf("\n--- Exception Details ---\n");
+            reportf("Type:    <unknown non-std::exception type>\n");
         }
     }
     else
     {
-        std::cerr << "\n--- Exception Details ---\n";
-        std::cerr << "No active exception - likely direct abort() or terminate() call.\n";
-        std::cerr << "Common causes:\n";
-        std::cerr << "  1. Assertion failure (assert() macro)\n";
-        std::cerr << "  2. Pure virtual function call\n";
-        std::cerr << "  3. Double free or heap corruption\n";
-        std::cerr << "  4. Stack buffer overrun detected by /GS\n";
+        reportf("\n--- Exception Details ---\n");
+        reportf("No active exception - likely direct abort() or terminate() call.\n");
+        reportf("Common causes:\n");
+        reportf("  1. Assertion failure (assert() macro)\n");
+        reportf("  2. Pure virtual function call\n");
+        reportf("  3. Double free or heap corruption\n");
+        reportf("  4. Stack buffer overrun detected by /GS\n");
     }
 
     printExceptionDiagnostics(exceptionType);
     printMemoryInfo();
     printThreadInfo();
     printStackTrace();
+    printAllThreadStacks();
+    reportFlightRecorder();
     printModuleInfo();
 
-    std::cerr << "\n################################################################################\n";
-    std::cerr << "###                         END CRASH REPORT                                 ###\n";
-    std::cerr << "################################################################################\n";
-    std::cerr.flush();
+    reportf("\n################################################################################\n");
+    reportf("###                         END CRASH REPORT                                 ###\n");
+    reportf("################################################################################\n");
+    endCrashReport(owned);
 
     // Call default handler to generate crash dump
     std::abort();
@@ -422,73 +1652,108 @@ inline void verboseTerminateHandler()
  */
 inline void signalHandler(int signal)
 {
-    std::cerr << "\n";
-    std::cerr << "################################################################################\n";
-    std::cerr << "###                     VERBOSE CRASH HANDLER                                ###\n";
-    std::cerr << "###                      Signal " << signal << " received                                  ###\n";
-    std::cerr << "################################################################################\n";
-    std::cerr << "\n";
-    std::cerr << "Timestamp: " << getCrashTimestamp() << "\n";
+    bool owned = beginCrashReport();
+    reportQueuedLog();
+
+    reportf("\n");
+    reportf("################################################################################\n");
+    reportf("###                     VERBOSE CRASH HANDLER                                ###\n");
+    reportf("###                      Signal %d received                                  ###\n", signal);
+    reportf("################################################################################\n");
+    reportf("\n");
+    reportTimestamp();
 
     // Print build info right after timestamp
     printCrashBuildInfo();
 
-    std::cerr << "\n--- Signal Details ---\n";
+    reportf("\n--- Signal Details ---\n");
 
     switch(signal)
     {
         case SIGABRT:
-            std::cerr << "Signal:  SIGABRT (abnormal termination)\n";
-            std::cerr << "Meaning: abort() was called\n";
-            std::cerr << "Common causes:\n";
-            std::cerr << "  1. Unhandled exception -> terminate() -> abort()\n";
-            std::cerr << "  2. assert() failure\n";
-            std::cerr << "  3. Heap corruption detected\n";
-            std::cerr << "  4. /GS security check failure (buffer overrun)\n";
+            reportf("Signal:  SIGABRT (abnormal termination)\n");
+            reportf("Meaning: abort() was called\n");
+            reportf("Common causes:\n");
+            reportf("  1. Unhandled exception -> terminate() -> abort()\n");
+            reportf("  2. assert() failure\n");
+            reportf("  3. Heap corruption detected\n");
+            reportf("  4. /GS security check failure (buffer overrun)\n");
             break;
         case SIGSEGV:
-            std::cerr << "Signal:  SIGSEGV (segmentation fault)\n";
-            std::cerr << "Meaning: Invalid memory access\n";
-            std::cerr << "Common causes:\n";
-            std::cerr << "  1. Null pointer dereference\n";
-            std::cerr << "  2. Use after free\n";
-            std::cerr << "  3. Stack overflow\n";
-            std::cerr << "  4. Writing to read-only memory\n";
+            reportf("Signal:  SIGSEGV (segmentation fault)\n");
+            reportf("Meaning: Invalid memory access\n");
+            reportf("Common causes:\n");
+            reportf("  1. Null pointer dereference\n");
+            reportf("  2. Use after free\n");
+            reportf("  3. Stack overflow\n");
+            reportf("  4. Writing to read-only memory\n");
             break;
         case SIGFPE:
-            std::cerr << "Signal:  SIGFPE (floating point exception)\n";
-            std::cerr << "Meaning: Arithmetic error\n";
-            std::cerr << "Common causes:\n";
-            std::cerr << "  1. Division by zero\n";
-            std::cerr << "  2. Integer overflow (with trapping enabled)\n";
+            reportf("Signal:  SIGFPE (floating point exception)\n");
+            reportf("Meaning: Arithmetic error\n");
+            reportf("Common causes:\n");
+            reportf("  1. Division by zero\n");
+            reportf("  2. Integer overflow (with trapping enabled)\n");
             break;
         case SIGILL:
-            std::cerr << "Signal:  SIGILL (illegal instruction)\n";
-            std::cerr << "Meaning: CPU encountered invalid opcode\n";
-            std::cerr << "Common causes:\n";
-            std::cerr << "  1. Corrupted code segment\n";
-            std::cerr << "  2. Jump to invalid address\n";
-            std::cerr << "  3. SSE/AVX instruction on unsupported CPU\n";
+            reportf("Signal:  SIGILL (illegal instruction)\n");
+            reportf("Meaning: CPU encountered invalid opcode\n");
+            reportf("Common causes:\n");
+            reportf("  1. Corrupted code segment\n");
+            reportf("  2. Jump to invalid address\n");
+            reportf("  3. SSE/AVX instruction on unsupported CPU\n");
             break;
         default:
-            std::cerr << "Signal:  Unknown (" << signal << ")\n";
+            reportf("Signal:  Unknown (%d)\n", signal);
             break;
     }
 
     printMemoryInfo();
     printThreadInfo();
     printStackTrace();
+    printAllThreadStacks();
+    reportFlightRecorder();
 
-    std::cerr << "\n################################################################################\n";
-    std::cerr << "###                         END CRASH REPORT                                 ###\n";
-    std::cerr << "################################################################################\n";
-    std::cerr.flush();
+    reportf("\n################################################################################\n");
+    reportf("###                         END CRASH REPORT                                 ###\n");
+    reportf("################################################################################\n");
+    endCrashReport(owned);
 
     // Reset and re-raise to get default behavior (crash dump)
     std::signal(signal, SIG_DFL);
     std::raise(signal);
 }
 
+/**
+ * On-demand stall report: every thread's stack without crashing.
+ * For hangs and deadlocks - call from a watchdog or an admin command.
+ * @param reason Printed in the header (optional)
+ */
+inline void printStallReport(const char* reason = nullptr)
+{
+    flushAsyncLog();
+    bool owned = beginCrashReport();
+
+    reportf("\n");
+    reportf("################################################################################\n");
+    reportf("###                          STALL REPORT                                    ###\n");
+    reportf("################################################################################\n");
+    reportf("\n");
+    reportTimestamp();
+    if (reason) {
+        reportf("Reason:    %s\n", reason);
+    }
+    reportf("Reporter:  thread %lu (not listed)\n", (unsigned long)GetCurrentThreadId());
+
+    printThreadInfo();
+    printAllThreadStacks(kMaxCaptureWorkers);
+
+    reportf("\n################################################################################\n");
+    reportf("###                         END STALL REPORT                                 ###\n");
+    reportf("################################################################################\n");
+    endCrashReport(owned);
+}
+
 /**
  * Install all verbose crash handlers.
  * Call this at the start of main().
@@ -497,6 +1762,12 @@ inline void installVerboseCrashHandlers()
 {
     std::cerr << "[DEBUG] Installing verbose crash handlers for diagnostics\n";
 
+    // Windows version, CPU and the rest, captured off this thread
+    startSystemInfoCapture();
+    if (!crashReport().output) {
+        crashReport().output = GetStdHandle(STD_ERROR_HANDLE);
+    }
+
     // Set terminate handler for unhandled exceptions
     std::set_terminate(verboseTerminateHandler);
 
@@ -506,6 +1777,11 @@ inline void installVerboseCrashHandlers()
     std::signal(SIGFPE, signalHandler);
     std::signal(SIGILL, signalHandler);
 
+    // Load symbols now, off the startup path, rather than inside the crash
+    if (crashSymbolization() == CrashSymbolization::RESOLVE) {
+        startSymbolInitialization();
+    }
+
     std::cerr << "[DEBUG] Verbose crash handlers installed\n";
 }
 
@@ -513,6 +1789,7 @@ inline void installVerboseCrashHandlers()
 
 // Convenience macro for global namespace
 #define installVerboseCrashHandlers() rippled_debug::installVerboseCrashHandlers()
+#define printStallReport(...) rippled_debug::printStallReport(__VA_ARGS__)
 
 #endif // _WIN32
 
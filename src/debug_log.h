@@ -8,10 +8,21 @@
  * Features:
  * - Rich-style colored log levels (INFO=cyan, WARN=yellow, ERROR=red)
  * - Box-drawing characters for sections
- * - Delta timestamps showing time since last log
- * - Correlation IDs for tracking related log entries
- * - Multiple output formats (Rich, JSON)
+ * - Delta timestamps showing time since the previous log on the same
+ *   thread (or with the same correlation ID)
+ * - Correlation IDs and nested spans, propagatable across threads
+ * - Multiple output formats (Rich, JSON, binary with offline decoding)
  * - Thread-safe logging
+ * - Compile-time checked printf formats, any message length, no per-line
+ *   heap allocation (growable per-thread buffers)
+ * - Optional async mode: lock-free queue + background writer thread
+ * - Flight recorder: the last records of every thread, filtered or not,
+ *   printed by the crash handlers and embedded in minidumps
+ * - Memory deltas from a background sampler or per-thread heap counters
+ *
+ * Levels:
+ *   Compile out levels with RIPPLED_DEBUG_MIN_LEVEL; at runtime use
+ *   setLogLevel() globally or setLogLevelFor("*overlay*", ...) per file glob.
  *
  * Usage:
  *   DEBUG_SECTION_BEGIN("rpc_startup");
@@ -25,6 +36,19 @@
 #ifndef RIPPLED_WINDOWS_DEBUG_DEBUG_LOG_H
 #define RIPPLED_WINDOWS_DEBUG_DEBUG_LOG_H
 
+// Compile-time level threshold. Logging macros below it expand to nothing
+// (arguments are not evaluated). Example: /DRIPPLED_DEBUG_MIN_LEVEL=2
+#define RIPPLED_DEBUG_LEVEL_DEBUG    0
+#define RIPPLED_DEBUG_LEVEL_INFO     1
+#define RIPPLED_DEBUG_LEVEL_WARN     2
+#define RIPPLED_DEBUG_LEVEL_ERROR    3
+#define RIPPLED_DEBUG_LEVEL_CRITICAL 4
+#define RIPPLED_DEBUG_LEVEL_OFF      5
+
+#ifndef RIPPLED_DEBUG_MIN_LEVEL
+#define RIPPLED_DEBUG_MIN_LEVEL RIPPLED_DEBUG_LEVEL_DEBUG
+#endif
+
 #ifdef _WIN32
 
 #include <windows.h>
@@ -32,14 +56,59 @@
 #include <cstdio>
 #include <cstdarg>
 #include <cstdint>
+#include <cstdlib>
 #include <atomic>
+#include <new>
 #include <string>
-#include <sstream>
+#include <type_traits>
+#include <vector>
 #include <iomanip>
 #include <ctime>
 
+#include <malloc.h>
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Vector width for the JSON escape scanner: SSE2 is baseline on x64,
+// AVX2 when the build enables it (/arch:AVX2, -mavx2), NEON on ARM64
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RIPPLED_DEBUG_JSON_SSE2 1
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define RIPPLED_DEBUG_JSON_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define RIPPLED_DEBUG_JSON_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include "binary_log_format.h"
+
 #pragma comment(lib, "psapi.lib")
 
+// printf format checking for the logging front ends
+#if defined(__GNUC__) || defined(__clang__)
+#define RIPPLED_DEBUG_PRINTF(fmtIndex, firstArg) __attribute__((format(printf, fmtIndex, firstArg)))
+#else
+#define RIPPLED_DEBUG_PRINTF(fmtIndex, firstArg)
+#endif
+
+// MSVC only checks _Printf_format_string_ under /analyze (code analysis); a
+// plain cl.exe build checks nothing, so mismatches surface in a /analyze or
+// clang-cl build (clang-cl takes the GCC attribute above)
+#ifdef _MSC_VER
+#include <sal.h>
+#define RIPPLED_DEBUG_FORMAT_STRING _Printf_format_string_
+#else
+#define RIPPLED_DEBUG_FORMAT_STRING
+#endif
+
 namespace rippled_debug {
 
 // ============================================================================
@@ -93,16 +162,49 @@ namespace box {
 // Configuration
 // ============================================================================
 
+// Severity levels. Values match RIPPLED_DEBUG_LEVEL_*. (Prefixed because
+// DEBUG and ERROR are commonly defined as macros on Windows.)
+enum class LogLevel : uint8_t {
+    LVL_DEBUG    = RIPPLED_DEBUG_LEVEL_DEBUG,
+    LVL_INFO     = RIPPLED_DEBUG_LEVEL_INFO,
+    LVL_WARN     = RIPPLED_DEBUG_LEVEL_WARN,
+    LVL_ERROR    = RIPPLED_DEBUG_LEVEL_ERROR,
+    LVL_CRITICAL = RIPPLED_DEBUG_LEVEL_CRITICAL,
+    LVL_OFF      = RIPPLED_DEBUG_LEVEL_OFF
+};
+
+inline const char* levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::LVL_DEBUG:    return "DEBUG";
+        case LogLevel::LVL_INFO:     return "INFO";
+        case LogLevel::LVL_WARN:     return "WARN";
+        case LogLevel::LVL_ERROR:    return "ERROR";
+        case LogLevel::LVL_CRITICAL: return "CRIT";
+        default:                     return "OFF";
+    }
+}
+
 enum class LogFormat {
     RICH,   // Rich-style colored output (default)
     TEXT,   // Plain text (no colors)
-    JSON    // Machine-parseable JSON
+    JSON,   // Machine-parseable JSON
+    BINARY  // Packed records, decoded offline (see binary_log_format.h)
+};
+
+// Output that takes the place of the config().output FILE* (the mapped log
+// file in log_file.h). flush(false) is called at record/batch boundaries and
+// may do nothing; flush(true) must get everything written so far to the OS.
+struct LogOutputSink {
+    void (*write)(const char* data, size_t len);
+    void (*flush)(bool force);
 };
 
 struct LogConfig {
     bool enabled = true;
+    std::atomic<LogLevel> minLevel{LogLevel::LVL_DEBUG};  // Runtime threshold (see setLogLevel)
     LogFormat format = LogFormat::RICH;
     FILE* output = stderr;
+    const LogOutputSink* sink = nullptr;    // Overrides output when set
     bool includeThreadId = false;       // Off by default for cleaner output
     bool includeCorrelationId = true;
     bool includeDeltaTime = true;       // Show time since last log
@@ -110,6 +212,9 @@ struct LogConfig {
     bool useColors = true;
     bool useMilliseconds = true;        // Include ms in timestamp
     int boxWidth = 76;
+    bool sectionBoxes = true;           // Per-call section boxes/records (off when profiling)
+    double slowSectionMs = -1.0;        // Without boxes, warn on sections slower than this
+    bool sectionCpu = false;            // Sections also record thread CPU cycles
 };
 
 inline LogConfig& config() {
@@ -119,8 +224,9 @@ inline LogConfig& config() {
 
 // Enable Windows ANSI support
 inline void enableAnsiSupport() {
-    static bool initialized = false;
-    if (initialized) return;
+    static std::atomic<bool> initialized{false};
+    if (initialized.load(std::memory_order_relaxed)) return;
+    if (initialized.exchange(true)) return;
 
     HANDLE hOut = GetStdHandle(STD_ERROR_HANDLE);
     DWORD mode = 0;
@@ -130,330 +236,3097 @@ inline void enableAnsiSupport() {
 
     // Set console to UTF-8
     SetConsoleOutputCP(CP_UTF8);
-
-    initialized = true;
 }
 
 // ============================================================================
 // Correlation ID System
 // ============================================================================
+//
+// A correlation ID names one end-to-end operation (an RPC, a ledger close)
+// and a span is one timed piece of it. Each thread keeps a stack of
+// (cid, spanId) frames: a DEBUG_SECTION pushes a new span that inherits the
+// enclosing cid (or starts one) and pops it on exit, so outer sections keep
+// their context after inner ones finish. SpanContext is a 16-byte value that
+// can be captured with currentSpan() and re-installed on another thread with
+// SpanScope, e.g. when a job or coroutine is handed to a worker.
 
 using CorrelationId = uint64_t;
 
+struct SpanContext {
+    CorrelationId cid = 0;
+    uint64_t spanId = 0;
+};
+
+constexpr int kMaxSpanDepth = 64;
+
+struct SpanStack {
+    SpanContext current;
+    SpanContext saved[kMaxSpanDepth];   // Frames below current
+    int depth = 0;                      // May exceed kMaxSpanDepth (not saved)
+};
+
+inline SpanStack& spanStack() {
+    thread_local SpanStack stack;
+    return stack;
+}
+
 inline CorrelationId generateCorrelationId() {
     static std::atomic<uint64_t> counter{0};
     return ++counter;
 }
 
-inline CorrelationId& currentCorrelationId() {
-    thread_local CorrelationId cid = 0;
-    return cid;
+// Span IDs are handed out to each thread in blocks so creating a span
+// doesn't touch a shared counter
+inline uint64_t generateSpanId() {
+    static std::atomic<uint64_t> nextBlock{0};
+    constexpr uint64_t kBlock = 4096;
+    thread_local uint64_t next = 0, end = 0;
+    if (next == end) {
+        next = nextBlock.fetch_add(kBlock, std::memory_order_relaxed) + 1;
+        end = next + kBlock;
+    }
+    return next++;
+}
+
+inline CorrelationId& currentCorrelationId() {
+    return spanStack().current.cid;
+}
+
+// Capture the calling thread's context for propagation
+inline SpanContext currentSpan() {
+    return spanStack().current;
+}
+
+inline uint64_t currentParentSpanId() {
+    const SpanStack& s = spanStack();
+    return (s.depth > 0 && s.depth <= kMaxSpanDepth) ? s.saved[s.depth - 1].spanId : 0;
+}
+
+inline void pushSpan(const SpanContext& ctx) {
+    SpanStack& s = spanStack();
+    if (s.depth < kMaxSpanDepth) s.saved[s.depth] = s.current;
+    s.depth++;
+    s.current = ctx;
+}
+
+inline void popSpan() {
+    SpanStack& s = spanStack();
+    if (s.depth == 0) {
+        s.current = SpanContext{};
+        return;
+    }
+    s.depth--;
+    if (s.depth < kMaxSpanDepth) s.current = s.saved[s.depth];
+}
+
+/**
+ * Open a child span of the current one. It keeps the current cid unless
+ * there is none or newCorrelation is set.
+ */
+inline SpanContext beginSpan(bool newCorrelation = false) {
+    SpanContext ctx;
+    CorrelationId cid = spanStack().current.cid;
+    ctx.cid = (newCorrelation || cid == 0) ? generateCorrelationId() : cid;
+    ctx.spanId = generateSpanId();
+    pushSpan(ctx);
+    return ctx;
+}
+
+// Close a span, also unwinding any frames above it that weren't closed
+inline void endSpan(const SpanContext& ctx) {
+    SpanStack& s = spanStack();
+    if (s.current.spanId == ctx.spanId) {
+        popSpan();
+        return;
+    }
+    int saved = (s.depth < kMaxSpanDepth) ? s.depth : kMaxSpanDepth;
+    for (int i = saved - 1; i >= 0; i--) {
+        if (s.saved[i].spanId == ctx.spanId) {
+            while (s.depth > i) popSpan();
+            return;
+        }
+    }
+}
+
+/**
+ * Re-install a captured context for the lifetime of the scope, so logs and
+ * sections on this thread attach to the originating operation:
+ *
+ *   SpanContext ctx = currentSpan();
+ *   jobQueue.post([ctx] { SpanScope scope(ctx); ... });
+ */
+struct SpanScope {
+    explicit SpanScope(const SpanContext& ctx) { pushSpan(ctx); }
+    ~SpanScope() { popSpan(); }
+    SpanScope(const SpanScope&) = delete;
+    SpanScope& operator=(const SpanScope&) = delete;
+};
+
+// Start a new correlation (a root span) on this thread
+inline CorrelationId startCorrelation(const char* context) {
+    return beginSpan(true).cid;
+}
+
+// End it, restoring the context that was current before startCorrelation
+inline void endCorrelation(CorrelationId cid) {
+    if (currentCorrelationId() == cid) {
+        popSpan();
+    }
+}
+
+// ============================================================================
+// Time Utilities
+// ============================================================================
+
+// QPC frequency, the origin all timestamps are relative to, and a 32.32
+// fixed-point nanoseconds-per-tick factor so conversions are multiply/shift
+// instead of a double division. Lazily calibrated without a guard variable
+// (everything is constant-initialized): racing first callers compute the
+// same frequency and agree on the origin via compare-exchange. After that
+// the cache line is read-only.
+struct ClockState {
+    std::atomic<int64_t> frequency{0};
+    std::atomic<int64_t> origin{0};
+    std::atomic<uint64_t> nsPerTick{0};     // 1e9 / frequency, 32.32 fixed point
+    std::atomic<bool> ready{false};
+};
+
+inline ClockState& clockStorage() {
+    alignas(64) static ClockState state;
+    return state;
+}
+
+inline int64_t getRawTimestamp() {
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+inline const ClockState& clockState() {
+    ClockState& clock = clockStorage();
+    if (!clock.ready.load(std::memory_order_acquire)) {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        clock.frequency.store(frequency.QuadPart, std::memory_order_relaxed);
+        clock.nsPerTick.store(
+            (uint64_t)((1000000000.0 / (double)frequency.QuadPart) * 4294967296.0),
+            std::memory_order_relaxed);
+        int64_t expected = 0;
+        clock.origin.compare_exchange_strong(expected, getRawTimestamp(),
+            std::memory_order_relaxed);
+        clock.ready.store(true, std::memory_order_release);
+    }
+    return clock;
+}
+
+// Tick count -> nanoseconds. Split so no intermediate exceeds 64 bits for any
+// realistic QPC frequency and uptime.
+inline int64_t ticksToNs(int64_t ticks) {
+    uint64_t mul = clockState().nsPerTick.load(std::memory_order_relaxed);
+    bool negative = ticks < 0;
+    uint64_t t = negative ? (uint64_t)-ticks : (uint64_t)ticks;
+    uint64_t hi = t >> 32, lo = t & 0xFFFFFFFFull;
+    uint64_t ns = hi * mul + lo * (mul >> 32) + ((lo * (mul & 0xFFFFFFFFull)) >> 32);
+    return negative ? -(int64_t)ns : (int64_t)ns;
+}
+
+inline double ticksToMs(int64_t ticks) {
+    return (double)ticksToNs(ticks) * 1e-6;
+}
+
+inline double rawTimestampToMs(int64_t raw) {
+    return ticksToMs(raw - clockState().origin.load(std::memory_order_relaxed));
+}
+
+inline double getTimestampMs() {
+    clockState();
+    return rawTimestampToMs(getRawTimestamp());
+}
+
+// ============================================================================
+// Thread CPU Time
+// ============================================================================
+//
+// QueryThreadCycleTime counts the cycles charged to the calling thread (user
+// and kernel mode) at the constant TSC rate, so cycles over wall time tells
+// CPU-bound from blocked. It is a system call, so sections only take it when
+// CPU timing is on (setSectionCpuTiming).
+
+inline uint64_t threadCycles() {
+    ULONG64 cycles = 0;
+    QueryThreadCycleTime(GetCurrentThread(), &cycles);
+    return cycles;
+}
+
+// Cycle counter rate, calibrated once by spinning: a busy thread is charged
+// for nearly every cycle of the interval. The best of a few rounds drops
+// rounds where the thread was preempted.
+inline double threadCyclesPerNs() {
+    static const double rate = [] {
+        double best = 0.0;
+        for (int round = 0; round < 3; round++) {
+            int64_t start = getRawTimestamp();
+            uint64_t startCycles = threadCycles();
+            int64_t ns;
+            do {
+                ns = ticksToNs(getRawTimestamp() - start);
+            } while (ns < 2000000);
+            double value = (double)(threadCycles() - startCycles) / (double)ns;
+            if (value > best) best = value;
+        }
+        return best > 0.0 ? best : 1.0;
+    }();
+    return rate;
+}
+
+inline double threadCyclesToMs(uint64_t cycles) {
+    return (double)cycles / threadCyclesPerNs() * 1e-6;
+}
+
+// Raw timestamp of this thread's previous log line, for the delta column.
+// Per-thread so concurrent loggers don't see each other's deltas or share a
+// written cache line.
+inline int64_t& lastLogTicks() {
+    thread_local int64_t last = 0;
+    return last;
+}
+
+// Per-correlation-ID delta clock. A correlated flow can hop threads, so this
+// is shared, but each slot is its own cache line and only flows hashing to
+// the same slot touch it. Collisions just restart that flow's delta.
+struct alignas(64) CorrelationClockSlot {
+    std::atomic<uint64_t> cid{0};
+    std::atomic<int64_t> ticks{0};
+};
+
+constexpr size_t kCorrelationClockSlots = 256;
+
+inline CorrelationClockSlot* correlationClock() {
+    static CorrelationClockSlot slots[kCorrelationClockSlots];
+    return slots;
+}
+
+// Record `now` for cid and return the raw time of the previous record with
+// the same cid, or 0 if it isn't known.
+inline int64_t exchangeCorrelationTime(uint64_t cid, int64_t now) {
+    CorrelationClockSlot& slot =
+        correlationClock()[(cid * 0x9E3779B97F4A7C15ull) >> 56];
+    if (slot.cid.load(std::memory_order_relaxed) != cid) {
+        slot.ticks.store(now, std::memory_order_relaxed);
+        slot.cid.store(cid, std::memory_order_relaxed);
+        return 0;
+    }
+    return slot.ticks.exchange(now, std::memory_order_relaxed);
+}
+
+// Delta for a new record at rawTime: since the previous record with the same
+// correlation ID, otherwise since this thread's previous record.
+inline double updateLogDelta(uint64_t cid, int64_t rawTime) {
+    int64_t& threadLast = lastLogTicks();
+    int64_t previous = (cid != 0) ? exchangeCorrelationTime(cid, rawTime) : 0;
+    if (previous == 0) previous = threadLast ? threadLast
+        : clockState().origin.load(std::memory_order_relaxed);
+    threadLast = rawTime;
+    return ticksToMs(rawTime - previous);
+}
+
+// Wall clock (UTC FILETIME, 100ns units) at the QPC origin. Sampled once so
+// log lines derive their time of day from the QPC value they already hold;
+// same lazy, guard-free initialization as ClockState.
+inline uint64_t wallClockOrigin() {
+    static std::atomic<uint64_t> origin{0};
+    uint64_t value = origin.load(std::memory_order_acquire);
+    if (value == 0) {
+        const ClockState& clock = clockState();
+        FILETIME utc;
+        GetSystemTimePreciseAsFileTime(&utc);
+        int64_t now = getRawTimestamp();
+        uint64_t wall = ((uint64_t)utc.dwHighDateTime << 32) | utc.dwLowDateTime;
+        wall -= (uint64_t)(ticksToNs(now - clock.origin.load(std::memory_order_relaxed)) / 100);
+        uint64_t expected = 0;
+        value = origin.compare_exchange_strong(expected, wall, std::memory_order_acq_rel)
+            ? wall : expected;
+    }
+    return value;
+}
+
+// Per-thread cache of the "HH:MM:SS" part of the current second
+struct TimeStringCache {
+    uint64_t second = ~0ull;    // UTC seconds since 1601
+    char prefix[12];
+};
+
+/**
+ * Format a log timestamp (ms since the clock origin, as in LogEvent) as
+ * local "HH:MM:SS[.mmm]". Returns the length written (buffer >= 16 bytes).
+ * The time zone conversion and formatting only run when the second changes;
+ * otherwise the cached prefix is copied and the millisecond digits patched.
+ */
+inline size_t formatWallClock(double timestampMs, char* buffer) {
+    thread_local TimeStringCache cache;
+
+    uint64_t wall = wallClockOrigin() + (uint64_t)(int64_t)(timestampMs * 10000.0);
+    uint64_t second = wall / 10000000;
+
+    if (second != cache.second) {
+        uint64_t whole = second * 10000000;
+        FILETIME utc, local;
+        utc.dwLowDateTime = (DWORD)(whole & 0xFFFFFFFF);
+        utc.dwHighDateTime = (DWORD)(whole >> 32);
+        SYSTEMTIME st;
+        FileTimeToLocalFileTime(&utc, &local);
+        FileTimeToSystemTime(&local, &st);
+        snprintf(cache.prefix, sizeof(cache.prefix), "%02d:%02d:%02d",
+            st.wHour, st.wMinute, st.wSecond);
+        cache.second = second;
+    }
+
+    memcpy(buffer, cache.prefix, 8);
+    if (!config().useMilliseconds) {
+        buffer[8] = '\0';
+        return 8;
+    }
+    unsigned ms = (unsigned)(wall / 10000 % 1000);
+    buffer[8] = '.';
+    buffer[9] = (char)('0' + ms / 100);
+    buffer[10] = (char)('0' + ms / 10 % 10);
+    buffer[11] = (char)('0' + ms % 10);
+    buffer[12] = '\0';
+    return 12;
+}
+
+inline std::string getTimeString() {
+    char buffer[16];
+    size_t len = formatWallClock(getTimestampMs(), buffer);
+    return std::string(buffer, len);
+}
+
+// "+1.2ms"-style delta into buffer (>= 16 bytes); returns the length
+inline size_t formatDelta(double deltaMs, char* buffer) {
+    int written;
+    if (deltaMs < 1.0) {
+        written = snprintf(buffer, 16, "+%.0fus", deltaMs * 1000);
+    } else if (deltaMs < 1000.0) {
+        written = snprintf(buffer, 16, "+%.1fms", deltaMs);
+    } else if (deltaMs < 60000.0) {
+        written = snprintf(buffer, 16, "+%.2fs", deltaMs / 1000);
+    } else {
+        written = snprintf(buffer, 16, "+%.1fm", deltaMs / 60000);
+    }
+    return (written > 0 && written < 16) ? (size_t)written : strlen(buffer);
+}
+
+inline std::string formatDelta(double deltaMs) {
+    char buffer[16];
+    size_t len = formatDelta(deltaMs, buffer);
+    return std::string(buffer, len);
+}
+
+inline DWORD getThreadId() {
+    return GetCurrentThreadId();
+}
+
+// ============================================================================
+// Memory Tracking
+// ============================================================================
+
+inline size_t getCurrentMemoryUsage() {
+    PROCESS_MEMORY_COUNTERS_EX pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
+        return pmc.WorkingSetSize;
+    }
+    return 0;
+}
+
+// "No previous sample": 0 is a real reading (an even heap balance in precise mode)
+constexpr size_t kNoMemorySample = SIZE_MAX;
+
+// Per-thread, like lastLogTicks()
+inline size_t& lastMemoryUsage() {
+    thread_local size_t last = kNoMemorySample;
+    return last;
+}
+
+// ----------------------------------------------------------------------------
+// Sampling mode: a background thread calls GetProcessMemoryInfo every
+// intervalMs and publishes the result; log lines and sections then read
+// memory without a syscall. Published through a seqlock (single writer).
+// ----------------------------------------------------------------------------
+
+struct MemorySnapshot {
+    size_t workingSet;
+    size_t privateBytes;
+    uint32_t pageFaults;
+};
+
+struct MemorySamplerState {
+    std::atomic<uint32_t> sequence{0};      // Odd while an update is in progress
+    std::atomic<size_t> workingSet{0};
+    std::atomic<size_t> privateBytes{0};
+    std::atomic<uint32_t> pageFaults{0};
+
+    std::atomic<bool> running{false};
+    DWORD intervalMs = 50;
+    HANDLE stopEvent = nullptr;
+    HANDLE thread = nullptr;
+};
+
+inline MemorySamplerState& memorySampler() {
+    static MemorySamplerState state;
+    return state;
+}
+
+inline bool isMemorySamplerRunning() {
+    return memorySampler().running.load(std::memory_order_acquire);
+}
+
+inline MemorySnapshot sampleMemoryNow() {
+    MemorySnapshot snap = {0, 0, 0};
+    PROCESS_MEMORY_COUNTERS_EX pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
+        snap.workingSet = pmc.WorkingSetSize;
+        snap.privateBytes = pmc.PrivateUsage;
+        snap.pageFaults = pmc.PageFaultCount;
+    }
+    return snap;
+}
+
+inline void publishMemorySnapshot(const MemorySnapshot& snap) {
+    MemorySamplerState& s = memorySampler();
+    uint32_t seq = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.workingSet.store(snap.workingSet, std::memory_order_relaxed);
+    s.privateBytes.store(snap.privateBytes, std::memory_order_relaxed);
+    s.pageFaults.store(snap.pageFaults, std::memory_order_relaxed);
+    s.sequence.store(seq + 2, std::memory_order_release);
+}
+
+/**
+ * Latest memory counters: the sampler's snapshot when it is running (no
+ * syscall), otherwise a direct GetProcessMemoryInfo call.
+ */
+inline MemorySnapshot currentMemorySnapshot() {
+    MemorySamplerState& s = memorySampler();
+    if (!isMemorySamplerRunning()) return sampleMemoryNow();
+
+    MemorySnapshot snap;
+    uint32_t before, after;
+    do {
+        before = s.sequence.load(std::memory_order_acquire);
+        snap.workingSet = s.workingSet.load(std::memory_order_relaxed);
+        snap.privateBytes = s.privateBytes.load(std::memory_order_relaxed);
+        snap.pageFaults = s.pageFaults.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = s.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return snap;
+}
+
+inline DWORD WINAPI memorySamplerMain(LPVOID) {
+    MemorySamplerState& s = memorySampler();
+    while (WaitForSingleObject(s.stopEvent, s.intervalMs) == WAIT_TIMEOUT) {
+        publishMemorySnapshot(sampleMemoryNow());
+    }
+    return 0;
+}
+
+/**
+ * Start the background memory sampler. A first snapshot is published before
+ * this returns. Calling it again while running only changes the interval.
+ */
+inline bool startMemorySampler(DWORD intervalMs = 50) {
+    MemorySamplerState& s = memorySampler();
+    s.intervalMs = intervalMs ? intervalMs : 1;
+    if (isMemorySamplerRunning()) return true;
+
+    publishMemorySnapshot(sampleMemoryNow());
+
+    s.stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!s.stopEvent) {
+        fprintf(stderr, "[rippled_debug] CreateEvent failed for memory sampler (error %lu)\n",
+            GetLastError());
+        return false;
+    }
+    s.thread = CreateThread(nullptr, 0, memorySamplerMain, nullptr, 0, nullptr);
+    if (!s.thread) {
+        fprintf(stderr, "[rippled_debug] Failed to start memory sampler thread (error %lu)\n",
+            GetLastError());
+        CloseHandle(s.stopEvent);
+        s.stopEvent = nullptr;
+        return false;
+    }
+    s.running.store(true, std::memory_order_release);
+    return true;
+}
+
+inline void stopMemorySampler() {
+    MemorySamplerState& s = memorySampler();
+    if (!s.running.exchange(false, std::memory_order_acq_rel)) return;
+
+    SetEvent(s.stopEvent);
+    WaitForSingleObject(s.thread, INFINITE);
+    CloseHandle(s.thread);
+    CloseHandle(s.stopEvent);
+    s.thread = nullptr;
+    s.stopEvent = nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// Precise mode: count heap bytes per thread instead of watching the working
+// set. Counting comes from either the debug CRT allocation hook (installed by
+// enablePreciseMemoryTracking() in _DEBUG builds) or replacement global
+// operator new/delete, defined in ONE translation unit with
+// RIPPLED_DEBUG_DEFINE_ALLOCATION_HOOKS(). Frees are charged to the freeing
+// thread, so a thread that frees another's memory can see a negative delta.
+// ----------------------------------------------------------------------------
+
+struct ThreadAllocationCounters {
+    int64_t allocated;
+    int64_t freed;
+};
+
+inline ThreadAllocationCounters& threadAllocationCounters() {
+    thread_local ThreadAllocationCounters counters = {0, 0};
+    return counters;
+}
+
+// Net heap bytes allocated by the calling thread since it started counting
+inline int64_t threadAllocationBalance() {
+    const ThreadAllocationCounters& c = threadAllocationCounters();
+    return c.allocated - c.freed;
+}
+
+// Set by RIPPLED_DEBUG_DEFINE_ALLOCATION_HOOKS() at static-init time
+inline bool& allocationHooksInstalled() {
+    static bool installed = false;
+    return installed;
+}
+
+inline std::atomic<bool>& preciseMemoryTracking() {
+    static std::atomic<bool> enabled{false};
+    return enabled;
+}
+
+inline void* trackedAlloc(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (p) threadAllocationCounters().allocated += (int64_t)_msize(p);
+    return p;
+}
+
+inline void trackedFree(void* p) {
+    if (!p) return;
+    threadAllocationCounters().freed += (int64_t)_msize(p);
+    free(p);
+}
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+inline int __cdecl crtAllocationHook(int allocType, void* userData, size_t size,
+                                     int blockType, long, const unsigned char*, int) {
+    if (blockType == _CRT_BLOCK) return TRUE;  // CRT-internal, and re-entrancy safe
+    ThreadAllocationCounters& c = threadAllocationCounters();
+    switch (allocType) {
+        case _HOOK_ALLOC:
+            c.allocated += (int64_t)size;
+            break;
+        case _HOOK_REALLOC:
+            if (userData) c.freed += (int64_t)_msize_dbg(userData, blockType);
+            c.allocated += (int64_t)size;
+            break;
+        case _HOOK_FREE:
+            if (userData) c.freed += (int64_t)_msize_dbg(userData, blockType);
+            break;
+    }
+    return TRUE;
+}
+#endif
+
+/**
+ * Switch memory deltas to per-thread heap byte counts. Returns false if no
+ * counting source is available (release CRT without the operator new hooks).
+ */
+inline bool enablePreciseMemoryTracking() {
+    if (!allocationHooksInstalled()) {
+#if defined(_MSC_VER) && defined(_DEBUG)
+        static std::atomic<bool> hookInstalled{false};
+        if (!hookInstalled.exchange(true)) _CrtSetAllocHook(crtAllocationHook);
+#else
+        fprintf(stderr, "[rippled_debug] Precise memory tracking needs a _DEBUG CRT "
+            "or RIPPLED_DEBUG_DEFINE_ALLOCATION_HOOKS() in one source file\n");
+        return false;
+#endif
+    }
+    preciseMemoryTracking().store(true, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Memory reading used for log line and section deltas: per-thread heap
+ * balance in precise mode, else the sampled (or direct) working set.
+ * Only differences between marks from the same thread are meaningful.
+ */
+inline size_t memoryMark() {
+    if (preciseMemoryTracking().load(std::memory_order_relaxed)) {
+        return (size_t)threadAllocationBalance();
+    }
+    return currentMemorySnapshot().workingSet;
+}
+
+// Sections measure memory when it is cheap (sampler/precise) or requested
+inline bool sectionMemoryEnabled() {
+    return config().includeMemoryDelta || isMemorySamplerRunning()
+        || preciseMemoryTracking().load(std::memory_order_relaxed);
+}
+
+// " [+1.5 MB]"-style delta into buffer (>= 32 bytes); returns the length,
+// 0 (empty string) when last is kNoMemorySample or nothing changed
+inline size_t formatMemoryDelta(size_t current, size_t last, char* buffer) {
+    buffer[0] = '\0';
+    if (last == kNoMemorySample || current == last) return 0;
+
+    int64_t delta = (int64_t)current - (int64_t)last;
+    char sign = (delta > 0) ? '+' : '-';
+    if (delta < 0) delta = -delta;
+
+    int written;
+    if (delta < 1024) {
+        written = snprintf(buffer, 32, " [%c%lld B]", sign, (long long)delta);
+    } else if (delta < 1024 * 1024) {
+        written = snprintf(buffer, 32, " [%c%.1f KB]", sign, delta / 1024.0);
+    } else {
+        written = snprintf(buffer, 32, " [%c%.1f MB]", sign, delta / 1024.0 / 1024.0);
+    }
+    return (written > 0 && written < 32) ? (size_t)written : strlen(buffer);
+}
+
+inline std::string formatMemoryDelta(size_t current, size_t last) {
+    char buffer[32];
+    size_t len = formatMemoryDelta(current, last, buffer);
+    return std::string(buffer, len);
+}
+
+// ============================================================================
+// JSON Escaping
+// ============================================================================
+
+// RFC 8259 string escaping. The scanner looks for bytes that cannot be
+// copied verbatim - '"', '\\', controls below 0x20, and anything >= 0x80
+// (checked as UTF-8) - 16 or 32 bytes at a time; the clean runs in between
+// are appended with one memcpy each.
+
+inline unsigned lowestSetBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+inline unsigned lowestSetBit64(uint64_t mask) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (unsigned)index;
+#elif defined(_MSC_VER)
+    uint32_t low = (uint32_t)mask;
+    return low ? lowestSetBit(low) : 32 + lowestSetBit((uint32_t)(mask >> 32));
+#else
+    return (unsigned)__builtin_ctzll(mask);
+#endif
+}
+
+inline bool jsonNeedsEscape(unsigned char c) {
+    return c < 0x20 || c >= 0x80 || c == '"' || c == '\\';
+}
+
+// Offset of the first byte in p[0, len) that jsonNeedsEscape, or len
+inline size_t findJsonSpecial(const unsigned char* p, size_t len) {
+    size_t i = 0;
+#if defined(RIPPLED_DEBUG_JSON_AVX2)
+    const __m256i space32 = _mm256_set1_epi8(0x20);
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    const __m256i backslash32 = _mm256_set1_epi8('\\');
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        // Signed compare: bytes >= 0x80 are negative, so "< 0x20" covers them too
+        __m256i special = _mm256_or_si256(_mm256_cmpgt_epi8(space32, v),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, backslash32)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+        if (mask) return i + lowestSetBit(mask);
+    }
+#endif
+#if defined(RIPPLED_DEBUG_JSON_SSE2)
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i special = _mm_or_si128(_mm_cmplt_epi8(v, space),
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+        if (mask) return i + lowestSetBit(mask);
+    }
+#elif defined(RIPPLED_DEBUG_JSON_NEON)
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    const uint8x16_t high = vdupq_n_u8(0x80);
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(p + i);
+        uint8x16_t special = vorrq_u8(vorrq_u8(vcltq_u8(v, space), vcgeq_u8(v, high)),
+            vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)));
+        // Narrow to 4 bits per byte so the first hit is a bit scan away
+        uint64_t mask = vget_lane_u64(
+            vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(special), 4)), 0);
+        if (mask) return i + (lowestSetBit64(mask) >> 2);
+    }
+#endif
+    for (; i < len; i++) {
+        if (jsonNeedsEscape(p[i])) return i;
+    }
+    return len;
+}
+
+// Length of the well-formed UTF-8 sequence at p (RFC 3629: no overlong
+// forms, surrogates or code points above U+10FFFF), 0 if there is none
+inline size_t utf8SequenceLength(const unsigned char* p, size_t len) {
+    unsigned char c = p[0];
+    unsigned char lo = 0x80, hi = 0xBF;     // Allowed range of the second byte
+    size_t n;
+    if (c >= 0xC2 && c <= 0xDF) {
+        n = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        n = 3;
+        if (c == 0xE0) lo = 0xA0;
+        if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        n = 4;
+        if (c == 0xF0) lo = 0x90;
+        if (c == 0xF4) hi = 0x8F;
+    } else {
+        return 0;
+    }
+
+    if (len < n || p[1] < lo || p[1] > hi) return 0;
+    for (size_t k = 2; k < n; k++) {
+        if ((p[k] & 0xC0) != 0x80) return 0;
+    }
+    return n;
+}
+
+/**
+ * Append str[0, len) to out (anything with append(const char*, size_t),
+ * e.g. a FormatBuffer or std::string) as the body of a JSON string.
+ * Controls use the short escapes or \u00XX; bytes that are not valid UTF-8
+ * become U+FFFD, so the output is always valid JSON.
+ */
+template <typename Out>
+inline void appendJsonEscaped(Out& out, const char* str, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char* p = (const unsigned char*)str;
+    size_t i = 0;
+
+    while (i < len) {
+        size_t clean = findJsonSpecial(p + i, len - i);
+        if (clean > 0) {
+            out.append(str + i, clean);
+            i += clean;
+            if (i == len) break;
+        }
+
+        unsigned char c = p[i];
+        if (c >= 0x80) {
+            size_t n = utf8SequenceLength(p + i, len - i);
+            if (n > 0) {
+                out.append(str + i, n);
+                i += n;
+            } else {
+                out.append("\\ufffd", 6);
+                i++;
+            }
+            continue;
+        }
+
+        switch (c) {
+            case '"':  out.append("\\\"", 2); break;
+            case '\\': out.append("\\\\", 2); break;
+            case '\b': out.append("\\b", 2); break;
+            case '\f': out.append("\\f", 2); break;
+            case '\n': out.append("\\n", 2); break;
+            case '\r': out.append("\\r", 2); break;
+            case '\t': out.append("\\t", 2); break;
+            default: {
+                char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                out.append(escape, 6);
+                break;
+            }
+        }
+        i++;
+    }
+}
+
+template <typename Out>
+inline void appendJsonEscaped(Out& out, const char* str) {
+    appendJsonEscaped(out, str, strlen(str));
+}
+
+inline std::string escapeJson(const char* str) {
+    size_t len = strlen(str);
+    std::string result;
+    result.reserve(len + 8);
+    appendJsonEscaped(result, str, len);
+    return result;
+}
+
+// ============================================================================
+// Filename extraction (smart truncation)
+// ============================================================================
+
+// Part of a path after the last separator. constexpr, so the call sites'
+// __FILE__ basenames are computed by the compiler (see LogSite).
+constexpr const char* fileBasename(const char* path) {
+    const char* name = path;
+    for (const char* p = path; *p; ++p) {
+        if (*p == '\\' || *p == '/') name = p + 1;
+    }
+    return name;
+}
+
+/**
+ * Copy a basename into out (size bytes), shortened to maxLen characters
+ * ".." while keeping the extension ("NetworkOPs.cpp" at 12 becomes
+ * "Networ...cpp"). Returns the length written.
+ */
+inline size_t formatFilename(const char* name, int maxLen, char* out, size_t size) {
+    if (size == 0) return 0;
+    size_t nameLen = strlen(name);
+
+    const char* parts[3] = {name, nullptr, nullptr};
+    size_t lengths[3] = {nameLen, 0, 0};
+    if ((int)nameLen > maxLen && maxLen > 3) {
+        // Truncate with ellipsis, keeping the extension
+        const char* dot = strrchr(name, '.');
+        if (dot && dot > name) {
+            int keep = maxLen - (int)(nameLen - (size_t)(dot - name)) - 2; // -2 for ".."
+            if (keep > 0) {
+                lengths[0] = (size_t)keep;
+                parts[1] = "..";
+                lengths[1] = 2;
+                parts[2] = dot;
+                lengths[2] = nameLen - (size_t)(dot - name);
+            }
+        } else {
+            lengths[0] = (size_t)(maxLen - 2);
+            parts[1] = "..";
+            lengths[1] = 2;
+        }
+    }
+
+    size_t length = 0;
+    for (int i = 0; i < 3 && parts[i]; i++) {
+        size_t n = lengths[i];
+        if (n > size - 1 - length) n = size - 1 - length;
+        memcpy(out + length, parts[i], n);
+        length += n;
+    }
+    out[length] = '\0';
+    return length;
+}
+
+inline std::string extractFilename(const char* path, int maxLen = 20) {
+    const char* name = fileBasename(path);
+    std::string result(strlen(name) + 1, '\0');
+    result.resize(formatFilename(name, maxLen, &result[0], result.size()));
+    return result;
+}
+
+// ============================================================================
+// Line Buffer (one write per record)
+// ============================================================================
+
+// Fixed-size stack buffer that a whole record or box line is rendered into,
+// so output goes out with a single fwrite instead of a string of fprintfs.
+struct LineBuffer {
+    char data[4096];
+    size_t length = 0;
+
+    void append(const char* str, size_t len) {
+        if (len > sizeof(data) - 1 - length) len = sizeof(data) - 1 - length;
+        memcpy(data + length, str, len);
+        length += len;
+        data[length] = '\0';
+    }
+
+    void append(const char* str) {
+        append(str, strlen(str));
+    }
+
+    void appendf(const char* fmt, ...) {
+        size_t space = sizeof(data) - length;
+        if (space <= 1) return;
+
+        va_list args;
+        va_start(args, fmt);
+        int written = vsnprintf(data + length, space, fmt, args);
+        va_end(args);
+
+        if (written > 0) {
+            length += ((size_t)written < space) ? (size_t)written : space - 1;
+        }
+    }
+
+    void repeat(const char* str, int count) {
+        size_t len = strlen(str);
+        for (int i = 0; i < count; i++) append(str, len);
+    }
+};
+
+// ============================================================================
+// Format Buffers (growable, per thread)
+// ============================================================================
+
+// Growable buffer that log messages and records are formatted into. Starts
+// in its inline storage and moves to the heap the first time a message
+// outgrows it; the memory is kept for the thread's later records, so steady
+// state logging does not allocate. If the heap is exhausted the text is
+// truncated, as with LineBuffer.
+struct FormatBuffer {
+    char inlineData[512];
+    char* data = inlineData;
+    size_t capacity = sizeof(inlineData);
+    size_t length = 0;
+
+    FormatBuffer() { inlineData[0] = '\0'; }
+    FormatBuffer(const FormatBuffer&) = delete;
+    FormatBuffer& operator=(const FormatBuffer&) = delete;
+    ~FormatBuffer() {
+        if (data != inlineData) free(data);
+    }
+
+    void clear() {
+        length = 0;
+        data[0] = '\0';
+    }
+
+    // Make room for extra more characters (plus the terminator)
+    bool reserve(size_t extra) {
+        size_t needed = length + extra + 1;
+        if (needed <= capacity) return true;
+
+        size_t grown = capacity * 2;
+        while (grown < needed) grown *= 2;
+        char* heap = (char*)malloc(grown);
+        if (!heap) return false;
+        memcpy(heap, data, length + 1);
+        if (data != inlineData) free(data);
+        data = heap;
+        capacity = grown;
+        return true;
+    }
+
+    void append(const char* str, size_t len) {
+        if (!reserve(len)) len = capacity - 1 - length;
+        memcpy(data + length, str, len);
+        length += len;
+        data[length] = '\0';
+    }
+
+    void append(const char* str) {
+        append(str, strlen(str));
+    }
+
+    void appendv(const char* fmt, va_list args) {
+        va_list retry;
+        va_copy(retry, args);
+        size_t space = capacity - length;
+        int written = vsnprintf(data + length, space, fmt, args);
+        if (written > 0 && (size_t)written >= space) {
+            if (reserve((size_t)written)) {
+                space = capacity - length;
+                written = vsnprintf(data + length, space, fmt, retry);
+            } else {
+                written = (int)(space - 1);
+            }
+        }
+        va_end(retry);
+
+        if (written > 0) {
+            length += ((size_t)written < space) ? (size_t)written : space - 1;
+        }
+        data[length] = '\0';
+    }
+
+    void appendf(const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        appendv(fmt, args);
+        va_end(args);
+    }
+
+    void repeat(const char* str, int count) {
+        size_t len = strlen(str);
+        for (int i = 0; i < count; i++) append(str, len);
+    }
+};
+
+// Each thread keeps a few buffers so logging from inside a log observer
+// (which runs while the outer record's buffers are in use) still has its
+// own; nesting deeper than that falls back to a temporary buffer.
+constexpr int kFormatBufferDepth = 4;
+
+struct FormatBufferPool {
+    FormatBuffer buffers[kFormatBufferDepth];
+    int depth = 0;
+};
+
+inline FormatBufferPool& formatBufferPool() {
+    thread_local FormatBufferPool pool;
+    return pool;
+}
+
+// Borrow a cleared buffer from this thread's pool for the current scope
+class ScopedFormatBuffer {
+public:
+    ScopedFormatBuffer() : pool_(formatBufferPool()) {
+        if (pool_.depth < kFormatBufferDepth) {
+            buffer_ = &pool_.buffers[pool_.depth];
+            buffer_->clear();
+        } else {
+            buffer_ = &overflow_;
+        }
+        pool_.depth++;
+    }
+
+    ~ScopedFormatBuffer() {
+        pool_.depth--;
+    }
+
+    ScopedFormatBuffer(const ScopedFormatBuffer&) = delete;
+    ScopedFormatBuffer& operator=(const ScopedFormatBuffer&) = delete;
+
+    FormatBuffer& operator*() { return *buffer_; }
+    FormatBuffer* operator->() { return buffer_; }
+
+private:
+    FormatBufferPool& pool_;
+    FormatBuffer* buffer_;
+    FormatBuffer overflow_;
+};
+
+// ============================================================================
+// Log Records
+// ============================================================================
+
+// Everything needed to render one log line, captured on the calling thread.
+struct LogEvent {
+    const char* level;      // String literal ("INFO", "ENTER", ...)
+    LogLevel severity;      // Drives color; ENTER/EXIT records use LVL_INFO
+    uint32_t outputs;       // kPrimaryOutput | sinkOutputBit(id) of accepting outputs
+    const char* file;       // __FILE__ of the call site
+    const char* fileName;   // Its basename (points into file)
+    int line;
+    DWORD tid;
+    CorrelationId cid;
+    uint64_t spanId;        // Innermost span when logged (0 = none)
+    uint64_t parentSpanId;
+    double timestamp;       // ms since first log (getTimestampMs)
+    double delta;           // ms since previous log
+    size_t memory;          // memoryMark(), 0 when memory tracking is off
+    size_t lastMemory;      // Previous mark, kNoMemorySample when there is none
+};
+
+enum class RecordKind : uint32_t {
+    LOG,        // LogEvent + message, formatted by the writer
+    TEXT,       // Pre-rendered output (boxes, banners), written verbatim
+    OVERSIZE    // LOG whose message did not fit: text holds a malloc'd copy
+};
+
+// Record text size is chosen so a queue cell (sequence + record) is 1 KB.
+constexpr size_t kLogRecordTextSize =
+    1024 - sizeof(std::atomic<size_t>) - sizeof(LogEvent) - 2 * sizeof(uint32_t);
+
+struct LogRecord {
+    LogEvent event;
+    RecordKind kind;
+    uint32_t length;
+    char text[kLogRecordTextSize];
+};
+
+// The message of a LOG or OVERSIZE record
+inline const char* recordMessage(const LogRecord& rec) {
+    if (rec.kind != RecordKind::OVERSIZE) return rec.text;
+    const char* message;
+    memcpy(&message, rec.text, sizeof(message));
+    return message;
+}
+
+// Whoever consumes an OVERSIZE record frees its message
+inline void releaseRecord(LogRecord& rec) {
+    if (rec.kind == RecordKind::OVERSIZE) free((void*)recordMessage(rec));
+}
+
+// ============================================================================
+// Record Formatting
+// ============================================================================
+
+inline const char* getLevelColor(LogLevel level) {
+    switch (level) {
+        case LogLevel::LVL_DEBUG:    return colors::LVL_DEBUG;
+        case LogLevel::LVL_INFO:     return colors::LVL_INFO;
+        case LogLevel::LVL_WARN:     return colors::LVL_WARN;
+        case LogLevel::LVL_ERROR:    return colors::LVL_ERROR;
+        case LogLevel::LVL_CRITICAL: return colors::LVL_CRITICAL;
+        default:                     return colors::RESET;
+    }
+}
+
+// Map a level name back to a severity (legacy string API)
+inline LogLevel levelFromName(const char* level) {
+    if (strcmp(level, "DEBUG") == 0) return LogLevel::LVL_DEBUG;
+    if (strcmp(level, "WARN") == 0)  return LogLevel::LVL_WARN;
+    if (strcmp(level, "ERROR") == 0) return LogLevel::LVL_ERROR;
+    if (strcmp(level, "CRIT") == 0)  return LogLevel::LVL_CRITICAL;
+    return LogLevel::LVL_INFO;
+}
+
+// Render one record in a text format (RICH without colors renders as TEXT)
+inline void formatLogLine(const LogEvent& ev, const char* message, LogFormat format,
+                          bool useColors, FormatBuffer& out) {
+    char filename[64];
+    formatFilename(ev.fileName, 20, filename, sizeof(filename));
+    char memDelta[32];
+    size_t memDeltaLen = 0;
+    if (ev.memory > 0) {
+        memDeltaLen = formatMemoryDelta(ev.memory, ev.lastMemory, memDelta);
+    }
+
+    if (format == LogFormat::JSON) {
+        // JSON format
+        out.appendf("{\"ts\":%.3f,\"delta\":%.3f,\"level\":\"%s\",\"tid\":%lu,\"cid\":%llu,\"file\":\"",
+            ev.timestamp, ev.delta, ev.level, ev.tid, ev.cid);
+        appendJsonEscaped(out, filename);
+        out.appendf("\",\"line\":%d,\"msg\":\"", ev.line);
+        appendJsonEscaped(out, message);
+        out.append("\"");
+
+        if (ev.spanId != 0) {
+            out.appendf(",\"span\":%llu,\"parent\":%llu", ev.spanId, ev.parentSpanId);
+        }
+        if (ev.memory > 0) {
+            out.appendf(",\"mem\":%zu", ev.memory);
+        }
+        out.append("}\n");
+    }
+    else if (format == LogFormat::RICH && useColors) {
+        // Rich-style colored output
+        // Format: [HH:MM:SS.mmm] [+delta] LEVEL    Message                  file.cpp:123
+
+        char timeStr[16];
+        size_t timeLen = formatWallClock(ev.timestamp, timeStr);
+        const char* levelColor = getLevelColor(ev.severity);
+
+        // Build location string
+        char location[96];
+        int locationLen = snprintf(location, sizeof(location), "%s:%d", filename, ev.line);
+
+        // Build delta string
+        char deltaStr[16];
+        size_t deltaLen = config().includeDeltaTime ? formatDelta(ev.delta, deltaStr) : 0;
+
+        // Calculate base content length for padding
+        int baseLen = (int)timeLen + 3;  // [time]
+        if (config().includeDeltaTime) baseLen += (int)deltaLen + 3;  // [delta]
+        baseLen += 9;  // LEVEL + space
+        baseLen += (int)strlen(message);
+        baseLen += locationLen + 2;
+
+        int padding = config().boxWidth - baseLen;
+        if (padding < 1) padding = 1;
+
+        // Timestamp
+        out.appendf("%s[%s]%s ", colors::TIMESTAMP, timeStr, colors::RESET);
+
+        // Delta time if enabled
+        if (config().includeDeltaTime) {
+            out.appendf("%s[%7s]%s ", colors::DELTA, deltaStr, colors::RESET);
+        }
+
+        // Level
+        out.appendf("%s%-8s%s ", levelColor, ev.level, colors::RESET);
+
+        // Message
+        out.append(message);
+
+        // Memory delta if enabled
+        if (memDeltaLen > 0) {
+            out.appendf("%s%s%s", colors::MEMORY, memDelta, colors::RESET);
+        }
+
+        // Right-align location
+        out.appendf("%*s%s%s%s\n", padding, "", colors::LOCATION, location, colors::RESET);
+    }
+    else {
+        // Plain text format
+        char timeStr[16];
+        formatWallClock(ev.timestamp, timeStr);
+
+        out.appendf("[%s]", timeStr);
+        if (config().includeDeltaTime) {
+            char deltaStr[16];
+            formatDelta(ev.delta, deltaStr);
+            out.appendf(" [%7s]", deltaStr);
+        }
+        out.appendf(" %-8s ", ev.level);
+        out.append(message);
+        out.appendf("    %s:%d\n", filename, ev.line);
+    }
+}
+
+inline void writeOutput(const char* data, size_t len) {
+    const LogOutputSink* sink = config().sink;
+    if (sink) {
+        sink->write(data, len);
+    } else {
+        fwrite(data, 1, len, config().output);
+    }
+}
+
+// force: explicit flushes and crash handlers, not just a record boundary
+inline void flushOutput(bool force = false) {
+    const LogOutputSink* sink = config().sink;
+    if (sink) {
+        sink->flush(force);
+    } else {
+        fflush(config().output);
+    }
+}
+
+// ============================================================================
+// Log Sinks
+// ============================================================================
+//
+// Extra outputs next to the primary one (config().output/sink/format), each
+// with its own level threshold and format: e.g. Rich on the console at WARN
+// while JSON goes to a file at INFO. Call sites cache which outputs accept
+// them, and a record is rendered at most once per distinct style and never
+// for outputs that filter it out. Boxes and banners stay on the primary.
+
+constexpr int kMaxLogSinks = 8;
+constexpr uint32_t kPrimaryOutput = 1;
+
+inline constexpr uint32_t sinkOutputBit(int id) { return 2u << id; }
+
+struct LogSink {
+    LogFormat format;               // RICH (colored), TEXT or JSON
+    FILE* output;                   // Used when writer is null
+    const LogOutputSink* writer;
+    // Structured sinks (ETW) get the unformatted event instead, on the
+    // logging thread before async queuing
+    void (*onEvent)(const LogEvent& ev, int64_t rawTime, const char* message);
+};
+
+// Append-only like the observer lists; a sink is retired by setting its
+// level to LVL_OFF
+struct LogSinkRegistry {
+    SRWLOCK lock = SRWLOCK_INIT;
+    std::atomic<int> count{0};
+    LogSink sinks[kMaxLogSinks] = {};
+    std::atomic<uint8_t> minLevel[kMaxLogSinks];
+    std::atomic<uint32_t> eventOutputs{0};  // sinkOutputBit of structured sinks
+};
+
+inline LogSinkRegistry& logSinks() {
+    static LogSinkRegistry registry;
+    return registry;
+}
+
+// Sink bits for a record of this severity (no primary bit)
+inline uint32_t sinkOutputsFor(LogLevel severity) {
+    const LogSinkRegistry& reg = logSinks();
+    int n = reg.count.load(std::memory_order_acquire);
+    uint32_t outputs = 0;
+    for (int i = 0; i < n; i++) {
+        if ((uint8_t)severity >= reg.minLevel[i].load(std::memory_order_relaxed)) {
+            outputs |= sinkOutputBit(i);
+        }
+    }
+    return outputs;
+}
+
+// Outputs for a record without a call site: the global level, then the sinks
+inline uint32_t logOutputsFor(LogLevel severity) {
+    LogLevel threshold = config().minLevel.load(std::memory_order_relaxed);
+    return (severity >= threshold ? kPrimaryOutput : 0) | sinkOutputsFor(severity);
+}
+
+inline void writeSink(const LogSink& sink, const char* data, size_t len) {
+    if (sink.writer) {
+        sink.writer->write(data, len);
+    } else {
+        fwrite(data, 1, len, sink.output);
+    }
+}
+
+inline void flushSink(const LogSink& sink, bool force) {
+    if (sink.writer) {
+        sink.writer->flush(force);
+    } else {
+        fflush(sink.output);
+    }
+}
+
+inline void flushSinks(bool force = false) {
+    const LogSinkRegistry& reg = logSinks();
+    int n = reg.count.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        if (!reg.sinks[i].onEvent) flushSink(reg.sinks[i], force);
+    }
+}
+
+// Hand a record to the structured sinks among `outputs`
+inline void dispatchLogEvent(const LogEvent& ev, int64_t rawTime, const char* message,
+                             uint32_t outputs) {
+    const LogSinkRegistry& reg = logSinks();
+    int n = reg.count.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        if (outputs & sinkOutputBit(i)) reg.sinks[i].onEvent(ev, rawTime, message);
+    }
+}
+
+// Write a text record to every output in ev.outputs. Each style (JSON, Rich,
+// plain) is rendered on first use into one shared buffer. flush: after each
+// output (synchronous logging) rather than once per batch.
+inline void writeLogEvent(const LogEvent& ev, const char* message, bool flush) {
+    enum { STYLE_JSON, STYLE_RICH, STYLE_TEXT, STYLE_COUNT };
+    size_t begin[STYLE_COUNT];
+    size_t end[STYLE_COUNT];
+    for (int i = 0; i < STYLE_COUNT; i++) begin[i] = SIZE_MAX;
+
+    ScopedFormatBuffer out;
+    auto render = [&](LogFormat format, bool useColors, size_t& len) -> const char* {
+        int style = (format == LogFormat::JSON) ? STYLE_JSON
+            : (format == LogFormat::RICH && useColors) ? STYLE_RICH : STYLE_TEXT;
+        if (begin[style] == SIZE_MAX) {
+            begin[style] = out->length;
+            formatLogLine(ev, message, format, useColors, *out);
+            end[style] = out->length;
+        }
+        len = end[style] - begin[style];
+        return out->data + begin[style];
+    };
+
+    size_t len;
+    if (ev.outputs & kPrimaryOutput) {
+        const char* text = render(config().format, config().useColors, len);
+        writeOutput(text, len);
+        if (flush) flushOutput();
+    }
+
+    const LogSinkRegistry& reg = logSinks();
+    int n = reg.count.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        if (!(ev.outputs & sinkOutputBit(i))) continue;
+        const LogSink& sink = reg.sinks[i];
+        const char* text = render(sink.format, true, len);
+        writeSink(sink, text, len);
+        if (flush) flushSink(sink, false);
+    }
+}
+
+// ============================================================================
+// Asynchronous Logging
+// ============================================================================
+//
+// Optional backend that moves formatting and I/O off the calling thread.
+// Producers claim a slot in a bounded MPMC ring (Vyukov-style sequence
+// numbers, no locks) and fill the record in place; a dedicated writer thread
+// formats queued records and flushes once per batch. The crash handlers move
+// what is still queued into the crash report, so lines are not lost on
+// terminate().
+
+enum class AsyncOverflow {
+    DROP,               // Discard the new record (default)
+    BLOCK,              // Wait for the writer to make room
+    OVERWRITE_OLDEST    // Discard the oldest queued record instead
+};
+
+struct alignas(64) LogQueueCell {
+    std::atomic<size_t> sequence;
+    LogRecord record;
+};
+
+static_assert(sizeof(LogQueueCell) == 1024, "queue cell should be 1 KB");
+
+struct AsyncLogState {
+    LogQueueCell* cells = nullptr;
+    size_t mask = 0;
+    AsyncOverflow policy = AsyncOverflow::DROP;
+
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+    alignas(64) std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> droppedReported{0};   // Advanced by whoever drains
+
+    alignas(64) std::atomic<int> producers{0};  // Between running check and publish
+
+    std::atomic<bool> running{false};
+    std::atomic<bool> writerSleeping{false};
+    HANDLE wakeEvent = NULL;
+    HANDLE writerThread = NULL;
+    DWORD flushIntervalMs = 10;
+};
+
+inline AsyncLogState& asyncState() {
+    static AsyncLogState state;
+    return state;
+}
+
+inline bool isAsyncLogging() {
+    return asyncState().running.load(std::memory_order_acquire);
+}
+
+// Counts the calling thread as a producer while async logging is on, so
+// disableAsyncLogging() can wait for records that passed the running check
+// before it does its final drain.
+class AsyncProducerScope {
+public:
+    AsyncProducerScope() {
+        AsyncLogState& q = asyncState();
+        if (!q.running.load(std::memory_order_relaxed)) return;
+        // seq_cst on both sides: either disable sees us counted, or we see
+        // running cleared
+        q.producers.fetch_add(1, std::memory_order_seq_cst);
+        active_ = q.running.load(std::memory_order_seq_cst);
+        if (!active_) q.producers.fetch_sub(1, std::memory_order_release);
+    }
+
+    ~AsyncProducerScope() {
+        if (active_) asyncState().producers.fetch_sub(1, std::memory_order_release);
+    }
+
+    AsyncProducerScope(const AsyncProducerScope&) = delete;
+    AsyncProducerScope& operator=(const AsyncProducerScope&) = delete;
+
+    bool active() const { return active_; }
+
+private:
+    bool active_ = false;
+};
+
+// Claim the next free cell. Returns nullptr when the ring is full.
+inline LogQueueCell* asyncTryClaim(size_t& pos) {
+    AsyncLogState& q = asyncState();
+    pos = q.enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        LogQueueCell* cell = &q.cells[pos & q.mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (q.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return cell;
+            }
+        } else if (diff < 0) {
+            return nullptr;
+        } else {
+            pos = q.enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+inline void asyncPublish(LogQueueCell* cell, size_t pos) {
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    // Pairs with the fence in asyncWriterMain: store-then-load on both sides,
+    // so either the writer sees this record or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    AsyncLogState& q = asyncState();
+    if (q.writerSleeping.load(std::memory_order_relaxed)) {
+        SetEvent(q.wakeEvent);
+    }
+}
+
+// Pop the oldest published record. The callback sees the record in place.
+// Returns false when the ring is empty (or the next slot is still being
+// written by a producer).
+template <typename Fn>
+inline bool asyncTryConsume(Fn&& fn) {
+    AsyncLogState& q = asyncState();
+    size_t pos = q.dequeuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        LogQueueCell* cell = &q.cells[pos & q.mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (q.dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                fn(cell->record);
+                cell->sequence.store(pos + q.mask + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = q.dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Claim a cell according to the overflow policy. nullptr means dropped, or
+// (BLOCK) that the writer stopped while waiting: isAsyncLogging() is false
+// then and the caller writes synchronously.
+inline LogQueueCell* asyncClaim(size_t& pos) {
+    AsyncLogState& q = asyncState();
+    for (;;) {
+        LogQueueCell* cell = asyncTryClaim(pos);
+        if (cell) return cell;
+
+        switch (q.policy) {
+            case AsyncOverflow::DROP:
+                q.dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            case AsyncOverflow::BLOCK:
+                // Nobody will make room once the writer is gone
+                if (!q.running.load(std::memory_order_acquire)) return nullptr;
+                SetEvent(q.wakeEvent);
+                SwitchToThread();
+                break;
+            case AsyncOverflow::OVERWRITE_OLDEST:
+                if (asyncTryConsume([](LogRecord& rec) { releaseRecord(rec); })) {
+                    q.dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+        }
+    }
+}
+
+inline void writeRecord(LogRecord& rec) {
+    if (rec.kind == RecordKind::TEXT) {
+        writeOutput(rec.text, rec.length);
+        return;
+    }
+
+    writeLogEvent(rec.event, recordMessage(rec), false);
+    releaseRecord(rec);
+}
+
+// Drain everything currently queued. Safe to call from any thread, including
+// a crash handler racing the writer thread.
+inline size_t drainAsyncLog() {
+    AsyncLogState& q = asyncState();
+    if (!q.cells) return 0;
+
+    size_t count = 0;
+    while (asyncTryConsume([](LogRecord& rec) { writeRecord(rec); })) {
+        count++;
+    }
+
+    // Crash handlers drain concurrently with the writer; only the caller
+    // that moves droppedReported forward reports that range
+    uint64_t dropped = q.dropped.load(std::memory_order_relaxed);
+    uint64_t reported = q.droppedReported.load(std::memory_order_relaxed);
+    while (dropped > reported &&
+           !q.droppedReported.compare_exchange_weak(reported, dropped, std::memory_order_relaxed)) {
+    }
+    if (dropped > reported) {
+        LineBuffer out;
+        out.appendf("[debug_log] %llu records dropped (async queue full)\n",
+            (unsigned long long)(dropped - reported));
+        writeOutput(out.data, out.length);
+    }
+
+    if (count > 0) {
+        flushOutput();
+        flushSinks();
+    }
+    return count;
+}
+
+inline DWORD WINAPI asyncWriterMain(LPVOID) {
+    AsyncLogState& q = asyncState();
+    while (q.running.load(std::memory_order_acquire)) {
+        if (drainAsyncLog() == 0) {
+            q.writerSleeping.store(true, std::memory_order_relaxed);
+            // Re-check after announcing we're asleep. The fence (paired with
+            // asyncPublish's) keeps the check from being ordered before the
+            // store, which would lose the wakeup for a record published in
+            // between.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!asyncTryConsume([](LogRecord& rec) { writeRecord(rec); })) {
+                WaitForSingleObject(q.wakeEvent, q.flushIntervalMs);
+            }
+            q.writerSleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+    drainAsyncLog();
+    return 0;
+}
+
+/**
+ * Flush queued async records synchronously on the calling thread, then the
+ * output stream. Used by crash handlers.
+ */
+inline void flushAsyncLog() {
+    if (asyncState().cells) drainAsyncLog();
+    flushOutput(true);
+    flushSinks(true);
+}
+
+inline uint64_t asyncDroppedCount() {
+    return asyncState().dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * Stop the writer thread after draining the queue. Synchronous logging
+ * resumes immediately.
+ */
+inline void disableAsyncLogging() {
+    AsyncLogState& q = asyncState();
+    if (!q.running.exchange(false, std::memory_order_seq_cst)) return;
+
+    SetEvent(q.wakeEvent);
+    WaitForSingleObject(q.writerThread, INFINITE);
+    CloseHandle(q.writerThread);
+    q.writerThread = NULL;
+
+    // Producers that saw running before it was cleared finish publishing
+    // (or fall back to writing synchronously) before the final drain
+    while (q.producers.load(std::memory_order_acquire) != 0) SwitchToThread();
+
+    // Catch records published between the writer's last drain and now
+    flushAsyncLog();
+}
+
+/**
+ * Route log output through a background writer thread.
+ * @param capacity Queue size in records (rounded up to a power of two, 1 KB
+ *                 each); fixed by the first call
+ * @param policy   What producers do when the queue is full
+ */
+inline bool enableAsyncLogging(size_t capacity = 4096,
+                               AsyncOverflow policy = AsyncOverflow::DROP) {
+    AsyncLogState& q = asyncState();
+    if (q.running.load(std::memory_order_acquire)) return true;
+
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+
+    // The ring is allocated once and never freed or reset: late producers
+    // and crash handlers may still index it after a disable. Re-enabling
+    // continues from the positions left behind.
+    if (!q.cells) {
+        LogQueueCell* cells = new LogQueueCell[size];
+        for (size_t i = 0; i < size; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        q.mask = size - 1;
+        q.cells = cells;
+    } else if (q.mask + 1 != size) {
+        fprintf(stderr, "[rippled_debug] Async queue keeps its first capacity (%zu records)\n",
+            q.mask + 1);
+    }
+    q.policy = policy;
+
+    if (!q.wakeEvent) {
+        q.wakeEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (!q.wakeEvent) return false;
+        atexit([] { disableAsyncLogging(); });
+    }
+
+    q.running.store(true, std::memory_order_release);
+    q.writerThread = CreateThread(NULL, 0, asyncWriterMain, NULL, 0, NULL);
+    if (!q.writerThread) {
+        q.running.store(false, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Call Sites
+// ============================================================================
+
+// One static instance per DEBUG_* macro expansion. Constant-initialized, so
+// the macros pay no guard check. The site registers itself (ID, format
+// classification, registry link) the first time it is reached, and caches
+// which outputs accept it until the filter rules or sinks change.
+struct LogSite {
+    LogLevel level;
+    const char* levelName;
+    const char* file;
+    const char* fileName;                   // Basename, computed at compile time
+    int line;
+    const char* fmt;
+
+    std::atomic<uint32_t> state{0};         // SITE_* below
+    std::atomic<uint32_t> filter{0};        // (filter generation << kSiteOutputBits) | outputs
+    std::atomic<uint32_t> emittedEpoch{0};  // Binary stream that has our 'S' record
+    std::atomic<int64_t> rateTat{0};        // Rate limiter: theoretical arrival time (QPC)
+    std::atomic<uint32_t> suppressed{0};    // Lines dropped by it since the last report
+    uint32_t id = 0;
+    int argCount = 0;                       // -1: format eagerly
+    uint8_t argTypes[binlog::kMaxArgs] = {};
+    LogSite* next = nullptr;
+
+    constexpr LogSite(LogLevel lvl, const char* f, int l, const char* fm)
+        : level(lvl), levelName(nullptr), file(f), fileName(fileBasename(f)), line(l), fmt(fm) {}
+
+    inline uint32_t outputs();
+    bool isEnabled() { return outputs() != 0; }
+    inline bool admit();
+};
+
+// Output mask (primary + one bit per sink) in the low bits of LogSite::filter
+constexpr uint32_t kSiteOutputBits = 1 + kMaxLogSinks;
+constexpr uint32_t kSiteOutputMask = (1u << kSiteOutputBits) - 1;
+
+enum : uint32_t {
+    SITE_UNREGISTERED = 0,
+    SITE_READY = 1
+};
+
+// Runtime per-file-glob level override
+struct LogLevelRule {
+    std::string glob;
+    LogLevel minLevel;
+};
+
+struct LogSiteRegistry {
+    SRWLOCK lock = SRWLOCK_INIT;
+    LogSite* head = nullptr;
+    uint32_t nextId = 1;
+    std::vector<LogLevelRule> rules;        // Later rules win
+    std::atomic<uint32_t> generation{1};    // Bumped on every filter change
+};
+
+inline LogSiteRegistry& logSiteRegistry() {
+    static LogSiteRegistry registry;
+    return registry;
+}
+
+// Case-insensitive glob ('*', '?'); '/' and '\\' compare equal
+inline bool globMatch(const char* pattern, const char* str) {
+    auto fold = [](char c) -> char {
+        if (c == '\\') return '/';
+        return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    };
+
+    const char* starP = nullptr;
+    const char* starS = nullptr;
+    while (*str) {
+        if (*pattern == '*') {
+            starP = pattern++;
+            starS = str;
+        } else if (*pattern == '?' || (*pattern && fold(*pattern) == fold(*str))) {
+            pattern++;
+            str++;
+        } else if (starP) {
+            pattern = starP + 1;
+            str = ++starS;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') pattern++;
+    return *pattern == '\0';
+}
+
+// Slow path, once per site
+inline void registerLogSite(LogSite& site) {
+    LogSiteRegistry& reg = logSiteRegistry();
+    AcquireSRWLockExclusive(&reg.lock);
+    if (site.state.load(std::memory_order_relaxed) != SITE_READY) {
+        site.id = reg.nextId++;
+        site.levelName = levelName(site.level);
+        site.argCount = binlog::classifyFormat(site.fmt, site.argTypes, binlog::kMaxArgs);
+        site.next = reg.head;
+        reg.head = &site;
+        site.state.store(SITE_READY, std::memory_order_release);
+    }
+    ReleaseSRWLockExclusive(&reg.lock);
+}
+
+// Re-evaluate a site against the global level, glob rules and sink levels
+inline uint32_t refreshLogSite(LogSite& site) {
+    if (site.state.load(std::memory_order_acquire) != SITE_READY) {
+        registerLogSite(site);
+    }
+
+    LogSiteRegistry& reg = logSiteRegistry();
+    AcquireSRWLockShared(&reg.lock);
+    // Acquire pairs with the bump in setLogLevel: a site stamped with this
+    // generation has seen the threshold stored before it
+    uint32_t gen = reg.generation.load(std::memory_order_acquire);
+
+    LogLevel threshold = config().minLevel.load(std::memory_order_relaxed);
+    for (const LogLevelRule& rule : reg.rules) {
+        if (globMatch(rule.glob.c_str(), site.file) || globMatch(rule.glob.c_str(), site.fileName)) {
+            threshold = rule.minLevel;
+        }
+    }
+    ReleaseSRWLockShared(&reg.lock);
+
+    uint32_t outputs = (site.level >= threshold ? kPrimaryOutput : 0) | sinkOutputsFor(site.level);
+    uint32_t value = (gen << kSiteOutputBits) | outputs;
+    site.filter.store(value, std::memory_order_relaxed);
+    return value;
+}
+
+// Hot path: one load of the site's cached state plus the shared generation
+inline uint32_t LogSite::outputs() {
+    if (!config().enabled) return 0;
+
+    uint32_t value = filter.load(std::memory_order_relaxed);
+    uint32_t gen = logSiteRegistry().generation.load(std::memory_order_relaxed);
+    if ((value >> kSiteOutputBits) != (gen & (UINT32_MAX >> kSiteOutputBits))) {
+        value = refreshLogSite(*this);
+    }
+    return value & kSiteOutputMask;
+}
+
+// Rate limit shared by all call sites: a per-site token bucket, run as GCRA
+// (one theoretical-arrival-time per site, advanced by compare-exchange)
+struct LogRateLimit {
+    std::atomic<int64_t> interval{0};       // QPC ticks per line (0 = unlimited)
+    std::atomic<int64_t> tolerance{0};      // interval * (burst - 1)
+};
+
+inline LogRateLimit& logRateLimit() {
+    static LogRateLimit limit;
+    return limit;
+}
+
+// Take a token for one line. Lock-free; a single relaxed load when no limit
+// is set. Suppressed lines are counted and never formatted.
+inline bool LogSite::admit() {
+    const LogRateLimit& limit = logRateLimit();
+    int64_t interval = limit.interval.load(std::memory_order_relaxed);
+    if (interval == 0) return true;
+
+    int64_t now = getRawTimestamp();
+    int64_t tat = rateTat.load(std::memory_order_relaxed);
+    for (;;) {
+        int64_t base = (tat > now) ? tat : now;
+        if (base - now > limit.tolerance.load(std::memory_order_relaxed)) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (rateTat.compare_exchange_weak(tat, base + interval, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+inline void bumpLogFilterGeneration() {
+    logSiteRegistry().generation.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * Set the runtime level threshold for all call sites without an override.
+ * Cannot re-enable levels removed by RIPPLED_DEBUG_MIN_LEVEL.
+ */
+inline void setLogLevel(LogLevel minLevel) {
+    config().minLevel.store(minLevel, std::memory_order_release);
+    bumpLogFilterGeneration();
+}
+
+/**
+ * Override the threshold for call sites whose file matches a glob, e.g.
+ * setLogLevelFor("*overlay*", LogLevel::LVL_DEBUG) or
+ * setLogLevelFor("PeerImp.cpp", LogLevel::LVL_OFF). Later rules win.
+ */
+inline void setLogLevelFor(const char* fileGlob, LogLevel minLevel) {
+    LogSiteRegistry& reg = logSiteRegistry();
+    AcquireSRWLockExclusive(&reg.lock);
+    reg.rules.push_back(LogLevelRule{fileGlob, minLevel});
+    ReleaseSRWLockExclusive(&reg.lock);
+    bumpLogFilterGeneration();
+}
+
+inline void clearLogLevelOverrides() {
+    LogSiteRegistry& reg = logSiteRegistry();
+    AcquireSRWLockExclusive(&reg.lock);
+    reg.rules.clear();
+    ReleaseSRWLockExclusive(&reg.lock);
+    bumpLogFilterGeneration();
+}
+
+inline int registerLogSink(const LogSink& sink, LogLevel minLevel) {
+    LogSinkRegistry& reg = logSinks();
+    AcquireSRWLockExclusive(&reg.lock);
+    int id = reg.count.load(std::memory_order_relaxed);
+    if (id < kMaxLogSinks) {
+        reg.sinks[id] = sink;
+        reg.minLevel[id].store((uint8_t)minLevel, std::memory_order_relaxed);
+        if (sink.onEvent) reg.eventOutputs.fetch_or(sinkOutputBit(id), std::memory_order_relaxed);
+        reg.count.store(id + 1, std::memory_order_release);
+    } else {
+        id = -1;
+    }
+    ReleaseSRWLockExclusive(&reg.lock);
+
+    if (id < 0) {
+        fprintf(stderr, "[rippled_debug] Too many log sinks (max %d)\n", kMaxLogSinks);
+        return -1;
+    }
+    bumpLogFilterGeneration();
+    return id;
+}
+
+/**
+ * Add an output with its own threshold and format, alongside the primary
+ * one. RICH sinks always use colors. BINARY is only supported on the primary
+ * output (the flight recorder keeps binary records of every level anyway).
+ * @return Sink ID for setLogSinkLevel(), or -1 if the format is BINARY or
+ *         kMaxLogSinks are registered
+ */
+inline int addLogSink(LogLevel minLevel, LogFormat format, FILE* output,
+                      const LogOutputSink* writer = nullptr) {
+    if (format == LogFormat::BINARY) {
+        fprintf(stderr, "[rippled_debug] BINARY is only supported on the primary output\n");
+        return -1;
+    }
+    enableAnsiSupport();
+    return registerLogSink(LogSink{format, output, writer, nullptr}, minLevel);
+}
+
+inline int addLogSink(LogLevel minLevel, LogFormat format, const LogOutputSink* writer) {
+    return addLogSink(minLevel, format, nullptr, writer);
+}
+
+/**
+ * Add a structured sink: onEvent receives each accepted record unformatted,
+ * synchronously on the logging thread (even in async mode), so it can stamp
+ * its own time and thread. Used by the ETW backend.
+ */
+inline int addLogEventSink(LogLevel minLevel,
+                           void (*onEvent)(const LogEvent& ev, int64_t rawTime, const char* message)) {
+    return registerLogSink(LogSink{LogFormat::TEXT, nullptr, nullptr, onEvent}, minLevel);
+}
+
+// LVL_OFF retires the sink (its slot is not reused)
+inline void setLogSinkLevel(int id, LogLevel minLevel) {
+    if (id < 0 || id >= logSinks().count.load(std::memory_order_acquire)) return;
+    logSinks().minLevel[id].store((uint8_t)minLevel, std::memory_order_relaxed);
+    bumpLogFilterGeneration();
+}
+
+/**
+ * Allow each call site at most perSecond lines, in bursts of up to burst
+ * (0 turns limiting off). Applies to the DEBUG_* macros; the count of
+ * suppressed lines is logged with the site's next line that gets through,
+ * or by reportSuppressedLogs().
+ */
+inline void setLogRateLimit(double perSecond, uint32_t burst = 10) {
+    LogRateLimit& limit = logRateLimit();
+    if (perSecond <= 0) {
+        limit.interval.store(0, std::memory_order_relaxed);
+        return;
+    }
+    int64_t interval = (int64_t)((double)clockState().frequency.load(std::memory_order_relaxed) / perSecond);
+    if (interval < 1) interval = 1;
+    limit.tolerance.store(interval * (int64_t)(burst > 1 ? burst - 1 : 0), std::memory_order_relaxed);
+    limit.interval.store(interval, std::memory_order_relaxed);
+}
+
+/**
+ * Print every call site reached so far with its current state.
+ */
+inline void printLogSites(FILE* output = stderr) {
+    LogSiteRegistry& reg = logSiteRegistry();
+    AcquireSRWLockShared(&reg.lock);
+    std::vector<LogSite*> sites;
+    for (LogSite* site = reg.head; site; site = site->next) sites.push_back(site);
+    ReleaseSRWLockShared(&reg.lock);
+
+    for (LogSite* site : sites) {
+        bool enabled = site->isEnabled();
+        uint32_t suppressed = site->suppressed.load(std::memory_order_relaxed);
+        fprintf(output, "%4u %-5s %-3s %s:%d", site->id, site->levelName,
+            enabled ? "on" : "off", extractFilename(site->file, 40).c_str(), site->line);
+        if (suppressed != 0) fprintf(output, " (%u suppressed)", suppressed);
+        fputc('\n', output);
+    }
+    fflush(output);
+}
+
+// ============================================================================
+// Binary Log Encoding
+// ============================================================================
+//
+// LogFormat::BINARY writes records described in binary_log_format.h. The hot
+// path does no formatting: it copies the raw arguments next to the site ID.
+// Decode offline with tools/log-decoder. Open the output FILE* in "wb" mode.
+
+template <size_t Capacity>
+struct BasicBinaryWriter {
+    char data[Capacity];
+    size_t length = 0;
+    bool overflow = false;
+
+    void put(const void* src, size_t len) {
+        if (len > sizeof(data) - length) {
+            overflow = true;
+            return;
+        }
+        memcpy(data + length, src, len);
+        length += len;
+    }
+
+    template <typename T>
+    void put(T value) { put(&value, sizeof(value)); }
+
+    void putString(const char* str, size_t maxLen) {
+        size_t len = strlen(str);
+        if (len > maxLen) len = maxLen;
+        if (len > sizeof(data) - length - sizeof(uint16_t)) {
+            len = (length + sizeof(uint16_t) < sizeof(data))
+                ? sizeof(data) - length - sizeof(uint16_t) : 0;
+        }
+        put((uint16_t)len);
+        put(str, len);
+    }
+
+    void putString(const char* str) { putString(str, 0xFFFF); }
+};
+
+using BinaryWriter = BasicBinaryWriter<kLogRecordTextSize>;
+
+// Bumped whenever a new stream starts, so sites re-emit their definitions
+inline std::atomic<uint32_t>& binaryStreamEpoch() {
+    static std::atomic<uint32_t> epoch{1};
+    return epoch;
+}
+
+inline void emitBytes(const char* data, size_t len);
+
+inline void putStreamHeader(BinaryWriter& w) {
+    const ClockState& clock = clockState();
+
+    // Wall clock at the QPC origin, as local time (same origin the live
+    // formatter uses, so decoded times match)
+    uint64_t origin = wallClockOrigin();
+    FILETIME utc, local;
+    utc.dwLowDateTime = (DWORD)(origin & 0xFFFFFFFF);
+    utc.dwHighDateTime = (DWORD)(origin >> 32);
+    FileTimeToLocalFileTime(&utc, &local);
+    uint64_t wall = ((uint64_t)local.dwHighDateTime << 32) | local.dwLowDateTime;
+
+    w.put((uint8_t)binlog::TAG_HEADER);
+    w.put(binlog::kMagic, sizeof(binlog::kMagic));
+    w.put(binlog::kVersion);
+    w.put((uint8_t)sizeof(void*));
+    w.put((uint8_t)0);
+    w.put((uint64_t)clock.frequency.load(std::memory_order_relaxed));
+    w.put((uint64_t)clock.origin.load(std::memory_order_relaxed));
+    w.put(wall);
+    w.put((uint32_t)GetCurrentProcessId());
+}
+
+/**
+ * Write a stream header to the current output. Called automatically when
+ * BINARY is selected or the output changes while in BINARY mode.
+ */
+inline void beginBinaryStream() {
+    binaryStreamEpoch().fetch_add(1, std::memory_order_acq_rel);
+
+    BinaryWriter w;
+    putStreamHeader(w);
+    emitBytes(w.data, w.length);
+}
+
+inline void putSiteDefinition(BinaryWriter& w, const LogSite& site) {
+    w.put((uint8_t)binlog::TAG_SITE);
+    w.put(site.id);
+    w.put((uint32_t)site.line);
+    w.put((uint8_t)site.argCount);
+    w.put(site.argTypes, (size_t)site.argCount);
+    w.putString(site.levelName);
+    w.putString(site.file, 255);
+    w.putString(site.fmt, 512);
+}
+
+inline void emitSiteDefinition(const LogSite& site) {
+    BinaryWriter w;
+    putSiteDefinition(w, site);
+    emitBytes(w.data, w.length);
+}
+
+// Raw arguments in site.argTypes order; strings are copied, nothing is formatted
+template <typename Writer>
+inline void packLogArguments(Writer& w, const LogSite& site, va_list args) {
+    for (int i = 0; i < site.argCount && !w.overflow; i++) {
+        switch (site.argTypes[i]) {
+            case binlog::ARG_INT32:   w.put((int32_t)va_arg(args, int)); break;
+            case binlog::ARG_INT64:   w.put((int64_t)va_arg(args, long long)); break;
+            case binlog::ARG_DOUBLE:  w.put(va_arg(args, double)); break;
+            case binlog::ARG_POINTER: w.put((uint64_t)(uintptr_t)va_arg(args, void*)); break;
+            case binlog::ARG_STRING: {
+                const char* str = va_arg(args, const char*);
+                w.putString(str ? str : "(null)");
+                break;
+            }
+        }
+    }
+}
+
+// Pack a call site's arguments without formatting them
+inline void logBinary(LogSite& site, CorrelationId cid, va_list args) {
+    uint32_t epoch = binaryStreamEpoch().load(std::memory_order_acquire);
+    if (site.emittedEpoch.load(std::memory_order_relaxed) != epoch &&
+        site.emittedEpoch.exchange(epoch, std::memory_order_acq_rel) != epoch) {
+        emitSiteDefinition(site);
+    }
+
+    BinaryWriter w;
+    w.put((uint8_t)binlog::TAG_LOG);
+    w.put(site.id);
+    w.put((uint64_t)getRawTimestamp());
+    w.put((uint32_t)getThreadId());
+    w.put((uint64_t)((cid != 0) ? cid : currentCorrelationId()));
+
+    size_t lenPos = w.length;
+    w.put((uint16_t)0);
+    packLogArguments(w, site, args);
+
+    uint16_t payloadLen = (uint16_t)(w.length - lenPos - sizeof(uint16_t));
+    memcpy(w.data + lenPos, &payloadLen, sizeof(payloadLen));
+    emitBytes(w.data, w.length);
+}
+
+// Already-formatted message ('M' record)
+inline void putMessageRecord(BinaryWriter& w, int64_t rawTime, DWORD tid, CorrelationId cid,
+                             int line, const char* level, const char* file, const char* message) {
+    w.put((uint8_t)binlog::TAG_MESSAGE);
+    w.put((uint64_t)rawTime);
+    w.put((uint32_t)tid);
+    w.put((uint64_t)cid);
+    w.put((uint32_t)line);
+    w.putString(level);
+    w.putString(file, 255);
+    w.putString(message);
+}
+
+inline void logBinaryMessage(const LogEvent& ev, int64_t rawTime, const char* message) {
+    BinaryWriter w;
+    putMessageRecord(w, rawTime, ev.tid, ev.cid, ev.line, ev.level, ev.file, message);
+    emitBytes(w.data, w.length);
+}
+
+// ============================================================================
+// Flight Recorder
+// ============================================================================
+//
+// Keeps the last N records of every thread in memory - including the ones
+// below the output threshold - so crash reports and minidumps show what led
+// up to the crash. Recording does no formatting and no I/O: DEBUG_* sites
+// pack their raw arguments as in LogFormat::BINARY, pre-formatted messages
+// are copied. Each thread writes only its own ring; readers run at crash
+// time and validate every slot against its sequence number instead of
+// stopping the writers.
+
+constexpr size_t kFlightPayloadSize = 184;          // 256-byte records on x64
+constexpr uint32_t kMaxFlightRings = 512;           // Threads past this aren't recorded
+constexpr size_t kFlightStreamBytes = 4 * 1024 * 1024;
+
+enum FlightKind : uint8_t {
+    FLIGHT_PACKED,          // Call site + packed arguments
+    FLIGHT_MESSAGE,         // Already-formatted text (debugLogImpl)
+    FLIGHT_FORMAT_ONLY      // Site whose format can't be packed: format text only
+};
+
+struct FlightRecord {
+    std::atomic<uint64_t> sequence{0};  // Ring position + 1 once complete, 0 while written
+    int64_t rawTime = 0;
+    CorrelationId cid = 0;
+    const LogSite* site = nullptr;      // PACKED / FORMAT_ONLY
+    const char* level = nullptr;        // MESSAGE; static strings, as in LogEvent
+    const char* file = nullptr;
+    int line = 0;
+    FlightKind kind = FLIGHT_MESSAGE;
+    BasicBinaryWriter<kFlightPayloadSize> payload;
+};
+
+struct FlightRing {
+    DWORD tid = 0;
+    uint64_t mask = 0;
+    std::atomic<uint64_t> head{0};      // Records written so far
+    FlightRecord* records = nullptr;
+};
+
+// A validated copy of one slot
+struct FlightEntry {
+    DWORD tid;
+    int64_t rawTime;
+    CorrelationId cid;
+    const LogSite* site;
+    const char* level;
+    const char* file;
+    int line;
+    FlightKind kind;
+    size_t length;
+    char payload[kFlightPayloadSize + 1];
+};
+
+// Unread window [first, last) of one ring; head is where the reader started
+struct FlightCursor {
+    uint64_t first;
+    uint64_t last;
+    uint64_t head;
+};
+
+struct FlightRecorderState {
+    std::atomic<bool> active{false};
+    uint32_t recordsPerThread = 0;              // Fixed by the first enable
+    std::atomic<uint32_t> ringCount{0};
+    std::atomic<FlightRing*> rings[kMaxFlightRings] = {};
+
+    // Crash-time reader state, static so reading never allocates
+    volatile LONG readerBusy = 0;
+    FlightCursor cursors[kMaxFlightRings] = {};
+    uint8_t siteDefined[8192] = {};             // Bitmap of site IDs already in a stream
+    char* stream = nullptr;                     // kFlightStreamBytes, reserved up front
+};
+
+inline FlightRecorderState& flightRecorder() {
+    static FlightRecorderState state;
+    return state;
+}
+
+inline bool flightRecorderActive() {
+    return flightRecorder().active.load(std::memory_order_relaxed);
+}
+
+inline FlightRing* createFlightRing() {
+    FlightRecorderState& fr = flightRecorder();
+    if (!fr.active.load(std::memory_order_acquire)) return nullptr;
+
+    uint32_t index = fr.ringCount.fetch_add(1, std::memory_order_relaxed);
+    if (index >= kMaxFlightRings) return nullptr;
+
+    FlightRing* ring = new (std::nothrow) FlightRing;
+    FlightRecord* records = ring ? new (std::nothrow) FlightRecord[fr.recordsPerThread] : nullptr;
+    if (!records) {
+        delete ring;
+        return nullptr;
+    }
+    ring->tid = GetCurrentThreadId();
+    ring->mask = fr.recordsPerThread - 1;
+    ring->records = records;
+    fr.rings[index].store(ring, std::memory_order_release);
+    return ring;
+}
+
+// Created on the thread's first record. Rings outlive their threads: a
+// worker that just exited may be the interesting one.
+inline FlightRing* threadFlightRing() {
+    thread_local FlightRing* ring = nullptr;
+    thread_local bool attempted = false;
+    if (!ring && !attempted) {
+        attempted = true;
+        ring = createFlightRing();
+    }
+    return ring;
+}
+
+inline FlightRecord& beginFlightRecord(FlightRing& ring, uint64_t& pos) {
+    pos = ring.head.load(std::memory_order_relaxed);
+    FlightRecord& rec = ring.records[pos & ring.mask];
+    rec.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    rec.rawTime = getRawTimestamp();
+    rec.payload.length = 0;
+    rec.payload.overflow = false;
+    return rec;
+}
+
+inline void commitFlightRecord(FlightRing& ring, FlightRecord& rec, uint64_t pos) {
+    rec.sequence.store(pos + 1, std::memory_order_release);
+    ring.head.store(pos + 1, std::memory_order_release);
+}
+
+inline void copyFlightText(BasicBinaryWriter<kFlightPayloadSize>& w, const char* text) {
+    size_t len = strlen(text);
+    if (len > sizeof(w.data) - 1) len = sizeof(w.data) - 1;
+    memcpy(w.data, text, len);
+    w.data[len] = '\0';
+    w.length = len;
+}
+
+// DEBUG_* record, enabled or not
+inline void recordFlight(LogSite& site, CorrelationId cid, const char* fmt, va_list args) {
+    FlightRing* ring = threadFlightRing();
+    if (!ring) return;
+    if (site.state.load(std::memory_order_acquire) != SITE_READY) registerLogSite(site);
+
+    uint64_t pos;
+    FlightRecord& rec = beginFlightRecord(*ring, pos);
+    rec.cid = (cid != 0) ? cid : currentCorrelationId();
+    rec.site = &site;
+    if (fmt == site.fmt && site.argCount >= 0) {
+        rec.kind = FLIGHT_PACKED;
+        packLogArguments(rec.payload, site, args);
+    } else {
+        rec.kind = FLIGHT_FORMAT_ONLY;
+        copyFlightText(rec.payload, fmt);
+    }
+    commitFlightRecord(*ring, rec, pos);
+}
+
+// Already-formatted record (debugLogImpl)
+inline void recordFlightMessage(const char* level, const char* file, int line,
+                                CorrelationId cid, const char* message) {
+    FlightRing* ring = threadFlightRing();
+    if (!ring) return;
+
+    uint64_t pos;
+    FlightRecord& rec = beginFlightRecord(*ring, pos);
+    rec.cid = (cid != 0) ? cid : currentCorrelationId();
+    rec.site = nullptr;
+    rec.level = level;
+    rec.file = file;
+    rec.line = line;
+    rec.kind = FLIGHT_MESSAGE;
+    copyFlightText(rec.payload, message);
+    commitFlightRecord(*ring, rec, pos);
+}
+
+/**
+ * Record the last records of every thread (including those filtered out by
+ * level) for crash reports and minidumps.
+ * @param recordsPerThread Ring size, rounded up to a power of two and fixed
+ *                         by the first call. 256 records take 64 KB per thread.
+ */
+inline bool enableFlightRecorder(uint32_t recordsPerThread = 256) {
+    FlightRecorderState& fr = flightRecorder();
+    clockState();   // Records are stamped before any line sets the origin
+    if (fr.recordsPerThread == 0) {
+        uint32_t size = 16;
+        while (size < recordsPerThread && size < (1u << 20)) size <<= 1;
+        fr.recordsPerThread = size;
+
+        // Reserved now so a crashing process can embed the recorder in its
+        // minidump without allocating
+        fr.stream = (char*)VirtualAlloc(nullptr, kFlightStreamBytes,
+            MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (!fr.stream) {
+            fprintf(stderr, "[rippled_debug] Failed to reserve flight recorder dump stream (error %lu)\n",
+                GetLastError());
+        }
+    }
+    fr.active.store(true, std::memory_order_release);
+    return true;
+}
+
+// Stop recording; what was recorded stays available to crash reports
+inline void disableFlightRecorder() {
+    flightRecorder().active.store(false, std::memory_order_release);
+}
+
+// Crash-time readers take turns; a second crashing thread skips the recorder
+inline bool acquireFlightReader(FlightRecorderState& fr) {
+    return InterlockedCompareExchange(&fr.readerBusy, 1, 0) == 0;
 }
 
-inline CorrelationId startCorrelation(const char* context) {
-    CorrelationId cid = generateCorrelationId();
-    currentCorrelationId() = cid;
-    return cid;
+inline void releaseFlightReader(FlightRecorderState& fr) {
+    InterlockedExchange(&fr.readerBusy, 0);
 }
 
-inline void endCorrelation(CorrelationId cid) {
-    if (currentCorrelationId() == cid) {
-        currentCorrelationId() = 0;
+// Copy a slot if it still holds record `pos` and wasn't rewritten meanwhile
+inline bool readFlightRecord(const FlightRing& ring, uint64_t pos, FlightEntry& out) {
+    const FlightRecord& rec = ring.records[pos & ring.mask];
+    if (rec.sequence.load(std::memory_order_acquire) != pos + 1) return false;
+
+    out.tid = ring.tid;
+    out.rawTime = rec.rawTime;
+    out.cid = rec.cid;
+    out.site = rec.site;
+    out.level = rec.level;
+    out.file = rec.file;
+    out.line = rec.line;
+    out.kind = rec.kind;
+    out.length = (rec.payload.length < kFlightPayloadSize) ? rec.payload.length : kFlightPayloadSize;
+    memcpy(out.payload, rec.payload.data, out.length);
+    out.payload[out.length] = '\0';
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return rec.sequence.load(std::memory_order_relaxed) == pos + 1;
+}
+
+// Point every cursor at its ring's retained records. Returns the ring count.
+inline uint32_t resetFlightCursors(FlightRecorderState& fr) {
+    uint32_t count = fr.ringCount.load(std::memory_order_acquire);
+    if (count > kMaxFlightRings) count = kMaxFlightRings;
+
+    for (uint32_t i = 0; i < count; i++) {
+        FlightCursor& c = fr.cursors[i];
+        FlightRing* ring = fr.rings[i].load(std::memory_order_acquire);
+        if (!ring) {
+            c.first = c.last = c.head = 0;
+            continue;
+        }
+        c.head = c.last = ring->head.load(std::memory_order_acquire);
+        c.first = (c.last > ring->mask + 1) ? c.last - (ring->mask + 1) : 0;
     }
+    return count;
 }
 
-// ============================================================================
-// Time Utilities
-// ============================================================================
+// Take the newest (or oldest) unread record over all rings. Slots rewritten
+// since the cursors were set are skipped.
+inline bool popFlightRecord(FlightRecorderState& fr, uint32_t count, bool newest, FlightEntry& out) {
+    for (;;) {
+        int best = -1;
+        int64_t bestTime = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const FlightCursor& c = fr.cursors[i];
+            if (c.first >= c.last) continue;
+            const FlightRing* ring = fr.rings[i].load(std::memory_order_relaxed);
+            uint64_t pos = newest ? c.last - 1 : c.first;
+            int64_t t = ring->records[pos & ring->mask].rawTime;
+            if (best < 0 || (newest ? t > bestTime : t < bestTime)) {
+                best = (int)i;
+                bestTime = t;
+            }
+        }
+        if (best < 0) return false;
 
-inline std::string getTimeString() {
-    SYSTEMTIME st;
-    GetLocalTime(&st);
+        FlightCursor& c = fr.cursors[best];
+        uint64_t pos = newest ? --c.last : c.first++;
+        if (readFlightRecord(*fr.rings[best].load(std::memory_order_relaxed), pos, out)) return true;
+    }
+}
 
-    char buffer[32];
-    if (config().useMilliseconds) {
-        snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d.%03d",
-            st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
-    } else {
-        snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d",
-            st.wHour, st.wMinute, st.wSecond);
+template <typename T>
+inline int formatFlightArgument(char* out, size_t size, const char* spec,
+                                int starCount, const int* stars, T value) {
+    switch (starCount) {
+        case 1:  return snprintf(out, size, spec, stars[0], value);
+        case 2:  return snprintf(out, size, spec, stars[0], stars[1], value);
+        default: return snprintf(out, size, spec, value);
     }
-    return std::string(buffer);
 }
 
-inline double getTimestampMs() {
-    static LARGE_INTEGER frequency = {};
-    static LARGE_INTEGER startTime = {};
-    static bool initialized = false;
+/**
+ * Render a packed record. The decoder's deferred printf, minus the
+ * portability work: the arguments were packed by this very binary, so each
+ * spec goes to snprintf as written. Bounded and allocation-free.
+ */
+inline size_t formatFlightMessage(const LogSite& site, const char* payload, size_t length,
+                                  char* out, size_t size) {
+    size_t used = 0;
+    size_t pos = 0;
+    int argIndex = 0;
+    auto take = [&](void* dst, size_t len) {
+        if (len > length - pos) return false;
+        memcpy(dst, payload + pos, len);
+        pos += len;
+        return true;
+    };
+    auto advance = [&](int written) {
+        if (written > 0) used += ((size_t)written < size - used) ? (size_t)written : size - used - 1;
+    };
+
+    out[0] = '\0';
+    for (const char* p = site.fmt; *p && used + 1 < size; ) {
+        if (*p != '%') {
+            out[used++] = *p++;
+            out[used] = '\0';
+            continue;
+        }
 
-    if (!initialized) {
-        QueryPerformanceFrequency(&frequency);
-        QueryPerformanceCounter(&startTime);
-        initialized = true;
-    }
+        const char* specStart = p++;
+        binlog::FormatSpec spec;
+        p = binlog::parseFormatSpec(p, spec);
+        if (spec.conversion == '%') {
+            advance(snprintf(out + used, size - used, "%%"));
+            continue;
+        }
 
-    LARGE_INTEGER counter;
-    QueryPerformanceCounter(&counter);
-    return (double)(counter.QuadPart - startTime.QuadPart) / frequency.QuadPart * 1000.0;
+        char conversion[32];
+        size_t specLen = (size_t)(p - specStart);
+        int stars[2] = {0, 0};
+        bool ok = specLen < sizeof(conversion);
+        for (int i = 0; i < spec.starCount && ok; i++) {
+            int32_t v = 0;
+            ok = argIndex < site.argCount && take(&v, sizeof(v));
+            stars[i] = v;
+            argIndex++;
+        }
+        if (!ok || argIndex >= site.argCount) {
+            advance(snprintf(out + used, size - used, "<?>"));
+            continue;
+        }
+        memcpy(conversion, specStart, specLen);
+        conversion[specLen] = '\0';
+
+        char* dst = out + used;
+        size_t room = size - used;
+        int written = -1;
+        switch (site.argTypes[argIndex++]) {
+            case binlog::ARG_INT32: {
+                int32_t v;
+                if (take(&v, sizeof(v))) written = formatFlightArgument(dst, room, conversion, spec.starCount, stars, (int)v);
+                break;
+            }
+            case binlog::ARG_INT64: {
+                int64_t v;
+                if (take(&v, sizeof(v))) written = formatFlightArgument(dst, room, conversion, spec.starCount, stars, (long long)v);
+                break;
+            }
+            case binlog::ARG_DOUBLE: {
+                double v;
+                if (take(&v, sizeof(v))) written = formatFlightArgument(dst, room, conversion, spec.starCount, stars, v);
+                break;
+            }
+            case binlog::ARG_POINTER: {
+                uint64_t v;
+                if (take(&v, sizeof(v))) written = formatFlightArgument(dst, room, conversion, spec.starCount, stars, (void*)(uintptr_t)v);
+                break;
+            }
+            case binlog::ARG_STRING: {
+                uint16_t len;
+                char text[kFlightPayloadSize + 1];
+                if (take(&len, sizeof(len)) && len <= kFlightPayloadSize && take(text, len)) {
+                    text[len] = '\0';
+                    written = formatFlightArgument(dst, room, conversion, spec.starCount, stars, (const char*)text);
+                }
+                break;
+            }
+        }
+        advance(written >= 0 ? written : snprintf(dst, room, "<?>"));
+    }
+    return used;
 }
 
-// Track last log time for delta calculation
-inline double& lastLogTime() {
-    static double last = 0;
-    return last;
-}
+inline void renderFlightEntry(const FlightEntry& e, LineBuffer& out) {
+    const LogSite* site = e.site;
+    const char* level = site ? site->levelName : e.level;
+    int line = site ? site->line : e.line;
+    const char* basename = site ? site->fileName : (e.file ? fileBasename(e.file) : "?");
 
-inline std::string formatDelta(double deltaMs) {
-    char buffer[16];
-    if (deltaMs < 1.0) {
-        snprintf(buffer, sizeof(buffer), "+%.0fus", deltaMs * 1000);
-    } else if (deltaMs < 1000.0) {
-        snprintf(buffer, sizeof(buffer), "+%.1fms", deltaMs);
-    } else if (deltaMs < 60000.0) {
-        snprintf(buffer, sizeof(buffer), "+%.2fs", deltaMs / 1000);
+    char timeStr[16];
+    formatWallClock(rawTimestampToMs(e.rawTime), timeStr);
+    out.appendf("  [%s] [tid %5lu] %-8s ", timeStr, (unsigned long)e.tid, level ? level : "?");
+
+    if (e.kind == FLIGHT_PACKED) {
+        char message[1024];
+        formatFlightMessage(*site, e.payload, e.length, message, sizeof(message));
+        out.append(message);
     } else {
-        snprintf(buffer, sizeof(buffer), "+%.1fm", deltaMs / 60000);
+        if (e.kind == FLIGHT_FORMAT_ONLY) out.append("(arguments not recorded) ");
+        out.append(e.payload, e.length);
     }
-    return std::string(buffer);
-}
-
-inline DWORD getThreadId() {
-    return GetCurrentThreadId();
+    out.appendf("    %s:%d\n", basename, line);
 }
 
-// ============================================================================
-// Memory Tracking
-// ============================================================================
-
-inline size_t getCurrentMemoryUsage() {
-    PROCESS_MEMORY_COUNTERS_EX pmc;
-    if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
-        return pmc.WorkingSetSize;
+/**
+ * Walk back maxRecords from the newest end over all threads; popFlightRecord
+ * (forward) then yields the selected records oldest first. Caller holds the
+ * reader.
+ * @param selected Receives the number of records selected
+ * @param total    Receives the number of records ever written
+ * @return the thread count to pass to popFlightRecord
+ */
+inline uint32_t selectFlightRecords(FlightRecorderState& fr, size_t maxRecords,
+                                    size_t& selected, uint64_t& total) {
+    uint32_t count = resetFlightCursors(fr);
+    FlightEntry entry;
+    selected = 0;
+    while (selected < maxRecords && popFlightRecord(fr, count, true, entry)) selected++;
+
+    total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        FlightCursor& c = fr.cursors[i];
+        c.first = c.last;
+        c.last = c.head;
+        total += c.head;
     }
-    return 0;
+    return count;
 }
 
-inline size_t& lastMemoryUsage() {
-    static size_t last = 0;
-    return last;
+// Where printFlightRecorder's text goes; the crash report writer passes its own
+typedef void (*FlightOutput)(const char* data, size_t length);
+
+inline void writeFlightToStderr(const char* data, size_t length) {
+    fwrite(data, 1, length, stderr);
 }
 
-inline std::string formatMemoryDelta(size_t current, size_t last) {
-    if (last == 0) return "";
+/**
+ * Print the newest records over all threads, oldest first. Safe to call any
+ * time; it formats with vsnprintf and writes through stdio, so the crash
+ * handlers render it with reportFlightRecorder() instead.
+ * @param output Text sink (default stderr)
+ */
+inline void printFlightRecorder(size_t maxRecords = 128, FlightOutput output = nullptr) {
+    FlightRecorderState& fr = flightRecorder();
+    if (fr.ringCount.load(std::memory_order_acquire) == 0) return;
+    if (!output) output = writeFlightToStderr;
+
+    LineBuffer line;
+    if (!acquireFlightReader(fr)) {
+        line.append("[rippled_debug] Flight recorder is being read by another thread\n");
+        output(line.data, line.length);
+        return;
+    }
 
-    int64_t delta = (int64_t)current - (int64_t)last;
-    char buffer[32];
+    size_t selected = 0;
+    uint64_t total = 0;
+    uint32_t count = selectFlightRecords(fr, maxRecords, selected, total);
+    FlightEntry entry;
+
+    line.appendf("\n--- Flight Recorder (last %zu of %llu records, %u threads) ---\n",
+                 selected, (unsigned long long)total, count);
+    output(line.data, line.length);
+    while (popFlightRecord(fr, count, false, entry)) {
+        line.length = 0;
+        renderFlightEntry(entry, line);
+        output(line.data, line.length);
+    }
+    if (output == writeFlightToStderr) fflush(stderr);
+    releaseFlightReader(fr);
+}
 
-    if (delta == 0) {
-        return "";
-    } else if (delta > 0) {
-        if (delta < 1024) {
-            snprintf(buffer, sizeof(buffer), " [+%lld B]", delta);
-        } else if (delta < 1024 * 1024) {
-            snprintf(buffer, sizeof(buffer), " [+%.1f KB]", delta / 1024.0);
-        } else {
-            snprintf(buffer, sizeof(buffer), " [+%.1f MB]", delta / 1024.0 / 1024.0);
-        }
+inline void putFlightEntry(BinaryWriter& w, const FlightEntry& e) {
+    if (e.kind == FLIGHT_PACKED) {
+        w.put((uint8_t)binlog::TAG_LOG);
+        w.put(e.site->id);
+        w.put((uint64_t)e.rawTime);
+        w.put((uint32_t)e.tid);
+        w.put((uint64_t)e.cid);
+        w.put((uint16_t)e.length);
+        w.put(e.payload, e.length);
+    } else if (e.kind == FLIGHT_FORMAT_ONLY) {
+        char message[kFlightPayloadSize + 32];
+        snprintf(message, sizeof(message), "(arguments not recorded) %s", e.payload);
+        putMessageRecord(w, e.rawTime, e.tid, e.cid, e.site->line, e.site->levelName,
+                         e.site->file, message);
     } else {
-        delta = -delta;
-        if (delta < 1024) {
-            snprintf(buffer, sizeof(buffer), " [-%lld B]", delta);
-        } else if (delta < 1024 * 1024) {
-            snprintf(buffer, sizeof(buffer), " [-%.1f KB]", delta / 1024.0);
-        } else {
-            snprintf(buffer, sizeof(buffer), " [-%.1f MB]", delta / 1024.0 / 1024.0);
+        putMessageRecord(w, e.rawTime, e.tid, e.cid, e.line, e.level ? e.level : "?",
+                         e.file ? e.file : "?", e.payload);
+    }
+}
+
+/**
+ * Encode the recorder as a LogFormat::BINARY stream (header, the site
+ * definitions it needs, then the records oldest first) that
+ * tools/log-decoder renders. When it doesn't fit, the oldest records are
+ * left out. Allocation-free; used for the minidump user stream.
+ * @return bytes written, 0 if there is nothing to write
+ */
+inline size_t serializeFlightRecorder(char* out, size_t capacity) {
+    FlightRecorderState& fr = flightRecorder();
+    if (!out || fr.ringCount.load(std::memory_order_acquire) == 0) return 0;
+    if (!acquireFlightReader(fr)) return 0;
+
+    BinaryWriter w;
+    putStreamHeader(w);
+    if (w.length > capacity) {
+        releaseFlightReader(fr);
+        return 0;
+    }
+    memcpy(out, w.data, w.length);
+
+    // Site definitions grow up from the header, records down from the end
+    // (newest first), then the records are moved down to join the definitions
+    size_t front = w.length;
+    size_t back = capacity;
+    memset(fr.siteDefined, 0, sizeof(fr.siteDefined));
+
+    uint32_t count = resetFlightCursors(fr);
+    FlightEntry entry;
+    BinaryWriter definition;
+    while (popFlightRecord(fr, count, true, entry)) {
+        w.length = 0;
+        putFlightEntry(w, entry);
+
+        definition.length = 0;
+        uint32_t id = (entry.kind == FLIGHT_PACKED) ? entry.site->id : 0;
+        bool tracked = id / 8 < sizeof(fr.siteDefined);
+        bool define = id != 0 && !(tracked && (fr.siteDefined[id / 8] & (1u << (id % 8))));
+        if (define) putSiteDefinition(definition, *entry.site);
+
+        if (w.length + definition.length > back - front) break;
+        back -= w.length;
+        memcpy(out + back, w.data, w.length);
+        if (define) {
+            memcpy(out + front, definition.data, definition.length);
+            front += definition.length;
+            if (tracked) fr.siteDefined[id / 8] |= (uint8_t)(1u << (id % 8));
         }
     }
-    return std::string(buffer);
+
+    memmove(out + front, out + back, capacity - back);
+    releaseFlightReader(fr);
+    return front + (capacity - back);
 }
 
 // ============================================================================
-// JSON Escaping
+// Core Logging Functions
 // ============================================================================
 
-inline std::string escapeJson(const char* str) {
-    std::ostringstream ss;
-    for (const char* p = str; *p; ++p) {
-        switch (*p) {
-            case '"':  ss << "\\\""; break;
-            case '\\': ss << "\\\\"; break;
-            case '\n': ss << "\\n"; break;
-            case '\r': ss << "\\r"; break;
-            case '\t': ss << "\\t"; break;
-            default:   ss << *p; break;
+// Write already-encoded output, keeping it in order with queued records when
+// async logging is on.
+inline void emitBytes(const char* data, size_t len) {
+    AsyncProducerScope producer;
+    while (len > 0 && producer.active()) {
+        size_t chunk = (len < kLogRecordTextSize) ? len : kLogRecordTextSize;
+        size_t pos;
+        LogQueueCell* cell = asyncClaim(pos);
+        if (!cell) {
+            if (isAsyncLogging()) return;   // Dropped
+            break;                          // Writer stopped: write the rest here
         }
+
+        cell->record.kind = RecordKind::TEXT;
+        cell->record.length = (uint32_t)chunk;
+        memcpy(cell->record.text, data, chunk);
+        asyncPublish(cell, pos);
+
+        data += chunk;
+        len -= chunk;
     }
-    return ss.str();
+    if (len == 0) return;
+
+    writeOutput(data, len);
+    // Binary streams rely on stdio buffering; flushAsyncLog() flushes them
+    if (config().format != LogFormat::BINARY) flushOutput();
 }
 
-// ============================================================================
-// Filename extraction (smart truncation)
-// ============================================================================
+// Write pre-rendered text (boxes, banners)
+inline void emitText(const char* data, size_t len) {
+    if (config().format != LogFormat::BINARY) {
+        emitBytes(data, len);
+        return;
+    }
 
-inline std::string extractFilename(const char* path, int maxLen = 20) {
-    const char* filename = path;
-    for (const char* p = path; *p; ++p) {
-        if (*p == '\\' || *p == '/') {
-            filename = p + 1;
-        }
+    // Wrap in 'R' records, each small enough for one queue cell
+    const size_t maxChunk = kLogRecordTextSize - 1 - sizeof(uint32_t);
+    while (len > 0) {
+        size_t chunk = (len < maxChunk) ? len : maxChunk;
+        BinaryWriter w;
+        w.put((uint8_t)binlog::TAG_TEXT);
+        w.put((uint32_t)chunk);
+        w.put(data, chunk);
+        emitBytes(w.data, w.length);
+        data += chunk;
+        len -= chunk;
     }
+}
 
-    std::string result(filename);
-    if ((int)result.length() > maxLen && maxLen > 3) {
-        // Truncate with ellipsis, keeping the extension
-        size_t dotPos = result.rfind('.');
-        if (dotPos != std::string::npos && dotPos > 0) {
-            std::string ext = result.substr(dotPos);
-            int nameLen = maxLen - (int)ext.length() - 2; // -2 for ".."
-            if (nameLen > 0) {
-                result = result.substr(0, nameLen) + ".." + ext;
-            }
-        } else {
-            result = result.substr(0, maxLen - 2) + "..";
+inline void emitText(const LineBuffer& buf) {
+    emitText(buf.data, buf.length);
+}
+
+// Fixed-size, append-only list of hook structs (log and section observers).
+// Adders are serialized; notifying is a plain loop over published entries.
+constexpr int kMaxObservers = 8;
+
+template <typename Observer>
+struct ObserverList {
+    SRWLOCK lock = SRWLOCK_INIT;
+    std::atomic<int> count{0};
+    Observer entries[kMaxObservers] = {};
+
+    bool add(const Observer& observer, const char* kind) {
+        AcquireSRWLockExclusive(&lock);
+        int n = count.load(std::memory_order_relaxed);
+        bool added = n < kMaxObservers;
+        if (added) {
+            entries[n] = observer;
+            count.store(n + 1, std::memory_order_release);
+        }
+        ReleaseSRWLockExclusive(&lock);
+        if (!added) {
+            fprintf(stderr, "[rippled_debug] Too many %s observers (max %d)\n",
+                kind, kMaxObservers);
         }
+        return added;
     }
-    return result;
-}
 
-// ============================================================================
-// Core Logging Functions
-// ============================================================================
+    bool empty() const {
+        return count.load(std::memory_order_relaxed) == 0;
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        int n = count.load(std::memory_order_acquire);
+        for (int i = 0; i < n; i++) fn(entries[i]);
+    }
+};
+
+// Sees every log record that passes filtering, in any output format, on the
+// logging thread (before async queuing). rawTime is the record's QPC stamp.
+struct LogObserver {
+    void (*onLog)(const LogEvent& ev, int64_t rawTime, const char* message);
+};
 
-inline const char* getLevelColor(const char* level) {
-    if (strcmp(level, "DEBUG") == 0) return colors::LVL_DEBUG;
-    if (strcmp(level, "INFO") == 0)  return colors::LVL_INFO;
-    if (strcmp(level, "WARN") == 0)  return colors::LVL_WARN;
-    if (strcmp(level, "ERROR") == 0) return colors::LVL_ERROR;
-    if (strcmp(level, "CRIT") == 0)  return colors::LVL_CRITICAL;
-    return colors::RESET;
+inline ObserverList<LogObserver>& logObservers() {
+    static ObserverList<LogObserver> list;
+    return list;
 }
 
-inline void debugLogImpl(
+inline bool addLogObserver(const LogObserver& observer) {
+    return logObservers().add(observer, "log");
+}
+
+// Filter-passing record to the observers and the outputs that accept it
+// (kPrimaryOutput | sinkOutputBit(id)). fileName is file's basename (the call
+// site's, when it has one).
+inline void emitLogMessage(
+    LogLevel severity,
     const char* level,
     const char* file,
+    const char* fileName,
     int line,
     CorrelationId cid,
-    const char* message
+    const char* message,
+    uint32_t outputs
 ) {
-    if (!config().enabled) return;
+    if (!config().enabled || outputs == 0) return;
 
     enableAnsiSupport();
 
-    double currentTime = getTimestampMs();
-    double deltaTime = currentTime - lastLogTime();
-    lastLogTime() = currentTime;
-
-    size_t currentMem = 0;
-    std::string memDelta;
+    LogEvent ev;
+    ev.level = level;
+    ev.severity = severity;
+    ev.outputs = outputs;
+    ev.file = file;
+    ev.fileName = fileName;
+    ev.line = line;
+    ev.tid = getThreadId();
+    // Explicit cids from another operation don't inherit this thread's span
+    const SpanContext& span = spanStack().current;
+    ev.cid = (cid != 0) ? cid : span.cid;
+    bool inSpan = (ev.cid == span.cid);
+    ev.spanId = inSpan ? span.spanId : 0;
+    ev.parentSpanId = inSpan ? currentParentSpanId() : 0;
+    clockState();
+    int64_t rawTime = getRawTimestamp();
+    ev.timestamp = rawTimestampToMs(rawTime);
+    ev.delta = updateLogDelta(ev.cid, rawTime);
+
+    ev.memory = 0;
+    ev.lastMemory = kNoMemorySample;
     if (config().includeMemoryDelta) {
-        currentMem = getCurrentMemoryUsage();
-        memDelta = formatMemoryDelta(currentMem, lastMemoryUsage());
-        lastMemoryUsage() = currentMem;
+        ev.memory = memoryMark();
+        ev.lastMemory = lastMemoryUsage();
+        lastMemoryUsage() = ev.memory;
     }
 
-    std::string filename = extractFilename(file);
-    CorrelationId effectiveCid = (cid != 0) ? cid : currentCorrelationId();
-
-    if (config().format == LogFormat::JSON) {
-        // JSON format
-        fprintf(config().output,
-            "{\"ts\":%.3f,\"delta\":%.3f,\"level\":\"%s\",\"tid\":%lu,\"cid\":%llu,"
-            "\"file\":\"%s\",\"line\":%d,\"msg\":\"%s\"",
-            currentTime, deltaTime, level, getThreadId(), effectiveCid,
-            escapeJson(filename.c_str()).c_str(), line, escapeJson(message).c_str());
+    logObservers().forEach([&](const LogObserver& o) {
+        if (o.onLog) o.onLog(ev, rawTime, message);
+    });
 
-        if (config().includeMemoryDelta && currentMem > 0) {
-            fprintf(config().output, ",\"mem\":%zu", currentMem);
-        }
-        fprintf(config().output, "}\n");
+    uint32_t events = outputs & logSinks().eventOutputs.load(std::memory_order_relaxed);
+    if (events) {
+        dispatchLogEvent(ev, rawTime, message, events);
+        ev.outputs &= ~events;
     }
-    else if (config().format == LogFormat::RICH && config().useColors) {
-        // Rich-style colored output
-        // Format: [HH:MM:SS.mmm] [+delta] LEVEL    Message                  file.cpp:123
-
-        std::string timeStr = getTimeString();
-        const char* levelColor = getLevelColor(level);
-
-        // Build location string
-        char location[64];
-        snprintf(location, sizeof(location), "%s:%d", filename.c_str(), line);
-
-        // Build delta string
-        std::string deltaStr = config().includeDeltaTime ? formatDelta(deltaTime) : "";
-
-        // Calculate base content length for padding
-        int baseLen = (int)timeStr.length() + 3;  // [time]
-        if (config().includeDeltaTime) baseLen += (int)deltaStr.length() + 3;  // [delta]
-        baseLen += 9;  // LEVEL + space
-        baseLen += (int)strlen(message);
-        baseLen += (int)strlen(location) + 2;
 
-        int padding = config().boxWidth - baseLen;
-        if (padding < 1) padding = 1;
+    if ((outputs & kPrimaryOutput) && config().format == LogFormat::BINARY) {
+        logBinaryMessage(ev, rawTime, message);
+        ev.outputs &= ~kPrimaryOutput;
+    }
+    if (ev.outputs == 0) return;
+
+    AsyncProducerScope producer;
+    if (producer.active()) {
+        // A message longer than one cell's text (rare) is queued as a heap
+        // copy, so it still goes out in order through the writer
+        size_t len = strlen(message);
+        char* oversize = nullptr;
+        if (len >= kLogRecordTextSize) {
+            oversize = (char*)malloc(len + 1);
+            if (oversize) memcpy(oversize, message, len + 1);
+        }
 
-        // Print timestamp
-        fprintf(config().output, "%s[%s]%s ",
-            colors::TIMESTAMP, timeStr.c_str(), colors::RESET);
+        bool queueable = len < kLogRecordTextSize || oversize;
 
-        // Print delta time if enabled
-        if (config().includeDeltaTime) {
-            fprintf(config().output, "%s[%7s]%s ",
-                colors::DELTA, deltaStr.c_str(), colors::RESET);
+        size_t pos;
+        LogQueueCell* cell = queueable ? asyncClaim(pos) : nullptr;
+        if (cell) {
+            cell->record.event = ev;
+            cell->record.length = (uint32_t)len;
+            if (oversize) {
+                cell->record.kind = RecordKind::OVERSIZE;
+                memcpy(cell->record.text, &oversize, sizeof(oversize));
+            } else {
+                cell->record.kind = RecordKind::LOG;
+                memcpy(cell->record.text, message, len);
+                cell->record.text[len] = '\0';
+            }
+            asyncPublish(cell, pos);
+            return;
         }
+        free(oversize);
+        // Dropped; else the writer stopped (or no memory for the copy)
+        if (queueable && isAsyncLogging()) return;
+    }
 
-        // Print level
-        fprintf(config().output, "%s%-8s%s ", levelColor, level, colors::RESET);
+    writeLogEvent(ev, message, true);
+}
 
-        // Print message
-        fprintf(config().output, "%s", message);
+inline void debugLogImpl(
+    LogLevel severity,
+    const char* level,
+    const char* file,
+    int line,
+    CorrelationId cid,
+    const char* message
+) {
+    if (flightRecorderActive()) recordFlightMessage(level, file, line, cid, message);
+    // Section records have always reached the primary output unfiltered
+    emitLogMessage(severity, level, file, fileBasename(file), line, cid, message,
+        kPrimaryOutput | sinkOutputsFor(severity));
+}
 
-        // Print memory delta if enabled
-        if (config().includeMemoryDelta && !memDelta.empty()) {
-            fprintf(config().output, "%s%s%s", colors::MEMORY, memDelta.c_str(), colors::RESET);
-        }
+inline void debugLogImpl(
+    const char* level,
+    const char* file,
+    int line,
+    CorrelationId cid,
+    const char* message
+) {
+    debugLogImpl(levelFromName(level), level, file, line, cid, message);
+}
 
-        // Right-align location
-        fprintf(config().output, "%*s%s%s%s\n",
-            padding, "", colors::LOCATION, location, colors::RESET);
-    }
-    else {
-        // Plain text format
-        std::string timeStr = getTimeString();
-        std::string deltaStr = config().includeDeltaTime ? formatDelta(deltaTime) : "";
+RIPPLED_DEBUG_PRINTF(4, 5)
+inline void debugLog(const char* level, const char* file, int line,
+                     RIPPLED_DEBUG_FORMAT_STRING const char* fmt, ...) {
+    if (!config().enabled) return;
+    LogLevel severity = levelFromName(level);
+    uint32_t outputs = logOutputsFor(severity);
+    if (outputs == 0) return;
 
-        fprintf(config().output, "[%s]", timeStr.c_str());
-        if (config().includeDeltaTime) {
-            fprintf(config().output, " [%7s]", deltaStr.c_str());
-        }
-        fprintf(config().output, " %-8s %s    %s:%d\n",
-            level, message, filename.c_str(), line);
-    }
+    ScopedFormatBuffer message;
+    va_list args;
+    va_start(args, fmt);
+    message->appendv(fmt, args);
+    va_end(args);
 
-    fflush(config().output);
+    if (flightRecorderActive()) recordFlightMessage(level, file, line, 0, message->data);
+    emitLogMessage(severity, level, file, fileBasename(file), line, 0, message->data, outputs);
 }
 
-inline void debugLog(const char* level, const char* file, int line, const char* fmt, ...) {
+RIPPLED_DEBUG_PRINTF(5, 6)
+inline void debugLogCid(CorrelationId cid, const char* level, const char* file, int line,
+                        RIPPLED_DEBUG_FORMAT_STRING const char* fmt, ...) {
     if (!config().enabled) return;
+    LogLevel severity = levelFromName(level);
+    uint32_t outputs = logOutputsFor(severity);
+    if (outputs == 0) return;
 
-    char buffer[2048];
+    ScopedFormatBuffer message;
     va_list args;
     va_start(args, fmt);
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    message->appendv(fmt, args);
     va_end(args);
 
-    debugLogImpl(level, file, line, 0, buffer);
+    if (flightRecorderActive()) recordFlightMessage(level, file, line, cid, message->data);
+    emitLogMessage(severity, level, file, fileBasename(file), line, cid, message->data, outputs);
 }
 
-inline void debugLogCid(CorrelationId cid, const char* level, const char* file, int line, const char* fmt, ...) {
-    if (!config().enabled) return;
+// Log how many lines the rate limiter dropped at this site, if any
+inline void reportSuppressedLogSite(LogSite& site, CorrelationId cid, uint32_t outputs) {
+    if (site.suppressed.load(std::memory_order_relaxed) == 0) return;
+    uint32_t count = site.suppressed.exchange(0, std::memory_order_relaxed);
+    if (count == 0) return;
+
+    char message[96];
+    snprintf(message, sizeof(message), "(%u more lines from this call site suppressed by rate limit)",
+        count);
+    emitLogMessage(site.level, site.levelName, site.file, site.fileName, site.line, cid, message,
+        outputs);
+}
 
-    char buffer[2048];
+// Entry point for the DEBUG_* macros: BINARY mode packs the arguments
+// against the call site, everything else formats as before.
+// The macro has already checked site.isEnabled() (which registers the site)
+// and site.admit(), unless the flight recorder is on: it keeps filtered-out
+// and rate-limited records too, so the checks happen here.
+inline void debugLogAt(LogSite& site, CorrelationId cid, const char* fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
+
+    if (flightRecorderActive()) {
+        va_list recorded;
+        va_copy(recorded, args);
+        recordFlight(site, cid, fmt, recorded);
+        va_end(recorded);
+        if (!site.isEnabled() || !site.admit()) {
+            va_end(args);
+            return;
+        }
+    }
+
+    // fmt can differ from site.fmt when a macro is given a non-literal format.
+    // Observers and text sinks need the formatted text, so they disable
+    // deferred formatting.
+    uint32_t outputs = site.outputs();
+    reportSuppressedLogSite(site, cid, outputs);
+    if (config().format == LogFormat::BINARY && fmt == site.fmt && logObservers().empty() &&
+        outputs == kPrimaryOutput) {
+        if (site.argCount >= 0) {
+            logBinary(site, cid, args);
+            va_end(args);
+            return;
+        }
+    }
+
+    ScopedFormatBuffer message;
+    message->appendv(fmt, args);
     va_end(args);
 
-    debugLogImpl(level, file, line, cid, buffer);
+    emitLogMessage(site.level, site.levelName, site.file, site.fileName, site.line, cid,
+        message->data, outputs);
+}
+
+// Types that C varargs pass to vsnprintf unchanged. Class types (notably
+// std::string without .c_str()) are undefined behavior through "...".
+template <typename T>
+struct IsLogArgument : std::integral_constant<bool,
+    std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+    std::is_pointer<T>::value || std::is_null_pointer<T>::value> {};
+
+template <typename... Args>
+struct AreLogArguments : std::true_type {};
+
+template <typename T, typename... Rest>
+struct AreLogArguments<T, Rest...> : std::integral_constant<bool,
+    IsLogArgument<typename std::decay<T>::type>::value && AreLogArguments<Rest...>::value> {};
+
+// Only declared: the macros call it inside sizeof() so the compiler checks
+// the format string against the arguments (printf format attribute on
+// GCC/Clang, SAL annotation for MSVC /analyze) without evaluating anything.
+// MSVC without /analyze skips the format check; only the argument type
+// static_assert in logAt() still applies there.
+RIPPLED_DEBUG_PRINTF(1, 2)
+int checkLogFormat(RIPPLED_DEBUG_FORMAT_STRING const char* fmt, ...);
+
+// Typed front end for the DEBUG_* macros
+template <typename... Args>
+inline void logAt(LogSite& site, CorrelationId cid, const char* fmt, const Args&... args) {
+    static_assert(AreLogArguments<Args...>::value,
+        "DEBUG_* arguments must be printf-compatible (pass strings as .c_str())");
+    debugLogAt(site, cid, fmt, args...);
+}
+
+/**
+ * Log the suppressed-line counts of every rate-limited call site now, e.g.
+ * on a timer or at shutdown, instead of waiting for each site's next line.
+ */
+inline void reportSuppressedLogs() {
+    LogSiteRegistry& reg = logSiteRegistry();
+    AcquireSRWLockShared(&reg.lock);
+    std::vector<LogSite*> sites;
+    for (LogSite* site = reg.head; site; site = site->next) {
+        if (site->suppressed.load(std::memory_order_relaxed) != 0) sites.push_back(site);
+    }
+    ReleaseSRWLockShared(&reg.lock);
+
+    for (LogSite* site : sites) {
+        reportSuppressedLogSite(*site, 0, site->outputs());
+    }
 }
 
 // ============================================================================
@@ -465,70 +3338,76 @@ inline void printBox(const char* title, bool isStart, const char* file = nullptr
 
     enableAnsiSupport();
 
+    LineBuffer out;
     int width = config().boxWidth;
     int titleLen = (int)strlen(title);
 
     if (config().format == LogFormat::RICH && config().useColors) {
         if (isStart) {
             // Top border: ┌── ▶ title ────────────────────── file.cpp:123 ──┐
-            fprintf(config().output, "\n%s%s", colors::BOX_COLOR, box::TL);
-            fprintf(config().output, "%s%s%s ", colors::RESET, box::H, box::H);
-            fprintf(config().output, "%s%s %s%s%s",
+            out.appendf("\n%s%s", colors::BOX_COLOR, box::TL);
+            out.appendf("%s%s%s ", colors::RESET, box::H, box::H);
+            out.appendf("%s%s %s%s%s",
                 colors::SECTION, box::ARROW_R, colors::BOLD, title, colors::RESET);
 
             // Add location if provided
             if (file && line > 0) {
-                std::string filename = extractFilename(file);
+                char filename[64];
+                formatFilename(fileBasename(file), 20, filename, sizeof(filename));
                 char location[64];
-                snprintf(location, sizeof(location), "%s:%d", filename.c_str(), line);
+                snprintf(location, sizeof(location), "%s:%d", filename, line);
                 int locLen = (int)strlen(location);
 
                 int remaining = width - titleLen - locLen - 12;
-                fprintf(config().output, " ");
-                for (int i = 0; i < remaining; i++) fprintf(config().output, "%s", box::H);
-                fprintf(config().output, " %s%s%s ", colors::LOCATION, location, colors::RESET);
+                out.appendf(" ");
+                out.repeat(box::H, remaining);
+                out.appendf(" %s%s%s ", colors::LOCATION, location, colors::RESET);
             } else {
                 int remaining = width - titleLen - 8;
-                fprintf(config().output, " ");
-                for (int i = 0; i < remaining; i++) fprintf(config().output, "%s", box::H);
+                out.appendf(" ");
+                out.repeat(box::H, remaining);
             }
-            fprintf(config().output, "%s%s%s\n", colors::BOX_COLOR, box::TR, colors::RESET);
+            out.appendf("%s%s%s\n", colors::BOX_COLOR, box::TR, colors::RESET);
         } else {
             // Bottom border (without timing - use printBoxWithTime for that)
-            fprintf(config().output, "%s%s", colors::BOX_COLOR, box::BL);
-            fprintf(config().output, "%s%s%s ", colors::RESET, box::H, box::H);
-            fprintf(config().output, "%s%s%s %s ",
+            out.appendf("%s%s", colors::BOX_COLOR, box::BL);
+            out.appendf("%s%s%s ", colors::RESET, box::H, box::H);
+            out.appendf("%s%s%s %s ",
                 colors::SUCCESS, box::CHECK, colors::RESET, title);
 
             int remaining = width - titleLen - 10;
-            for (int i = 0; i < remaining; i++) fprintf(config().output, "%s", box::H);
-            fprintf(config().output, "%s%s%s\n\n", colors::BOX_COLOR, box::BR, colors::RESET);
+            out.repeat(box::H, remaining);
+            out.appendf("%s%s%s\n\n", colors::BOX_COLOR, box::BR, colors::RESET);
         }
     } else {
         // Plain text fallback
         if (isStart) {
-            fprintf(config().output, "\n+-- %s ", title);
+            out.appendf("\n+-- %s ", title);
             if (file && line > 0) {
-                std::string filename = extractFilename(file);
-                fprintf(config().output, "(%s:%d) ", filename.c_str(), line);
+                char filename[64];
+                formatFilename(fileBasename(file), 20, filename, sizeof(filename));
+                out.appendf("(%s:%d) ", filename, line);
             }
-            for (int i = 0; i < width - titleLen - 6; i++) fprintf(config().output, "-");
-            fprintf(config().output, "+\n");
+            out.repeat("-", width - titleLen - 6);
+            out.appendf("+\n");
         } else {
-            fprintf(config().output, "+-- [done] %s ", title);
-            for (int i = 0; i < width - titleLen - 14; i++) fprintf(config().output, "-");
-            fprintf(config().output, "+\n\n");
+            out.appendf("+-- [done] %s ", title);
+            out.repeat("-", width - titleLen - 14);
+            out.appendf("+\n\n");
         }
     }
 
-    fflush(config().output);
+    emitText(out);
 }
 
-inline void printBoxWithTime(const char* title, double elapsedMs, size_t memDelta = 0) {
+// cpuMs < 0: CPU timing off
+inline void printBoxWithTime(const char* title, double elapsedMs, int64_t memDelta = 0,
+                             double cpuMs = -1.0) {
     if (!config().enabled) return;
 
     enableAnsiSupport();
 
+    LineBuffer out;
     int width = config().boxWidth;
 
     if (config().format == LogFormat::RICH && config().useColors) {
@@ -546,9 +3425,9 @@ inline void printBoxWithTime(const char* title, double elapsedMs, size_t memDelt
         int timeLen = (int)strlen(timeStr);
 
         // Bottom border: └── ✔ title (123.4ms) [+1.2 MB] ─────────────────┘
-        fprintf(config().output, "%s%s", colors::BOX_COLOR, box::BL);
-        fprintf(config().output, "%s%s%s ", colors::RESET, box::H, box::H);
-        fprintf(config().output, "%s%s%s %s %s(%s)%s",
+        out.appendf("%s%s", colors::BOX_COLOR, box::BL);
+        out.appendf("%s%s%s ", colors::RESET, box::H, box::H);
+        out.appendf("%s%s%s %s %s(%s)%s",
             colors::SUCCESS, box::CHECK, colors::RESET,
             title,
             colors::DIM, timeStr, colors::RESET);
@@ -556,74 +3435,193 @@ inline void printBoxWithTime(const char* title, double elapsedMs, size_t memDelt
         int remaining = width - titleLen - timeLen - 14;
 
         // Add memory delta if significant
-        if (memDelta > 1024) {
+        int64_t memSize = (memDelta < 0) ? -memDelta : memDelta;
+        if (memSize > 1024) {
             char memStr[32];
-            if (memDelta < 1024 * 1024) {
-                snprintf(memStr, sizeof(memStr), " [+%.1f KB]", memDelta / 1024.0);
+            char sign = (memDelta < 0) ? '-' : '+';
+            if (memSize < 1024 * 1024) {
+                snprintf(memStr, sizeof(memStr), " [%c%.1f KB]", sign, memSize / 1024.0);
             } else {
-                snprintf(memStr, sizeof(memStr), " [+%.1f MB]", memDelta / 1024.0 / 1024.0);
+                snprintf(memStr, sizeof(memStr), " [%c%.1f MB]", sign, memSize / 1024.0 / 1024.0);
             }
-            fprintf(config().output, "%s%s%s", colors::MEMORY, memStr, colors::RESET);
+            out.appendf("%s%s%s", colors::MEMORY, memStr, colors::RESET);
             remaining -= (int)strlen(memStr);
         }
 
-        fprintf(config().output, " ");
-        for (int i = 0; i < remaining - 1; i++) fprintf(config().output, "%s", box::H);
-        fprintf(config().output, "%s%s%s\n\n", colors::BOX_COLOR, box::BR, colors::RESET);
+        if (cpuMs >= 0) {
+            char cpuStr[32];
+            snprintf(cpuStr, sizeof(cpuStr), " [cpu %.0f%%]",
+                elapsedMs > 0 ? 100.0 * cpuMs / elapsedMs : 0.0);
+            out.appendf("%s%s%s", colors::DIM, cpuStr, colors::RESET);
+            remaining -= (int)strlen(cpuStr);
+        }
+
+        out.appendf(" ");
+        out.repeat(box::H, remaining - 1);
+        out.appendf("%s%s%s\n\n", colors::BOX_COLOR, box::BR, colors::RESET);
     } else {
-        fprintf(config().output, "+-- [done: %s] %s ",
-            (elapsedMs < 1000) ? (std::to_string((int)elapsedMs) + "ms").c_str()
-                               : (std::to_string(elapsedMs/1000) + "s").c_str(),
-            title);
+        char cpuStr[32] = "";
+        if (cpuMs >= 0) {
+            snprintf(cpuStr, sizeof(cpuStr), ", cpu %.0f%%",
+                elapsedMs > 0 ? 100.0 * cpuMs / elapsedMs : 0.0);
+        }
+        char timeStr[32];
+        if (elapsedMs < 1000) {
+            snprintf(timeStr, sizeof(timeStr), "%dms", (int)elapsedMs);
+        } else {
+            snprintf(timeStr, sizeof(timeStr), "%fs", elapsedMs / 1000);
+        }
+        out.appendf("+-- [done: %s%s] %s ", timeStr, cpuStr, title);
         int titleLen = (int)strlen(title);
-        for (int i = 0; i < width - titleLen - 22; i++) fprintf(config().output, "-");
-        fprintf(config().output, "+\n\n");
+        out.repeat("-", width - titleLen - 22 - (int)strlen(cpuStr));
+        out.appendf("+\n\n");
     }
 
-    fflush(config().output);
+    emitText(out);
+}
+
+// ============================================================================
+// Section Sites and Observers
+// ============================================================================
+//
+// Each DEBUG_SECTION expansion owns a static SectionSite (like LogSite for
+// log calls) carrying its optional slow threshold. Subsystems that consume
+// section enter/exit (profiler, trace export) register a SectionObserver.
+
+struct SectionSite {
+    const char* file;
+    int line;
+    double slowMs;      // Slow-outlier threshold; < 0 = use config().slowSectionMs
+
+    constexpr SectionSite(const char* f, int l, double slow = -1.0)
+        : file(f), line(l), slowMs(slow) {}
+};
+
+struct SectionEvent {
+    const SectionSite* site;    // nullptr when SectionTimer is used directly
+    const char* name;
+    const char* file;
+    int line;
+    CorrelationId cid;
+    uint64_t spanId;
+    uint64_t parentSpanId;
+    int64_t startTicks;         // Raw QPC at enter
+    int64_t endTicks;           // Raw QPC at exit (0 on enter)
+    uint64_t startCycles;       // Thread cycles at enter (0: CPU timing off)
+    uint64_t endCycles;         // Thread cycles at exit (0 on enter or when off)
+};
+
+struct SectionObserver {
+    void (*onEnter)(const SectionEvent&);
+    void (*onExit)(const SectionEvent&);
+};
+
+inline ObserverList<SectionObserver>& sectionObservers() {
+    static ObserverList<SectionObserver> list;
+    return list;
+}
+
+inline bool addSectionObserver(const SectionObserver& observer) {
+    return sectionObservers().add(observer, "section");
+}
+
+inline void notifySectionEnter(const SectionEvent& ev) {
+    sectionObservers().forEach([&](const SectionObserver& o) {
+        if (o.onEnter) o.onEnter(ev);
+    });
+}
+
+inline void notifySectionExit(const SectionEvent& ev) {
+    sectionObservers().forEach([&](const SectionObserver& o) {
+        if (o.onExit) o.onExit(ev);
+    });
 }
 
 struct SectionTimer {
     const char* name;
     const char* file;
     int line;
-    double startTime;
+    const SectionSite* site;
+    int64_t startTicks;
     size_t startMem;
+    uint64_t startCycles;   // 0 unless CPU timing was on at enter
+    uint64_t parentSpanId;
+    SpanContext span;       // Child of the enclosing span; inherits its cid
     CorrelationId cid;
 
-    SectionTimer(const char* n, const char* f, int l)
-        : name(n), file(f), line(l), startTime(getTimestampMs()),
-          startMem(getCurrentMemoryUsage()), cid(startCorrelation(n)) {
+    SectionTimer(const SectionSite& s, const char* n)
+        : SectionTimer(n, s.file, s.line, &s) {}
+
+    SectionTimer(const char* n, const char* f, int l, const SectionSite* s = nullptr)
+        : name(n), file(f), line(l), site(s), startTicks((clockState(), getRawTimestamp())),
+          startMem(sectionMemoryEnabled() ? memoryMark() : 0),
+          startCycles(config().sectionCpu ? threadCycles() : 0),
+          parentSpanId(currentSpan().spanId), span(beginSpan()), cid(span.cid) {
         if (!config().enabled) return;
 
+        notifySectionEnter(event(0, 0));
+
         // Update timing tracker
-        lastLogTime() = startTime;
+        lastLogTicks() = startTicks;
 
-        if (config().format == LogFormat::JSON) {
-            debugLogImpl("ENTER", file, line, cid,
-                (std::string("section_start:") + name).c_str());
+        if (!config().sectionBoxes) return;
+
+        if (config().format == LogFormat::JSON || config().format == LogFormat::BINARY) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "section_start:%s", name);
+            debugLogImpl("ENTER", file, line, cid, msg);
         } else {
             printBox(name, true, file, line);
         }
     }
 
     ~SectionTimer() {
-        if (!config().enabled) return;
-
-        double elapsed = getTimestampMs() - startTime;
-        size_t endMem = getCurrentMemoryUsage();
-        size_t memDelta = (endMem > startMem) ? (endMem - startMem) : 0;
+        if (!config().enabled) {
+            endSpan(span);
+            return;
+        }
 
-        if (config().format == LogFormat::JSON) {
+        uint64_t endCycles = startCycles ? threadCycles() : 0;
+        int64_t endTicks = getRawTimestamp();
+        notifySectionExit(event(endTicks, endCycles));
+
+        double elapsed = ticksToMs(endTicks - startTicks);
+        double cpuMs = startCycles ? threadCyclesToMs(endCycles - startCycles) : -1.0;
+        // Marks can be heap balances (precise mode), so compare signed
+        int64_t memDelta = sectionMemoryEnabled() ? (int64_t)memoryMark() - (int64_t)startMem : 0;
+
+        if (!config().sectionBoxes) {
+            double slowMs = (site && site->slowMs >= 0) ? site->slowMs : config().slowSectionMs;
+            if (slowMs >= 0 && elapsed >= slowMs) {
+                char msg[256];
+                if (cpuMs >= 0) {
+                    snprintf(msg, sizeof(msg),
+                        "slow section %s: %.3fms, cpu %.3fms (threshold %.3fms)",
+                        name, elapsed, cpuMs, slowMs);
+                } else {
+                    snprintf(msg, sizeof(msg), "slow section %s: %.3fms (threshold %.3fms)",
+                        name, elapsed, slowMs);
+                }
+                debugLogImpl(LogLevel::LVL_WARN, "SLOW", file, line, cid, msg);
+            }
+        } else if (config().format == LogFormat::JSON || config().format == LogFormat::BINARY) {
             char msg[256];
-            snprintf(msg, sizeof(msg), "section_end:%s,elapsed_ms:%.3f,mem_delta:%zu",
-                name, elapsed, memDelta);
+            int len = snprintf(msg, sizeof(msg), "section_end:%s,elapsed_ms:%.3f,mem_delta:%lld",
+                name, elapsed, (long long)memDelta);
+            if (cpuMs >= 0 && len > 0 && (size_t)len < sizeof(msg)) {
+                snprintf(msg + len, sizeof(msg) - len, ",cpu_ms:%.3f", cpuMs);
+            }
             debugLogImpl("EXIT", file, line, cid, msg);
         } else {
-            printBoxWithTime(name, elapsed, memDelta);
+            printBoxWithTime(name, elapsed, memDelta, cpuMs);
         }
 
-        endCorrelation(cid);
+        endSpan(span);
+    }
+
+    SectionEvent event(int64_t endTicks, uint64_t endCycles) const {
+        return SectionEvent{site, name, file, line, cid, span.spanId, parentSpanId,
+            startTicks, endTicks, startCycles, endCycles};
     }
 };
 
@@ -636,11 +3634,16 @@ inline void setDebugEnabled(bool enabled) {
 }
 
 inline void setLogFormat(LogFormat format) {
+    bool startStream = (format == LogFormat::BINARY && config().format != LogFormat::BINARY);
     config().format = format;
+    if (startStream) beginBinaryStream();
 }
 
 inline void setLogOutput(FILE* output) {
+    flushAsyncLog();
     config().output = output;
+    config().sink = nullptr;
+    if (config().format == LogFormat::BINARY) beginBinaryStream();
 }
 
 inline void setUseColors(bool useColors) {
@@ -659,55 +3662,67 @@ inline void setIncludeMemoryDelta(bool include) {
     config().includeMemoryDelta = include;
 }
 
+/**
+ * Record thread CPU cycles (QueryThreadCycleTime) at section enter and exit,
+ * next to wall time: boxes, records and slow-section warnings show CPU time,
+ * and the section profiler reports CPU time and wait share per section.
+ * Costs two system calls per section; the first call calibrates (~6ms).
+ */
+inline void setSectionCpuTiming(bool enabled) {
+    if (enabled) threadCyclesPerNs();
+    config().sectionCpu = enabled;
+}
+
 // Print a banner (useful for startup)
 inline void printBanner(const char* title, const char* subtitle = nullptr) {
     if (!config().enabled) return;
 
     enableAnsiSupport();
 
+    LineBuffer out;
     int width = config().boxWidth;
     int titleLen = (int)strlen(title);
     int subtitleLen = subtitle ? (int)strlen(subtitle) : 0;
 
     if (config().format == LogFormat::RICH && config().useColors) {
         // Top border
-        fprintf(config().output, "\n%s%s", colors::SECTION, box::TL);
-        for (int i = 0; i < width - 2; i++) fprintf(config().output, "%s", box::H);
-        fprintf(config().output, "%s%s\n", box::TR, colors::RESET);
+        out.appendf("\n%s%s", colors::SECTION, box::TL);
+        out.repeat(box::H, width - 2);
+        out.appendf("%s%s\n", box::TR, colors::RESET);
 
         // Title line
         int padding = (width - 4 - titleLen) / 2;
-        fprintf(config().output, "%s%s%s", colors::SECTION, box::V, colors::RESET);
-        fprintf(config().output, "%*s%s%s%s%*s",
+        out.appendf("%s%s%s", colors::SECTION, box::V, colors::RESET);
+        out.appendf("%*s%s%s%s%*s",
             padding, "", colors::BOLD, title, colors::RESET,
             width - 4 - padding - titleLen, "");
-        fprintf(config().output, "%s%s%s\n", colors::SECTION, box::V, colors::RESET);
+        out.appendf("%s%s%s\n", colors::SECTION, box::V, colors::RESET);
 
         // Subtitle line (if provided)
         if (subtitle) {
             int subPadding = (width - 4 - subtitleLen) / 2;
-            fprintf(config().output, "%s%s%s", colors::SECTION, box::V, colors::RESET);
-            fprintf(config().output, "%*s%s%s%s%*s",
+            out.appendf("%s%s%s", colors::SECTION, box::V, colors::RESET);
+            out.appendf("%*s%s%s%s%*s",
                 subPadding, "", colors::DIM, subtitle, colors::RESET,
                 width - 4 - subPadding - subtitleLen, "");
-            fprintf(config().output, "%s%s%s\n", colors::SECTION, box::V, colors::RESET);
+            out.appendf("%s%s%s\n", colors::SECTION, box::V, colors::RESET);
         }
 
         // Bottom border
-        fprintf(config().output, "%s%s", colors::SECTION, box::BL);
-        for (int i = 0; i < width - 2; i++) fprintf(config().output, "%s", box::H);
-        fprintf(config().output, "%s%s\n\n", box::BR, colors::RESET);
+        out.appendf("%s%s", colors::SECTION, box::BL);
+        out.repeat(box::H, width - 2);
+        out.appendf("%s%s\n\n", box::BR, colors::RESET);
     } else {
         // Plain text
-        fprintf(config().output, "\n");
-        for (int i = 0; i < width; i++) fprintf(config().output, "=");
-        fprintf(config().output, "\n  %s\n", title);
-        if (subtitle) fprintf(config().output, "  %s\n", subtitle);
-        for (int i = 0; i < width; i++) fprintf(config().output, "=");
-        fprintf(config().output, "\n\n");
+        out.appendf("\n");
+        out.repeat("=", width);
+        out.appendf("\n  %s\n", title);
+        if (subtitle) out.appendf("  %s\n", subtitle);
+        out.repeat("=", width);
+        out.appendf("\n\n");
     }
 
-    fflush(config().output);
+    emitText(out);
 }
 
 // Print current memory status
@@ -732,33 +3747,79 @@ inline void printMemoryStatus(const char* label = "Memory") {
 // Convenience Macros
 // ============================================================================
 
-// Basic logging (Rich-style)
+// Every logging macro expands to its own static LogSite. Disabled and
+// rate-limited sites cost one inlined check and skip argument evaluation
+// (unless the flight recorder is on, which records them without formatting).
+// The format string and argument types are checked at compile time.
+#define RIPPLED_DEBUG_LOG_SITE(level, cid, fmt, ...) \
+    do { \
+        static rippled_debug::LogSite _rd_log_site( \
+            rippled_debug::LogLevel::level, __FILE__, __LINE__, fmt); \
+        (void)sizeof(rippled_debug::checkLogFormat(fmt, ##__VA_ARGS__)); \
+        if (rippled_debug::flightRecorderActive() || \
+            (_rd_log_site.isEnabled() && _rd_log_site.admit())) { \
+            rippled_debug::logAt(_rd_log_site, cid, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+// Basic logging (Rich-style). Levels below RIPPLED_DEBUG_MIN_LEVEL compile out.
+#if RIPPLED_DEBUG_MIN_LEVEL <= RIPPLED_DEBUG_LEVEL_DEBUG
 #define DEBUG_LOG(fmt, ...) \
-    rippled_debug::debugLog("DEBUG", __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+    RIPPLED_DEBUG_LOG_SITE(LVL_DEBUG, 0, fmt, ##__VA_ARGS__)
+#define DEBUG_LOG_CID(cid, fmt, ...) \
+    RIPPLED_DEBUG_LOG_SITE(LVL_DEBUG, cid, fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_LOG(fmt, ...) ((void)0)
+#define DEBUG_LOG_CID(cid, fmt, ...) ((void)0)
+#endif
 
+#if RIPPLED_DEBUG_MIN_LEVEL <= RIPPLED_DEBUG_LEVEL_INFO
 #define DEBUG_INFO(fmt, ...) \
-    rippled_debug::debugLog("INFO", __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+    RIPPLED_DEBUG_LOG_SITE(LVL_INFO, 0, fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_INFO(fmt, ...) ((void)0)
+#endif
 
+#if RIPPLED_DEBUG_MIN_LEVEL <= RIPPLED_DEBUG_LEVEL_WARN
 #define DEBUG_WARN(fmt, ...) \
-    rippled_debug::debugLog("WARN", __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+    RIPPLED_DEBUG_LOG_SITE(LVL_WARN, 0, fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_WARN(fmt, ...) ((void)0)
+#endif
 
+#if RIPPLED_DEBUG_MIN_LEVEL <= RIPPLED_DEBUG_LEVEL_ERROR
 #define DEBUG_ERROR(fmt, ...) \
-    rippled_debug::debugLog("ERROR", __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+    RIPPLED_DEBUG_LOG_SITE(LVL_ERROR, 0, fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_ERROR(fmt, ...) ((void)0)
+#endif
 
+#if RIPPLED_DEBUG_MIN_LEVEL <= RIPPLED_DEBUG_LEVEL_CRITICAL
 #define DEBUG_CRITICAL(fmt, ...) \
-    rippled_debug::debugLog("CRIT", __FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
-// Logging with explicit correlation ID
-#define DEBUG_LOG_CID(cid, fmt, ...) \
-    rippled_debug::debugLogCid(cid, "DEBUG", __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+    RIPPLED_DEBUG_LOG_SITE(LVL_CRITICAL, 0, fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_CRITICAL(fmt, ...) ((void)0)
+#endif
 
 // Section tracking with RAII (auto-timing, Rich-style boxes)
+#define RIPPLED_DEBUG_CONCAT_(a, b) a##b
+#define RIPPLED_DEBUG_CONCAT(a, b) RIPPLED_DEBUG_CONCAT_(a, b)
+
 #define DEBUG_SECTION(name) \
-    rippled_debug::SectionTimer _section_##__LINE__(name, __FILE__, __LINE__)
+    DEBUG_SECTION_SLOW(name, -1.0)
+
+// Section with its own slow-outlier threshold (reported when boxes are off,
+// e.g. while profiling)
+#define DEBUG_SECTION_SLOW(name, slowMs) \
+    static rippled_debug::SectionSite RIPPLED_DEBUG_CONCAT(_section_site_, __LINE__)( \
+        __FILE__, __LINE__, slowMs); \
+    rippled_debug::SectionTimer RIPPLED_DEBUG_CONCAT(_section_, __LINE__)( \
+        RIPPLED_DEBUG_CONCAT(_section_site_, __LINE__), name)
 
 // Legacy section macros (for compatibility)
 #define DEBUG_SECTION_BEGIN(name) \
-    { rippled_debug::SectionTimer _section_(name, __FILE__, __LINE__)
+    { static rippled_debug::SectionSite _section_site_(__FILE__, __LINE__); \
+      rippled_debug::SectionTimer _section_(_section_site_, name)
 
 #define DEBUG_SECTION_END(name) \
     }
@@ -770,6 +3831,14 @@ inline void printMemoryStatus(const char* label = "Memory") {
 #define DEBUG_CORRELATION_END(cid) \
     rippled_debug::endCorrelation(cid)
 
+// Carry the current span to another thread:
+//   auto ctx = DEBUG_SPAN_CAPTURE();  ...  DEBUG_SPAN_RESUME(ctx);
+#define DEBUG_SPAN_CAPTURE() \
+    rippled_debug::currentSpan()
+
+#define DEBUG_SPAN_RESUME(ctx) \
+    rippled_debug::SpanScope RIPPLED_DEBUG_CONCAT(_span_scope_, __LINE__)(ctx)
+
 // Variable inspection
 #define DEBUG_VAR(var) \
     DEBUG_LOG(#var " = %s", std::to_string(var).c_str())
@@ -787,6 +3856,42 @@ inline void printMemoryStatus(const char* label = "Memory") {
 #define DEBUG_MEMORY_LABEL(label) \
     rippled_debug::printMemoryStatus(label)
 
+// Background memory sampling / per-thread heap byte deltas
+#define DEBUG_MEMORY_SAMPLER_START(intervalMs) \
+    rippled_debug::startMemorySampler(intervalMs)
+
+#define DEBUG_MEMORY_SAMPLER_STOP() \
+    rippled_debug::stopMemorySampler()
+
+#define DEBUG_MEMORY_PRECISE() \
+    rippled_debug::enablePreciseMemoryTracking()
+
+// Place once, at global scope, in a single .cpp to count heap bytes per
+// thread through replacement operator new/delete (see precise mode above)
+#define RIPPLED_DEBUG_DEFINE_ALLOCATION_HOOKS() \
+    void* operator new(size_t size) { \
+        void* p = rippled_debug::trackedAlloc(size); \
+        if (!p) throw std::bad_alloc(); \
+        return p; \
+    } \
+    void* operator new[](size_t size) { \
+        void* p = rippled_debug::trackedAlloc(size); \
+        if (!p) throw std::bad_alloc(); \
+        return p; \
+    } \
+    void* operator new(size_t size, const std::nothrow_t&) noexcept { \
+        return rippled_debug::trackedAlloc(size); \
+    } \
+    void* operator new[](size_t size, const std::nothrow_t&) noexcept { \
+        return rippled_debug::trackedAlloc(size); \
+    } \
+    void operator delete(void* p) noexcept { rippled_debug::trackedFree(p); } \
+    void operator delete[](void* p) noexcept { rippled_debug::trackedFree(p); } \
+    void operator delete(void* p, size_t) noexcept { rippled_debug::trackedFree(p); } \
+    void operator delete[](void* p, size_t) noexcept { rippled_debug::trackedFree(p); } \
+    static const bool rippled_debug_allocation_hooks_ = \
+        (rippled_debug::allocationHooksInstalled() = true)
+
 // Banner for startup
 #define DEBUG_BANNER(title, subtitle) \
     rippled_debug::printBanner(title, subtitle)
@@ -804,15 +3909,52 @@ inline void printMemoryStatus(const char* label = "Memory") {
 #define DEBUG_FORMAT_TEXT() \
     rippled_debug::setLogFormat(rippled_debug::LogFormat::TEXT)
 
+#define DEBUG_FORMAT_BINARY() \
+    rippled_debug::setLogFormat(rippled_debug::LogFormat::BINARY)
+
 #define DEBUG_COLORS(enabled) \
     rippled_debug::setUseColors(enabled)
 
+// Sections also measure thread CPU time (cycles) to separate compute from waits
+#define DEBUG_SECTION_CPU(enabled) \
+    rippled_debug::setSectionCpuTiming(enabled)
+
+// Runtime level filtering, e.g. DEBUG_LEVEL(LVL_WARN), DEBUG_LEVEL_FOR("*overlay*", LVL_DEBUG)
+#define DEBUG_LEVEL(level) \
+    rippled_debug::setLogLevel(rippled_debug::LogLevel::level)
+
+#define DEBUG_LEVEL_FOR(fileGlob, level) \
+    rippled_debug::setLogLevelFor(fileGlob, rippled_debug::LogLevel::level)
+
+#define DEBUG_RATE_LIMIT(perSecond, burst) \
+    rippled_debug::setLogRateLimit(perSecond, burst)
+
+#define DEBUG_RATE_LIMIT_REPORT() \
+    rippled_debug::reportSuppressedLogs()
+
+#define DEBUG_LOG_SINK(level, format, output) \
+    rippled_debug::addLogSink(rippled_debug::LogLevel::level, rippled_debug::LogFormat::format, output)
+
 #define DEBUG_DELTA_TIME(enabled) \
     rippled_debug::setIncludeDeltaTime(enabled)
 
 #define DEBUG_MEMORY_TRACKING(enabled) \
     rippled_debug::setIncludeMemoryDelta(enabled)
 
+// Async logging (background writer thread)
+#define DEBUG_ASYNC_ENABLE(capacity, policy) \
+    rippled_debug::enableAsyncLogging(capacity, rippled_debug::AsyncOverflow::policy)
+
+#define DEBUG_ASYNC_DISABLE() \
+    rippled_debug::disableAsyncLogging()
+
+#define DEBUG_ASYNC_FLUSH() \
+    rippled_debug::flushAsyncLog()
+
+// Flight recorder (last records per thread, printed and dumped on crash)
+#define DEBUG_FLIGHT_RECORDER(recordsPerThread) \
+    rippled_debug::enableFlightRecorder(recordsPerThread)
+
 #else // !_WIN32
 
 // No-op on non-Windows platforms
@@ -823,23 +3965,41 @@ inline void printMemoryStatus(const char* label = "Memory") {
 #define DEBUG_CRITICAL(fmt, ...) ((void)0)
 #define DEBUG_LOG_CID(cid, fmt, ...) ((void)0)
 #define DEBUG_SECTION(name) ((void)0)
+#define DEBUG_SECTION_SLOW(name, slowMs) ((void)0)
 #define DEBUG_SECTION_BEGIN(name) {
 #define DEBUG_SECTION_END(name) }
 #define DEBUG_CORRELATION_START(context) 0
 #define DEBUG_CORRELATION_END(cid) ((void)0)
+#define DEBUG_SPAN_CAPTURE() 0
+#define DEBUG_SPAN_RESUME(ctx) ((void)(ctx))
 #define DEBUG_VAR(var) ((void)0)
 #define DEBUG_PTR(ptr) ((void)0)
 #define DEBUG_STR(str) ((void)0)
 #define DEBUG_MEMORY() ((void)0)
 #define DEBUG_MEMORY_LABEL(label) ((void)0)
+#define DEBUG_MEMORY_SAMPLER_START(intervalMs) ((void)0)
+#define DEBUG_MEMORY_SAMPLER_STOP() ((void)0)
+#define DEBUG_MEMORY_PRECISE() ((void)0)
+#define RIPPLED_DEBUG_DEFINE_ALLOCATION_HOOKS() static_assert(true, "")
 #define DEBUG_BANNER(title, subtitle) ((void)0)
 #define DEBUG_ENABLED(enabled) ((void)0)
 #define DEBUG_FORMAT_RICH() ((void)0)
 #define DEBUG_FORMAT_JSON() ((void)0)
 #define DEBUG_FORMAT_TEXT() ((void)0)
+#define DEBUG_FORMAT_BINARY() ((void)0)
 #define DEBUG_COLORS(enabled) ((void)0)
+#define DEBUG_SECTION_CPU(enabled) ((void)0)
+#define DEBUG_LEVEL(level) ((void)0)
+#define DEBUG_LEVEL_FOR(fileGlob, level) ((void)0)
+#define DEBUG_LOG_SINK(level, format, output) ((void)0)
+#define DEBUG_RATE_LIMIT(perSecond, burst) ((void)0)
+#define DEBUG_RATE_LIMIT_REPORT() ((void)0)
 #define DEBUG_DELTA_TIME(enabled) ((void)0)
 #define DEBUG_MEMORY_TRACKING(enabled) ((void)0)
+#define DEBUG_ASYNC_ENABLE(capacity, policy) ((void)0)
+#define DEBUG_ASYNC_DISABLE() ((void)0)
+#define DEBUG_ASYNC_FLUSH() ((void)0)
+#define DEBUG_FLIGHT_RECORDER(recordsPerThread) ((void)0)
 
 #endif // _WIN32
 
@@ -0,0 +1,259 @@
+/**
+ * @file etw_trace.h
+ * @brief ETW (TraceLogging) backend for log records and sections
+ *
+ * Publishes the "Rippled.Debug" TraceLogging provider so rippled's log lines
+ * and DEBUG_SECTION regions show up in WPA/xperf next to CPU sampling,
+ * context switches and disk I/O:
+ * - log records  -> "Log" events (level mapped, keyword 0x1)
+ * - sections     -> "Section" start/stop pairs (keyword 0x2), one activity
+ *                   per span, related to the parent span's activity
+ *
+ * Activity IDs come from the correlation ID and span ID, so one cid's work
+ * can be followed across threads. ETW stamps time, thread and CPU itself.
+ *
+ * Without a listening session the cost is the existing call-site filter:
+ * the provider is a log sink whose level follows the sessions' (LVL_OFF when
+ * none), and sections check TraceLoggingProviderEnabled() first.
+ *
+ * Capture:
+ *   wpr -start GeneralProfile -start rippled.wprp     (or)
+ *   tracelog -start rd -f rd.etl -guid *Rippled.Debug -level 5
+ *
+ * Usage (the provider must be defined in ONE source file):
+ *   RIPPLED_DEBUG_DEFINE_ETW_PROVIDER();
+ *   ...
+ *   DEBUG_ETW_ENABLE();
+ */
+
+#ifndef RIPPLED_WINDOWS_DEBUG_ETW_TRACE_H
+#define RIPPLED_WINDOWS_DEBUG_ETW_TRACE_H
+
+#if defined(_WIN32) && defined(__has_include)
+#if __has_include(<TraceLoggingProvider.h>)
+#define RIPPLED_DEBUG_HAS_ETW 1
+#endif
+#endif
+
+#ifdef RIPPLED_DEBUG_HAS_ETW
+
+#include "debug_log.h"
+
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "advapi32.lib")
+#endif
+
+// Defined by RIPPLED_DEBUG_DEFINE_ETW_PROVIDER()
+TRACELOGGING_DECLARE_PROVIDER(g_rippledDebugEtwProvider);
+
+// TraceLogging needs compile-time constants for keywords and levels
+#define RIPPLED_DEBUG_ETW_KEYWORD_LOG      0x1
+#define RIPPLED_DEBUG_ETW_KEYWORD_SECTION  0x2
+
+namespace rippled_debug {
+
+// ============================================================================
+// Provider State
+// ============================================================================
+
+struct EtwState {
+    SRWLOCK lock = SRWLOCK_INIT;
+    bool registered = false;
+    int sinkId = -1;
+    std::atomic<bool> observerAdded{false};
+};
+
+inline EtwState& etwState() {
+    static EtwState state;
+    return state;
+}
+
+// Lowest level any session wants log events at (LVL_OFF: nobody listening)
+inline LogLevel etwSessionLevel() {
+    static const struct { UCHAR etw; LogLevel level; } levels[] = {
+        {WINEVENT_LEVEL_VERBOSE,  LogLevel::LVL_DEBUG},
+        {WINEVENT_LEVEL_INFO,     LogLevel::LVL_INFO},
+        {WINEVENT_LEVEL_WARNING,  LogLevel::LVL_WARN},
+        {WINEVENT_LEVEL_ERROR,    LogLevel::LVL_ERROR},
+        {WINEVENT_LEVEL_CRITICAL, LogLevel::LVL_CRITICAL},
+    };
+    for (const auto& l : levels) {
+        if (TraceLoggingProviderEnabled(g_rippledDebugEtwProvider, l.etw,
+                RIPPLED_DEBUG_ETW_KEYWORD_LOG)) {
+            return l.level;
+        }
+    }
+    return LogLevel::LVL_OFF;
+}
+
+// Sessions attach and detach at any time; re-filter call sites when they do.
+// TraceLogging updates the provider's enable state before calling this.
+inline void NTAPI etwEnableCallback(LPCGUID, ULONG, UCHAR, ULONGLONG, ULONGLONG,
+                                    PEVENT_FILTER_DESCRIPTOR, PVOID) {
+    EtwState& state = etwState();
+    if (state.sinkId >= 0) setLogSinkLevel(state.sinkId, etwSessionLevel());
+}
+
+// {cid, spanId} as a GUID: stable per span, shared prefix per correlation
+inline GUID etwActivityId(CorrelationId cid, uint64_t spanId) {
+    GUID id;
+    id.Data1 = (unsigned long)(cid >> 32);
+    id.Data2 = (unsigned short)(cid >> 16);
+    id.Data3 = (unsigned short)cid;
+    memcpy(id.Data4, &spanId, sizeof(id.Data4));
+    return id;
+}
+
+// ============================================================================
+// Events
+// ============================================================================
+
+#define RIPPLED_DEBUG_ETW_WRITE_LOG(etwLevel) \
+    TraceLoggingWriteActivity(g_rippledDebugEtwProvider, "Log", activity, nullptr, \
+        TraceLoggingLevel(etwLevel), \
+        TraceLoggingKeyword(RIPPLED_DEBUG_ETW_KEYWORD_LOG), \
+        TraceLoggingString(ev.level, "Level"), \
+        TraceLoggingUtf8String(message, "Message"), \
+        TraceLoggingString(ev.fileName, "File"), \
+        TraceLoggingInt32(ev.line, "Line"), \
+        TraceLoggingUInt64(ev.cid, "CorrelationId"), \
+        TraceLoggingUInt64(ev.spanId, "SpanId"))
+
+// Log sink callback, on the logging thread
+inline void etwOnLog(const LogEvent& ev, int64_t, const char* message) {
+    GUID id = etwActivityId(ev.cid, ev.spanId);
+    const GUID* activity = (ev.cid != 0 || ev.spanId != 0) ? &id : nullptr;
+
+    switch (ev.severity) {
+        case LogLevel::LVL_DEBUG:    RIPPLED_DEBUG_ETW_WRITE_LOG(WINEVENT_LEVEL_VERBOSE); break;
+        case LogLevel::LVL_INFO:     RIPPLED_DEBUG_ETW_WRITE_LOG(WINEVENT_LEVEL_INFO); break;
+        case LogLevel::LVL_WARN:     RIPPLED_DEBUG_ETW_WRITE_LOG(WINEVENT_LEVEL_WARNING); break;
+        case LogLevel::LVL_ERROR:    RIPPLED_DEBUG_ETW_WRITE_LOG(WINEVENT_LEVEL_ERROR); break;
+        default:                     RIPPLED_DEBUG_ETW_WRITE_LOG(WINEVENT_LEVEL_CRITICAL); break;
+    }
+}
+
+#undef RIPPLED_DEBUG_ETW_WRITE_LOG
+
+inline bool etwSectionsEnabled() {
+    return TraceLoggingProviderEnabled(g_rippledDebugEtwProvider, WINEVENT_LEVEL_INFO,
+        RIPPLED_DEBUG_ETW_KEYWORD_SECTION);
+}
+
+inline void etwOnSectionEnter(const SectionEvent& ev) {
+    if (!etwSectionsEnabled()) return;
+
+    GUID activity = etwActivityId(ev.cid, ev.spanId);
+    GUID parent = etwActivityId(ev.cid, ev.parentSpanId);
+    TraceLoggingWriteActivity(g_rippledDebugEtwProvider, "Section", &activity,
+        ev.parentSpanId != 0 ? &parent : nullptr,
+        TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+        TraceLoggingKeyword(RIPPLED_DEBUG_ETW_KEYWORD_SECTION),
+        TraceLoggingOpcode(WINEVENT_OPCODE_START),
+        TraceLoggingUtf8String(ev.name ? ev.name : "", "Name"),
+        TraceLoggingString(ev.file ? fileBasename(ev.file) : "", "File"),
+        TraceLoggingInt32(ev.line, "Line"),
+        TraceLoggingUInt64(ev.cid, "CorrelationId"));
+}
+
+inline void etwOnSectionExit(const SectionEvent& ev) {
+    if (!etwSectionsEnabled()) return;
+
+    GUID activity = etwActivityId(ev.cid, ev.spanId);
+    TraceLoggingWriteActivity(g_rippledDebugEtwProvider, "Section", &activity, nullptr,
+        TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+        TraceLoggingKeyword(RIPPLED_DEBUG_ETW_KEYWORD_SECTION),
+        TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+        TraceLoggingUtf8String(ev.name ? ev.name : "", "Name"),
+        TraceLoggingUInt64((uint64_t)ticksToNs(ev.endTicks - ev.startTicks), "DurationNs"));
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+inline void disableEtwTracing();
+
+/**
+ * Register the Rippled.Debug provider and route log records and sections to
+ * it whenever a session enables it. Needs RIPPLED_DEBUG_DEFINE_ETW_PROVIDER()
+ * in one source file.
+ */
+inline bool enableEtwTracing() {
+    EtwState& state = etwState();
+    AcquireSRWLockExclusive(&state.lock);
+    if (state.registered) {
+        ReleaseSRWLockExclusive(&state.lock);
+        return true;
+    }
+
+    // The sink exists (filtered out) before registering: the enable
+    // callback can run inside TraceLoggingRegisterEx
+    if (state.sinkId < 0) state.sinkId = addLogEventSink(LogLevel::LVL_OFF, etwOnLog);
+    HRESULT hr = (state.sinkId >= 0)
+        ? TraceLoggingRegisterEx(g_rippledDebugEtwProvider, etwEnableCallback, nullptr)
+        : E_FAIL;
+    state.registered = SUCCEEDED(hr);
+    ReleaseSRWLockExclusive(&state.lock);
+
+    if (!state.registered) {
+        fprintf(stderr, "[rippled_debug] Cannot register ETW provider (0x%08lx)\n",
+            (unsigned long)hr);
+        return false;
+    }
+    setLogSinkLevel(state.sinkId, etwSessionLevel());
+
+    if (!state.observerAdded.exchange(true)) {
+        addSectionObserver(SectionObserver{etwOnSectionEnter, etwOnSectionExit});
+    }
+
+    static std::atomic<bool> atexitRegistered{false};
+    if (!atexitRegistered.exchange(true)) atexit(disableEtwTracing);
+    return true;
+}
+
+/**
+ * Stop sending events and unregister the provider (also runs at exit;
+ * required before a DLL using the toolkit unloads).
+ */
+inline void disableEtwTracing() {
+    EtwState& state = etwState();
+    AcquireSRWLockExclusive(&state.lock);
+    if (state.registered) {
+        if (state.sinkId >= 0) setLogSinkLevel(state.sinkId, LogLevel::LVL_OFF);
+        TraceLoggingUnregister(g_rippledDebugEtwProvider);
+        state.registered = false;
+    }
+    ReleaseSRWLockExclusive(&state.lock);
+}
+
+} // namespace rippled_debug
+
+// ============================================================================
+// Convenience Macros
+// ============================================================================
+
+// At global scope in exactly one source file. The GUID is the standard
+// name hash of "Rippled.Debug", so tools accept *Rippled.Debug too.
+#define RIPPLED_DEBUG_DEFINE_ETW_PROVIDER() \
+    TRACELOGGING_DEFINE_PROVIDER(g_rippledDebugEtwProvider, "Rippled.Debug", \
+        (0x10120823, 0xd940, 0x5d10, 0x51, 0x4d, 0x80, 0x15, 0x95, 0xb9, 0x58, 0xe0))
+
+#define DEBUG_ETW_ENABLE() \
+    rippled_debug::enableEtwTracing()
+
+#define DEBUG_ETW_DISABLE() \
+    rippled_debug::disableEtwTracing()
+
+#else // !RIPPLED_DEBUG_HAS_ETW
+
+#define RIPPLED_DEBUG_DEFINE_ETW_PROVIDER() static_assert(true, "")
+#define DEBUG_ETW_ENABLE() ((void)0)
+#define DEBUG_ETW_DISABLE() ((void)0)
+
+#endif // RIPPLED_DEBUG_HAS_ETW
+
+#endif // RIPPLED_WINDOWS_DEBUG_ETW_TRACE_H
@@ -0,0 +1,514 @@
+/**
+ * @file exception_monitor.h
+ * @brief First-chance exception counters from a vectored exception handler
+ *
+ * SetUnhandledExceptionFilter and the CRT signal handlers only see the
+ * exception that ends the process. Exceptions thrown and caught on a hot
+ * path (a parse failure in the RPC layer, a lookup that throws instead of
+ * returning) never show up, yet each one costs a kernel round trip and an
+ * unwind. The monitor installs a vectored handler that sees every
+ * first-chance exception, counts it by code and by throwing call site in
+ * lock-free tables, and can keep the stack of one exception in N.
+ *
+ * The handler never handles anything (EXCEPTION_CONTINUE_SEARCH), never
+ * allocates or locks, and adds one RtlCaptureStackBackTrace to a dispatch
+ * that already takes microseconds.
+ *
+ * Usage:
+ *   DEBUG_EXCEPTION_MONITOR(1000);      // count everything, 1 stack in 1000
+ *   ...
+ *   DEBUG_EXCEPTION_MONITOR_PRINT();    // table in the current log format
+ */
+
+#ifndef RIPPLED_WINDOWS_DEBUG_EXCEPTION_MONITOR_H
+#define RIPPLED_WINDOWS_DEBUG_EXCEPTION_MONITOR_H
+
+#ifdef _WIN32
+
+#include "crash_handlers.h"
+#include "debug_log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace rippled_debug {
+
+// ============================================================================
+// Counters
+// ============================================================================
+
+constexpr DWORD kCxxExceptionCode = 0xE06D7363;     // MSVC throw ('msc' | 0xE0000000)
+constexpr size_t kExceptionCodeSlots = 64;
+constexpr size_t kExceptionSiteSlots = 4096;        // Power of two
+constexpr int kExceptionSiteProbe = 16;
+constexpr int kExceptionSampleFrames = 32;
+constexpr size_t kExceptionSampleSlots = 64;        // Power of two
+
+struct ExceptionCodeCounter {
+    std::atomic<DWORD> code{0};                     // 0 = empty slot
+    std::atomic<uint64_t> count{0};
+};
+
+// A throwing call site: the return address into the function that threw
+// (C++ and RaiseException), or the faulting instruction (hardware faults)
+struct ExceptionSiteCounter {
+    std::atomic<uint64_t> address{0};               // 0 = empty slot
+    std::atomic<DWORD> code{0};                     // First code seen here
+    std::atomic<uint64_t> typeDescriptor{0};        // C++: thrown type, 0 = unknown
+    std::atomic<uint64_t> count{0};
+};
+
+struct ExceptionStackSample {
+    std::atomic<uint64_t> sequence{0};              // Sample number + 1 once complete, 0 while written
+    DWORD code = 0;
+    DWORD threadId = 0;
+    uint64_t typeDescriptor = 0;
+    int frameCount = 0;                             // frames[0] is the call site
+    DWORD64 frames[kExceptionSampleFrames] = {};
+};
+
+struct ExceptionMonitorState {
+    PVOID handler = nullptr;
+    std::atomic<bool> active{false};
+    std::atomic<uint32_t> sampleEvery{0};           // 0 = count only
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> unrecordedSites{0};       // Site table probe window full
+    std::atomic<uint64_t> samplesTaken{0};
+
+    // KernelBase.dll, where RaiseException lives; set at install
+    uint64_t raiseBegin = 0;
+    uint64_t raiseEnd = 0;
+
+    ExceptionCodeCounter codes[kExceptionCodeSlots];
+    ExceptionSiteCounter sites[kExceptionSiteSlots];
+    ExceptionStackSample samples[kExceptionSampleSlots];
+};
+
+inline ExceptionMonitorState& exceptionMonitor() {
+    static ExceptionMonitorState state;
+    return state;
+}
+
+inline void countExceptionCode(ExceptionMonitorState& m, DWORD code) {
+    for (size_t i = 0; i < kExceptionCodeSlots; i++) {
+        ExceptionCodeCounter& slot = m.codes[i];
+        DWORD current = slot.code.load(std::memory_order_acquire);
+        if (current == 0) {
+            DWORD expected = 0;
+            current = slot.code.compare_exchange_strong(expected, code, std::memory_order_acq_rel)
+                ? code : expected;
+        }
+        if (current == code) {
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+inline void countExceptionSite(ExceptionMonitorState& m, uint64_t address, DWORD code,
+                               uint64_t typeDescriptor) {
+    size_t home = (size_t)((address * 0x9E3779B97F4A7C15ull) >> 32) & (kExceptionSiteSlots - 1);
+    for (int i = 0; i < kExceptionSiteProbe; i++) {
+        ExceptionSiteCounter& slot = m.sites[(home + i) & (kExceptionSiteSlots - 1)];
+        uint64_t current = slot.address.load(std::memory_order_acquire);
+        if (current == 0) {
+            uint64_t expected = 0;
+            if (slot.address.compare_exchange_strong(expected, address, std::memory_order_acq_rel)) {
+                slot.code.store(code, std::memory_order_relaxed);
+                slot.typeDescriptor.store(typeDescriptor, std::memory_order_relaxed);
+                current = address;
+            } else {
+                current = expected;
+            }
+        }
+        if (current == address) {
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    m.unrecordedSites.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// Vectored Handler
+// ============================================================================
+
+/**
+ * Thrown type of an MSVC C++ exception. ExceptionInformation holds
+ * {magic, object, ThrowInfo, image base (64-bit only)}; the ThrowInfo's
+ * first catchable type is the thrown type itself, and its TypeDescriptor
+ * is what type_info is on MSVC. Offsets are image-relative on 64-bit and
+ * absolute pointers on x86 (base 0).
+ * @return TypeDescriptor address, 0 if not a C++ throw or a bare rethrow
+ */
+inline uint64_t cxxExceptionType(const EXCEPTION_RECORD* record) {
+    if (record->ExceptionCode != kCxxExceptionCode || record->NumberParameters < 3) return 0;
+    ULONG_PTR magic = record->ExceptionInformation[0];
+    if (magic < 0x19930520 || magic > 0x19930522) return 0;
+
+    const int32_t* throwInfo = (const int32_t*)record->ExceptionInformation[2];
+    if (!throwInfo) return 0;
+    uintptr_t base = record->NumberParameters >= 4 ? record->ExceptionInformation[3] : 0;
+
+    // ThrowInfo: attributes, pmfnUnwind, pForwardCompat, pCatchableTypeArray
+    const int32_t* catchables = (const int32_t*)(base + (uint32_t)throwInfo[3]);
+    if (catchables[0] < 1) return 0;
+    // CatchableType: properties, pType, ...
+    const int32_t* catchable = (const int32_t*)(base + (uint32_t)catchables[1]);
+    return (uint64_t)(base + (uint32_t)catchable[1]);
+}
+
+/**
+ * Index of the throwing call site in a stack captured inside the handler.
+ * RaiseException reports its own return address from RtlRaiseException as
+ * ExceptionAddress; the site is its caller, one frame further for C++
+ * (past _CxxThrowException). Anything else faulted where it says it did.
+ * @return frame index, or -1 to use ExceptionAddress
+ */
+inline int exceptionSiteFrame(const ExceptionMonitorState& m, const EXCEPTION_RECORD* record,
+                              const DWORD64* frames, int count) {
+    uint64_t address = (uint64_t)(uintptr_t)record->ExceptionAddress;
+    if (address < m.raiseBegin || address >= m.raiseEnd) return -1;
+
+    int skip = record->ExceptionCode == kCxxExceptionCode ? 2 : 1;
+    for (int i = 0; i + skip < count; i++) {
+        if (frames[i] == address) return i + skip;
+    }
+    return -1;
+}
+
+inline void recordExceptionSample(ExceptionMonitorState& m, const EXCEPTION_RECORD* record,
+                                  uint64_t typeDescriptor, uint64_t site,
+                                  const DWORD64* frames, int count) {
+    uint64_t pos = m.samplesTaken.fetch_add(1, std::memory_order_relaxed);
+    ExceptionStackSample& sample = m.samples[pos & (kExceptionSampleSlots - 1)];
+
+    sample.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    sample.code = record->ExceptionCode;
+    sample.threadId = GetCurrentThreadId();
+    sample.typeDescriptor = typeDescriptor;
+    if (count > 0) {
+        memcpy(sample.frames, frames, count * sizeof(DWORD64));
+        sample.frameCount = count;
+    } else {
+        sample.frames[0] = site;
+        sample.frameCount = 1;
+    }
+    sample.sequence.store(pos + 1, std::memory_order_release);
+}
+
+inline LONG CALLBACK exceptionMonitorHandler(PEXCEPTION_POINTERS info) {
+    ExceptionMonitorState& m = exceptionMonitor();
+    if (!m.active.load(std::memory_order_relaxed)) return EXCEPTION_CONTINUE_SEARCH;
+
+    const EXCEPTION_RECORD* record = info->ExceptionRecord;
+    uint64_t n = m.total.fetch_add(1, std::memory_order_relaxed) + 1;
+    countExceptionCode(m, record->ExceptionCode);
+
+    // Little stack left to walk on: count the code only
+    if (record->ExceptionCode == EXCEPTION_STACK_OVERFLOW) return EXCEPTION_CONTINUE_SEARCH;
+
+    void* addresses[kExceptionSampleFrames];
+    int count = RtlCaptureStackBackTrace(1, kExceptionSampleFrames, addresses, NULL);
+    DWORD64 frames[kExceptionSampleFrames];
+    for (int i = 0; i < count; i++) {
+        frames[i] = (DWORD64)(uintptr_t)addresses[i];
+    }
+
+    int siteFrame = exceptionSiteFrame(m, record, frames, count);
+    uint64_t site = siteFrame >= 0 ? frames[siteFrame] : (uint64_t)(uintptr_t)record->ExceptionAddress;
+    uint64_t typeDescriptor = cxxExceptionType(record);
+    countExceptionSite(m, site, record->ExceptionCode, typeDescriptor);
+
+    uint32_t every = m.sampleEvery.load(std::memory_order_relaxed);
+    if (every && n % every == 0) {
+        // Drop the dispatcher frames: the sample starts at the call site
+        int first = siteFrame;
+        for (int i = 0; first < 0 && i < count; i++) {
+            if (frames[i] == site) first = i;
+        }
+        if (first < 0) first = count;
+        recordExceptionSample(m, record, typeDescriptor, site, frames + first, count - first);
+    }
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+/**
+ * Start counting first-chance exceptions. Calling it again only changes
+ * the sample rate.
+ * @param sampleEvery Keep the stack of every Nth exception (0 = count only)
+ */
+inline bool installExceptionMonitor(uint32_t sampleEvery = 0) {
+    ExceptionMonitorState& m = exceptionMonitor();
+    m.sampleEvery.store(sampleEvery, std::memory_order_relaxed);
+    if (m.handler) {
+        m.active.store(true, std::memory_order_release);
+        return true;
+    }
+
+    HMODULE kernelBase = GetModuleHandleW(L"kernelbase.dll");
+    MODULEINFO module;
+    if (kernelBase && GetModuleInformation(GetCurrentProcess(), kernelBase, &module, sizeof(module))) {
+        m.raiseBegin = (uint64_t)(uintptr_t)module.lpBaseOfDll;
+        m.raiseEnd = m.raiseBegin + module.SizeOfImage;
+    }
+
+    // First in the chain, so a handler that resolves the exception cannot hide it
+    m.handler = AddVectoredExceptionHandler(1, exceptionMonitorHandler);
+    if (!m.handler) {
+        fprintf(stderr, "[rippled_debug] AddVectoredExceptionHandler failed (error %lu)\n",
+            GetLastError());
+        return false;
+    }
+    m.active.store(true, std::memory_order_release);
+    return true;
+}
+
+inline void removeExceptionMonitor() {
+    ExceptionMonitorState& m = exceptionMonitor();
+    m.active.store(false, std::memory_order_release);
+    if (m.handler) {
+        RemoveVectoredExceptionHandler(m.handler);
+        m.handler = nullptr;
+    }
+}
+
+inline void setExceptionSampleRate(uint32_t sampleEvery) {
+    exceptionMonitor().sampleEvery.store(sampleEvery, std::memory_order_relaxed);
+}
+
+/**
+ * Zero the counters (sites stay in the table with a count of 0, which
+ * reports skip) and forget the samples.
+ */
+inline void resetExceptionMonitor() {
+    ExceptionMonitorState& m = exceptionMonitor();
+    m.total.store(0, std::memory_order_relaxed);
+    m.unrecordedSites.store(0, std::memory_order_relaxed);
+    for (ExceptionCodeCounter& slot : m.codes) slot.count.store(0, std::memory_order_relaxed);
+    for (ExceptionSiteCounter& slot : m.sites) slot.count.store(0, std::memory_order_relaxed);
+    for (ExceptionStackSample& sample : m.samples) sample.sequence.store(0, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// Reports
+// ============================================================================
+
+struct ExceptionCodeCount {
+    DWORD code;
+    uint64_t count;
+};
+
+struct ExceptionSiteCount {
+    uint64_t address;
+    DWORD code;
+    uint64_t typeDescriptor;
+    uint64_t count;
+};
+
+/**
+ * Copy the counters, largest first. Safe while exceptions are being counted.
+ * @return total first-chance exceptions since install or reset
+ */
+inline uint64_t collectExceptionCounts(std::vector<ExceptionCodeCount>& codes,
+                                       std::vector<ExceptionSiteCount>& sites) {
+    ExceptionMonitorState& m = exceptionMonitor();
+    codes.clear();
+    sites.clear();
+
+    for (const ExceptionCodeCounter& slot : m.codes) {
+        DWORD code = slot.code.load(std::memory_order_acquire);
+        uint64_t count = slot.count.load(std::memory_order_relaxed);
+        if (code && count) codes.push_back(ExceptionCodeCount{code, count});
+    }
+    for (const ExceptionSiteCounter& slot : m.sites) {
+        uint64_t address = slot.address.load(std::memory_order_acquire);
+        uint64_t count = slot.count.load(std::memory_order_relaxed);
+        if (address && count) {
+            sites.push_back(ExceptionSiteCount{address, slot.code.load(std::memory_order_relaxed),
+                slot.typeDescriptor.load(std::memory_order_relaxed), count});
+        }
+    }
+
+    std::sort(codes.begin(), codes.end(), [](const ExceptionCodeCount& a, const ExceptionCodeCount& b) {
+        return a.count > b.count;
+    });
+    std::sort(sites.begin(), sites.end(), [](const ExceptionSiteCount& a, const ExceptionSiteCount& b) {
+        return a.count > b.count;
+    });
+    return m.total.load(std::memory_order_relaxed);
+}
+
+inline const char* exceptionCodeName(DWORD code) {
+    switch (code) {
+        case kCxxExceptionCode:                     return "C++ exception";
+        case EXCEPTION_ACCESS_VIOLATION:            return "ACCESS_VIOLATION";
+        case EXCEPTION_STACK_OVERFLOW:              return "STACK_OVERFLOW";
+        case EXCEPTION_INT_DIVIDE_BY_ZERO:          return "INT_DIVIDE_BY_ZERO";
+        case EXCEPTION_ILLEGAL_INSTRUCTION:         return "ILLEGAL_INSTRUCTION";
+        case EXCEPTION_BREAKPOINT:                  return "BREAKPOINT";
+        case EXCEPTION_GUARD_PAGE:                  return "GUARD_PAGE";
+        case EXCEPTION_IN_PAGE_ERROR:               return "IN_PAGE_ERROR";
+        case 0x40010006:                            return "OutputDebugString";
+        case 0x406D1388:                            return "SetThreadName";
+        case 0x000006BA:                            return "RPC_S_SERVER_UNAVAILABLE";
+        default:                                    return "";
+    }
+}
+
+// "std::runtime_error" from the site's TypeDescriptor (decorated name after vftable + spare)
+inline void exceptionSiteType(uint64_t typeDescriptor, char* out, size_t size) {
+    if (!typeDescriptor) {
+        if (size) out[0] = '\0';
+        return;
+    }
+    undecorateTypeName((const char*)(uintptr_t)(typeDescriptor + 2 * sizeof(void*)), out, size);
+}
+
+// Symbol when the session is ready, else module+offset
+inline void describeExceptionSite(uint64_t address, char* out, size_t size) {
+    ReportBuffer text(out, size);
+    SymbolCacheEntry sym;
+    if (resolveSymbol(address, sym)) {
+        if (sym.line) text.appendf("%s (%s:%lu)", sym.name, sym.file, (unsigned long)sym.line);
+        else text.append(sym.name);
+        return;
+    }
+    char module[64];
+    DWORD64 offset = 0, preferredVa = 0;
+    if (describeModuleAddress(address, module, sizeof(module), offset, preferredVa)) {
+        text.appendf("%s+0x%llx", module, (unsigned long long)offset);
+    } else {
+        text.appendf("0x%016llx", (unsigned long long)address);
+    }
+}
+
+/**
+ * Print exception counts by code and by call site, plus the sampled
+ * stacks, in the current log format (JSON: one object per line).
+ * @param maxSites Call sites listed
+ */
+inline void printExceptionMonitor(size_t maxSites = 20) {
+    if (!config().enabled) return;
+    enableAnsiSupport();
+
+    std::vector<ExceptionCodeCount> codes;
+    std::vector<ExceptionSiteCount> sites;
+    uint64_t total = collectExceptionCounts(codes, sites);
+    ExceptionMonitorState& m = exceptionMonitor();
+    bool json = config().format == LogFormat::JSON;
+    bool rich = config().format == LogFormat::RICH && config().useColors;
+    char where[320], type[128];
+
+    LineBuffer out;
+    if (json) {
+        out.appendf("{\"exceptions_total\":%llu,\"unrecorded_sites\":%llu}\n",
+            (unsigned long long)total,
+            (unsigned long long)m.unrecordedSites.load(std::memory_order_relaxed));
+    } else {
+        out.appendf("\n%s--- First-Chance Exceptions (%llu total) ---%s\n",
+            rich ? colors::BOLD : "", (unsigned long long)total, rich ? colors::RESET : "");
+    }
+    emitText(out);
+
+    for (const ExceptionCodeCount& c : codes) {
+        out.length = 0;
+        if (json) {
+            out.appendf("{\"exception_code\":\"0x%08lX\",\"name\":\"%s\",\"count\":%llu}\n",
+                (unsigned long)c.code, exceptionCodeName(c.code), (unsigned long long)c.count);
+        } else {
+            out.appendf("  0x%08lX %-24s %12llu\n",
+                (unsigned long)c.code, exceptionCodeName(c.code), (unsigned long long)c.count);
+        }
+        emitText(out);
+    }
+
+    if (!json && !sites.empty()) {
+        out.length = 0;
+        out.appendf("\n%s%12s  %-10s  %-28s %s%s\n", rich ? colors::BOLD : "",
+            "Count", "Code", "Type", "Call site", rich ? colors::RESET : "");
+        emitText(out);
+    }
+    for (size_t i = 0; i < sites.size() && i < maxSites; i++) {
+        const ExceptionSiteCount& s = sites[i];
+        describeExceptionSite(s.address, where, sizeof(where));
+        exceptionSiteType(s.typeDescriptor, type, sizeof(type));
+        out.length = 0;
+        if (json) {
+            out.appendf("{\"exception_site\":\"%s\",\"address\":\"0x%llx\",\"code\":\"0x%08lX\","
+                "\"type\":\"%s\",\"count\":%llu}\n", escapeJson(where).c_str(),
+                (unsigned long long)s.address, (unsigned long)s.code,
+                escapeJson(type).c_str(), (unsigned long long)s.count);
+        } else {
+            out.appendf("%s%12llu%s  0x%08lX  %-28s %s\n", rich ? colors::NUMBER : "",
+                (unsigned long long)s.count, rich ? colors::RESET : "",
+                (unsigned long)s.code, type[0] ? type : exceptionCodeName(s.code), where);
+        }
+        emitText(out);
+    }
+    if (!json && sites.size() > maxSites) {
+        out.length = 0;
+        out.appendf("  ... and %zu more call sites\n", sites.size() - maxSites);
+        emitText(out);
+    }
+
+    // Sampled stacks, oldest first
+    uint64_t taken = m.samplesTaken.load(std::memory_order_acquire);
+    uint64_t first = taken > kExceptionSampleSlots ? taken - kExceptionSampleSlots : 0;
+    for (uint64_t pos = first; pos < taken; pos++) {
+        const ExceptionStackSample& slot = m.samples[pos & (kExceptionSampleSlots - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) continue;
+        ExceptionStackSample sample;
+        sample.code = slot.code;
+        sample.threadId = slot.threadId;
+        sample.typeDescriptor = slot.typeDescriptor;
+        sample.frameCount = (std::min)(slot.frameCount, kExceptionSampleFrames);
+        memcpy(sample.frames, slot.frames, sample.frameCount * sizeof(DWORD64));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != pos + 1) continue;
+
+        exceptionSiteType(sample.typeDescriptor, type, sizeof(type));
+        out.length = 0;
+        if (json) {
+            out.appendf("{\"exception_sample\":%llu,\"code\":\"0x%08lX\",\"type\":\"%s\",\"tid\":%lu,\"frames\":[",
+                (unsigned long long)pos + 1, (unsigned long)sample.code, escapeJson(type).c_str(),
+                (unsigned long)sample.threadId);
+            for (int f = 0; f < sample.frameCount; f++) {
+                describeExceptionSite(sample.frames[f], where, sizeof(where));
+                out.appendf("%s\"%s\"", f ? "," : "", escapeJson(where).c_str());
+            }
+            out.append("]}\n");
+        } else {
+            out.appendf("\nSample %llu: 0x%08lX %s (tid %lu)\n", (unsigned long long)pos + 1,
+                (unsigned long)sample.code, type[0] ? type : exceptionCodeName(sample.code),
+                (unsigned long)sample.threadId);
+            for (int f = 0; f < sample.frameCount; f++) {
+                describeExceptionSite(sample.frames[f], where, sizeof(where));
+                out.appendf("  [%2d] %s\n", f, where);
+            }
+        }
+        emitText(out);
+    }
+}
+
+} // namespace rippled_debug
+
+// Convenience macros
+#define DEBUG_EXCEPTION_MONITOR(sampleEvery) \
+    rippled_debug::installExceptionMonitor(sampleEvery)
+
+#define DEBUG_EXCEPTION_MONITOR_PRINT() \
+    rippled_debug::printExceptionMonitor()
+
+#else // !_WIN32
+
+#define DEBUG_EXCEPTION_MONITOR(sampleEvery) ((void)0)
+#define DEBUG_EXCEPTION_MONITOR_PRINT() ((void)0)
+
+#endif // _WIN32
+
+#endif // RIPPLED_WINDOWS_DEBUG_EXCEPTION_MONITOR_H
@@ -0,0 +1,477 @@
+/**
+ * @file log_file.h
+ * @brief Memory-mapped, rotating log file sink
+ *
+ * setLogOutput(FILE*) pays stdio locking plus an fflush (a WriteFile) per
+ * record. This sink maps a pre-allocated segment of the log file and copies
+ * records into it, so the hot path is a memcpy under a lock - no syscalls.
+ * Mapped pages belong to the OS cache, so everything written survives a
+ * process crash without any flush; FlushViewOfFile only runs on the
+ * size/time policy (for power loss) and on flushAsyncLog(). The minidump
+ * filter calls that last, best effort, after the dump and crash report are
+ * written; the terminate and signal handlers do not flush at all.
+ *
+ * Files rotate by size and age: "rippled.log" becomes "rippled.log.1", older
+ * files shift up, and only maxFiles are kept. Under the lock, rotation only
+ * renames the full file aside and maps its replacement; the thread that
+ * rotated flushes, trims and shifts the old file after releasing it. A file
+ * left by a crash is
+ * zero-padded to the end of its last segment (decode_log skips the padding);
+ * closeLogFile() trims it to the bytes written.
+ *
+ * Usage:
+ *   rippled_debug::LogFileOptions options;
+ *   options.maxFileBytes = 512ull << 20;
+ *   options.maxFiles = 10;
+ *   rippled_debug::openLogFile("C:\\rippled\\logs\\debug.log", options);
+ *   ...
+ *   DEBUG_LOG_FILE_CLOSE();
+ *
+ * Or keep the console as the primary output and add the file as a sink:
+ *   rippled_debug::addLogFileSink("debug.json", LogLevel::LVL_INFO, LogFormat::JSON);
+ */
+
+#ifndef RIPPLED_WINDOWS_DEBUG_LOG_FILE_H
+#define RIPPLED_WINDOWS_DEBUG_LOG_FILE_H
+
+#ifdef _WIN32
+
+#include "debug_log.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+namespace rippled_debug {
+
+// ============================================================================
+// Options
+// ============================================================================
+
+struct LogFileOptions {
+    size_t segmentBytes = 4u << 20;     // Mapped ahead of the writer (rounded to 64 KB)
+    uint64_t maxFileBytes = 256u << 20; // Rotate at this size (0 = never)
+    DWORD maxAgeSeconds = 0;            // Rotate files older than this (0 = never)
+    int maxFiles = 8;                   // Current file plus rotated ones
+    size_t flushBytes = 1u << 20;       // FlushViewOfFile after this many bytes...
+    DWORD flushIntervalMs = 1000;       // ...or when this long since the last one
+};
+
+// ============================================================================
+// Mapped File State
+// ============================================================================
+
+struct LogFileState {
+    SRWLOCK lock = SRWLOCK_INIT;
+    SRWLOCK retireLock = SRWLOCK_INIT;  // Held while a rotated-out file is finished
+    LogFileOptions options;
+    char path[MAX_PATH] = {};
+
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    char* view = nullptr;
+    uint64_t viewOffset = 0;            // File offset of view[0]
+    size_t viewSize = 0;
+    size_t cursor = 0;                  // Next free byte in the view
+    uint64_t written = 0;               // Bytes in the current file
+    uint64_t openedTick = 0;
+
+    std::atomic<size_t> unflushed{0};
+    std::atomic<uint64_t> lastFlushTick{0};
+    uint64_t rotations = 0;
+    int sinkId = -1;                    // addLogFileSink() registration
+};
+
+inline LogFileState& logFileState() {
+    static LogFileState state;
+    return state;
+}
+
+inline size_t allocationGranularity() {
+    static size_t granularity = [] {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (size_t)(info.dwAllocationGranularity ? info.dwAllocationGranularity : 65536);
+    }();
+    return granularity;
+}
+
+inline void unmapLogSegment(LogFileState& f) {
+    if (f.view) UnmapViewOfFile(f.view);
+    if (f.mapping) CloseHandle(f.mapping);
+    f.view = nullptr;
+    f.mapping = nullptr;
+}
+
+// Extend the file by one segment and map it at the current end of data.
+// Views start on allocation-granularity boundaries, so the new view may
+// begin with the tail of the previous segment.
+inline bool mapLogSegment(LogFileState& f) {
+    if (f.view) FlushViewOfFile(f.view, 0);     // Start write-back of the old segment
+    unmapLogSegment(f);
+
+    size_t granularity = allocationGranularity();
+    uint64_t offset = f.written - f.written % granularity;
+    size_t size = f.options.segmentBytes;
+    size = (size + granularity - 1) / granularity * granularity;
+    if (size < granularity) size = granularity;
+
+    uint64_t end = offset + size;
+    f.mapping = CreateFileMappingA(f.file, NULL, PAGE_READWRITE,
+        (DWORD)(end >> 32), (DWORD)(end & 0xFFFFFFFF), NULL);
+    if (!f.mapping) return false;
+
+    f.view = (char*)MapViewOfFile(f.mapping, FILE_MAP_WRITE,
+        (DWORD)(offset >> 32), (DWORD)(offset & 0xFFFFFFFF), size);
+    if (!f.view) {
+        CloseHandle(f.mapping);
+        f.mapping = nullptr;
+        return false;
+    }
+    f.viewOffset = offset;
+    f.viewSize = size;
+    f.cursor = (size_t)(f.written - offset);
+    return true;
+}
+
+// An open file taken out of LogFileState, to be finished without its lock
+struct RetiredLogFile {
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    char* view = nullptr;
+    uint64_t written = 0;
+};
+
+inline RetiredLogFile detachLogFile(LogFileState& f) {
+    RetiredLogFile r;
+    r.file = f.file;
+    r.mapping = f.mapping;
+    r.view = f.view;
+    r.written = f.written;
+    f.file = INVALID_HANDLE_VALUE;
+    f.mapping = nullptr;
+    f.view = nullptr;
+    return r;
+}
+
+// Unmap and cut the pre-allocated tail off the file
+inline void finishLogFile(const RetiredLogFile& r) {
+    if (r.view) {
+        FlushViewOfFile(r.view, 0);
+        UnmapViewOfFile(r.view);
+    }
+    if (r.mapping) CloseHandle(r.mapping);
+
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG)r.written;
+    if (SetFilePointerEx(r.file, end, NULL, FILE_BEGIN)) SetEndOfFile(r.file);
+    FlushFileBuffers(r.file);
+    CloseHandle(r.file);
+}
+
+inline void closeLogFileHandle(LogFileState& f) {
+    if (f.file == INVALID_HANDLE_VALUE) return;
+    finishLogFile(detachLogFile(f));
+}
+
+// Where a full file waits (renamed while still open) to be finished and shifted
+inline void retiringLogFilePath(const LogFileState& f, char* out, size_t size) {
+    snprintf(out, size, "%s.rotating", f.path);
+}
+
+// current -> path.1, path.1 -> path.2 ...; the oldest beyond maxFiles is
+// deleted. current is f.path, or the retiring name during rotation.
+inline void shiftRotatedLogFiles(const LogFileState& f, const char* current) {
+    char from[MAX_PATH + 16];
+    char to[MAX_PATH + 16];
+    int keep = f.options.maxFiles > 1 ? f.options.maxFiles - 1 : 0;
+    if (keep == 0) {
+        DeleteFileA(current);
+        return;
+    }
+
+    snprintf(to, sizeof(to), "%s.%d", f.path, keep);
+    DeleteFileA(to);
+    for (int i = keep - 1; i >= 1; i--) {
+        snprintf(from, sizeof(from), "%s.%d", f.path, i);
+        snprintf(to, sizeof(to), "%s.%d", f.path, i + 1);
+        MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+    }
+    snprintf(to, sizeof(to), "%s.1", f.path);
+    MoveFileExA(current, to, MOVEFILE_REPLACE_EXISTING);
+}
+
+// Start a fresh, empty file at f.path (the old one is rotated away first)
+inline bool createLogFile(LogFileState& f) {
+    DWORD attributes = GetFileAttributesA(f.path);
+    if (attributes != INVALID_FILE_ATTRIBUTES) shiftRotatedLogFiles(f, f.path);
+
+    f.file = CreateFileA(f.path, GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (f.file == INVALID_HANDLE_VALUE) return false;
+
+    f.written = 0;
+    f.openedTick = GetTickCount64();
+    f.lastFlushTick.store(f.openedTick, std::memory_order_relaxed);
+    f.unflushed.store(0, std::memory_order_relaxed);
+    if (!mapLogSegment(f)) {
+        CloseHandle(f.file);
+        f.file = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    return true;
+}
+
+inline void copyToLogFile(LogFileState& f, const char* data, size_t len) {
+    while (len > 0) {
+        if (f.cursor == f.viewSize && !mapLogSegment(f)) {
+            fprintf(stderr, "[rippled_debug] Cannot map log file segment (error %lu); "
+                "file output stopped\n", GetLastError());
+            return;
+        }
+        size_t n = f.viewSize - f.cursor;
+        if (n > len) n = len;
+        memcpy(f.view + f.cursor, data, n);
+        f.cursor += n;
+        f.written += n;
+        data += n;
+        len -= n;
+    }
+}
+
+inline bool logFileRotationDue(const LogFileState& f, size_t incoming) {
+    if (f.written == 0) return false;
+    if (f.options.maxFileBytes && f.written + incoming > f.options.maxFileBytes) return true;
+    return f.options.maxAgeSeconds &&
+        GetTickCount64() - f.openedTick >= (uint64_t)f.options.maxAgeSeconds * 1000;
+}
+
+// A rotated binary log starts with its own stream header, and call sites
+// re-send their definitions. A record whose site definition went to the
+// previous file just before the rotation decodes as an unknown site.
+inline const LogOutputSink& logFileSink();
+
+// Swap in a fresh file. Renaming the open file aside (it is shared for
+// delete) frees f.path, so the flush, trim and shift of the old file are left
+// to finishRotatedLogFile() once f.lock is released. retired stays unset when
+// the rename fails; the old file is then finished here, as on open.
+inline void rotateLogFileLocked(LogFileState& f, RetiredLogFile& retired) {
+    // Only one retired file at a time: a rotation right behind another
+    // (a tiny maxFileBytes) waits for it, keeping the shifts in order
+    AcquireSRWLockExclusive(&f.retireLock);
+    char retiring[MAX_PATH + 16];
+    retiringLogFilePath(f, retiring, sizeof(retiring));
+    if (MoveFileExA(f.path, retiring, MOVEFILE_REPLACE_EXISTING)) {
+        retired = detachLogFile(f);
+    } else {
+        closeLogFileHandle(f);
+        ReleaseSRWLockExclusive(&f.retireLock);
+    }
+
+    if (!createLogFile(f)) {
+        fprintf(stderr, "[rippled_debug] Cannot rotate log file %s (error %lu)\n",
+            f.path, GetLastError());
+        return;
+    }
+    f.rotations++;
+
+    if (config().sink == &logFileSink() && config().format == LogFormat::BINARY) {
+        binaryStreamEpoch().fetch_add(1, std::memory_order_acq_rel);
+        BinaryWriter w;
+        putStreamHeader(w);
+        copyToLogFile(f, w.data, w.length);
+    }
+}
+
+// Outside f.lock: finish the file rotateLogFileLocked() renamed aside
+inline void finishRotatedLogFile(LogFileState& f, const RetiredLogFile& retired) {
+    char retiring[MAX_PATH + 16];
+    retiringLogFilePath(f, retiring, sizeof(retiring));
+    finishLogFile(retired);
+    shiftRotatedLogFiles(f, retiring);
+    ReleaseSRWLockExclusive(&f.retireLock);
+}
+
+// Under f.lock: let a rotated-out file finish before touching f.path
+inline void waitForRotatedLogFile(LogFileState& f) {
+    AcquireSRWLockExclusive(&f.retireLock);
+    ReleaseSRWLockExclusive(&f.retireLock);
+}
+
+// ============================================================================
+// Sink
+// ============================================================================
+
+inline void logFileWrite(const char* data, size_t len) {
+    LogFileState& f = logFileState();
+    RetiredLogFile retired;
+    AcquireSRWLockExclusive(&f.lock);
+    if (f.view) {
+        if (logFileRotationDue(f, len)) rotateLogFileLocked(f, retired);
+        if (f.view) copyToLogFile(f, data, len);
+        f.unflushed.fetch_add(len, std::memory_order_relaxed);
+    }
+    ReleaseSRWLockExclusive(&f.lock);
+
+    if (retired.file != INVALID_HANDLE_VALUE) finishRotatedLogFile(f, retired);
+}
+
+inline void flushLogFileLocked(LogFileState& f, bool durable) {
+    if (!f.view) return;
+    FlushViewOfFile(f.view, f.cursor);
+    if (durable) FlushFileBuffers(f.file);
+    f.unflushed.store(0, std::memory_order_relaxed);
+    f.lastFlushTick.store(GetTickCount64(), std::memory_order_relaxed);
+}
+
+// Record/batch boundary: two relaxed loads unless the policy is due. Forced
+// (explicit and crash-time) flushes also flush the file's metadata; if the
+// lock stays held - a thread crashed inside logFileWrite - they flush anyway.
+inline void logFileFlush(bool force) {
+    LogFileState& f = logFileState();
+    if (!force) {
+        if (f.unflushed.load(std::memory_order_relaxed) < f.options.flushBytes &&
+            GetTickCount64() - f.lastFlushTick.load(std::memory_order_relaxed) <
+                f.options.flushIntervalMs) {
+            return;
+        }
+        AcquireSRWLockExclusive(&f.lock);
+        flushLogFileLocked(f, false);
+        ReleaseSRWLockExclusive(&f.lock);
+        return;
+    }
+
+    for (int attempt = 0; attempt < 100; attempt++) {
+        if (TryAcquireSRWLockExclusive(&f.lock)) {
+            flushLogFileLocked(f, true);
+            ReleaseSRWLockExclusive(&f.lock);
+            return;
+        }
+        Sleep(1);
+    }
+    flushLogFileLocked(f, true);
+}
+
+inline const LogOutputSink& logFileSink() {
+    static const LogOutputSink sink = {logFileWrite, logFileFlush};
+    return sink;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+// Create (rotating any existing file) and map path; the caller attaches it
+inline bool openMappedLogFile(const char* path, const LogFileOptions& options) {
+    flushAsyncLog();
+
+    LogFileState& f = logFileState();
+    AcquireSRWLockExclusive(&f.lock);
+    waitForRotatedLogFile(f);
+    closeLogFileHandle(f);
+    f.options = options;
+    snprintf(f.path, sizeof(f.path), "%s", path);
+
+    // A crash mid-rotation leaves the full file under the retiring name; it
+    // is older than the one at path, so it shifts in first
+    char retiring[MAX_PATH + 16];
+    retiringLogFilePath(f, retiring, sizeof(retiring));
+    if (GetFileAttributesA(retiring) != INVALID_FILE_ATTRIBUTES) shiftRotatedLogFiles(f, retiring);
+
+    bool opened = createLogFile(f);
+    DWORD error = GetLastError();
+    ReleaseSRWLockExclusive(&f.lock);
+
+    if (!opened) {
+        fprintf(stderr, "[rippled_debug] Cannot open log file %s (error %lu)\n", path, error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Send log output to a memory-mapped file at path (replacing the FILE*
+ * output until closeLogFile() or setLogOutput()). An existing file is
+ * rotated to path.1 first. Returns false if the file cannot be created or
+ * mapped; output is then unchanged.
+ */
+inline bool openLogFile(const char* path, const LogFileOptions& options = LogFileOptions()) {
+    if (!openMappedLogFile(path, options)) return false;
+
+    LogFileState& f = logFileState();
+    if (f.sinkId >= 0) setLogSinkLevel(f.sinkId, LogLevel::LVL_OFF);
+    config().sink = &logFileSink();
+    if (config().format == LogFormat::BINARY) beginBinaryStream();
+    return true;
+}
+
+/**
+ * Write the mapped file as an extra sink with its own level and format
+ * (RICH, TEXT or JSON), leaving the primary output alone. There is one
+ * mapped file per process: it is either the primary output or a sink.
+ * @return Sink ID (see setLogSinkLevel), or -1 on failure
+ */
+inline int addLogFileSink(const char* path, LogLevel minLevel, LogFormat format,
+                          const LogFileOptions& options = LogFileOptions()) {
+    LogFileState& f = logFileState();
+    if (config().sink == &logFileSink()) {
+        fprintf(stderr, "[rippled_debug] Log file is already the primary output\n");
+        return -1;
+    }
+    if (format == LogFormat::BINARY) {
+        fprintf(stderr, "[rippled_debug] BINARY is only supported on the primary output\n");
+        return -1;
+    }
+    if (!openMappedLogFile(path, options)) return -1;
+
+    if (f.sinkId >= 0) {
+        // Reopened: the registry keeps the slot, so reuse it
+        logSinks().sinks[f.sinkId].format = format;
+        setLogSinkLevel(f.sinkId, minLevel);
+    } else {
+        f.sinkId = addLogSink(minLevel, format, &logFileSink());
+    }
+    return f.sinkId;
+}
+
+// Finish the file (flushed and trimmed to size) and go back to the FILE* output
+inline void closeLogFile() {
+    flushAsyncLog();
+    if (config().sink == &logFileSink()) config().sink = nullptr;
+    if (logFileState().sinkId >= 0) setLogSinkLevel(logFileState().sinkId, LogLevel::LVL_OFF);
+
+    LogFileState& f = logFileState();
+    AcquireSRWLockExclusive(&f.lock);
+    waitForRotatedLogFile(f);
+    closeLogFileHandle(f);
+    ReleaseSRWLockExclusive(&f.lock);
+}
+
+// Push everything written so far to disk (crash handlers do this through
+// flushAsyncLog())
+inline void flushLogFile() {
+    logFileFlush(true);
+}
+
+inline uint64_t logFileRotationCount() {
+    return logFileState().rotations;
+}
+
+} // namespace rippled_debug
+
+// Convenience macros
+#define DEBUG_LOG_FILE(path) \
+    rippled_debug::openLogFile(path)
+
+#define DEBUG_LOG_FILE_CLOSE() \
+    rippled_debug::closeLogFile()
+
+#else // !_WIN32
+
+#define DEBUG_LOG_FILE(path) ((void)0)
+#define DEBUG_LOG_FILE_CLOSE() ((void)0)
+
+#endif // _WIN32
+
+#endif // RIPPLED_WINDOWS_DEBUG_LOG_FILE_H
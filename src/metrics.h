@@ -0,0 +1,785 @@
+/**
+ * @file metrics.h
+ * @brief Counters, gauges and histograms with a Prometheus pull endpoint
+ *
+ * Numeric metrics next to the log, without parsing it:
+ * - DEBUG_COUNTER(name, delta)     monotonically increasing total
+ * - DEBUG_GAUGE(name, value)       last value set (DEBUG_GAUGE_ADD for +/-)
+ * - DEBUG_HISTOGRAM(name, value)   distribution (p50/p90/p99/max)
+ * - every DEBUG_SECTION's duration, once enableSectionMetrics() has run
+ *   (the endpoint and periodic reports turn it on)
+ *
+ * Each macro expansion caches its metric ID in a constant-initialized site,
+ * like the logging macros. Counters and histograms are written to the
+ * calling thread's own cache-line-aligned shard (plain load + store, no
+ * locked instructions) and summed across threads on read; histograms use
+ * the section profiler's log-linear buckets. Gauges are one shared atomic,
+ * since only the last write matters.
+ *
+ * Reading:
+ * - startMetricsServer(port) serves GET /metrics on 127.0.0.1 in the
+ *   Prometheus text format (histograms as summaries with quantiles)
+ * - printMetrics() renders a table in the current log format, and
+ *   startMetricsReports(ms) prints it periodically
+ *
+ * Usage:
+ *   DEBUG_METRICS_SERVER(9464);
+ *   DEBUG_COUNTER("peer.messages_received", 1);
+ *   DEBUG_GAUGE("job_queue.depth", queue.size());
+ *   DEBUG_HISTOGRAM("ledger.tx_count", txCount);
+ */
+
+#ifndef RIPPLED_WINDOWS_DEBUG_METRICS_H
+#define RIPPLED_WINDOWS_DEBUG_METRICS_H
+
+#ifdef _WIN32
+
+#include "debug_log.h"
+#include "section_profiler.h"
+
+// <windows.h> already brings in Winsock 1.1 unless WIN32_LEAN_AND_MEAN is
+// set; the endpoint only needs calls both versions have
+#ifndef _WINSOCKAPI_
+#include <winsock2.h>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+
+namespace rippled_debug {
+
+// ============================================================================
+// Registry
+// ============================================================================
+
+constexpr int kMaxMetrics = 256;
+constexpr uint32_t kNoMetric = UINT32_MAX;
+
+enum class MetricKind : uint8_t {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+inline const char* metricKindName(MetricKind kind) {
+    switch (kind) {
+        case MetricKind::COUNTER: return "counter";
+        case MetricKind::GAUGE:   return "gauge";
+        default:                  return "summary";
+    }
+}
+
+// Section durations are histograms of nanoseconds in one family, labelled
+// by section name
+constexpr const char* kSectionMetricName = "rippled_section_duration_seconds";
+
+struct MetricInfo {
+    std::string name;               // Sanitized for Prometheus
+    std::string section;            // Section name label; empty for user metrics
+    MetricKind kind = MetricKind::COUNTER;
+    std::atomic<int64_t> gauge{0};
+};
+
+struct MetricShard;
+
+struct MetricRegistry {
+    SRWLOCK lock = SRWLOCK_INIT;
+    std::atomic<int> count{0};
+    MetricInfo metrics[kMaxMetrics];
+    std::atomic<MetricShard*> shards{nullptr};
+    std::atomic<bool> sectionObserverAdded{false};
+};
+
+inline MetricRegistry& metricRegistry() {
+    static MetricRegistry registry;
+    return registry;
+}
+
+// [a-zA-Z_:][a-zA-Z0-9_:]*; anything else becomes '_'
+inline std::string sanitizeMetricName(const char* name) {
+    std::string out;
+    for (const char* p = name; *p; p++) {
+        char c = *p;
+        bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' ||
+            (c >= '0' && c <= '9' && !out.empty());
+        out += valid ? c : '_';
+    }
+    if (out.empty()) out = "_";
+    return out;
+}
+
+// Slow path: find or add (name, section). kNoMetric when the registry is
+// full or the name is already used by a metric of another kind.
+inline uint32_t registerMetric(const char* name, const char* section, MetricKind kind) {
+    std::string sanitized = sanitizeMetricName(name);
+    MetricRegistry& reg = metricRegistry();
+
+    AcquireSRWLockExclusive(&reg.lock);
+    int n = reg.count.load(std::memory_order_relaxed);
+    uint32_t id = kNoMetric;
+    const char* conflict = nullptr;     // Kind the name is already used as
+    for (int i = 0; i < n; i++) {
+        MetricInfo& info = reg.metrics[i];
+        if (info.name != sanitized) continue;
+        if (info.kind != kind) {
+            conflict = metricKindName(info.kind);
+            break;
+        }
+        if (info.section == section) {
+            id = (uint32_t)i;
+            break;
+        }
+    }
+    if (id == kNoMetric && !conflict && n < kMaxMetrics) {
+        MetricInfo& info = reg.metrics[n];
+        info.name = sanitized;
+        info.section = section;
+        info.kind = kind;
+        id = (uint32_t)n;
+        reg.count.store(n + 1, std::memory_order_release);
+    }
+    ReleaseSRWLockExclusive(&reg.lock);
+
+    if (conflict) {
+        fprintf(stderr, "[rippled_debug] Metric %s already registered as a %s\n",
+            sanitized.c_str(), conflict);
+    } else if (id == kNoMetric) {
+        fprintf(stderr, "[rippled_debug] Too many metrics (max %d); %s is not recorded\n",
+            kMaxMetrics, sanitized.c_str());
+    }
+    return id;
+}
+
+// One static instance per metric macro expansion. slot is the metric ID + 1
+// (0 = not looked up yet).
+struct MetricSite {
+    MetricKind kind;
+    const char* name;
+    std::atomic<uint32_t> slot{0};
+
+    constexpr MetricSite(MetricKind k, const char* n) : kind(k), name(n) {}
+
+    uint32_t id() {
+        uint32_t s = slot.load(std::memory_order_relaxed);
+        if (s == 0) {
+            uint32_t id = registerMetric(name, "", kind);
+            s = (id == kNoMetric) ? kNoMetric : id + 1;
+            slot.store(s, std::memory_order_relaxed);
+        }
+        return (s == kNoMetric) ? kNoMetric : s - 1;
+    }
+};
+
+// ============================================================================
+// Per-thread shards
+// ============================================================================
+//
+// Only the owning thread writes its shard (addOwned, as in the profiler), so
+// recording takes no lock and shares no cache line with other threads.
+// Histograms are allocated on first use. Shards are never freed, so reads
+// include threads that have exited.
+
+struct MetricHistogram {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> min{UINT64_MAX};
+    std::atomic<uint64_t> max{0};
+    std::atomic<uint32_t> buckets[kProfileBucketCount] = {};
+};
+
+// Section -> metric ID cache (sites by pointer, bare SectionTimers by
+// file/line), so section exits do not take the registry lock
+constexpr int kSectionMetricSlots = 128;
+
+struct SectionMetricSlot {
+    const void* key;
+    int line;
+    uint32_t id;
+};
+
+struct alignas(64) MetricShard {
+    std::atomic<uint64_t> counters[kMaxMetrics] = {};
+    std::atomic<MetricHistogram*> histograms[kMaxMetrics] = {};
+    SectionMetricSlot sections[kSectionMetricSlots] = {};
+    MetricShard* next = nullptr;
+};
+
+inline MetricShard& metricShard() {
+    thread_local MetricShard* shard = nullptr;
+    if (!shard) {
+        shard = new MetricShard;
+        MetricRegistry& reg = metricRegistry();
+        MetricShard* head = reg.shards.load(std::memory_order_relaxed);
+        do {
+            shard->next = head;
+        } while (!reg.shards.compare_exchange_weak(head, shard,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+    return *shard;
+}
+
+inline void recordMetricValue(uint32_t id, uint64_t value) {
+    MetricShard& shard = metricShard();
+    MetricHistogram* h = shard.histograms[id].load(std::memory_order_relaxed);
+    if (!h) {
+        h = new MetricHistogram;
+        shard.histograms[id].store(h, std::memory_order_release);
+    }
+    addOwned(h->count, 1);
+    addOwned(h->sum, value);
+    if (value < h->min.load(std::memory_order_relaxed)) h->min.store(value, std::memory_order_relaxed);
+    if (value > h->max.load(std::memory_order_relaxed)) h->max.store(value, std::memory_order_relaxed);
+    std::atomic<uint32_t>& bucket = h->buckets[profileBucketIndex(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Hot paths behind the macros
+inline void addMetricCounter(MetricSite& site, uint64_t delta) {
+    uint32_t id = site.id();
+    if (id == kNoMetric) return;
+    addOwned(metricShard().counters[id], delta);
+}
+
+inline void setMetricGauge(MetricSite& site, int64_t value) {
+    uint32_t id = site.id();
+    if (id == kNoMetric) return;
+    metricRegistry().metrics[id].gauge.store(value, std::memory_order_relaxed);
+}
+
+inline void addMetricGauge(MetricSite& site, int64_t delta) {
+    uint32_t id = site.id();
+    if (id == kNoMetric) return;
+    metricRegistry().metrics[id].gauge.fetch_add(delta, std::memory_order_relaxed);
+}
+
+inline void recordMetricHistogram(MetricSite& site, uint64_t value) {
+    uint32_t id = site.id();
+    if (id == kNoMetric) return;
+    recordMetricValue(id, value);
+}
+
+// ============================================================================
+// Section durations
+// ============================================================================
+
+inline uint32_t sectionMetricId(MetricShard& shard, const SectionEvent& ev) {
+    const void* key = ev.site ? (const void*)ev.site : (const void*)ev.file;
+    int line = ev.site ? 0 : ev.line;
+    size_t hash = (((uintptr_t)key >> 4) ^ ((size_t)line * 0x9E3779B1u)) % kSectionMetricSlots;
+
+    for (int probe = 0; probe < kSectionMetricSlots; probe++) {
+        SectionMetricSlot& slot = shard.sections[(hash + probe) % kSectionMetricSlots];
+        if (slot.key == key && slot.line == line) return slot.id;
+        if (!slot.key) {
+            uint32_t id = registerMetric(kSectionMetricName, ev.name ? ev.name : "", MetricKind::HISTOGRAM);
+            slot.key = key;
+            slot.line = line;
+            slot.id = id;
+            return id;
+        }
+    }
+    // Cache full: more distinct sections on this thread than slots
+    return registerMetric(kSectionMetricName, ev.name ? ev.name : "", MetricKind::HISTOGRAM);
+}
+
+inline void metricsOnSectionExit(const SectionEvent& ev) {
+    MetricShard& shard = metricShard();
+    uint32_t id = sectionMetricId(shard, ev);
+    if (id == kNoMetric) return;
+    recordMetricValue(id, (uint64_t)ticksToNs(ev.endTicks - ev.startTicks));
+}
+
+/**
+ * Record every section's duration as a histogram (one series per section
+ * name; a bare SectionTimer keeps the name it first ran with).
+ */
+inline void enableSectionMetrics() {
+    if (!metricRegistry().sectionObserverAdded.exchange(true)) {
+        addSectionObserver(SectionObserver{nullptr, metricsOnSectionExit});
+    }
+}
+
+// ============================================================================
+// Snapshots
+// ============================================================================
+
+struct MetricSnapshot {
+    const MetricInfo* info;
+    int64_t value = 0;              // Counter total or gauge
+    uint64_t count = 0;             // Histogram
+    uint64_t sum = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;
+
+    uint64_t percentile(double q) const {
+        if (count == 0) return 0;
+        uint64_t target = (uint64_t)(q * (double)count + 0.5);
+        if (target < 1) target = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < (int)buckets.size(); i++) {
+            seen += buckets[i];
+            if (seen >= target) {
+                uint64_t value = profileBucketValue(i);
+                if (value < min) value = min;
+                if (value > max) value = max;
+                return value;
+            }
+        }
+        return max;
+    }
+};
+
+/**
+ * Sum all shards, sorted by name then section so each Prometheus family is
+ * contiguous. Values written concurrently may be one update behind.
+ */
+inline std::vector<MetricSnapshot> collectMetrics() {
+    MetricRegistry& reg = metricRegistry();
+    int n = reg.count.load(std::memory_order_acquire);
+
+    std::vector<MetricSnapshot> snapshots((size_t)n);
+    for (int i = 0; i < n; i++) {
+        snapshots[i].info = &reg.metrics[i];
+        if (reg.metrics[i].kind == MetricKind::GAUGE) {
+            snapshots[i].value = reg.metrics[i].gauge.load(std::memory_order_relaxed);
+        }
+    }
+
+    for (MetricShard* shard = reg.shards.load(std::memory_order_acquire); shard; shard = shard->next) {
+        for (int i = 0; i < n; i++) {
+            MetricSnapshot& s = snapshots[i];
+            switch (s.info->kind) {
+                case MetricKind::COUNTER:
+                    s.value += (int64_t)shard->counters[i].load(std::memory_order_relaxed);
+                    break;
+                case MetricKind::HISTOGRAM: {
+                    const MetricHistogram* h = shard->histograms[i].load(std::memory_order_acquire);
+                    if (!h) break;
+                    s.count += h->count.load(std::memory_order_relaxed);
+                    s.sum += h->sum.load(std::memory_order_relaxed);
+                    uint64_t mn = h->min.load(std::memory_order_relaxed);
+                    uint64_t mx = h->max.load(std::memory_order_relaxed);
+                    if (mn < s.min) s.min = mn;
+                    if (mx > s.max) s.max = mx;
+                    if (s.buckets.empty()) s.buckets.assign(kProfileBucketCount, 0);
+                    for (int b = 0; b < kProfileBucketCount; b++) {
+                        s.buckets[b] += h->buckets[b].load(std::memory_order_relaxed);
+                    }
+                    break;
+                }
+                case MetricKind::GAUGE:
+                    break;
+            }
+        }
+    }
+
+    std::sort(snapshots.begin(), snapshots.end(),
+        [](const MetricSnapshot& a, const MetricSnapshot& b) {
+            int c = a.info->name.compare(b.info->name);
+            return c != 0 ? c < 0 : a.info->section < b.info->section;
+        });
+    return snapshots;
+}
+
+// ============================================================================
+// Prometheus text format
+// ============================================================================
+
+inline void appendPrometheusLabel(std::string& out, const std::string& value) {
+    for (char c : value) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+}
+
+// name{section="...",quantile="..."} with whichever labels apply
+inline void appendPrometheusSeries(std::string& out, const MetricSnapshot& s, const char* suffix,
+                                   const char* quantile) {
+    out += s.info->name;
+    out += suffix;
+    if (!s.info->section.empty() || quantile) {
+        out += '{';
+        if (!s.info->section.empty()) {
+            out += "section=\"";
+            appendPrometheusLabel(out, s.info->section);
+            out += quantile ? "\"," : "\"";
+        }
+        if (quantile) {
+            out += "quantile=\"";
+            out += quantile;
+            out += '"';
+        }
+        out += '}';
+    }
+    out += ' ';
+}
+
+/**
+ * Render all metrics in the Prometheus text exposition format (0.0.4).
+ * Counters get a _total suffix; histograms are exported as summaries
+ * (section durations in seconds, user histograms in their own unit).
+ */
+inline std::string formatPrometheusMetrics() {
+    std::vector<MetricSnapshot> snapshots = collectMetrics();
+    std::string out;
+    char number[64];
+
+    const std::string* family = nullptr;
+    for (const MetricSnapshot& s : snapshots) {
+        const MetricInfo& info = *s.info;
+        bool counter = info.kind == MetricKind::COUNTER;
+        bool hasTotal = info.name.size() > 6 &&
+            info.name.compare(info.name.size() - 6, 6, "_total") == 0;
+        const char* suffix = (counter && !hasTotal) ? "_total" : "";
+
+        if (!family || *family != info.name) {
+            out += "# TYPE ";
+            out += info.name;
+            out += suffix;
+            out += ' ';
+            out += metricKindName(info.kind);
+            out += '\n';
+            family = &info.name;
+        }
+
+        if (info.kind != MetricKind::HISTOGRAM) {
+            appendPrometheusSeries(out, s, suffix, nullptr);
+            snprintf(number, sizeof(number), "%lld\n", (long long)s.value);
+            out += number;
+            continue;
+        }
+
+        // Section durations are recorded in ns and exported in seconds
+        double scale = info.section.empty() ? 1.0 : 1e-9;
+        static const struct { const char* label; double q; } quantiles[] = {
+            {"0.5", 0.50}, {"0.9", 0.90}, {"0.99", 0.99}, {"1", 1.0}
+        };
+        for (const auto& q : quantiles) {
+            appendPrometheusSeries(out, s, "", q.label);
+            uint64_t value = (q.q >= 1.0) ? s.max : s.percentile(q.q);
+            snprintf(number, sizeof(number), "%.9g\n", (double)value * scale);
+            out += number;
+        }
+        appendPrometheusSeries(out, s, "_sum", nullptr);
+        snprintf(number, sizeof(number), "%.9g\n", (double)s.sum * scale);
+        out += number;
+        appendPrometheusSeries(out, s, "_count", nullptr);
+        snprintf(number, sizeof(number), "%llu\n", (unsigned long long)s.count);
+        out += number;
+    }
+    return out;
+}
+
+// ============================================================================
+// Endpoint
+// ============================================================================
+//
+// Minimal HTTP/1.1 on 127.0.0.1, one request per connection, served on its
+// own thread. Anything but GET /metrics (or /) gets a 404.
+
+struct MetricsServerState {
+    SOCKET listenSocket = INVALID_SOCKET;
+    HANDLE serverThread = nullptr;
+    uint16_t port = 0;
+
+    // Periodic printMetrics()
+    DWORD reportIntervalMs = 0;
+    HANDLE reportStopEvent = nullptr;
+    HANDLE reportThread = nullptr;
+};
+
+inline MetricsServerState& metricsServerState() {
+    static MetricsServerState state;
+    return state;
+}
+
+inline bool sendAll(SOCKET socket, const char* data, size_t len) {
+    while (len > 0) {
+        int sent = send(socket, data, (int)(len < 65536 ? len : 65536), 0);
+        if (sent <= 0) return false;
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return true;
+}
+
+inline void serveMetricsRequest(SOCKET client) {
+    DWORD timeoutMs = 2000;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutMs, sizeof(timeoutMs));
+
+    // Only the request line matters; read until the end of the headers
+    char request[2048];
+    int length = 0;
+    while (length < (int)sizeof(request) - 1) {
+        int n = recv(client, request + length, (int)sizeof(request) - 1 - length, 0);
+        if (n <= 0) break;
+        length += n;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n")) break;
+    }
+    request[length] = '\0';
+
+    bool found = strncmp(request, "GET /metrics", 12) == 0 || strncmp(request, "GET / ", 6) == 0;
+    std::string body = found ? formatPrometheusMetrics() : std::string("not found\n");
+
+    char header[192];
+    int headerLen = snprintf(header, sizeof(header),
+        "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+        found ? "200 OK" : "404 Not Found", body.size());
+    if (sendAll(client, header, (size_t)headerLen)) sendAll(client, body.data(), body.size());
+}
+
+inline DWORD WINAPI metricsServerMain(LPVOID) {
+    MetricsServerState& state = metricsServerState();
+    for (;;) {
+        SOCKET client = accept(state.listenSocket, nullptr, nullptr);
+        if (client == INVALID_SOCKET) break;    // Closed by stopMetricsServer()
+        serveMetricsRequest(client);
+        closesocket(client);
+    }
+    return 0;
+}
+
+inline void stopMetricsServer() {
+    MetricsServerState& state = metricsServerState();
+    if (!state.serverThread) return;
+
+    closesocket(state.listenSocket);
+    state.listenSocket = INVALID_SOCKET;
+    WaitForSingleObject(state.serverThread, INFINITE);
+    CloseHandle(state.serverThread);
+    state.serverThread = nullptr;
+}
+
+/**
+ * Serve http://127.0.0.1:port/metrics for Prometheus (or curl). Also turns
+ * on section metrics. Returns false if the port cannot be bound.
+ */
+inline bool startMetricsServer(uint16_t port = 9464) {
+    MetricsServerState& state = metricsServerState();
+    stopMetricsServer();
+    enableSectionMetrics();
+
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        fprintf(stderr, "[rippled_debug] WSAStartup failed for metrics endpoint\n");
+        return false;
+    }
+
+    SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        fprintf(stderr, "[rippled_debug] Cannot create metrics socket (error %d)\n", WSAGetLastError());
+        return false;
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenSocket, (const sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listenSocket, 8) != 0) {
+        fprintf(stderr, "[rippled_debug] Cannot listen on 127.0.0.1:%u for metrics (error %d)\n",
+            (unsigned)port, WSAGetLastError());
+        closesocket(listenSocket);
+        return false;
+    }
+
+    state.listenSocket = listenSocket;
+    state.port = port;
+    state.serverThread = CreateThread(nullptr, 0, metricsServerMain, nullptr, 0, nullptr);
+    if (!state.serverThread) {
+        fprintf(stderr, "[rippled_debug] Failed to start metrics thread (error %lu)\n",
+            GetLastError());
+        closesocket(listenSocket);
+        state.listenSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    static std::atomic<bool> atexitRegistered{false};
+    if (!atexitRegistered.exchange(true)) atexit(stopMetricsServer);
+    return true;
+}
+
+// ============================================================================
+// Table report
+// ============================================================================
+
+inline void formatMetricValue(const MetricSnapshot& s, uint64_t value, char* buffer, size_t size) {
+    if (s.info->section.empty()) snprintf(buffer, size, "%llu", (unsigned long long)value);
+    else formatProfileDuration(value, buffer, size);
+}
+
+// Print every metric as a table (or JSON lines) in the current log format
+inline void printMetrics() {
+    if (!config().enabled) return;
+
+    enableAnsiSupport();
+
+    std::vector<MetricSnapshot> snapshots = collectMetrics();
+    bool json = config().format == LogFormat::JSON;
+    bool rich = config().format == LogFormat::RICH && config().useColors;
+
+    if (!json) {
+        char subtitle[64];
+        snprintf(subtitle, sizeof(subtitle), "%zu metrics", snapshots.size());
+        printBanner("Metrics", subtitle);
+
+        LineBuffer out;
+        out.appendf("%s%-44s %-8s %12s %9s %9s %9s %9s%s\n", rich ? colors::BOLD : "",
+            "Metric", "Type", "Value", "p50", "p90", "p99", "Max", rich ? colors::RESET : "");
+        out.appendf("%s", rich ? colors::BOX_COLOR : "");
+        out.repeat(rich ? box::H : "-", 105);
+        out.appendf("%s\n", rich ? colors::RESET : "");
+        emitText(out);
+    }
+
+    for (const MetricSnapshot& s : snapshots) {
+        std::string name = s.info->section.empty() ? s.info->name : "section " + s.info->section;
+
+        LineBuffer out;
+        if (json) {
+            out.appendf("{\"metric\":\"%s\",\"type\":\"%s\"", escapeJson(s.info->name.c_str()).c_str(),
+                metricKindName(s.info->kind));
+            if (!s.info->section.empty()) {
+                out.appendf(",\"section\":\"%s\"", escapeJson(s.info->section.c_str()).c_str());
+            }
+            if (s.info->kind == MetricKind::HISTOGRAM) {
+                out.appendf(",\"count\":%llu,\"sum\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,"
+                    "\"max\":%llu}\n", (unsigned long long)s.count, (unsigned long long)s.sum,
+                    (unsigned long long)s.percentile(0.50), (unsigned long long)s.percentile(0.90),
+                    (unsigned long long)s.percentile(0.99), (unsigned long long)s.max);
+            } else {
+                out.appendf(",\"value\":%lld}\n", (long long)s.value);
+            }
+        } else {
+            out.appendf("%s%-44.44s%s %-8s", rich ? colors::SECTION : "", name.c_str(),
+                rich ? colors::RESET : "", s.info->kind == MetricKind::HISTOGRAM ? "hist"
+                : metricKindName(s.info->kind));
+            if (s.info->kind == MetricKind::HISTOGRAM) {
+                char p50[16], p90[16], p99[16], maxStr[16];
+                formatMetricValue(s, s.percentile(0.50), p50, sizeof(p50));
+                formatMetricValue(s, s.percentile(0.90), p90, sizeof(p90));
+                formatMetricValue(s, s.percentile(0.99), p99, sizeof(p99));
+                formatMetricValue(s, s.max, maxStr, sizeof(maxStr));
+                out.appendf(" %s%12llu%s %9s %9s %9s %9s\n", rich ? colors::NUMBER : "",
+                    (unsigned long long)s.count, rich ? colors::RESET : "", p50, p90, p99, maxStr);
+            } else {
+                out.appendf(" %s%12lld%s\n", rich ? colors::NUMBER : "", (long long)s.value,
+                    rich ? colors::RESET : "");
+            }
+        }
+        emitText(out);
+    }
+
+    if (!json) {
+        LineBuffer out;
+        out.append("\n");
+        emitText(out);
+    }
+}
+
+inline DWORD WINAPI metricsReportMain(LPVOID) {
+    MetricsServerState& state = metricsServerState();
+    while (WaitForSingleObject(state.reportStopEvent, state.reportIntervalMs) == WAIT_TIMEOUT) {
+        printMetrics();
+    }
+    return 0;
+}
+
+inline void stopMetricsReports() {
+    MetricsServerState& state = metricsServerState();
+    if (!state.reportThread) return;
+
+    SetEvent(state.reportStopEvent);
+    WaitForSingleObject(state.reportThread, INFINITE);
+    CloseHandle(state.reportThread);
+    CloseHandle(state.reportStopEvent);
+    state.reportThread = nullptr;
+    state.reportStopEvent = nullptr;
+}
+
+/**
+ * printMetrics() every intervalMs on a background thread (also turns on
+ * section metrics).
+ */
+inline bool startMetricsReports(DWORD intervalMs = 60000) {
+    MetricsServerState& state = metricsServerState();
+    stopMetricsReports();
+    enableSectionMetrics();
+
+    state.reportIntervalMs = intervalMs ? intervalMs : 1;
+    state.reportStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!state.reportStopEvent) {
+        fprintf(stderr, "[rippled_debug] CreateEvent failed for metrics reports (error %lu)\n",
+            GetLastError());
+        return false;
+    }
+    state.reportThread = CreateThread(nullptr, 0, metricsReportMain, nullptr, 0, nullptr);
+    if (!state.reportThread) {
+        fprintf(stderr, "[rippled_debug] Failed to start metrics report thread (error %lu)\n",
+            GetLastError());
+        CloseHandle(state.reportStopEvent);
+        state.reportStopEvent = nullptr;
+        return false;
+    }
+
+    static std::atomic<bool> atexitRegistered{false};
+    if (!atexitRegistered.exchange(true)) atexit(stopMetricsReports);
+    return true;
+}
+
+} // namespace rippled_debug
+
+// ============================================================================
+// Convenience Macros
+// ============================================================================
+
+#define RIPPLED_DEBUG_METRIC(kind, name, call, value) \
+    do { \
+        static rippled_debug::MetricSite _rd_metric_site(rippled_debug::MetricKind::kind, name); \
+        rippled_debug::call(_rd_metric_site, value); \
+    } while (0)
+
+#define DEBUG_COUNTER(name, delta) \
+    RIPPLED_DEBUG_METRIC(COUNTER, name, addMetricCounter, (uint64_t)(delta))
+
+#define DEBUG_GAUGE(name, value) \
+    RIPPLED_DEBUG_METRIC(GAUGE, name, setMetricGauge, (int64_t)(value))
+
+#define DEBUG_GAUGE_ADD(name, delta) \
+    RIPPLED_DEBUG_METRIC(GAUGE, name, addMetricGauge, (int64_t)(delta))
+
+#define DEBUG_HISTOGRAM(name, value) \
+    RIPPLED_DEBUG_METRIC(HISTOGRAM, name, recordMetricHistogram, (uint64_t)(value))
+
+#define DEBUG_METRICS_SERVER(port) \
+    rippled_debug::startMetricsServer(port)
+
+#define DEBUG_METRICS_PRINT() \
+    rippled_debug::printMetrics()
+
+#define DEBUG_METRICS_REPORT(intervalMs) \
+    rippled_debug::startMetricsReports(intervalMs)
+
+#else // !_WIN32
+
+#define DEBUG_COUNTER(name, delta) ((void)0)
+#define DEBUG_GAUGE(name, value) ((void)0)
+#define DEBUG_GAUGE_ADD(name, delta) ((void)0)
+#define DEBUG_HISTOGRAM(name, value) ((void)0)
+#define DEBUG_METRICS_SERVER(port) ((void)0)
+#define DEBUG_METRICS_PRINT() ((void)0)
+#define DEBUG_METRICS_REPORT(intervalMs) ((void)0)
+
+#endif // _WIN32
+
+#endif // RIPPLED_WINDOWS_DEBUG_METRICS_H
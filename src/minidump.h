@@ -3,6 +3,8 @@
  * @brief Automatic minidump generation for crash analysis
  *
  * Captures full crash dumps that can be analyzed with WinDbg or Visual Studio.
+ * With the flight recorder on (debug_log.h) dumps also carry the last log
+ * records of every thread; tools/log-decoder reads them from the .dmp.
  *
  * Usage:
  *   #include "minidump.h"
@@ -10,6 +12,12 @@
  *       installMinidumpHandler();
  *       // or with custom path:
  *       installMinidumpHandler("C:\\CrashDumps");
+ *       // or written by an out-of-process helper:
+ *       installMinidumpHandler(nullptr, "crash_helper.exe");
+ *
+ *       // Live dumps from a process snapshot - the node keeps running:
+ *       installLiveDumpTrigger();   // trigger_dump <pid> from outside
+ *       writeLiveMinidump();        // or on demand in code
  *   }
  */
 
@@ -20,12 +28,25 @@
 
 #include <windows.h>
 #include <dbghelp.h>
+#include <compressapi.h>
+#include <processsnapshot.h>
 #include <shlobj.h>
+#include <algorithm>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <cwchar>
 #include <ctime>
 #include <string>
+#include <vector>
+
+#include "debug_log.h"
+
+// Crash-safe report writer for the exception filter's output
+#include "crash_handlers.h"
 
 #pragma comment(lib, "dbghelp.lib")
+#pragma comment(lib, "cabinet.lib")
 
 namespace rippled_debug {
 
@@ -35,8 +56,457 @@ inline std::wstring& dumpDirectory() {
     return dir;
 }
 
-// Generate dump filename with timestamp
-inline std::wstring generateDumpFilename() {
+inline std::wstring utf8ToWide(const char* str) {
+    int len = MultiByteToWideChar(CP_UTF8, 0, str, -1, NULL, 0);
+    if (len <= 0) return std::wstring();
+    std::wstring wide(len, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str, -1, &wide[0], len);
+    wide.resize(len - 1); // Remove null terminator
+    return wide;
+}
+
+// ============================================================================
+// Dump Policy
+// ============================================================================
+//
+// A full-memory dump of a large node is many GB and takes minutes to write;
+// most crashes only need the threads and what their stacks point at. The
+// tier picks how much is captured, and the retention budget keeps the dump
+// directory from filling the disk (oldest dumps are evicted first).
+
+/**
+ * How much of the process a dump captures.
+ */
+enum class DumpTier : DWORD {
+    SMALL,      // Threads, stacks, exception, module list
+    MEDIUM,     // + memory referenced from stacks, the executable's globals, handles
+    FULL        // Entire address space (default)
+};
+
+struct DumpPolicy {
+    DumpTier tier = DumpTier::FULL;
+    size_t maxDumps = 10;           // 0 = no count limit
+    uint64_t maxTotalBytes = 0;     // 0 = no size limit
+    bool compress = false;          // Stream into a .dmp.rdz (see decompressDumpFile)
+};
+
+inline DumpPolicy& dumpPolicy() {
+    static DumpPolicy policy;
+    return policy;
+}
+
+/**
+ * Configure dump contents and retention.
+ * Call before installMinidumpHandler() so a crash helper inherits it.
+ */
+inline void setDumpPolicy(DumpTier tier, size_t maxDumps = 10, uint64_t maxTotalMB = 0) {
+    DumpPolicy& policy = dumpPolicy();
+    policy.tier = tier;
+    policy.maxDumps = maxDumps;
+    policy.maxTotalBytes = maxTotalMB * 1024 * 1024;
+}
+
+inline bool prepareDumpCompression();
+
+/**
+ * Stream dumps through the Windows Compression API into .dmp.rdz files.
+ * Expand with tools/dump-decompress before opening in WinDbg.
+ */
+inline void setDumpCompression(bool enabled) {
+    dumpPolicy().compress = enabled && prepareDumpCompression();
+}
+
+inline const wchar_t* dumpTierName(DumpTier tier) {
+    switch (tier) {
+        case DumpTier::SMALL:  return L"small";
+        case DumpTier::MEDIUM: return L"medium";
+        case DumpTier::FULL:   return L"full";
+    }
+    return L"unknown";
+}
+
+inline MINIDUMP_TYPE dumpTypeForTier(DumpTier tier) {
+    const int small = MiniDumpNormal | MiniDumpWithThreadInfo | MiniDumpWithUnloadedModules;
+
+    switch (tier) {
+        case DumpTier::SMALL:
+            return static_cast<MINIDUMP_TYPE>(small);
+        case DumpTier::MEDIUM:
+            return static_cast<MINIDUMP_TYPE>(small |
+                MiniDumpWithIndirectlyReferencedMemory |
+                MiniDumpWithDataSegs |
+                MiniDumpWithHandleData |
+                MiniDumpWithFullMemoryInfo |
+                MiniDumpIgnoreInaccessibleMemory);
+        case DumpTier::FULL:
+            break;
+    }
+    return static_cast<MINIDUMP_TYPE>(
+        MiniDumpWithFullMemory |
+        MiniDumpWithFullMemoryInfo |
+        MiniDumpWithHandleData |
+        MiniDumpWithThreadInfo |
+        MiniDumpWithUnloadedModules);
+}
+
+inline bool isExecutablePath(const wchar_t* path) {
+    size_t len = path ? wcslen(path) : 0;
+    return len >= 4 && _wcsicmp(path + len - 4, L".exe") == 0;
+}
+
+// ============================================================================
+// Compressed Dumps
+// ============================================================================
+//
+// Full-memory dumps compress very well. MiniDumpWriteDump can route its
+// writes through IoWriteAllCallback, so the dump is streamed straight into a
+// compressed .dmp.rdz container and never hits the disk uncompressed.
+// Writes are mostly sequential; each contiguous run is cut into chunks and
+// compressed with the built-in Windows Compression API (XPRESS Huffman, no
+// extra dependency). The few out-of-order writes (header / directory
+// patches) become their own small chunks, and decompressDumpFile() replays
+// every chunk at its offset, so the result is byte-identical to a .dmp.
+// Buffers and the compressor are created up front, not during a crash.
+
+constexpr uint32_t kCompressedDumpMagic = 0x315A4452;  // "RDZ1"
+constexpr uint32_t kCompressedDumpVersion = 1;
+constexpr DWORD kCompressedDumpAlgorithm = COMPRESS_ALGORITHM_XPRESS_HUFF;
+constexpr size_t kCompressedDumpChunk = 4 * 1024 * 1024;
+constexpr uint32_t kChunkCompressed = 1;                // Otherwise stored raw
+
+struct CompressedDumpHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t algorithm;         // COMPRESS_ALGORITHM_*
+    uint32_t chunkSize;         // Largest rawSize in the file
+};
+
+struct CompressedDumpChunk {
+    uint64_t offset;            // Position in the uncompressed dump
+    uint32_t rawSize;
+    uint32_t storedSize;        // Bytes that follow this header
+    uint32_t flags;             // kChunkCompressed
+    uint32_t reserved;
+};
+
+static_assert(sizeof(CompressedDumpHeader) == 16, "CompressedDumpHeader layout");
+static_assert(sizeof(CompressedDumpChunk) == 24, "CompressedDumpChunk layout");
+
+struct DumpCompressor {
+    COMPRESSOR_HANDLE handle = nullptr;
+    BYTE* raw = nullptr;            // kCompressedDumpChunk bytes
+    BYTE* packed = nullptr;         // kCompressedDumpChunk bytes
+    volatile LONG busy = 0;         // One dump at a time
+
+    // Per-dump state
+    HANDLE file = INVALID_HANDLE_VALUE;
+    uint64_t chunkOffset = 0;
+    size_t fill = 0;
+    bool failed = false;
+    uint64_t rawBytes = 0;
+    uint64_t storedBytes = 0;
+};
+
+inline DumpCompressor& dumpCompressor() {
+    static DumpCompressor compressor;
+    return compressor;
+}
+
+/**
+ * Create the compressor and its buffers (idempotent).
+ * @return false if the Compression API is unavailable
+ */
+inline bool prepareDumpCompression() {
+    DumpCompressor& comp = dumpCompressor();
+    if (comp.handle) return true;
+
+    comp.raw = (BYTE*)VirtualAlloc(NULL, kCompressedDumpChunk * 2, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!comp.raw) return false;
+    comp.packed = comp.raw + kCompressedDumpChunk;
+
+    if (!CreateCompressor(kCompressedDumpAlgorithm | COMPRESS_RAW, NULL, &comp.handle)) {
+        fprintf(stderr, "[MINIDUMP] Compression unavailable. Error: %lu\n", GetLastError());
+        VirtualFree(comp.raw, 0, MEM_RELEASE);
+        comp.raw = comp.packed = nullptr;
+        comp.handle = nullptr;
+        return false;
+    }
+    return true;
+}
+
+inline bool writeAllToFile(HANDLE file, const void* data, size_t size) {
+    const BYTE* p = (const BYTE*)data;
+    while (size > 0) {
+        DWORD chunk = (DWORD)(size < 0x40000000 ? size : 0x40000000);
+        DWORD written = 0;
+        if (!WriteFile(file, p, chunk, &written, NULL) || written == 0) return false;
+        p += written;
+        size -= written;
+    }
+    return true;
+}
+
+inline void flushCompressedChunk(DumpCompressor& comp) {
+    if (comp.fill == 0 || comp.failed) return;
+
+    CompressedDumpChunk chunk;
+    chunk.offset = comp.chunkOffset;
+    chunk.rawSize = (uint32_t)comp.fill;
+    chunk.storedSize = (uint32_t)comp.fill;
+    chunk.flags = 0;
+    chunk.reserved = 0;
+    const BYTE* stored = comp.raw;
+
+    SIZE_T packedSize = 0;
+    if (Compress(comp.handle, comp.raw, comp.fill, comp.packed, kCompressedDumpChunk, &packedSize) &&
+        packedSize < comp.fill) {
+        chunk.storedSize = (uint32_t)packedSize;
+        chunk.flags = kChunkCompressed;
+        stored = comp.packed;
+    }
+
+    if (!writeAllToFile(comp.file, &chunk, sizeof(chunk)) ||
+        !writeAllToFile(comp.file, stored, chunk.storedSize)) {
+        comp.failed = true;
+    }
+    comp.rawBytes += chunk.rawSize;
+    comp.storedBytes += sizeof(chunk) + chunk.storedSize;
+    comp.fill = 0;
+}
+
+// IoWriteAllCallback target
+inline bool compressedDumpWrite(DumpCompressor& comp, uint64_t offset, const void* buffer, size_t size) {
+    const BYTE* data = (const BYTE*)buffer;
+    while (size > 0 && !comp.failed) {
+        if (comp.fill > 0 && offset != comp.chunkOffset + comp.fill) {
+            flushCompressedChunk(comp);
+        }
+        if (comp.fill == 0) {
+            comp.chunkOffset = offset;
+        }
+
+        size_t take = kCompressedDumpChunk - comp.fill;
+        if (take > size) take = size;
+        memcpy(comp.raw + comp.fill, data, take);
+        comp.fill += take;
+        offset += take;
+        data += take;
+        size -= take;
+
+        if (comp.fill == kCompressedDumpChunk) {
+            flushCompressedChunk(comp);
+        }
+    }
+    return !comp.failed;
+}
+
+inline bool beginCompressedDump(DumpCompressor& comp, HANDLE file) {
+    comp.file = file;
+    comp.chunkOffset = 0;
+    comp.fill = 0;
+    comp.failed = false;
+    comp.rawBytes = 0;
+    comp.storedBytes = sizeof(CompressedDumpHeader);
+
+    CompressedDumpHeader header;
+    header.magic = kCompressedDumpMagic;
+    header.version = kCompressedDumpVersion;
+    header.algorithm = kCompressedDumpAlgorithm;
+    header.chunkSize = (uint32_t)kCompressedDumpChunk;
+    return writeAllToFile(file, &header, sizeof(header));
+}
+
+inline bool finishCompressedDump(DumpCompressor& comp) {
+    flushCompressedChunk(comp);
+    comp.file = INVALID_HANDLE_VALUE;
+    return !comp.failed;
+}
+
+/**
+ * Expand a .dmp.rdz into a regular .dmp for WinDbg / Visual Studio.
+ * @return true on success
+ */
+inline bool decompressDumpFile(const wchar_t* inputPath, const wchar_t* outputPath) {
+    HANDLE in = CreateFileW(inputPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (in == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "[MINIDUMP] Cannot open %ls. Error: %lu\n", inputPath, GetLastError());
+        return false;
+    }
+
+    auto readExact = [in](void* buffer, DWORD size) {
+        DWORD got = 0;
+        return ReadFile(in, buffer, size, &got, NULL) && got == size;
+    };
+
+    CompressedDumpHeader header;
+    if (!readExact(&header, sizeof(header)) || header.magic != kCompressedDumpMagic ||
+        header.version != kCompressedDumpVersion || header.chunkSize == 0) {
+        fprintf(stderr, "[MINIDUMP] %ls is not a compressed dump\n", inputPath);
+        CloseHandle(in);
+        return false;
+    }
+
+    DECOMPRESSOR_HANDLE decompressor = nullptr;
+    if (!CreateDecompressor(header.algorithm | COMPRESS_RAW, NULL, &decompressor)) {
+        fprintf(stderr, "[MINIDUMP] Decompressor unavailable. Error: %lu\n", GetLastError());
+        CloseHandle(in);
+        return false;
+    }
+
+    HANDLE out = CreateFileW(outputPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (out == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "[MINIDUMP] Cannot create %ls. Error: %lu\n", outputPath, GetLastError());
+        CloseDecompressor(decompressor);
+        CloseHandle(in);
+        return false;
+    }
+
+    std::vector<BYTE> stored(header.chunkSize);
+    std::vector<BYTE> expanded(header.chunkSize);
+    bool ok = true;
+    uint64_t chunks = 0;
+
+    CompressedDumpChunk chunk;
+    while (ok && readExact(&chunk, sizeof(chunk))) {
+        if (chunk.rawSize > header.chunkSize || chunk.storedSize > header.chunkSize ||
+            !readExact(stored.data(), chunk.storedSize)) {
+            ok = false;
+            break;
+        }
+
+        const BYTE* data = stored.data();
+        if (chunk.flags & kChunkCompressed) {
+            SIZE_T size = 0;
+            if (!Decompress(decompressor, stored.data(), chunk.storedSize,
+                            expanded.data(), chunk.rawSize, &size) || size != chunk.rawSize) {
+                ok = false;
+                break;
+            }
+            data = expanded.data();
+        }
+
+        LARGE_INTEGER position;
+        position.QuadPart = (LONGLONG)chunk.offset;
+        ok = SetFilePointerEx(out, position, NULL, FILE_BEGIN) &&
+             writeAllToFile(out, data, chunk.rawSize);
+        chunks++;
+    }
+
+    CloseHandle(out);
+    CloseDecompressor(decompressor);
+    CloseHandle(in);
+
+    if (!ok) {
+        fprintf(stderr, "[MINIDUMP] %ls is truncated or corrupt (chunk %llu)\n",
+                inputPath, (unsigned long long)chunks);
+        DeleteFileW(outputPath);
+    }
+    return ok;
+}
+
+struct DumpCallbackContext {
+    DumpTier tier;
+    DumpCompressor* compressor;     // null = dbghelp writes the file itself
+    bool snapshot;                  // Process handle is an HPSS snapshot
+};
+
+/**
+ * MiniDumpWriteDump callback: I/O redirection for compressed dumps, snapshot
+ * sources for live dumps, plus the MEDIUM-tier filter - data segments of
+ * system DLLs are rarely useful and dominate the size, so only the
+ * executable's globals are kept.
+ */
+inline BOOL CALLBACK dumpCallback(PVOID param, PMINIDUMP_CALLBACK_INPUT input, PMINIDUMP_CALLBACK_OUTPUT output) {
+    const DumpCallbackContext* context = (const DumpCallbackContext*)param;
+    if (!context || !input || !output) return FALSE;
+
+    switch (input->CallbackType) {
+        case IoStartCallback:
+            // S_FALSE: send every write to IoWriteAllCallback
+            if (!context->compressor) return FALSE;
+            output->Status = S_FALSE;
+            return TRUE;
+        case IoWriteAllCallback:
+            if (!context->compressor) return FALSE;
+            output->Status = compressedDumpWrite(*context->compressor, input->Io.Offset,
+                input->Io.Buffer, input->Io.BufferBytes) ? S_OK : E_FAIL;
+            return TRUE;
+        case IoFinishCallback:
+            if (!context->compressor) return FALSE;
+            output->Status = S_OK;
+            return TRUE;
+        case IsProcessSnapshotCallback:
+            // S_FALSE: the "process" handle is a PssCaptureSnapshot clone
+            if (!context->snapshot) return FALSE;
+            output->Status = S_FALSE;
+            return TRUE;
+        case IncludeModuleCallback:
+        case IncludeThreadCallback:
+        case ThreadCallback:
+        case ThreadExCallback:
+            return TRUE;
+        case ModuleCallback:
+            if (context->tier == DumpTier::MEDIUM && !isExecutablePath(input->Module.FullPath)) {
+                output->ModuleWriteFlags &= ~ModuleWriteDataSeg;
+            }
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+// ============================================================================
+// Process Snapshots
+// ============================================================================
+//
+// MiniDumpWriteDump suspends every thread of the target for the whole write,
+// which for a full-memory dump of a validator in consensus is far too long.
+// PssCaptureSnapshot instead clones the address space copy-on-write and
+// captures thread contexts; the target pauses only for the clone and the dump
+// is then written from the snapshot while the node keeps running.
+
+constexpr PSS_CAPTURE_FLAGS kLiveDumpCaptureFlags =
+    PSS_CAPTURE_VA_CLONE |
+    PSS_CAPTURE_HANDLES |
+    PSS_CAPTURE_HANDLE_NAME_INFORMATION |
+    PSS_CAPTURE_HANDLE_BASIC_INFORMATION |
+    PSS_CAPTURE_HANDLE_TYPE_SPECIFIC_INFORMATION |
+    PSS_CAPTURE_HANDLE_TRACE |
+    PSS_CAPTURE_THREADS |
+    PSS_CAPTURE_THREAD_CONTEXT |
+    PSS_CAPTURE_THREAD_CONTEXT_EXTENDED |
+    PSS_CREATE_BREAKAWAY |
+    PSS_CREATE_BREAKAWAY_OPTIONAL |
+    PSS_CREATE_USE_VM_ALLOCATIONS |
+    PSS_CREATE_RELEASE_SECTION;
+
+/**
+ * Snapshot a process for a live dump (Windows 8.1+).
+ * The process handle needs PROCESS_CREATE_PROCESS and PROCESS_VM_OPERATION.
+ * @return ERROR_SUCCESS, or the PssCaptureSnapshot error
+ */
+inline DWORD captureDumpSnapshot(HANDLE process, HPSS& snapshot) {
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+
+    snapshot = NULL;
+    DWORD status = PssCaptureSnapshot(process, kLiveDumpCaptureFlags, CONTEXT_ALL, &snapshot);
+
+    QueryPerformanceCounter(&end);
+    if (status != ERROR_SUCCESS) {
+        fprintf(stderr, "[MINIDUMP] Process snapshot failed. Error: %lu\n", status);
+        snapshot = NULL;
+        return status;
+    }
+    fprintf(stderr, "[MINIDUMP] Process snapshot captured in %.1f ms\n",
+            (double)(end.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart);
+    return ERROR_SUCCESS;
+}
+
+// Generate dump filename: timestamp + PID + per-process sequence, never reused
+inline std::wstring generateDumpFilename(DWORD pid = GetCurrentProcessId()) {
+    static volatile LONG sequence = 0;
     wchar_t filename[MAX_PATH];
 
     // Get current time
@@ -44,80 +514,548 @@ inline std::wstring generateDumpFilename() {
     struct tm timeinfo;
     localtime_s(&timeinfo, &now);
 
-    // Format: rippled_YYYYMMDD_HHMMSS.dmp
+    // Format: rippled_YYYYMMDD_HHMMSS_<pid>_<seq>.dmp
     swprintf_s(filename, MAX_PATH,
-        L"%s\\rippled_%04d%02d%02d_%02d%02d%02d.dmp",
+        L"%s\\rippled_%04d%02d%02d_%02d%02d%02d_%lu_%ld.dmp",
         dumpDirectory().c_str(),
         timeinfo.tm_year + 1900,
         timeinfo.tm_mon + 1,
         timeinfo.tm_mday,
         timeinfo.tm_hour,
         timeinfo.tm_min,
-        timeinfo.tm_sec);
+        timeinfo.tm_sec,
+        (unsigned long)pid,
+        (long)InterlockedIncrement(&sequence));
 
     return std::wstring(filename);
 }
 
-// Exception filter that writes minidump
-inline LONG WINAPI minidumpExceptionFilter(EXCEPTION_POINTERS* exceptionInfo) {
-    fprintf(stderr, "\n[MINIDUMP] Unhandled exception caught!\n");
-    fprintf(stderr, "[MINIDUMP] Exception code: 0x%08X\n", exceptionInfo->ExceptionRecord->ExceptionCode);
+// Serialize our flight recorder (debug_log.h) into its reserved buffer as a
+// dump user stream; decode it with tools/log-decoder
+inline bool flightRecorderStream(MINIDUMP_USER_STREAM& stream) {
+    FlightRecorderState& fr = flightRecorder();
+    size_t size = serializeFlightRecorder(fr.stream, kFlightStreamBytes);
+    if (size == 0) return false;
 
-    // Generate filename
-    std::wstring dumpPath = generateDumpFilename();
-
-    fprintf(stderr, "[MINIDUMP] Writing dump to: %ls\n", dumpPath.c_str());
+    stream.Type = binlog::kFlightRecorderStreamType;
+    stream.BufferSize = (ULONG)size;
+    stream.Buffer = fr.stream;
+    return true;
+}
 
-    // Create dump file
-    HANDLE hFile = CreateFileW(
-        dumpPath.c_str(),
-        GENERIC_WRITE,
-        0,
-        NULL,
-        CREATE_ALWAYS,
-        FILE_ATTRIBUTE_NORMAL,
-        NULL);
+/**
+ * Create a new dump file and write the given tier into it.
+ * CREATE_NEW means an existing dump is never overwritten. With compression
+ * enabled (and prepared) the file is a .dmp.rdz container.
+ * @param path        Receives the file name used
+ * @param error       Receives GetLastError() on failure
+ * @param snapshot    Dump a PssCaptureSnapshot clone instead of suspending the
+ *                    process; there is no fallback to a suspending dump
+ * @param userStreams Extra streams; by default a dump of this process gets
+ *                    its flight recorder
+ */
+inline bool writeDumpFile(HANDLE process, DWORD pid, DumpTier tier,
+                          MINIDUMP_EXCEPTION_INFORMATION* exInfo,
+                          std::wstring& path, DWORD& error, bool snapshot = false,
+                          MINIDUMP_USER_STREAM_INFORMATION* userStreams = NULL) {
+    DumpCompressor& comp = dumpCompressor();
+    bool compress = dumpPolicy().compress && comp.handle &&
+                    InterlockedCompareExchange(&comp.busy, 1, 0) == 0;
 
+    HANDLE hFile = INVALID_HANDLE_VALUE;
+    for (int attempt = 0; attempt < 8 && hFile == INVALID_HANDLE_VALUE; attempt++) {
+        path = generateDumpFilename(pid);
+        if (compress) path += L".rdz";
+        hFile = CreateFileW(
+            path.c_str(),
+            GENERIC_WRITE,
+            0,
+            NULL,
+            CREATE_NEW,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL);
+        error = GetLastError();
+        if (hFile == INVALID_HANDLE_VALUE && error != ERROR_FILE_EXISTS) break;
+    }
     if (hFile == INVALID_HANDLE_VALUE) {
-        fprintf(stderr, "[MINIDUMP] Failed to create dump file. Error: %lu\n", GetLastError());
-        return EXCEPTION_CONTINUE_SEARCH;
+        if (compress) InterlockedExchange(&comp.busy, 0);
+        return false;
     }
 
-    // Write minidump
-    MINIDUMP_EXCEPTION_INFORMATION exInfo;
-    exInfo.ThreadId = GetCurrentThreadId();
-    exInfo.ExceptionPointers = exceptionInfo;
-    exInfo.ClientPointers = FALSE;
+    DumpCallbackContext context;
+    context.tier = tier;
+    context.compressor = compress ? &comp : nullptr;
+    context.snapshot = snapshot;
 
-    // Use MiniDumpWithFullMemory for most detailed dumps
-    // Can use MiniDumpNormal for smaller dumps
-    MINIDUMP_TYPE dumpType = static_cast<MINIDUMP_TYPE>(
-        MiniDumpWithFullMemory |
-        MiniDumpWithFullMemoryInfo |
-        MiniDumpWithHandleData |
-        MiniDumpWithThreadInfo |
-        MiniDumpWithUnloadedModules);
+    MINIDUMP_CALLBACK_INFORMATION callback;
+    callback.CallbackRoutine = dumpCallback;
+    callback.CallbackParam = &context;
 
-    BOOL success = MiniDumpWriteDump(
-        GetCurrentProcess(),
-        GetCurrentProcessId(),
+    MINIDUMP_USER_STREAM flightStream;
+    MINIDUMP_USER_STREAM_INFORMATION ownStreams;
+    if (!userStreams && pid == GetCurrentProcessId() && flightRecorderStream(flightStream)) {
+        ownStreams.UserStreamCount = 1;
+        ownStreams.UserStreamArray = &flightStream;
+        userStreams = &ownStreams;
+    }
+
+    // Captured after the file exists so the snapshot is as fresh as possible
+    HPSS snapshotHandle = NULL;
+    DWORD snapshotError = snapshot ? captureDumpSnapshot(process, snapshotHandle) : ERROR_SUCCESS;
+
+    BOOL success = snapshotError == ERROR_SUCCESS &&
+        (!compress || beginCompressedDump(comp, hFile)) && MiniDumpWriteDump(
+        snapshotHandle ? (HANDLE)snapshotHandle : process,
+        pid,
         hFile,
-        dumpType,
-        &exInfo,
-        NULL,
-        NULL);
+        dumpTypeForTier(tier),
+        exInfo,
+        userStreams,
+        (compress || snapshot || tier == DumpTier::MEDIUM) ? &callback : NULL);
+    error = success ? 0 : (snapshotError != ERROR_SUCCESS ? snapshotError : GetLastError());
+
+    if (snapshotHandle) {
+        PssFreeSnapshot(GetCurrentProcess(), snapshotHandle);
+    }
+
+    if (compress) {
+        if (!finishCompressedDump(comp) && success) {
+            success = FALSE;
+            error = ERROR_WRITE_FAULT;
+        }
+        if (success) {
+            fprintf(stderr, "[MINIDUMP] Compressed %llu MB -> %llu MB\n",
+                    (unsigned long long)(comp.rawBytes / 1024 / 1024),
+                    (unsigned long long)(comp.storedBytes / 1024 / 1024));
+        }
+        InterlockedExchange(&comp.busy, 0);
+    }
 
     CloseHandle(hFile);
+    if (!success) {
+        // A truncated dump is unusable and would count against the budget
+        DeleteFileW(path.c_str());
+    }
+    return success != FALSE;
+}
+
+/**
+ * Evict the oldest rippled_*.dmp / .dmp.rdz files until the count and size budgets hold.
+ * Runs at install time and after helper / manual dumps - never on the
+ * in-process crash path, where the heap may be corrupt.
+ * @param keep A dump that must survive (the one just written)
+ */
+inline void enforceDumpRetention(const std::wstring& keep = std::wstring()) {
+    const DumpPolicy& policy = dumpPolicy();
+    if (policy.maxDumps == 0 && policy.maxTotalBytes == 0) return;
+
+    struct DumpFile {
+        ULONGLONG written;
+        uint64_t size;
+        std::wstring path;
+    };
+    std::vector<DumpFile> files;
+    uint64_t totalBytes = 0;
+
+    WIN32_FIND_DATAW data;
+    HANDLE find = FindFirstFileW((dumpDirectory() + L"\\rippled_*.dmp*").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE) return;
+    do {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        DumpFile file;
+        file.written = ((ULONGLONG)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+        file.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        file.path = dumpDirectory() + L"\\" + data.cFileName;
+        totalBytes += file.size;
+        files.push_back(file);
+    } while (FindNextFileW(find, &data));
+    FindClose(find);
+
+    std::sort(files.begin(), files.end(),
+        [](const DumpFile& a, const DumpFile& b) { return a.written < b.written; });
+
+    size_t count = files.size();
+    for (const DumpFile& file : files) {
+        bool overCount = policy.maxDumps && count > policy.maxDumps;
+        bool overSize = policy.maxTotalBytes && totalBytes > policy.maxTotalBytes;
+        if (!overCount && !overSize) break;
+        if (file.path == keep) continue;
+
+        if (DeleteFileW(file.path.c_str())) {
+            count--;
+            totalBytes -= file.size;
+            fprintf(stderr, "[MINIDUMP] Removed old dump: %ls (%llu MB)\n",
+                    file.path.c_str(), (unsigned long long)(file.size / 1024 / 1024));
+        }
+    }
+}
+
+// ============================================================================
+// Out-of-Process Dumps
+// ============================================================================
+//
+// Writing a full-memory dump from inside the crashing process is unreliable
+// (loader lock, corrupt heap) and freezes a large node for minutes. With a
+// helper configured, the crashing thread only fills a pre-mapped block with
+// its thread ID and exception pointers, signals a pre-created event and
+// waits; the helper process reads our memory and writes the dump. Objects are
+// named by client PID so a helper can also be attached by hand.
+
+constexpr uint32_t kCrashHelperMagic = 0x48434452;  // "RDCH"
+constexpr uint32_t kCrashHelperVersion = 4;
+
+enum CrashHelperState : LONG {
+    HELPER_IDLE,
+    HELPER_REQUESTED,
+    HELPER_DONE
+};
+
+// Shared between client and helper; fixed layout, no pointers into the helper
+struct CrashHelperBlock {
+    uint32_t magic;
+    uint32_t version;
+    DWORD clientPid;
+    volatile DWORD helperPid;       // Set by the helper once attached
+    volatile LONG state;            // CrashHelperState
+    DWORD threadId;                 // Crashing thread
+    uint64_t exceptionPointers;     // EXCEPTION_POINTERS* in the client (or 0)
+    DWORD dumpTier;                 // DumpTier
+    BOOL snapshot;                  // Live dump from a process snapshot
+    uint64_t flightStream;          // Serialized flight recorder in the client (or 0)
+    DWORD flightStreamSize;
+    BOOL success;                   // Helper result
+    DWORD error;
+    wchar_t dumpPath[MAX_PATH];
+};
+
+struct CrashHelperClient {
+    HANDLE mapping = nullptr;
+    HANDLE crashEvent = nullptr;    // Client -> helper
+    HANDLE doneEvent = nullptr;     // Helper -> client
+    HANDLE helperProcess = nullptr;
+    CrashHelperBlock* block = nullptr;
+};
+
+inline CrashHelperClient& crashHelperClient() {
+    static CrashHelperClient client;
+    return client;
+}
+
+inline void crashHelperObjectName(wchar_t* buffer, size_t size, DWORD clientPid, const wchar_t* kind) {
+    swprintf_s(buffer, size, L"Local\\rippled_crash_%lu_%s", (unsigned long)clientPid, kind);
+}
+
+inline void releaseCrashHelperObjects(CrashHelperClient& helper) {
+    if (helper.block) UnmapViewOfFile(helper.block);
+    if (helper.mapping) CloseHandle(helper.mapping);
+    if (helper.crashEvent) CloseHandle(helper.crashEvent);
+    if (helper.doneEvent) CloseHandle(helper.doneEvent);
+    if (helper.helperProcess) CloseHandle(helper.helperProcess);
+    helper = CrashHelperClient();
+}
+
+/**
+ * Create the shared block and events, then launch the helper.
+ * Called from installMinidumpHandler() once dumpDirectory() is set.
+ * @return false if anything failed (dumps stay in-process)
+ */
+inline bool startCrashHelper(const char* helperExe) {
+    CrashHelperClient& helper = crashHelperClient();
+    if (helper.block) return true;
 
-    if (success) {
-        fprintf(stderr, "[MINIDUMP] Dump written successfully!\n");
-        fprintf(stderr, "[MINIDUMP] Analyze with: windbg -z \"%ls\"\n", dumpPath.c_str());
+    DWORD pid = GetCurrentProcessId();
+    wchar_t name[64];
+    CrashHelperClient created;
+
+    crashHelperObjectName(name, 64, pid, L"block");
+    created.mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        0, sizeof(CrashHelperBlock), name);
+    if (created.mapping) {
+        created.block = (CrashHelperBlock*)MapViewOfFile(created.mapping, FILE_MAP_ALL_ACCESS,
+            0, 0, sizeof(CrashHelperBlock));
+    }
+    crashHelperObjectName(name, 64, pid, L"crash");
+    created.crashEvent = CreateEventW(NULL, FALSE, FALSE, name);
+    crashHelperObjectName(name, 64, pid, L"done");
+    created.doneEvent = CreateEventW(NULL, FALSE, FALSE, name);
+
+    if (!created.block || !created.crashEvent || !created.doneEvent) {
+        fprintf(stderr, "[MINIDUMP] Failed to create crash helper objects. Error: %lu\n", GetLastError());
+        releaseCrashHelperObjects(created);
+        return false;
+    }
+
+    memset(created.block, 0, sizeof(CrashHelperBlock));
+    created.block->magic = kCrashHelperMagic;
+    created.block->version = kCrashHelperVersion;
+    created.block->clientPid = pid;
+
+    const DumpPolicy& policy = dumpPolicy();
+    std::wstring commandLine = L"\"" + utf8ToWide(helperExe) + L"\" --pid " +
+        std::to_wstring(pid) + L" --dir \"" + dumpDirectory() + L"\"" +
+        L" --max-dumps " + std::to_wstring(policy.maxDumps) +
+        L" --max-mb " + std::to_wstring(policy.maxTotalBytes / 1024 / 1024) +
+        (policy.compress ? L" --compress" : L"");
+
+    STARTUPINFOW startup;
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    PROCESS_INFORMATION info;
+    memset(&info, 0, sizeof(info));
+
+    if (!CreateProcessW(NULL, &commandLine[0], NULL, NULL, FALSE, CREATE_NO_WINDOW,
+                        NULL, NULL, &startup, &info)) {
+        fprintf(stderr, "[MINIDUMP] Failed to launch crash helper %s. Error: %lu\n", helperExe, GetLastError());
+        releaseCrashHelperObjects(created);
+        return false;
+    }
+    CloseHandle(info.hThread);
+    created.helperProcess = info.hProcess;
+
+    helper = created;
+    fprintf(stderr, "[MINIDUMP] Crash helper started (pid %lu)\n", (unsigned long)info.dwProcessId);
+    return true;
+}
+
+// UTF-8 copy of a dump path for ReportBuffer, which has no %ls
+inline const char* narrowDumpPath(const wchar_t* path, char* out, int size) {
+    if (WideCharToMultiByte(CP_UTF8, 0, path, -1, out, size, NULL, NULL) <= 0) out[0] = '\0';
+    return out;
+}
+
+/**
+ * Ask the helper to dump this process and wait for it to finish.
+ * This touches only the pre-mapped block and events, and prints the outcome
+ * with WriteFile on the stderr handle - safe on a corrupt heap or with
+ * stderr locked by another thread.
+ * @param snapshot Write a live dump from a process snapshot
+ * @return true if the helper wrote the dump
+ */
+inline bool requestHelperDump(EXCEPTION_POINTERS* exceptionInfo, DumpTier tier, bool snapshot = false) {
+    CrashHelperClient& helper = crashHelperClient();
+    CrashHelperBlock* block = helper.block;
+    if (!block) return false;
+
+    // One request at a time; a second crashing thread queues behind the first
+    while (InterlockedCompareExchange(&block->state, HELPER_REQUESTED, HELPER_IDLE) != HELPER_IDLE) {
+        if (WaitForSingleObject(helper.helperProcess, 10) != WAIT_TIMEOUT) return false;
+    }
+
+    if (block->helperPid == 0 || WaitForSingleObject(helper.helperProcess, 0) != WAIT_TIMEOUT) {
+        fprintf(stderr, "[MINIDUMP] Crash helper not running, writing dump in-process\n");
+        InterlockedExchange(&block->state, HELPER_IDLE);
+        return false;
+    }
+
+    block->threadId = GetCurrentThreadId();
+    block->exceptionPointers = (uint64_t)(uintptr_t)exceptionInfo;
+    block->dumpTier = (DWORD)tier;
+    block->snapshot = snapshot ? TRUE : FALSE;
+    MINIDUMP_USER_STREAM flight;
+    bool hasFlight = flightRecorderStream(flight);
+    block->flightStream = hasFlight ? (uint64_t)(uintptr_t)flight.Buffer : 0;
+    block->flightStreamSize = hasFlight ? flight.BufferSize : 0;
+    block->success = FALSE;
+    block->error = 0;
+    block->dumpPath[0] = L'\0';
+
+    SetEvent(helper.crashEvent);
+
+    // The helper reads our memory, so stay alive until it is done (or gone)
+    HANDLE waits[2] = {helper.doneEvent, helper.helperProcess};
+    DWORD result = WaitForMultipleObjects(2, waits, FALSE, INFINITE);
+
+    char text[512];
+    ReportBuffer out(text, sizeof(text), GetStdHandle(STD_ERROR_HANDLE));
+    out.appendf("[MINIDUMP] Dump handed to crash helper (pid %lu)\n", (unsigned long)block->helperPid);
+    bool written = (result == WAIT_OBJECT_0) && block->success;
+    if (written) {
+        char path[MAX_PATH * 3];
+        out.appendf("[MINIDUMP] Dump written successfully!\n");
+        out.appendf("[MINIDUMP] Analyze with: windbg -z \"%s\"\n",
+                    narrowDumpPath(block->dumpPath, path, (int)sizeof(path)));
+    } else if (result == WAIT_OBJECT_0) {
+        out.appendf("[MINIDUMP] Crash helper failed to write dump. Error: %lu\n", block->error);
     } else {
-        fprintf(stderr, "[MINIDUMP] Failed to write dump. Error: %lu\n", GetLastError());
+        out.appendf("[MINIDUMP] Crash helper exited before finishing the dump\n");
+    }
+    out.flush();
+
+    InterlockedExchange(&block->state, HELPER_IDLE);
+    return written;
+}
+
+/**
+ * Helper side: attach to a client and write dumps on request until it exits.
+ * dumpDirectory() must already be set.
+ * @return process exit code
+ */
+inline int runCrashHelper(DWORD clientPid) {
+    wchar_t name[64];
+
+    crashHelperObjectName(name, 64, clientPid, L"block");
+    HANDLE mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, name);
+    CrashHelperBlock* block = mapping
+        ? (CrashHelperBlock*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(CrashHelperBlock))
+        : nullptr;
+    crashHelperObjectName(name, 64, clientPid, L"crash");
+    HANDLE crashEvent = OpenEventW(SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, name);
+    crashHelperObjectName(name, 64, clientPid, L"done");
+    HANDLE doneEvent = OpenEventW(SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, name);
+    HANDLE process = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ |
+        PROCESS_DUP_HANDLE | PROCESS_CREATE_PROCESS | PROCESS_VM_OPERATION |
+        SYNCHRONIZE, FALSE, clientPid);
+
+    if (!block || !crashEvent || !doneEvent || !process ||
+        block->magic != kCrashHelperMagic || block->version != kCrashHelperVersion) {
+        fprintf(stderr, "[MINIDUMP] Helper cannot attach to process %lu. Error: %lu\n",
+                (unsigned long)clientPid, GetLastError());
+        return 1;
     }
 
+    block->helperPid = GetCurrentProcessId();
+    fprintf(stderr, "[MINIDUMP] Helper attached to process %lu, dumps go to: %ls\n",
+            (unsigned long)clientPid, dumpDirectory().c_str());
     fflush(stderr);
 
+    HANDLE waits[2] = {crashEvent, process};
+    while (WaitForMultipleObjects(2, waits, FALSE, INFINITE) == WAIT_OBJECT_0) {
+        if (block->state != HELPER_REQUESTED) continue;
+
+        // Exception pointers live in the client's address space
+        MINIDUMP_EXCEPTION_INFORMATION exInfo;
+        exInfo.ThreadId = block->threadId;
+        exInfo.ExceptionPointers = (PEXCEPTION_POINTERS)(uintptr_t)block->exceptionPointers;
+        exInfo.ClientPointers = TRUE;
+
+        // The client's flight recorder becomes a user stream of our dump
+        std::vector<char> flight;
+        MINIDUMP_USER_STREAM flightStream;
+        MINIDUMP_USER_STREAM_INFORMATION streams;
+        SIZE_T copied = 0;
+        if (block->flightStream && block->flightStreamSize <= kFlightStreamBytes) {
+            flight.resize(block->flightStreamSize);
+            if (!ReadProcessMemory(process, (LPCVOID)(uintptr_t)block->flightStream,
+                                   flight.data(), flight.size(), &copied) || copied != flight.size()) {
+                fprintf(stderr, "[MINIDUMP] Helper could not read the flight recorder. Error: %lu\n",
+                        GetLastError());
+                flight.clear();
+            }
+        }
+        flightStream.Type = binlog::kFlightRecorderStreamType;
+        flightStream.BufferSize = (ULONG)flight.size();
+        flightStream.Buffer = flight.data();
+        streams.UserStreamCount = 1;
+        streams.UserStreamArray = &flightStream;
+
+        std::wstring dumpPath;
+        DWORD error = 0;
+        bool success = writeDumpFile(process, clientPid, (DumpTier)block->dumpTier,
+            block->exceptionPointers ? &exInfo : NULL, dumpPath, error, block->snapshot != FALSE,
+            flight.empty() ? NULL : &streams);
+
+        swprintf_s(block->dumpPath, MAX_PATH, L"%s", dumpPath.c_str());
+        block->success = success ? TRUE : FALSE;
+        block->error = error;
+        InterlockedExchange(&block->state, HELPER_DONE);
+        SetEvent(doneEvent);
+
+        if (success) {
+            fprintf(stderr, "[MINIDUMP] Helper wrote %ls%ls dump: %ls\n",
+                    block->snapshot ? L"live " : L"",
+                    dumpTierName((DumpTier)block->dumpTier), dumpPath.c_str());
+            enforceDumpRetention(dumpPath);
+        } else {
+            fprintf(stderr, "[MINIDUMP] Helper failed to write dump. Error: %lu\n", error);
+        }
+        fflush(stderr);
+    }
+
+    // Client exited (normally or after its dump)
+    UnmapViewOfFile(block);
+    CloseHandle(mapping);
+    CloseHandle(crashEvent);
+    CloseHandle(doneEvent);
+    CloseHandle(process);
+    return 0;
+}
+
+/**
+ * Entry point for a crash helper executable:
+ *   --pid <client> --dir <dumps> [--max-dumps N] [--max-mb M] [--compress]
+ */
+inline int crashHelperMain(int argc, wchar_t* argv[]) {
+    DWORD clientPid = 0;
+    DumpPolicy& policy = dumpPolicy();
+    for (int i = 1; i < argc; i++) {
+        if (wcscmp(argv[i], L"--compress") == 0) {
+            setDumpCompression(true);
+            continue;
+        }
+        if (i + 1 >= argc) break;
+        if (wcscmp(argv[i], L"--pid") == 0) {
+            clientPid = (DWORD)wcstoul(argv[++i], nullptr, 10);
+        } else if (wcscmp(argv[i], L"--dir") == 0) {
+            dumpDirectory() = argv[++i];
+        } else if (wcscmp(argv[i], L"--max-dumps") == 0) {
+            policy.maxDumps = (size_t)wcstoull(argv[++i], nullptr, 10);
+        } else if (wcscmp(argv[i], L"--max-mb") == 0) {
+            policy.maxTotalBytes = wcstoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        }
+    }
+    if (clientPid == 0 || dumpDirectory().empty()) {
+        fprintf(stderr, "Usage: crash_helper --pid <process id> --dir <dump directory> [--max-dumps N] [--max-mb M] [--compress]\n");
+        return 2;
+    }
+    CreateDirectoryW(dumpDirectory().c_str(), NULL);
+    return runCrashHelper(clientPid);
+}
+
+// Exception filter that writes minidump
+inline LONG WINAPI minidumpExceptionFilter(EXCEPTION_POINTERS* exceptionInfo) {
+    DumpTier tier = dumpPolicy().tier;
+
+    // The dump comes first, by the helper or in-process, before anything
+    // that takes a lock a crashed thread may hold (stderr, the log sinks)
+    bool handedOff = requestHelperDump(exceptionInfo, tier);
+
+    bool written = false;
+    std::wstring dumpPath;
+    DWORD error = 0;
+    if (!handedOff) {
+        MINIDUMP_EXCEPTION_INFORMATION exInfo;
+        exInfo.ThreadId = GetCurrentThreadId();
+        exInfo.ExceptionPointers = exceptionInfo;
+        exInfo.ClientPointers = FALSE;
+
+        // Retention is left to the next install: the heap may be corrupt here
+        written = writeDumpFile(GetCurrentProcess(), GetCurrentProcessId(), tier, &exInfo, dumpPath, error);
+    }
+
+    // Then the report, through the crash report writer (no CRT locks)
+    bool owned = beginCrashReport();
+    reportQueuedLog();
+    reportf("\n[MINIDUMP] Unhandled exception caught!\n");
+    reportf("[MINIDUMP] Exception code: 0x%08X\n", (unsigned)exceptionInfo->ExceptionRecord->ExceptionCode);
+    if (!handedOff) {
+        char path[MAX_PATH * 3];
+        char tierName[16];
+        narrowDumpPath(dumpTierName(tier), tierName, (int)sizeof(tierName));
+        if (written) {
+            reportf("[MINIDUMP] Dump written successfully (%s)!\n", tierName);
+            reportf("[MINIDUMP] Analyze with: windbg -z \"%s\"\n",
+                    narrowDumpPath(dumpPath.c_str(), path, (int)sizeof(path)));
+        } else {
+            reportf("[MINIDUMP] Failed to write %s dump to %s. Error: %lu\n", tierName,
+                    narrowDumpPath(dumpDirectory().c_str(), path, (int)sizeof(path)), error);
+        }
+    }
+    reportFlightRecorder();
+    endCrashReport(owned);
+
+    // Best effort, last: the mapped log file and sinks reach the OS
+    flushAsyncLog();
+
     // Continue to default handler (will terminate process)
     return EXCEPTION_CONTINUE_SEARCH;
 }
@@ -125,16 +1063,13 @@ inline LONG WINAPI minidumpExceptionFilter(EXCEPTION_POINTERS* exceptionInfo) {
 /**
  * Install minidump handler.
  * @param dumpDir Directory to write dumps (default: %LOCALAPPDATA%\rippled\CrashDumps)
+ * @param helperExe Crash helper executable (tools/crash-helper); when set,
+ *                  dumps are written out-of-process
  */
-inline void installMinidumpHandler(const char* dumpDir = nullptr) {
+inline void installMinidumpHandler(const char* dumpDir = nullptr, const char* helperExe = nullptr) {
     // Set dump directory
     if (dumpDir) {
-        // Convert to wide string
-        int len = MultiByteToWideChar(CP_UTF8, 0, dumpDir, -1, NULL, 0);
-        std::wstring wdir(len, 0);
-        MultiByteToWideChar(CP_UTF8, 0, dumpDir, -1, &wdir[0], len);
-        wdir.resize(len - 1); // Remove null terminator
-        dumpDirectory() = wdir;
+        dumpDirectory() = utf8ToWide(dumpDir);
     } else {
         // Default to %LOCALAPPDATA%\rippled\CrashDumps
         wchar_t localAppData[MAX_PATH];
@@ -148,11 +1083,18 @@ inline void installMinidumpHandler(const char* dumpDir = nullptr) {
     // Create directory if it doesn't exist
     CreateDirectoryW(dumpDirectory().c_str(), NULL);
 
+    // Dumps left by earlier crashes count against the budget
+    enforceDumpRetention();
+
+    if (helperExe) {
+        startCrashHelper(helperExe);
+    }
+
     // Install exception filter
     SetUnhandledExceptionFilter(minidumpExceptionFilter);
 
-    fprintf(stderr, "[MINIDUMP] Handler installed. Dumps will be written to: %ls\n",
-            dumpDirectory().c_str());
+    fprintf(stderr, "[MINIDUMP] Handler installed (%ls dumps). Dumps will be written to: %ls\n",
+            dumpTierName(dumpPolicy().tier), dumpDirectory().c_str());
     fflush(stderr);
 }
 
@@ -162,37 +1104,96 @@ inline void installMinidumpHandler(const char* dumpDir = nullptr) {
 inline void writeMinidump() {
     fprintf(stderr, "[MINIDUMP] Manual dump requested\n");
 
-    std::wstring dumpPath = generateDumpFilename();
+    DumpTier tier = dumpPolicy().tier;
+    if (requestHelperDump(nullptr, tier)) {
+        return;
+    }
+
+    std::wstring dumpPath;
+    DWORD error = 0;
+    if (writeDumpFile(GetCurrentProcess(), GetCurrentProcessId(), tier, NULL, dumpPath, error)) {
+        fprintf(stderr, "[MINIDUMP] Manual dump written: %ls\n", dumpPath.c_str());
+        enforceDumpRetention(dumpPath);
+    } else {
+        fprintf(stderr, "[MINIDUMP] Failed to write dump. Error: %lu\n", error);
+    }
+    fflush(stderr);
+}
+
+// ============================================================================
+// Live Dumps
+// ============================================================================
+//
+// Same tier and retention as writeMinidump(), but written from a process
+// snapshot so a running node only pauses for the clone. The trigger thread
+// waits on a named auto-reset event so an operator can request a dump from
+// outside (tools/dump-trigger) without attaching a debugger.
 
-    HANDLE hFile = CreateFileW(
-        dumpPath.c_str(),
-        GENERIC_WRITE,
-        0,
-        NULL,
-        CREATE_ALWAYS,
-        FILE_ATTRIBUTE_NORMAL,
-        NULL);
+inline void liveDumpEventName(wchar_t* buffer, size_t size, DWORD pid) {
+    swprintf_s(buffer, size, L"Local\\rippled_dump_%lu", (unsigned long)pid);
+}
 
-    if (hFile == INVALID_HANDLE_VALUE) {
-        fprintf(stderr, "[MINIDUMP] Failed to create dump file\n");
-        return;
+/**
+ * Write a live dump of this process from a snapshot.
+ * Goes through the crash helper when one is running.
+ * @param tier Defaults to the dump policy's tier
+ * @return true if the dump was written
+ */
+inline bool writeLiveMinidump(DumpTier tier = dumpPolicy().tier) {
+    fprintf(stderr, "[MINIDUMP] Live %ls dump requested\n", dumpTierName(tier));
+
+    if (requestHelperDump(nullptr, tier, true)) {
+        return true;
     }
 
-    BOOL success = MiniDumpWriteDump(
-        GetCurrentProcess(),
-        GetCurrentProcessId(),
-        hFile,
-        MiniDumpWithFullMemory,
-        NULL,
-        NULL,
-        NULL);
+    std::wstring dumpPath;
+    DWORD error = 0;
+    bool written = writeDumpFile(GetCurrentProcess(), GetCurrentProcessId(), tier, NULL,
+                                 dumpPath, error, true);
+    if (written) {
+        fprintf(stderr, "[MINIDUMP] Live dump written: %ls\n", dumpPath.c_str());
+        enforceDumpRetention(dumpPath);
+    } else {
+        fprintf(stderr, "[MINIDUMP] Failed to write live dump. Error: %lu\n", error);
+    }
+    fflush(stderr);
+    return written;
+}
 
-    CloseHandle(hFile);
+inline DWORD WINAPI liveDumpTriggerThread(LPVOID param) {
+    HANDLE event = (HANDLE)param;
+    while (WaitForSingleObject(event, INFINITE) == WAIT_OBJECT_0) {
+        fprintf(stderr, "[MINIDUMP] Live dump triggered\n");
+        writeLiveMinidump();
+    }
+    return 0;
+}
 
-    if (success) {
-        fprintf(stderr, "[MINIDUMP] Manual dump written: %ls\n", dumpPath.c_str());
+/**
+ * Listen on Local\rippled_dump_<pid>; each SetEvent writes one live dump.
+ * Call after installMinidumpHandler() so the dump directory is set.
+ * @return false if the event or thread could not be created
+ */
+inline bool installLiveDumpTrigger() {
+    static volatile LONG installed = 0;
+    if (InterlockedCompareExchange(&installed, 1, 0) != 0) return true;
+
+    wchar_t name[64];
+    liveDumpEventName(name, 64, GetCurrentProcessId());
+    HANDLE event = CreateEventW(NULL, FALSE, FALSE, name);
+    HANDLE thread = event ? CreateThread(NULL, 0, liveDumpTriggerThread, event, 0, NULL) : NULL;
+    if (!thread) {
+        fprintf(stderr, "[MINIDUMP] Failed to install live dump trigger. Error: %lu\n", GetLastError());
+        if (event) CloseHandle(event);
+        InterlockedExchange(&installed, 0);
+        return false;
     }
+    SetThreadPriority(thread, THREAD_PRIORITY_BELOW_NORMAL);
+    CloseHandle(thread);
+
+    fprintf(stderr, "[MINIDUMP] Live dump trigger: %ls\n", name);
     fflush(stderr);
+    return true;
 }
 
 } // namespace rippled_debug
@@ -200,11 +1201,15 @@ inline void writeMinidump() {
 // Convenience macros
 #define installMinidumpHandler(...) rippled_debug::installMinidumpHandler(__VA_ARGS__)
 #define writeMinidump() rippled_debug::writeMinidump()
+#define writeLiveMinidump(...) rippled_debug::writeLiveMinidump(__VA_ARGS__)
+#define installLiveDumpTrigger() rippled_debug::installLiveDumpTrigger()
 
 #else // !_WIN32
 
 #define installMinidumpHandler(...) ((void)0)
 #define writeMinidump() ((void)0)
+#define writeLiveMinidump(...) ((void)0)
+#define installLiveDumpTrigger() ((void)0)
 
 #endif // _WIN32
 
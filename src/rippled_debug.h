@@ -24,7 +24,14 @@
 #include "build_info.h"
 #include "crash_handlers.h"
 #include "debug_log.h"
+#include "exception_monitor.h"
+#include "etw_trace.h"
+#include "log_file.h"
+#include "metrics.h"
 #include "minidump.h"
+#include "section_profiler.h"
+#include "trace_export.h"
+#include "watchdog.h"
 
 #ifdef _WIN32
 
@@ -43,10 +50,13 @@ inline void initAll(bool verbose = true) {
     }
     SetConsoleOutputCP(CP_UTF8);
 
+    // The full build info waits for the system info, captured in the
+    // background so startup does not; it is printed when that finishes
     if (verbose) {
-        printBuildInfo();
+        startSystemInfoCapture(true, stderr);
     } else {
         printVersionLine();
+        startSystemInfoCapture();
     }
 
     installVerboseCrashHandlers();
@@ -0,0 +1,622 @@
+/**
+ * @file section_profiler.h
+ * @brief Aggregating profiler for DEBUG_SECTION call trees
+ *
+ * In profiling mode sections stop printing a box per call. Instead each
+ * thread records them into its own call tree (count, total, min, max and an
+ * HDR-style log-linear histogram for p50/p99). Only slow outliers are logged,
+ * above the section's DEBUG_SECTION_SLOW threshold or the global one.
+ * With DEBUG_SECTION_CPU(true) nodes also sum thread CPU time, and reports
+ * show how much of each section's wall time was spent waiting (I/O, locks,
+ * preemption) rather than computing.
+ *
+ * Reports merge all threads:
+ * - printSectionProfile() renders a table (Rich, text or JSON lines)
+ * - dumpSectionProfile(path) writes collapsed stacks (flamegraph.pl,
+ *   speedscope) weighted by self time in microseconds
+ * - startSectionProfileDumps(path, ms) rewrites that file periodically
+ *
+ * Usage:
+ *   DEBUG_PROFILE_ENABLE(5.0);          // warn on sections slower than 5ms
+ *   ...
+ *   DEBUG_PROFILE_PRINT();
+ *   DEBUG_PROFILE_DUMP("sections.folded");
+ */
+
+#ifndef RIPPLED_WINDOWS_DEBUG_SECTION_PROFILER_H
+#define RIPPLED_WINDOWS_DEBUG_SECTION_PROFILER_H
+
+#ifdef _WIN32
+
+#include "debug_log.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace rippled_debug {
+
+// ============================================================================
+// Histogram
+// ============================================================================
+//
+// Log-linear buckets over nanoseconds: exact below 16ns, then 16 sub-buckets
+// per power of two (~6% wide), up to 2^48ns (~78 hours).
+
+constexpr int kProfileSubBucketBits = 4;
+constexpr int kProfileSubBuckets = 1 << kProfileSubBucketBits;
+constexpr int kProfileMaxExponent = 47;
+constexpr int kProfileBucketCount =
+    kProfileSubBuckets + (kProfileMaxExponent + 1 - kProfileSubBucketBits) * kProfileSubBuckets;
+
+inline int highestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+inline int profileBucketIndex(uint64_t ns) {
+    if (ns < (uint64_t)kProfileSubBuckets) return (int)ns;
+    int msb = highestBit(ns);
+    if (msb > kProfileMaxExponent) return kProfileBucketCount - 1;
+    int shift = msb - kProfileSubBucketBits;
+    int sub = (int)(ns >> shift) - kProfileSubBuckets;
+    return kProfileSubBuckets + shift * kProfileSubBuckets + sub;
+}
+
+// Midpoint of a bucket, in nanoseconds
+inline uint64_t profileBucketValue(int index) {
+    if (index < kProfileSubBuckets) return (uint64_t)index;
+    int shift = (index - kProfileSubBuckets) / kProfileSubBuckets;
+    int sub = (index - kProfileSubBuckets) % kProfileSubBuckets;
+    uint64_t low = (uint64_t)(kProfileSubBuckets + sub) << shift;
+    return low + ((1ull << shift) >> 1);
+}
+
+// ============================================================================
+// Per-thread call tree
+// ============================================================================
+//
+// Only the owning thread writes a node's counters (plain load + store on
+// relaxed atomics, no RMW), so the hot path takes no lock. Adding a node
+// takes the thread's own lock exclusively; report readers take it shared.
+// Nodes and thread trees are never freed so reports can include threads
+// that have exited.
+
+struct ProfileNode {
+    std::string name;               // Copied: section names may be temporaries
+    const SectionSite* site;
+    const char* file;
+    int line;
+
+    ProfileNode* parent = nullptr;
+    ProfileNode* firstChild = nullptr;
+    ProfileNode* nextSibling = nullptr;
+
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> childNs{0};   // Time spent in child sections
+    std::atomic<uint64_t> minNs{UINT64_MAX};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint32_t> buckets[kProfileBucketCount] = {};
+
+    // Calls measured with CPU timing on (it can be toggled while running)
+    std::atomic<uint64_t> cpuCount{0};
+    std::atomic<uint64_t> cpuWallNs{0};
+    std::atomic<uint64_t> cycles{0};
+
+    ProfileNode(const char* n, const SectionSite* s, const char* f, int l)
+        : name(n ? n : ""), site(s), file(f), line(l) {}
+
+    bool matches(const SectionEvent& ev) const {
+        if (site || ev.site) return site == ev.site;
+        return line == ev.line && file == ev.file;
+    }
+
+    void clear() {
+        count.store(0, std::memory_order_relaxed);
+        totalNs.store(0, std::memory_order_relaxed);
+        childNs.store(0, std::memory_order_relaxed);
+        minNs.store(UINT64_MAX, std::memory_order_relaxed);
+        maxNs.store(0, std::memory_order_relaxed);
+        for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+        cpuCount.store(0, std::memory_order_relaxed);
+        cpuWallNs.store(0, std::memory_order_relaxed);
+        cycles.store(0, std::memory_order_relaxed);
+        for (ProfileNode* c = firstChild; c; c = c->nextSibling) c->clear();
+    }
+};
+
+inline void addOwned(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+constexpr int kProfileMaxDepth = 128;
+
+struct ThreadProfile {
+    SRWLOCK lock = SRWLOCK_INIT;
+    DWORD tid;
+    ProfileNode root;
+    ProfileNode* current;
+    int depth = 0;
+    int ignoredDepth = 0;       // Enters beyond kProfileMaxDepth still to exit
+    std::atomic<uint32_t> resetEpoch{0};  // Last reset applied by the owner
+    ThreadProfile* next = nullptr;
+
+    explicit ThreadProfile(DWORD t) : tid(t), root("", nullptr, "", 0), current(&root) {}
+};
+
+struct ProfilerState {
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> observerAdded{false};
+    std::atomic<ThreadProfile*> threads{nullptr};
+    std::atomic<uint32_t> resetEpoch{0};
+
+    // Periodic collapsed-stack dumps
+    std::string dumpPath;
+    DWORD dumpIntervalMs = 0;
+    HANDLE dumpStopEvent = nullptr;
+    HANDLE dumpThread = nullptr;
+};
+
+inline ProfilerState& profilerState() {
+    static ProfilerState state;
+    return state;
+}
+
+inline ThreadProfile*& threadProfileSlot() {
+    thread_local ThreadProfile* profile = nullptr;
+    return profile;
+}
+
+inline ThreadProfile& threadProfile() {
+    ThreadProfile*& profile = threadProfileSlot();
+    if (!profile) {
+        profile = new ThreadProfile(GetCurrentThreadId());
+        ProfilerState& state = profilerState();
+        ThreadProfile* head = state.threads.load(std::memory_order_relaxed);
+        do {
+            profile->next = head;
+        } while (!state.threads.compare_exchange_weak(head, profile,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+    return *profile;
+}
+
+inline void profilerOnEnter(const SectionEvent& ev) {
+    ProfilerState& state = profilerState();
+    if (!state.enabled.load(std::memory_order_relaxed)) return;
+
+    ThreadProfile& tp = threadProfile();
+
+    // Resets are applied by the owner so counters keep a single writer
+    uint32_t epoch = state.resetEpoch.load(std::memory_order_relaxed);
+    if (epoch != tp.resetEpoch.load(std::memory_order_relaxed)) {
+        tp.root.clear();
+        tp.resetEpoch.store(epoch, std::memory_order_relaxed);
+    }
+
+    if (tp.depth >= kProfileMaxDepth || tp.ignoredDepth > 0) {
+        tp.ignoredDepth++;
+        return;
+    }
+
+    ProfileNode* parent = tp.current;
+    ProfileNode* node = parent->firstChild;
+    ProfileNode* last = nullptr;
+    while (node && !node->matches(ev)) {
+        last = node;
+        node = node->nextSibling;
+    }
+
+    if (!node) {
+        // Appended so reports list children in first-seen order
+        node = new ProfileNode(ev.name, ev.site, ev.file, ev.line);
+        node->parent = parent;
+        AcquireSRWLockExclusive(&tp.lock);
+        if (last) last->nextSibling = node;
+        else parent->firstChild = node;
+        ReleaseSRWLockExclusive(&tp.lock);
+    }
+
+    tp.current = node;
+    tp.depth++;
+}
+
+inline void profilerOnExit(const SectionEvent& ev) {
+    // Runs even when disabled so sections entered before disabling unwind
+    ThreadProfile* profile = threadProfileSlot();
+    if (!profile) return;
+    ThreadProfile& tp = *profile;
+    if (tp.ignoredDepth > 0) {
+        tp.ignoredDepth--;
+        return;
+    }
+    ProfileNode* node = tp.current;
+    if (node == &tp.root || !node->matches(ev)) return;  // Entered before enabling
+
+    uint64_t ns = (uint64_t)ticksToNs(ev.endTicks - ev.startTicks);
+    addOwned(node->count, 1);
+    addOwned(node->totalNs, ns);
+    if (ns < node->minNs.load(std::memory_order_relaxed)) node->minNs.store(ns, std::memory_order_relaxed);
+    if (ns > node->maxNs.load(std::memory_order_relaxed)) node->maxNs.store(ns, std::memory_order_relaxed);
+    std::atomic<uint32_t>& bucket = node->buckets[profileBucketIndex(ns)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (node->parent != &tp.root) addOwned(node->parent->childNs, ns);
+    if (ev.startCycles != 0) {
+        addOwned(node->cpuCount, 1);
+        addOwned(node->cpuWallNs, ns);
+        addOwned(node->cycles, ev.endCycles - ev.startCycles);
+    }
+
+    tp.current = node->parent;
+    tp.depth--;
+}
+
+// ============================================================================
+// Reports
+// ============================================================================
+
+// One node of the call tree merged across threads
+struct ProfileSummary {
+    std::string name;
+    const char* file = "";
+    int line = 0;
+    uint64_t count = 0;
+    uint64_t totalNs = 0;
+    uint64_t childNs = 0;
+    uint64_t minNs = UINT64_MAX;
+    uint64_t maxNs = 0;
+    std::vector<uint64_t> buckets;
+    std::vector<ProfileSummary> children;
+    uint64_t cpuCount = 0;
+    uint64_t cpuWallNs = 0;
+    uint64_t cycles = 0;
+
+    uint64_t selfNs() const { return totalNs > childNs ? totalNs - childNs : 0; }
+
+    // CPU time, estimated over all calls from the ones measured
+    uint64_t cpuNs() const {
+        if (cpuCount == 0) return 0;
+        double measured = (double)cycles / threadCyclesPerNs();
+        return (uint64_t)(measured * (double)count / (double)cpuCount);
+    }
+
+    // Share of wall time not running on a CPU, in percent (< 0: not measured)
+    double waitPercent() const {
+        if (cpuCount == 0 || cpuWallNs == 0) return -1.0;
+        double cpu = (double)cycles / threadCyclesPerNs();
+        double wait = 100.0 * (1.0 - cpu / (double)cpuWallNs);
+        return wait < 0.0 ? 0.0 : wait;
+    }
+
+    uint64_t percentileNs(double q) const {
+        if (count == 0) return 0;
+        uint64_t target = (uint64_t)(q * (double)count + 0.5);
+        if (target < 1) target = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < (int)buckets.size(); i++) {
+            seen += buckets[i];
+            if (seen >= target) {
+                uint64_t value = profileBucketValue(i);
+                if (value < minNs) value = minNs;
+                if (value > maxNs) value = maxNs;
+                return value;
+            }
+        }
+        return maxNs;
+    }
+};
+
+inline void mergeProfileNode(ProfileSummary& into, const ProfileNode& node) {
+    into.count += node.count.load(std::memory_order_relaxed);
+    into.totalNs += node.totalNs.load(std::memory_order_relaxed);
+    into.childNs += node.childNs.load(std::memory_order_relaxed);
+    uint64_t mn = node.minNs.load(std::memory_order_relaxed);
+    uint64_t mx = node.maxNs.load(std::memory_order_relaxed);
+    if (mn < into.minNs) into.minNs = mn;
+    if (mx > into.maxNs) into.maxNs = mx;
+    if (into.buckets.empty()) into.buckets.assign(kProfileBucketCount, 0);
+    for (int i = 0; i < kProfileBucketCount; i++) {
+        into.buckets[i] += node.buckets[i].load(std::memory_order_relaxed);
+    }
+    into.cpuCount += node.cpuCount.load(std::memory_order_relaxed);
+    into.cpuWallNs += node.cpuWallNs.load(std::memory_order_relaxed);
+    into.cycles += node.cycles.load(std::memory_order_relaxed);
+
+    for (const ProfileNode* c = node.firstChild; c; c = c->nextSibling) {
+        ProfileSummary* target = nullptr;
+        for (auto& existing : into.children) {
+            if (existing.line == c->line && existing.name == c->name
+                && strcmp(existing.file, c->file) == 0) {
+                target = &existing;
+                break;
+            }
+        }
+        if (!target) {
+            into.children.emplace_back();
+            target = &into.children.back();
+            target->name = c->name;
+            target->file = c->file;
+            target->line = c->line;
+        }
+        mergeProfileNode(*target, *c);
+    }
+}
+
+/**
+ * Snapshot of all threads' call trees, merged by section (name + location).
+ * The returned root is a placeholder; its children are top-level sections.
+ * Counters of sections still running on other threads may be mid-update.
+ */
+inline ProfileSummary collectSectionProfile() {
+    ProfileSummary root;
+    root.name = "all";
+    ProfilerState& state = profilerState();
+    uint32_t epoch = state.resetEpoch.load(std::memory_order_relaxed);
+    for (ThreadProfile* tp = state.threads.load(std::memory_order_acquire);
+         tp; tp = tp->next) {
+        // Threads that haven't entered a section since the last reset still
+        // hold pre-reset numbers
+        if (tp->resetEpoch.load(std::memory_order_relaxed) != epoch) continue;
+        AcquireSRWLockShared(&tp->lock);
+        mergeProfileNode(root, tp->root);
+        ReleaseSRWLockShared(&tp->lock);
+    }
+    return root;
+}
+
+inline void writeCollapsedStacks(FILE* out, const ProfileSummary& node, std::string& stack) {
+    size_t mark = stack.size();
+    if (!stack.empty()) stack += ';';
+    for (char c : node.name) stack += (c == ';' || c == '\n') ? ':' : c;
+
+    uint64_t selfUs = node.selfNs() / 1000;
+    if (selfUs > 0) fprintf(out, "%s %llu\n", stack.c_str(), (unsigned long long)selfUs);
+
+    for (const auto& child : node.children) writeCollapsedStacks(out, child, stack);
+    stack.resize(mark);
+}
+
+/**
+ * Write the merged call tree as collapsed stacks ("outer;inner <self_us>"),
+ * the input format of flamegraph.pl and speedscope.
+ */
+inline bool dumpSectionProfile(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "[rippled_debug] Cannot open profile output: %s\n", path);
+        return false;
+    }
+    ProfileSummary root = collectSectionProfile();
+    std::string stack;
+    for (const auto& child : root.children) writeCollapsedStacks(out, child, stack);
+    fclose(out);
+    return true;
+}
+
+inline void formatProfileDuration(uint64_t ns, char* buffer, size_t size) {
+    if (ns < 1000) snprintf(buffer, size, "%lluns", (unsigned long long)ns);
+    else if (ns < 1000000) snprintf(buffer, size, "%.1fus", ns / 1e3);
+    else if (ns < 1000000000) snprintf(buffer, size, "%.2fms", ns / 1e6);
+    else snprintf(buffer, size, "%.2fs", ns / 1e9);
+}
+
+inline bool profileHasCpu(const ProfileSummary& node) {
+    if (node.cpuCount > 0) return true;
+    for (const auto& child : node.children) {
+        if (profileHasCpu(child)) return true;
+    }
+    return false;
+}
+
+inline void printProfileRows(const ProfileSummary& node, int depth, std::string& path,
+                             bool cpuColumns) {
+    size_t mark = path.size();
+    if (!path.empty()) path += ';';
+    path += node.name;
+
+    uint64_t mean = node.count ? node.totalNs / node.count : 0;
+    uint64_t minNs = node.count ? node.minNs : 0;
+    LineBuffer out;
+
+    if (config().format == LogFormat::JSON) {
+        out.appendf("{\"section\":\"%s\",\"calls\":%llu,\"total_ns\":%llu,\"self_ns\":%llu,"
+            "\"min_ns\":%llu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu",
+            escapeJson(path.c_str()).c_str(), (unsigned long long)node.count,
+            (unsigned long long)node.totalNs, (unsigned long long)node.selfNs(),
+            (unsigned long long)minNs, (unsigned long long)node.percentileNs(0.50),
+            (unsigned long long)node.percentileNs(0.99), (unsigned long long)node.maxNs);
+        if (node.cpuCount > 0) {
+            out.appendf(",\"cpu_ns\":%llu,\"wait_pct\":%.1f",
+                (unsigned long long)node.cpuNs(), node.waitPercent());
+        }
+        out.append("}\n");
+    } else {
+        char total[16], meanStr[16], minStr[16], p50[16], p99[16], maxStr[16];
+        formatProfileDuration(node.totalNs, total, sizeof(total));
+        formatProfileDuration(mean, meanStr, sizeof(meanStr));
+        formatProfileDuration(minNs, minStr, sizeof(minStr));
+        formatProfileDuration(node.percentileNs(0.50), p50, sizeof(p50));
+        formatProfileDuration(node.percentileNs(0.99), p99, sizeof(p99));
+        formatProfileDuration(node.maxNs, maxStr, sizeof(maxStr));
+
+        int indent = depth * 2;
+        int nameWidth = 34 - indent;
+        if (nameWidth < 8) nameWidth = 8;
+        bool rich = config().format == LogFormat::RICH && config().useColors;
+
+        out.appendf("%*s%s%-*.*s%s", indent, "", rich ? colors::SECTION : "",
+            nameWidth, nameWidth, node.name.c_str(), rich ? colors::RESET : "");
+        out.appendf(" %s%9llu%s", rich ? colors::NUMBER : "",
+            (unsigned long long)node.count, rich ? colors::RESET : "");
+        out.appendf(" %10s %9s %9s %9s %9s %9s", total, meanStr, minStr, p50, p99, maxStr);
+        if (cpuColumns) {
+            char cpu[16] = "-", wait[16] = "-";
+            if (node.cpuCount > 0) {
+                formatProfileDuration(node.cpuNs(), cpu, sizeof(cpu));
+                snprintf(wait, sizeof(wait), "%.0f%%", node.waitPercent());
+            }
+            out.appendf(" %10s %6s", cpu, wait);
+        }
+        out.append("\n");
+    }
+    emitText(out);
+
+    for (const auto& child : node.children) printProfileRows(child, depth + 1, path, cpuColumns);
+    path.resize(mark);
+}
+
+// Print the merged call tree as a table in the current log format
+inline void printSectionProfile() {
+    if (!config().enabled) return;
+
+    enableAnsiSupport();
+
+    ProfileSummary root = collectSectionProfile();
+    bool rich = config().format == LogFormat::RICH && config().useColors;
+    bool cpuColumns = profileHasCpu(root);
+
+    if (config().format != LogFormat::JSON) {
+        LineBuffer out;
+        out.appendf("\n%s%-34s %9s %10s %9s %9s %9s %9s %9s",
+            rich ? colors::BOLD : "", "Section", "Calls", "Total", "Mean",
+            "Min", "p50", "p99", "Max");
+        if (cpuColumns) out.appendf(" %10s %6s", "CPU", "Wait");
+        out.appendf("%s\n", rich ? colors::RESET : "");
+        out.appendf("%s", rich ? colors::BOX_COLOR : "");
+        out.repeat(rich ? box::H : "-", cpuColumns ? 123 : 105);
+        out.appendf("%s\n", rich ? colors::RESET : "");
+        emitText(out);
+    }
+
+    std::string path;
+    for (const auto& child : root.children) printProfileRows(child, 0, path, cpuColumns);
+
+    if (config().format != LogFormat::JSON) {
+        LineBuffer out;
+        out.append("\n");
+        emitText(out);
+    }
+}
+
+inline void resetSectionProfile() {
+    profilerState().resetEpoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// Enable / periodic dumps
+// ============================================================================
+
+/**
+ * Turn on profiling mode: sections feed the call tree instead of printing,
+ * and only those slower than slowSectionMs (or their DEBUG_SECTION_SLOW
+ * threshold) are logged. Pass a negative value to log none.
+ */
+inline void enableSectionProfiling(double slowSectionMs = 10.0) {
+    ProfilerState& state = profilerState();
+    if (!state.observerAdded.exchange(true)) {
+        addSectionObserver(SectionObserver{profilerOnEnter, profilerOnExit});
+    }
+    config().slowSectionMs = slowSectionMs;
+    config().sectionBoxes = false;
+    state.enabled.store(true, std::memory_order_release);
+}
+
+inline void disableSectionProfiling() {
+    profilerState().enabled.store(false, std::memory_order_release);
+    config().sectionBoxes = true;
+}
+
+inline DWORD WINAPI profileDumpMain(LPVOID) {
+    ProfilerState& state = profilerState();
+    while (WaitForSingleObject(state.dumpStopEvent, state.dumpIntervalMs) == WAIT_TIMEOUT) {
+        dumpSectionProfile(state.dumpPath.c_str());
+    }
+    return 0;
+}
+
+inline void stopSectionProfileDumps() {
+    ProfilerState& state = profilerState();
+    if (!state.dumpThread) return;
+
+    SetEvent(state.dumpStopEvent);
+    WaitForSingleObject(state.dumpThread, INFINITE);
+    CloseHandle(state.dumpThread);
+    CloseHandle(state.dumpStopEvent);
+    state.dumpThread = nullptr;
+    state.dumpStopEvent = nullptr;
+
+    dumpSectionProfile(state.dumpPath.c_str());   // Final, complete snapshot
+}
+
+/**
+ * Rewrite `path` with collapsed stacks every intervalMs, and once more at
+ * exit (or stopSectionProfileDumps()).
+ */
+inline bool startSectionProfileDumps(const char* path, DWORD intervalMs = 10000) {
+    ProfilerState& state = profilerState();
+    stopSectionProfileDumps();
+
+    state.dumpPath = path;
+    state.dumpIntervalMs = intervalMs ? intervalMs : 1;
+    state.dumpStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!state.dumpStopEvent) {
+        fprintf(stderr, "[rippled_debug] CreateEvent failed for profile dumps (error %lu)\n",
+            GetLastError());
+        return false;
+    }
+    state.dumpThread = CreateThread(nullptr, 0, profileDumpMain, nullptr, 0, nullptr);
+    if (!state.dumpThread) {
+        fprintf(stderr, "[rippled_debug] Failed to start profile dump thread (error %lu)\n",
+            GetLastError());
+        CloseHandle(state.dumpStopEvent);
+        state.dumpStopEvent = nullptr;
+        return false;
+    }
+
+    static std::atomic<bool> atexitRegistered{false};
+    if (!atexitRegistered.exchange(true)) atexit(stopSectionProfileDumps);
+    return true;
+}
+
+} // namespace rippled_debug
+
+// ============================================================================
+// Convenience Macros
+// ============================================================================
+
+#define DEBUG_PROFILE_ENABLE(slowMs) \
+    rippled_debug::enableSectionProfiling(slowMs)
+
+#define DEBUG_PROFILE_DISABLE() \
+    rippled_debug::disableSectionProfiling()
+
+#define DEBUG_PROFILE_PRINT() \
+    rippled_debug::printSectionProfile()
+
+#define DEBUG_PROFILE_DUMP(path) \
+    rippled_debug::dumpSectionProfile(path)
+
+#define DEBUG_PROFILE_RESET() \
+    rippled_debug::resetSectionProfile()
+
+#else // !_WIN32
+
+#define DEBUG_PROFILE_ENABLE(slowMs) ((void)0)
+#define DEBUG_PROFILE_DISABLE() ((void)0)
+#define DEBUG_PROFILE_PRINT() ((void)0)
+#define DEBUG_PROFILE_DUMP(path) ((void)0)
+#define DEBUG_PROFILE_RESET() ((void)0)
+
+#endif // _WIN32
+
+#endif // RIPPLED_WINDOWS_DEBUG_SECTION_PROFILER_H
@@ -0,0 +1,429 @@
+/**
+ * @file trace_export.h
+ * @brief Streaming Chrome Trace Event export for sections and log records
+ *
+ * Writes the JSON Array trace format read by chrome://tracing, Perfetto UI
+ * (ui.perfetto.dev) and speedscope:
+ * - DEBUG_SECTION -> complete ("X") slices on the thread's track
+ * - log records   -> thread-scoped instant ("i") events with level/file/cid
+ * - correlation IDs -> flow arrows ("s"/"t") whenever a cid shows up on a
+ *   different thread than last time, bound to the enclosing section slice
+ *
+ * Memory is bounded: each thread appends to its own fixed-size ring (no
+ * locks, no shared cache lines between producers) and a background thread
+ * drains all rings to the file every flushIntervalMs. A full ring drops the
+ * event and counts it; the total is written as metadata when the trace is
+ * stopped. The file is valid JSON after stopTrace(); if the process dies
+ * first the viewers still load it (the closing ']' is optional).
+ *
+ * Usage:
+ *   DEBUG_TRACE_START("rippled.trace.json");
+ *   ...
+ *   DEBUG_TRACE_STOP();     // also runs at exit
+ */
+
+#ifndef RIPPLED_WINDOWS_DEBUG_TRACE_EXPORT_H
+#define RIPPLED_WINDOWS_DEBUG_TRACE_EXPORT_H
+
+#ifdef _WIN32
+
+#include "debug_log.h"
+
+#include <cstdlib>
+#include <string>
+
+namespace rippled_debug {
+
+// ============================================================================
+// Per-thread event rings
+// ============================================================================
+
+constexpr size_t kTraceNameSize = 184;
+
+struct TraceEvent {
+    char phase;             // 'X' section, 'i' log record, 's'/'t' flow
+    DWORD tid;
+    int64_t ticks;          // Raw QPC (slice start for 'X')
+    int64_t durTicks;       // 'X' only
+    CorrelationId cid;
+    uint64_t spanId;
+    uint64_t parentSpanId;
+    const char* file;       // __FILE__ literals, never freed
+    const char* level;
+    int line;
+    char name[kTraceNameSize];  // Copied: section names/messages may be temporaries
+};
+
+// Single producer (the owning thread), single consumer (the trace writer)
+struct ThreadTraceBuffer {
+    TraceEvent* events = nullptr;
+    uint32_t mask = 0;
+    DWORD tid = 0;
+    alignas(64) std::atomic<uint32_t> head{0};     // Next slot to write
+    alignas(64) std::atomic<uint32_t> tail{0};     // Next slot to read
+    std::atomic<uint64_t> dropped{0};
+    bool announced = false;                         // Writer-side: thread_name emitted
+    ThreadTraceBuffer* next = nullptr;
+};
+
+struct TraceFlowSlot {
+    std::atomic<uint64_t> cid{0};
+    std::atomic<DWORD> lastTid{0};
+};
+
+constexpr size_t kTraceFlowSlots = 1024;
+
+struct TraceState {
+    std::atomic<bool> running{false};
+    std::atomic<bool> observersAdded{false};
+    std::atomic<ThreadTraceBuffer*> buffers{nullptr};
+    uint32_t eventsPerThread = 2048;
+
+    FILE* output = nullptr;
+    uint64_t droppedWritten = 0;
+    DWORD flushIntervalMs = 50;
+    HANDLE stopEvent = nullptr;
+    HANDLE writerThread = nullptr;
+
+    TraceFlowSlot flows[kTraceFlowSlots];
+};
+
+inline TraceState& traceState() {
+    static TraceState state;
+    return state;
+}
+
+inline bool isTracing() {
+    return traceState().running.load(std::memory_order_acquire);
+}
+
+inline ThreadTraceBuffer& threadTraceBuffer() {
+    thread_local ThreadTraceBuffer* buffer = nullptr;
+    if (!buffer) {
+        TraceState& state = traceState();
+        uint32_t capacity = 64;
+        while (capacity < state.eventsPerThread) capacity <<= 1;
+
+        buffer = new ThreadTraceBuffer;
+        buffer->events = new TraceEvent[capacity];
+        buffer->mask = capacity - 1;
+        buffer->tid = GetCurrentThreadId();
+
+        ThreadTraceBuffer* head = state.buffers.load(std::memory_order_relaxed);
+        do {
+            buffer->next = head;
+        } while (!state.buffers.compare_exchange_weak(head, buffer,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+    return *buffer;
+}
+
+// Reserve the next event slot, or nullptr (counted as dropped) when full
+inline TraceEvent* traceClaim(ThreadTraceBuffer& buf) {
+    uint32_t head = buf.head.load(std::memory_order_relaxed);
+    if (head - buf.tail.load(std::memory_order_acquire) > buf.mask) {
+        buf.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &buf.events[head & buf.mask];
+}
+
+inline void tracePublish(ThreadTraceBuffer& buf) {
+    buf.head.store(buf.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+inline void traceCopyName(TraceEvent& ev, const char* text) {
+    size_t len = text ? strlen(text) : 0;
+    if (len > kTraceNameSize - 1) len = kTraceNameSize - 1;
+    if (len) memcpy(ev.name, text, len);
+    ev.name[len] = '\0';
+}
+
+/**
+ * Flow phase for an event with this cid on this thread: 's' the first time
+ * the cid is seen, 't' when it moved threads since its last event, 0 when
+ * there's nothing to draw. Hash collisions just start a new flow.
+ */
+inline char traceFlowPhase(CorrelationId cid, DWORD tid) {
+    TraceFlowSlot& slot =
+        traceState().flows[(cid * 0x9E3779B97F4A7C15ull) >> 54];
+    if (slot.cid.load(std::memory_order_relaxed) != cid) {
+        slot.lastTid.store(tid, std::memory_order_relaxed);
+        slot.cid.store(cid, std::memory_order_relaxed);
+        return 's';
+    }
+    return (slot.lastTid.exchange(tid, std::memory_order_relaxed) != tid) ? 't' : 0;
+}
+
+inline void traceFlow(ThreadTraceBuffer& buf, CorrelationId cid, int64_t ticks) {
+    if (cid == 0) return;
+    char phase = traceFlowPhase(cid, buf.tid);
+    if (!phase) return;
+
+    TraceEvent* ev = traceClaim(buf);
+    if (!ev) return;
+    ev->phase = phase;
+    ev->tid = buf.tid;
+    ev->ticks = ticks;
+    ev->durTicks = 0;
+    ev->cid = cid;
+    ev->spanId = 0;
+    ev->parentSpanId = 0;
+    ev->file = "";
+    ev->level = "";
+    ev->line = 0;
+    ev->name[0] = '\0';
+    tracePublish(buf);
+}
+
+inline void traceOnSectionExit(const SectionEvent& sec) {
+    if (!isTracing()) return;
+
+    ThreadTraceBuffer& buf = threadTraceBuffer();
+    TraceEvent* ev = traceClaim(buf);
+    if (ev) {
+        ev->phase = 'X';
+        ev->tid = buf.tid;
+        ev->ticks = sec.startTicks;
+        ev->durTicks = sec.endTicks - sec.startTicks;
+        ev->cid = sec.cid;
+        ev->spanId = sec.spanId;
+        ev->parentSpanId = sec.parentSpanId;
+        ev->file = sec.file;
+        ev->level = "";
+        ev->line = sec.line;
+        traceCopyName(*ev, sec.name);
+        tracePublish(buf);
+    }
+    traceFlow(buf, sec.cid, sec.startTicks);
+}
+
+inline void traceOnLog(const LogEvent& log, int64_t rawTime, const char* message) {
+    if (!isTracing()) return;
+
+    ThreadTraceBuffer& buf = threadTraceBuffer();
+    TraceEvent* ev = traceClaim(buf);
+    if (ev) {
+        ev->phase = 'i';
+        ev->tid = buf.tid;
+        ev->ticks = rawTime;
+        ev->durTicks = 0;
+        ev->cid = log.cid;
+        ev->spanId = log.spanId;
+        ev->parentSpanId = log.parentSpanId;
+        ev->file = log.file;
+        ev->level = log.level;
+        ev->line = log.line;
+        traceCopyName(*ev, message);
+        tracePublish(buf);
+    }
+    traceFlow(buf, log.cid, rawTime);
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+inline double traceMicros(int64_t ticks) {
+    return (double)ticksToNs(ticks) / 1000.0;
+}
+
+inline void appendTraceEvent(FormatBuffer& out, DWORD pid, const TraceEvent& ev) {
+    double ts = traceMicros(ev.ticks - clockState().origin.load(std::memory_order_relaxed));
+    char file[64];
+    if (ev.phase == 'X' || ev.phase == 'i') {
+        formatFilename(fileBasename(ev.file), 20, file, sizeof(file));
+    }
+
+    switch (ev.phase) {
+        case 'X':
+            out.append("{\"name\":\"");
+            appendJsonEscaped(out, ev.name);
+            out.appendf("\",\"cat\":\"section\",\"ph\":\"X\",\"ts\":%.3f,"
+                "\"dur\":%.3f,\"pid\":%lu,\"tid\":%lu,\"args\":{\"cid\":%llu,\"span\":%llu,"
+                "\"parent\":%llu,\"file\":\"",
+                ts, traceMicros(ev.durTicks),
+                (unsigned long)pid, (unsigned long)ev.tid, (unsigned long long)ev.cid,
+                (unsigned long long)ev.spanId, (unsigned long long)ev.parentSpanId);
+            appendJsonEscaped(out, file);
+            out.appendf("\",\"line\":%d}},\n", ev.line);
+            break;
+        case 'i':
+            out.append("{\"name\":\"");
+            appendJsonEscaped(out, ev.name);
+            out.appendf("\",\"cat\":\"log\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                "\"pid\":%lu,\"tid\":%lu,\"args\":{\"level\":\"%s\",\"cid\":%llu,\"span\":%llu,"
+                "\"file\":\"",
+                ts, (unsigned long)pid, (unsigned long)ev.tid,
+                ev.level, (unsigned long long)ev.cid, (unsigned long long)ev.spanId);
+            appendJsonEscaped(out, file);
+            out.appendf("\",\"line\":%d}},\n", ev.line);
+            break;
+        case 's':
+        case 't':
+            out.appendf("{\"name\":\"correlation\",\"cat\":\"cid\",\"ph\":\"%c\",\"id\":%llu,"
+                "\"ts\":%.3f,\"pid\":%lu,\"tid\":%lu,\"bp\":\"e\"},\n",
+                ev.phase, (unsigned long long)ev.cid, ts, (unsigned long)pid, (unsigned long)ev.tid);
+            break;
+    }
+}
+
+// Batches are written out whenever they pass this size
+constexpr size_t kTraceWriteBatch = 64 * 1024;
+
+// Drain every thread's ring. Only ever run by one thread at a time (the
+// writer thread, or stopTrace() after joining it).
+inline size_t drainTraceBuffers() {
+    TraceState& state = traceState();
+    if (!state.output) return 0;
+
+    DWORD pid = GetCurrentProcessId();
+    size_t count = 0;
+    ScopedFormatBuffer out;
+    for (ThreadTraceBuffer* buf = state.buffers.load(std::memory_order_acquire);
+         buf; buf = buf->next) {
+        uint32_t tail = buf->tail.load(std::memory_order_relaxed);
+        uint32_t head = buf->head.load(std::memory_order_acquire);
+        if (tail == head) continue;
+
+        if (!buf->announced) {
+            out->appendf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,"
+                "\"args\":{\"name\":\"thread %lu\"}},\n",
+                (unsigned long)pid, (unsigned long)buf->tid, (unsigned long)buf->tid);
+            buf->announced = true;
+        }
+        for (; tail != head; tail++) {
+            appendTraceEvent(*out, pid, buf->events[tail & buf->mask]);
+            count++;
+            if (out->length >= kTraceWriteBatch) {
+                fwrite(out->data, 1, out->length, state.output);
+                out->clear();
+            }
+        }
+        buf->tail.store(tail, std::memory_order_release);
+    }
+    if (out->length > 0) fwrite(out->data, 1, out->length, state.output);
+    if (count > 0) fflush(state.output);
+    return count;
+}
+
+inline uint64_t traceDroppedCount() {
+    uint64_t total = 0;
+    for (ThreadTraceBuffer* buf = traceState().buffers.load(std::memory_order_acquire);
+         buf; buf = buf->next) {
+        total += buf->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+inline DWORD WINAPI traceWriterMain(LPVOID) {
+    TraceState& state = traceState();
+    while (WaitForSingleObject(state.stopEvent, state.flushIntervalMs) == WAIT_TIMEOUT) {
+        drainTraceBuffers();
+    }
+    return 0;
+}
+
+/**
+ * Stop tracing: drain what's buffered, record the dropped-event count and
+ * close the JSON array. Registered with atexit by startTrace().
+ */
+inline void stopTrace() {
+    TraceState& state = traceState();
+    if (!state.running.exchange(false, std::memory_order_acq_rel)) return;
+
+    SetEvent(state.stopEvent);
+    WaitForSingleObject(state.writerThread, INFINITE);
+    CloseHandle(state.writerThread);
+    CloseHandle(state.stopEvent);
+    state.writerThread = nullptr;
+    state.stopEvent = nullptr;
+
+    drainTraceBuffers();
+
+    uint64_t dropped = traceDroppedCount();
+    fprintf(state.output, "{\"name\":\"trace_stats\",\"ph\":\"M\",\"pid\":%lu,"
+        "\"args\":{\"dropped_events\":%llu}}\n]\n",
+        (unsigned long)GetCurrentProcessId(),
+        (unsigned long long)(dropped - state.droppedWritten));
+    state.droppedWritten = dropped;
+    fclose(state.output);
+    state.output = nullptr;
+}
+
+/**
+ * Start streaming a trace to `path` (overwritten). eventsPerThread bounds
+ * each thread's ring (rounded up to a power of two, 256 bytes per event).
+ * Ring sizes are fixed when a thread first traces.
+ */
+inline bool startTrace(const char* path, uint32_t eventsPerThread = 2048,
+                       DWORD flushIntervalMs = 50) {
+    TraceState& state = traceState();
+    if (isTracing()) stopTrace();
+
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "[rippled_debug] Cannot open trace output: %s\n", path);
+        return false;
+    }
+    setvbuf(out, nullptr, _IOFBF, 64 * 1024);
+
+    char exe[MAX_PATH] = "";
+    GetModuleFileNameA(nullptr, exe, MAX_PATH);
+    fprintf(out, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,\"args\":{\"name\":\"%s\"}},\n",
+        (unsigned long)GetCurrentProcessId(), escapeJson(extractFilename(exe, MAX_PATH).c_str()).c_str());
+
+    state.output = out;
+    state.eventsPerThread = eventsPerThread ? eventsPerThread : 1;
+    state.flushIntervalMs = flushIntervalMs ? flushIntervalMs : 1;
+    state.droppedWritten = traceDroppedCount();
+
+    // Events already sitting in rings belong to an earlier trace
+    for (ThreadTraceBuffer* buf = state.buffers.load(std::memory_order_acquire);
+         buf; buf = buf->next) {
+        buf->tail.store(buf->head.load(std::memory_order_acquire), std::memory_order_release);
+        buf->announced = false;
+    }
+
+    state.stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    state.writerThread = state.stopEvent
+        ? CreateThread(nullptr, 0, traceWriterMain, nullptr, 0, nullptr) : nullptr;
+    if (!state.writerThread) {
+        fprintf(stderr, "[rippled_debug] Failed to start trace writer thread (error %lu)\n",
+            GetLastError());
+        if (state.stopEvent) CloseHandle(state.stopEvent);
+        state.stopEvent = nullptr;
+        fclose(out);
+        state.output = nullptr;
+        return false;
+    }
+
+    if (!state.observersAdded.exchange(true)) {
+        addSectionObserver(SectionObserver{nullptr, traceOnSectionExit});
+        addLogObserver(LogObserver{traceOnLog});
+        atexit(stopTrace);
+    }
+    state.running.store(true, std::memory_order_release);
+    return true;
+}
+
+} // namespace rippled_debug
+
+// ============================================================================
+// Convenience Macros
+// ============================================================================
+
+#define DEBUG_TRACE_START(path) \
+    rippled_debug::startTrace(path)
+
+#define DEBUG_TRACE_STOP() \
+    rippled_debug::stopTrace()
+
+#else // !_WIN32
+
+#define DEBUG_TRACE_START(path) ((void)0)
+#define DEBUG_TRACE_STOP() ((void)0)
+
+#endif // _WIN32
+
+#endif // RIPPLED_WINDOWS_DEBUG_TRACE_EXPORT_H
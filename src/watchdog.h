@@ -0,0 +1,319 @@
+/**
+ * @file watchdog.h
+ * @brief Stall watchdog driven by named heartbeats
+ *
+ * Crashes leave a report; stalls (a stuck ledger close, a job queue that
+ * stops draining) leave nothing. Loops that must keep making progress call
+ * DEBUG_HEARTBEAT(name), which costs one relaxed load and one relaxed store
+ * of GetTickCount64(), cheap enough for consensus loops. A watchdog thread
+ * checks the heartbeats; when one goes stale past its deadline it prints a
+ * stall report with every thread's stack (crash_handlers.h) and can write a
+ * small live minidump from a process snapshot (minidump.h), then waits for
+ * the heartbeat to recover before it can fire again.
+ *
+ * Usage:
+ *   DEBUG_WATCHDOG_START(30000);                  // default deadline 30s
+ *   rippled_debug::setWatchdogDump(true);         // ...and dump on a stall
+ *
+ *   while (running) {
+ *       DEBUG_HEARTBEAT("ledger_close");
+ *       ...
+ *   }
+ *   DEBUG_HEARTBEAT_DEADLINE("job_queue", 5000);  // own deadline
+ *   DEBUG_HEARTBEAT_IDLE("job_queue");            // not expected to beat
+ */
+
+#ifndef RIPPLED_WINDOWS_DEBUG_WATCHDOG_H
+#define RIPPLED_WINDOWS_DEBUG_WATCHDOG_H
+
+#ifdef _WIN32
+
+#include "crash_handlers.h"
+#include "minidump.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace rippled_debug {
+
+// ============================================================================
+// Heartbeats
+// ============================================================================
+
+// One static instance per DEBUG_HEARTBEAT expansion, constant-initialized so
+// the macro pays no guard check. Sites sharing a name are one heartbeat: it
+// is fresh while any of them beats.
+struct HeartbeatSite {
+    const char* name;
+    DWORD deadlineMs;                       // 0 = watchdog default
+
+    std::atomic<uint64_t> lastBeatMs{0};    // GetTickCount64(); 0 = idle
+    std::atomic<uint32_t> state{0};         // SITE_UNREGISTERED / SITE_READY
+    HeartbeatSite* next = nullptr;
+
+    constexpr HeartbeatSite(const char* n, DWORD deadline)
+        : name(n), deadlineMs(deadline) {}
+
+    inline void beat();
+};
+
+struct HeartbeatRegistry {
+    SRWLOCK lock = SRWLOCK_INIT;
+    HeartbeatSite* head = nullptr;
+};
+
+inline HeartbeatRegistry& heartbeatRegistry() {
+    static HeartbeatRegistry registry;
+    return registry;
+}
+
+// Slow path, once per site
+inline void registerHeartbeatSite(HeartbeatSite& site) {
+    HeartbeatRegistry& reg = heartbeatRegistry();
+    AcquireSRWLockExclusive(&reg.lock);
+    if (site.state.load(std::memory_order_relaxed) != SITE_READY) {
+        site.next = reg.head;
+        reg.head = &site;
+        site.state.store(SITE_READY, std::memory_order_release);
+    }
+    ReleaseSRWLockExclusive(&reg.lock);
+}
+
+// Hot path
+inline void HeartbeatSite::beat() {
+    if (state.load(std::memory_order_relaxed) != SITE_READY) {
+        registerHeartbeatSite(*this);
+    }
+    lastBeatMs.store(GetTickCount64(), std::memory_order_relaxed);
+}
+
+/**
+ * Mark a heartbeat idle (e.g. a queue that is legitimately empty) so the
+ * watchdog ignores it until its next beat.
+ */
+inline void heartbeatIdle(const char* name) {
+    HeartbeatRegistry& reg = heartbeatRegistry();
+    AcquireSRWLockShared(&reg.lock);
+    for (HeartbeatSite* site = reg.head; site; site = site->next) {
+        if (strcmp(site->name, name) == 0) {
+            site->lastBeatMs.store(0, std::memory_order_relaxed);
+        }
+    }
+    ReleaseSRWLockShared(&reg.lock);
+}
+
+// ============================================================================
+// Watchdog
+// ============================================================================
+
+struct WatchdogState {
+    std::atomic<bool> running{false};
+    DWORD defaultDeadlineMs = 30000;
+    DWORD checkIntervalMs = 1000;
+    std::atomic<bool> writeDump{false};
+    DumpTier dumpTier = DumpTier::SMALL;
+    HANDLE stopEvent = nullptr;
+    HANDLE thread = nullptr;
+
+    // Watchdog thread only: names currently reported as stalled
+    std::vector<std::string> stalled;
+};
+
+inline WatchdogState& watchdog() {
+    static WatchdogState state;
+    return state;
+}
+
+/**
+ * Also write a live minidump (process snapshot, the node keeps running)
+ * when a stall is detected. SMALL keeps it to stacks and thread state.
+ */
+inline void setWatchdogDump(bool enabled, DumpTier tier = DumpTier::SMALL) {
+    WatchdogState& w = watchdog();
+    w.dumpTier = tier;
+    w.writeDump.store(enabled, std::memory_order_relaxed);
+}
+
+struct HeartbeatStatus {
+    const char* name;
+    uint64_t lastBeatMs;    // Newest beat over all sites with this name
+    DWORD deadlineMs;       // Tightest explicit deadline, else the default
+};
+
+// Merge sites by name
+inline void collectHeartbeats(std::vector<HeartbeatStatus>& out, DWORD defaultDeadlineMs) {
+    out.clear();
+    HeartbeatRegistry& reg = heartbeatRegistry();
+    AcquireSRWLockShared(&reg.lock);
+    for (HeartbeatSite* site = reg.head; site; site = site->next) {
+        uint64_t beat = site->lastBeatMs.load(std::memory_order_relaxed);
+        HeartbeatStatus* status = nullptr;
+        for (HeartbeatStatus& existing : out) {
+            if (strcmp(existing.name, site->name) == 0) {
+                status = &existing;
+                break;
+            }
+        }
+        if (!status) {
+            out.push_back(HeartbeatStatus{site->name, 0, 0});
+            status = &out.back();
+        }
+        if (beat > status->lastBeatMs) status->lastBeatMs = beat;
+        if (site->deadlineMs && (!status->deadlineMs || site->deadlineMs < status->deadlineMs)) {
+            status->deadlineMs = site->deadlineMs;
+        }
+    }
+    ReleaseSRWLockShared(&reg.lock);
+
+    for (HeartbeatStatus& status : out) {
+        if (!status.deadlineMs) status.deadlineMs = defaultDeadlineMs;
+    }
+}
+
+inline bool isReportedStalled(const WatchdogState& w, const char* name) {
+    for (const std::string& stalled : w.stalled) {
+        if (stalled == name) return true;
+    }
+    return false;
+}
+
+/**
+ * One watchdog pass: report heartbeats that just went stale (one stall
+ * report for all of them) and note the ones that recovered.
+ * @return number of newly stalled heartbeats
+ */
+inline int checkHeartbeats() {
+    WatchdogState& w = watchdog();
+    std::vector<HeartbeatStatus> beats;
+    collectHeartbeats(beats, w.defaultDeadlineMs);
+    uint64_t now = GetTickCount64();
+
+    std::string reason;
+    int newlyStalled = 0;
+    for (const HeartbeatStatus& beat : beats) {
+        bool stale = beat.lastBeatMs != 0 && now > beat.lastBeatMs &&
+                     now - beat.lastBeatMs > beat.deadlineMs;
+        bool reported = isReportedStalled(w, beat.name);
+
+        if (stale && !reported) {
+            char line[160];
+            snprintf(line, sizeof(line), "heartbeat '%s' stale for %.1f s (deadline %.1f s)",
+                     beat.name, (now - beat.lastBeatMs) / 1000.0, beat.deadlineMs / 1000.0);
+            fprintf(stderr, "[WATCHDOG] Stall detected: %s\n", line);
+            if (!reason.empty()) reason += "; ";
+            reason += line;
+            w.stalled.push_back(beat.name);
+            newlyStalled++;
+        } else if (!stale && reported) {
+            fprintf(stderr, "[WATCHDOG] Heartbeat '%s' recovered\n", beat.name);
+            for (size_t i = 0; i < w.stalled.size(); i++) {
+                if (w.stalled[i] == beat.name) {
+                    w.stalled.erase(w.stalled.begin() + i);
+                    break;
+                }
+            }
+        }
+    }
+    fflush(stderr);
+
+    if (newlyStalled) {
+        printStallReport(reason.c_str());
+        if (w.writeDump.load(std::memory_order_relaxed)) {
+            writeLiveMinidump(w.dumpTier);
+        }
+    }
+    return newlyStalled;
+}
+
+inline DWORD WINAPI watchdogMain(LPVOID) {
+    WatchdogState& w = watchdog();
+    while (WaitForSingleObject(w.stopEvent, w.checkIntervalMs) == WAIT_TIMEOUT) {
+        checkHeartbeats();
+    }
+    return 0;
+}
+
+/**
+ * Start the watchdog thread. Calling it again while running only changes
+ * the default deadline and the check interval.
+ * @param defaultDeadlineMs Deadline for heartbeats without their own
+ * @param checkIntervalMs   How often heartbeats are checked
+ */
+inline bool startWatchdog(DWORD defaultDeadlineMs = 30000, DWORD checkIntervalMs = 1000) {
+    WatchdogState& w = watchdog();
+    w.defaultDeadlineMs = defaultDeadlineMs ? defaultDeadlineMs : 1;
+    w.checkIntervalMs = checkIntervalMs ? checkIntervalMs : 1;
+    if (w.running.load(std::memory_order_acquire)) return true;
+
+    w.stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!w.stopEvent) {
+        fprintf(stderr, "[rippled_debug] CreateEvent failed for watchdog (error %lu)\n",
+            GetLastError());
+        return false;
+    }
+    w.thread = CreateThread(nullptr, 0, watchdogMain, nullptr, 0, nullptr);
+    if (!w.thread) {
+        fprintf(stderr, "[rippled_debug] Failed to start watchdog thread (error %lu)\n",
+            GetLastError());
+        CloseHandle(w.stopEvent);
+        w.stopEvent = nullptr;
+        return false;
+    }
+    // Keep checking while the workers it watches saturate the CPU
+    SetThreadPriority(w.thread, THREAD_PRIORITY_ABOVE_NORMAL);
+    w.running.store(true, std::memory_order_release);
+
+    fprintf(stderr, "[WATCHDOG] Started (default deadline %.1f s, checking every %lu ms)\n",
+            w.defaultDeadlineMs / 1000.0, (unsigned long)w.checkIntervalMs);
+    fflush(stderr);
+    return true;
+}
+
+inline void stopWatchdog() {
+    WatchdogState& w = watchdog();
+    if (!w.running.exchange(false, std::memory_order_acq_rel)) return;
+
+    SetEvent(w.stopEvent);
+    WaitForSingleObject(w.thread, INFINITE);
+    CloseHandle(w.thread);
+    CloseHandle(w.stopEvent);
+    w.thread = nullptr;
+    w.stopEvent = nullptr;
+    w.stalled.clear();
+}
+
+} // namespace rippled_debug
+
+// Convenience macros
+#define DEBUG_HEARTBEAT(name) \
+    DEBUG_HEARTBEAT_DEADLINE(name, 0)
+
+#define DEBUG_HEARTBEAT_DEADLINE(name, deadlineMs) \
+    do { \
+        static rippled_debug::HeartbeatSite _rd_heartbeat_site(name, deadlineMs); \
+        _rd_heartbeat_site.beat(); \
+    } while (0)
+
+#define DEBUG_HEARTBEAT_IDLE(name) \
+    rippled_debug::heartbeatIdle(name)
+
+#define DEBUG_WATCHDOG_START(deadlineMs) \
+    rippled_debug::startWatchdog(deadlineMs)
+
+#define DEBUG_WATCHDOG_STOP() \
+    rippled_debug::stopWatchdog()
+
+#else // !_WIN32
+
+#define DEBUG_HEARTBEAT(name) ((void)0)
+#define DEBUG_HEARTBEAT_DEADLINE(name, deadlineMs) ((void)0)
+#define DEBUG_HEARTBEAT_IDLE(name) ((void)0)
+#define DEBUG_WATCHDOG_START(deadlineMs) ((void)0)
+#define DEBUG_WATCHDOG_STOP() ((void)0)
+
+#endif // _WIN32
+
+#endif // RIPPLED_WINDOWS_DEBUG_WATCHDOG_H
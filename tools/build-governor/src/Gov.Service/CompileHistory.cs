@@ -0,0 +1,234 @@
+using System.Text.Json;
+using Gov.Protocol;
+
+namespace Gov.Service;
+
+/// <summary>
+/// Persistent per-translation-unit history of duration and peak commit, as
+/// measured by the wrappers and reported on release. The token pool uses it
+/// to size token costs and to grant the longest jobs first.
+/// </summary>
+public sealed class CompileHistory
+{
+    // Entries not seen for this long are dropped on load (renamed/deleted files)
+    private static readonly TimeSpan RetentionPeriod = TimeSpan.FromDays(30);
+
+    // Weight of the newest run in the duration average
+    private const double DurationSmoothing = 0.3;
+
+    // Per-run decay of the remembered peak, so a TU that got lighter recovers
+    private const double PeakDecay = 0.9;
+
+    private static readonly JsonSerializerOptions JsonOptions = new()
+    {
+        PropertyNamingPolicy = JsonNamingPolicy.CamelCase,
+        PropertyNameCaseInsensitive = true,
+        WriteIndented = true
+    };
+
+    private readonly object _gate = new();
+    private readonly Dictionary<string, CompileRecord> _records = new(StringComparer.OrdinalIgnoreCase);
+    private readonly string _path;
+    private bool _dirty;
+    private int _typicalDurationMs;
+
+    public CompileHistory(string? path = null)
+    {
+        _path = path ?? DefaultPath;
+        Load();
+    }
+
+    /// <summary>
+    /// %LOCALAPPDATA%\BuildGovernor\compile-history.json, or GOV_HISTORY_PATH.
+    /// </summary>
+    public static string DefaultPath
+    {
+        get
+        {
+            var env = Environment.GetEnvironmentVariable("GOV_HISTORY_PATH");
+            if (!string.IsNullOrEmpty(env)) return env;
+
+            return Path.Combine(
+                Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData),
+                "BuildGovernor", "compile-history.json");
+        }
+    }
+
+    public string FilePath => _path;
+
+    public int Count
+    {
+        get { lock (_gate) return _records.Count; }
+    }
+
+    /// <summary>
+    /// History key: the source file for compiles, else tool + command-line hash.
+    /// </summary>
+    public static string? KeyFor(string tool, string? sourceFile, string? argsHash)
+    {
+        if (!string.IsNullOrEmpty(sourceFile))
+        {
+            try
+            {
+                return Path.GetFullPath(sourceFile);
+            }
+            catch
+            {
+                return sourceFile;
+            }
+        }
+
+        return string.IsNullOrEmpty(argsHash) ? null : $"{tool}:{argsHash}";
+    }
+
+    public CompileRecord? Lookup(string? key)
+    {
+        if (key == null) return null;
+        lock (_gate)
+        {
+            return _records.TryGetValue(key, out var record) ? record : null;
+        }
+    }
+
+    /// <summary>
+    /// Expected duration for scheduling: the TU's own average, or the median
+    /// of known TUs for one never seen (0 with no history).
+    /// </summary>
+    public int PredictDurationMs(string? key)
+    {
+        var record = Lookup(key);
+        if (record != null && record.Samples > 0) return (int)record.DurationMs;
+        lock (_gate) return _typicalDurationMs;
+    }
+
+    /// <summary>
+    /// Add one run. Successful runs update duration and peak; OOM-classified
+    /// failures only raise the peak (they died early, so their duration is not
+    /// representative, but the memory they reached is a lower bound).
+    /// </summary>
+    public void Record(string? key, int durationMs, long peakCommitBytes, FailureClassification classification)
+    {
+        if (key == null) return;
+
+        var success = classification == FailureClassification.Success;
+        var oom = classification is FailureClassification.LikelyOOM or FailureClassification.LikelyPagingDeath;
+        if (!success && !oom) return;
+
+        lock (_gate)
+        {
+            _records.TryGetValue(key, out var old);
+
+            var duration = old?.DurationMs ?? 0;
+            if (success)
+            {
+                duration = (old == null || old.Samples == 0)
+                    ? durationMs
+                    : old.DurationMs + DurationSmoothing * (durationMs - old.DurationMs);
+            }
+
+            var peak = Math.Max(peakCommitBytes, (long)((old?.PeakCommitBytes ?? 0) * PeakDecay));
+
+            _records[key] = new CompileRecord
+            {
+                DurationMs = duration,
+                PeakCommitBytes = peak,
+                Samples = (old?.Samples ?? 0) + (success ? 1 : 0),
+                OomCount = (old?.OomCount ?? 0) + (oom ? 1 : 0),
+                LastSeen = DateTime.UtcNow
+            };
+            _dirty = true;
+        }
+    }
+
+    /// <summary>
+    /// The heaviest entries by duration, for reports.
+    /// </summary>
+    public List<KeyValuePair<string, CompileRecord>> Heaviest(int count)
+    {
+        lock (_gate)
+        {
+            return _records
+                .OrderByDescending(r => r.Value.DurationMs)
+                .Take(count)
+                .ToList();
+        }
+    }
+
+    /// <summary>
+    /// Write the history if it changed. The file is replaced atomically so a
+    /// crash mid-write keeps the previous version.
+    /// </summary>
+    public void SaveIfDirty()
+    {
+        Dictionary<string, CompileRecord> snapshot;
+        lock (_gate)
+        {
+            if (!_dirty) return;
+            snapshot = new Dictionary<string, CompileRecord>(_records, StringComparer.OrdinalIgnoreCase);
+            _dirty = false;
+            _typicalDurationMs = MedianDuration(snapshot.Values);
+        }
+
+        try
+        {
+            Directory.CreateDirectory(Path.GetDirectoryName(_path)!);
+            var tempPath = _path + ".tmp";
+            var file = new HistoryFile { Version = 1, Records = snapshot };
+            File.WriteAllText(tempPath, JsonSerializer.Serialize(file, JsonOptions));
+            File.Move(tempPath, _path, overwrite: true);
+        }
+        catch (Exception ex)
+        {
+            Console.WriteLine($"[{DateTime.Now:HH:mm:ss}] WARNING: Could not save compile history to {_path}: {ex.Message}");
+            lock (_gate) _dirty = true;
+        }
+    }
+
+    private void Load()
+    {
+        try
+        {
+            if (!File.Exists(_path)) return;
+
+            var file = JsonSerializer.Deserialize<HistoryFile>(File.ReadAllText(_path), JsonOptions);
+            if (file?.Records == null) return;
+
+            var cutoff = DateTime.UtcNow - RetentionPeriod;
+            foreach (var (key, record) in file.Records)
+            {
+                if (record.LastSeen >= cutoff)
+                    _records[key] = record;
+                else
+                    _dirty = true;
+            }
+            _typicalDurationMs = MedianDuration(_records.Values);
+        }
+        catch (Exception ex)
+        {
+            // A corrupt history only costs the scheduling hints; start over
+            Console.WriteLine($"[{DateTime.Now:HH:mm:ss}] WARNING: Ignoring unreadable compile history {_path}: {ex.Message}");
+            _records.Clear();
+        }
+    }
+
+    private static int MedianDuration(IEnumerable<CompileRecord> records)
+    {
+        var durations = records.Where(r => r.Samples > 0).Select(r => r.DurationMs).OrderBy(d => d).ToList();
+        return durations.Count == 0 ? 0 : (int)durations[durations.Count / 2];
+    }
+
+    private sealed record HistoryFile
+    {
+        public int Version { get; init; }
+        public Dictionary<string, CompileRecord>? Records { get; init; }
+    }
+}
+
+public sealed record CompileRecord
+{
+    public double DurationMs { get; init; }         // Smoothed over successful runs
+    public long PeakCommitBytes { get; init; }      // Decaying maximum
+    public int Samples { get; init; }               // Successful runs recorded
+    public int OomCount { get; init; }              // Runs classified as OOM
+    public DateTime LastSeen { get; init; }
+}
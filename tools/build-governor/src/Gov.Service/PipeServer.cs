@@ -125,7 +125,8 @@ public sealed class PipeServer : IAsyncDisposable
         var result = await _tokenPool.TryAcquireAsync(
             req.Tool,
             req.RequestedTokens,
-            req.TimeoutMs);
+            req.TimeoutMs,
+            CompileHistory.KeyFor(req.Tool, req.SourceFile, req.ArgsHash));
 
         var response = new AcquireTokensResponse
         {
@@ -139,7 +140,9 @@ public sealed class PipeServer : IAsyncDisposable
 
         if (result.Success)
         {
-            Console.WriteLine($"[{DateTime.Now:HH:mm:ss}] ACQUIRE {req.Tool} tokens={result.GrantedTokens} lease={result.LeaseId} commit={result.CommitRatio:P0}");
+            var source = req.SourceFile != null ? $" src={Path.GetFileName(req.SourceFile)}" : "";
+            var predicted = result.PredictedDurationMs is int ms ? $" predicted={ms / 1000.0:F1}s" : "";
+            Console.WriteLine($"[{DateTime.Now:HH:mm:ss}] ACQUIRE {req.Tool} tokens={result.GrantedTokens} lease={result.LeaseId} commit={result.CommitRatio:P0}{source}{predicted}");
         }
         else
         {
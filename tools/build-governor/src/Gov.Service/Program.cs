@@ -68,7 +68,10 @@ var config = new TokenBudgetConfig
     HardStopRatio = 0.92
 };
 
-using var tokenPool = new TokenPool(config);
+// Per-TU compile history: token sizing and longest-job-first scheduling
+var history = new CompileHistory();
+
+using var tokenPool = new TokenPool(config, history);
 var status = tokenPool.GetStatus();
 
 if (!isQuiet)
@@ -77,6 +80,7 @@ if (!isQuiet)
     Console.WriteLine($"  Total tokens:    {status.TotalTokens}");
     Console.WriteLine($"  Throttle level:  {status.ThrottleLevel}");
     Console.WriteLine($"  Recommended -j:  {status.RecommendedParallelism}");
+    Console.WriteLine($"  History:         {history.Count} jobs ({history.FilePath})");
     Console.WriteLine();
 }
 
@@ -6,6 +6,9 @@ namespace Gov.Service;
 /// <summary>
 /// Manages the token pool for build tool concurrency control.
 /// Includes lease TTL for automatic reclamation if wrappers crash.
+/// With a compile history, token costs come from each TU's measured peak
+/// commit, and when tokens are scarce waiting requests are granted longest
+/// predicted job first. Waiters wake on release instead of polling.
 /// </summary>
 public sealed class TokenPool : IDisposable
 {
@@ -14,20 +17,38 @@ public sealed class TokenPool : IDisposable
     private readonly SemaphoreSlim _lock = new(1, 1);
     private readonly PeriodicTimer _monitorTimer;
     private readonly CancellationTokenSource _cts = new();
+    private readonly CompileHistory? _history;
+    private readonly List<Waiter> _waiters = [];    // Guarded by _lock
+
+    // Completed (and replaced) whenever tokens may have become available
+    private TaskCompletionSource _poolChanged = NewPoolChangedSignal();   // Guarded by _lock
 
     // Lease TTL: if not released within this time, tokens are reclaimed
     private static readonly TimeSpan LeaseTimeout = TimeSpan.FromMinutes(30);
     private static readonly TimeSpan LeaseWarningThreshold = TimeSpan.FromMinutes(10);
 
+    // Extra commit reserved above a TU's recorded peak when sizing its tokens
+    private const double HistoryCommitHeadroom = 1.25;
+
+    // Waiting raises a request's priority by this much per ms waited, so short
+    // jobs still get tokens well before the wrappers' acquire timeout
+    internal const double WaitAging = 2.0;
+
+    // History is written at most this often while leases are active
+    private static readonly TimeSpan HistorySaveInterval = TimeSpan.FromSeconds(10);
+
     private int _totalTokens;
     private int _availableTokens;
     private MemoryStatus _lastMemoryStatus;
     private ThrottleLevel _throttleLevel;
     private int _expiredLeaseCount;
+    private long _waiterSequence;
+    private DateTime _lastHistorySave = DateTime.UtcNow;
 
-    public TokenPool(TokenBudgetConfig? config = null)
+    public TokenPool(TokenBudgetConfig? config = null, CompileHistory? history = null)
     {
         _config = config ?? new TokenBudgetConfig();
+        _history = history;
         _lastMemoryStatus = WindowsMemoryMetrics.GetMemoryStatus();
         RecalculateBudget();
 
@@ -42,20 +63,65 @@ public sealed class TokenPool : IDisposable
     public int ExpiredLeaseCount => _expiredLeaseCount;
     public MemoryStatus LastMemoryStatus => _lastMemoryStatus;
     public ThrottleLevel ThrottleLevel => _throttleLevel;
+    public CompileHistory? History => _history;
 
     /// <summary>
     /// Try to acquire tokens for a build operation.
+    /// historyKey (see <see cref="CompileHistory.KeyFor"/>) identifies the job
+    /// for token sizing and longest-job-first ordering.
     /// </summary>
     public async Task<TokenAcquireResult> TryAcquireAsync(
         string tool,
         int requestedTokens,
         int timeoutMs,
+        string? historyKey = null,
         CancellationToken ct = default)
     {
         var deadline = DateTime.UtcNow.AddMilliseconds(timeoutMs);
 
+        // Measured peak commit beats the wrapper's command-line estimate
+        var record = _history?.Lookup(historyKey);
+        if (record != null && record.PeakCommitBytes > 0)
+            requestedTokens = TokensForCommit(record.PeakCommitBytes);
+        var predictedMs = _history?.PredictDurationMs(historyKey) ?? 0;
+
+        var waiter = new Waiter
+        {
+            PredictedMs = predictedMs,
+            RequestedTokens = requestedTokens,
+            EnqueuedAt = DateTime.UtcNow,
+            Sequence = Interlocked.Increment(ref _waiterSequence)
+        };
+
+        await _lock.WaitAsync(ct);
+        _waiters.Add(waiter);
+        _lock.Release();
+
+        try
+        {
+            return await AcquireLoopAsync(tool, requestedTokens, historyKey, waiter, deadline, ct);
+        }
+        finally
+        {
+            // Whoever was queued behind this request may now go first
+            await _lock.WaitAsync(CancellationToken.None);
+            _waiters.Remove(waiter);
+            SignalPoolChanged();
+            _lock.Release();
+        }
+    }
+
+    private async Task<TokenAcquireResult> AcquireLoopAsync(
+        string tool,
+        int requestedTokens,
+        string? historyKey,
+        Waiter waiter,
+        DateTime deadline,
+        CancellationToken ct)
+    {
         while (DateTime.UtcNow < deadline && !ct.IsCancellationRequested)
         {
+            Task poolChanged;
             await _lock.WaitAsync(ct);
             try
             {
@@ -74,9 +140,11 @@ public sealed class TokenPool : IDisposable
                     };
                 }
 
-                // Try to grant tokens
+                // Try to grant tokens. While tokens are scarce the longest
+                // predicted job goes first, so the slowest TUs don't start last
+                // and stretch the tail of the build.
                 var grantedTokens = Math.Min(requestedTokens, _availableTokens);
-                if (grantedTokens > 0 || requestedTokens == 0)
+                if ((grantedTokens > 0 || requestedTokens == 0) && MayGrant(waiter))
                 {
                     var leaseId = Guid.NewGuid().ToString("N")[..12];
                     var lease = new Lease
@@ -86,7 +154,8 @@ public sealed class TokenPool : IDisposable
                         Tokens = grantedTokens,
                         AcquiredAt = DateTime.UtcNow,
                         ExpiresAt = DateTime.UtcNow + LeaseTimeout,
-                        CommitRatioAtAcquire = _lastMemoryStatus.CommitRatio
+                        CommitRatioAtAcquire = _lastMemoryStatus.CommitRatio,
+                        HistoryKey = historyKey
                     };
 
                     _activeLeases[leaseId] = lease;
@@ -98,16 +167,20 @@ public sealed class TokenPool : IDisposable
                         LeaseId = leaseId,
                         GrantedTokens = grantedTokens,
                         RecommendedParallelism = CalculateRecommendedParallelism(),
-                        CommitRatio = _lastMemoryStatus.CommitRatio
+                        CommitRatio = _lastMemoryStatus.CommitRatio,
+                        PredictedDurationMs = waiter.PredictedMs > 0 ? waiter.PredictedMs : null
                     };
                 }
+
+                poolChanged = _poolChanged.Task;
             }
             finally
             {
                 _lock.Release();
             }
 
-            // Wait before retry (with backoff based on throttle level)
+            // Wait for a release or budget change; the timeout (backoff based
+            // on throttle level) only catches memory freed outside the pool
             var delay = _throttleLevel switch
             {
                 ThrottleLevel.SoftStop => 500,
@@ -115,7 +188,14 @@ public sealed class TokenPool : IDisposable
                 _ => 100
             };
 
-            await Task.Delay(delay, ct);
+            var remainingMs = (int)Math.Max(0, (deadline - DateTime.UtcNow).TotalMilliseconds);
+            try
+            {
+                await poolChanged.WaitAsync(TimeSpan.FromMilliseconds(Math.Min(delay, remainingMs)), ct);
+            }
+            catch (TimeoutException)
+            {
+            }
         }
 
         return new TokenAcquireResult
@@ -146,6 +226,7 @@ public sealed class TokenPool : IDisposable
             }
 
             _availableTokens += lease.Tokens;
+            SignalPoolChanged();
 
             // Get current memory status for classification
             _lastMemoryStatus = WindowsMemoryMetrics.GetMemoryStatus();
@@ -165,6 +246,7 @@ public sealed class TokenPool : IDisposable
             };
 
             var classification = FailureClassifier.Classify(classificationInput);
+            _history?.Record(lease.HistoryKey, durationMs, peakCommitBytes, classification.Classification);
 
             return new TokenReleaseResult
             {
@@ -217,9 +299,53 @@ public sealed class TokenPool : IDisposable
         var budget = WindowsMemoryMetrics.CalculateTokenBudget(_lastMemoryStatus, _config);
 
         var usedTokens = _totalTokens - _availableTokens;
+        var previousAvailable = _availableTokens;
         _totalTokens = budget.TotalTokens;
         _availableTokens = Math.Max(0, _totalTokens - usedTokens);
         _throttleLevel = budget.ThrottleLevel;
+
+        if (_availableTokens > previousAvailable) SignalPoolChanged();
+    }
+
+    private static TaskCompletionSource NewPoolChangedSignal() =>
+        new(TaskCreationOptions.RunContinuationsAsynchronously);
+
+    // Caller holds _lock (or is the constructor). Wakes every waiter to
+    // re-check the pool.
+    private void SignalPoolChanged()
+    {
+        var signal = _poolChanged;
+        _poolChanged = NewPoolChangedSignal();
+        signal.TrySetResult();
+    }
+
+    private int TokensForCommit(long peakCommitBytes)
+    {
+        var gb = peakCommitBytes / (1024.0 * 1024 * 1024) * HistoryCommitHeadroom;
+        return Math.Clamp((int)Math.Ceiling(gb / _config.GbPerToken), 1, _config.MaxTokens);
+    }
+
+    // Caller holds _lock. Ordering only matters when the free tokens can't
+    // cover everyone ahead of this waiter too: then only the head of the
+    // line is served (possibly with fewer tokens than it asked for).
+    private bool MayGrant(Waiter waiter)
+    {
+        var now = DateTime.UtcNow;
+        var priority = waiter.Priority(now);
+        var tokensAhead = 0;
+        var waitersAhead = 0;
+        foreach (var other in _waiters)
+        {
+            if (other == waiter) continue;
+            var otherPriority = other.Priority(now);
+            if (otherPriority > priority ||
+                (otherPriority == priority && other.Sequence < waiter.Sequence))
+            {
+                tokensAhead += other.RequestedTokens;
+                waitersAhead++;
+            }
+        }
+        return waitersAhead == 0 || tokensAhead + waiter.RequestedTokens <= _availableTokens;
     }
 
     private int CalculateRecommendedParallelism()
@@ -261,6 +387,7 @@ public sealed class TokenPool : IDisposable
             {
                 _availableTokens += lease.Tokens;
                 _expiredLeaseCount++;
+                SignalPoolChanged();
                 Console.WriteLine($"[{DateTime.Now:HH:mm:ss}] EXPIRED: Lease {id} ({lease.Tool}) reclaimed {lease.Tokens} tokens");
             }
         }
@@ -285,6 +412,14 @@ public sealed class TokenPool : IDisposable
                 {
                     _lock.Release();
                 }
+
+                // Save as soon as a build goes idle, periodically during one
+                if (_history != null &&
+                    (_activeLeases.IsEmpty || DateTime.UtcNow - _lastHistorySave >= HistorySaveInterval))
+                {
+                    _history.SaveIfDirty();
+                    _lastHistorySave = DateTime.UtcNow;
+                }
             }
             catch (OperationCanceledException)
             {
@@ -296,6 +431,7 @@ public sealed class TokenPool : IDisposable
     public void Dispose()
     {
         _cts.Cancel();
+        _history?.SaveIfDirty();
         _monitorTimer.Dispose();
         _lock.Dispose();
         _cts.Dispose();
@@ -310,9 +446,21 @@ public sealed record Lease
     public required DateTime AcquiredAt { get; init; }
     public required DateTime ExpiresAt { get; init; }
     public required double CommitRatioAtAcquire { get; init; }
+    public string? HistoryKey { get; init; }
     public bool WarningLogged { get; set; }
 }
 
+internal sealed class Waiter
+{
+    public required int PredictedMs { get; init; }
+    public required int RequestedTokens { get; init; }
+    public required DateTime EnqueuedAt { get; init; }
+    public required long Sequence { get; init; }
+
+    public double Priority(DateTime now) =>
+        PredictedMs + TokenPool.WaitAging * (now - EnqueuedAt).TotalMilliseconds;
+}
+
 public sealed record TokenAcquireResult
 {
     public required bool Success { get; init; }
@@ -321,6 +469,7 @@ public sealed record TokenAcquireResult
     public required int RecommendedParallelism { get; init; }
     public string? Reason { get; init; }
     public double CommitRatio { get; init; }
+    public int? PredictedDurationMs { get; init; }
 }
 
 public sealed record TokenReleaseResult
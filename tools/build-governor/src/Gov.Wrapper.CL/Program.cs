@@ -16,6 +16,12 @@ var tokenCost = EstimateTokenCost(args);
 var argsHash = ComputeArgsHash(args);
 var sourceFile = GetSourceFile(args);
 
+// Absolute, so the governor's per-TU history matches across build directories
+if (sourceFile != null)
+{
+    try { sourceFile = Path.GetFullPath(sourceFile); } catch { }
+}
+
 // Try to connect to governor (fail-safe: if unavailable, run ungoverned)
 using var client = new GovernorClient();
 var connected = client.TryConnect();
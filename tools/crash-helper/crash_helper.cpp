@@ -0,0 +1,20 @@
+/**
+ * @file crash_helper.cpp
+ * @brief Out-of-process minidump writer for minidump.h
+ *
+ * Launched by installMinidumpHandler(dumpDir, "crash_helper.exe"). Waits on
+ * the client's pre-created crash event and writes the dump from outside the
+ * crashing process, then exits when the client does.
+ *
+ * Build:
+ *   cl /EHsc /O2 /utf-8 crash_helper.cpp /link dbghelp.lib cabinet.lib
+ *
+ * Run (normally done by the client):
+ *   crash_helper --pid <process id> --dir <dump directory>
+ */
+
+#include "../../src/minidump.h"
+
+int wmain(int argc, wchar_t* argv[]) {
+    return rippled_debug::crashHelperMain(argc, argv);
+}
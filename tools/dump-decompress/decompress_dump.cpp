@@ -0,0 +1,39 @@
+/**
+ * @file decompress_dump.cpp
+ * @brief Expand a compressed .dmp.rdz minidump for WinDbg / Visual Studio
+ *
+ * Dumps written with setDumpCompression(true) are streamed through the
+ * Windows Compression API into a chunked .dmp.rdz container. This restores
+ * the original .dmp byte for byte.
+ *
+ * Build:
+ *   cl /EHsc /O2 /utf-8 decompress_dump.cpp /link dbghelp.lib cabinet.lib
+ *
+ * Run:
+ *   decompress_dump input.dmp.rdz [output.dmp]
+ */
+
+#include "../../src/minidump.h"
+
+int wmain(int argc, wchar_t* argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: decompress_dump input.dmp.rdz [output.dmp]\n");
+        return 2;
+    }
+
+    std::wstring input = argv[1];
+    std::wstring output;
+    if (argc == 3) {
+        output = argv[2];
+    } else if (input.size() > 4 && input.compare(input.size() - 4, 4, L".rdz") == 0) {
+        output = input.substr(0, input.size() - 4);
+    } else {
+        output = input + L".dmp";
+    }
+
+    if (!rippled_debug::decompressDumpFile(input.c_str(), output.c_str())) {
+        return 1;
+    }
+    fprintf(stderr, "Wrote %ls\n", output.c_str());
+    return 0;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file trigger_dump.cpp
+ * @brief Ask a running rippled for a live (snapshot) minidump
+ *
+ * Signals the Local\rippled_dump_<pid> event created by
+ * installLiveDumpTrigger(). The process snapshots itself and writes the dump
+ * to its usual dump directory without being suspended or debugged.
+ *
+ * Build:
+ *   cl /EHsc /O2 /utf-8 trigger_dump.cpp /link dbghelp.lib cabinet.lib
+ *
+ * Run:
+ *   trigger_dump <process id>
+ */
+
+#include "../../src/minidump.h"
+
+int wmain(int argc, wchar_t* argv[]) {
+    DWORD pid = argc == 2 ? (DWORD)wcstoul(argv[1], nullptr, 10) : 0;
+    if (pid == 0) {
+        fprintf(stderr, "Usage: trigger_dump <process id>\n");
+        return 2;
+    }
+
+    wchar_t name[64];
+    rippled_debug::liveDumpEventName(name, 64, pid);
+    HANDLE event = OpenEventW(EVENT_MODIFY_STATE, FALSE, name);
+    if (!event) {
+        fprintf(stderr, "No live dump trigger for process %lu (installLiveDumpTrigger not called?). Error: %lu\n",
+                (unsigned long)pid, GetLastError());
+        return 1;
+    }
+
+    BOOL signaled = SetEvent(event);
+    CloseHandle(event);
+    if (!signaled) {
+        fprintf(stderr, "Failed to signal %ls. Error: %lu\n", name, GetLastError());
+        return 1;
+    }
+    fprintf(stderr, "Live dump requested from process %lu; see its dump directory\n", (unsigned long)pid);
+    return 0;
+}
@@ -0,0 +1,678 @@
+/**
+ * @file decode_log.cpp
+ * @brief Offline decoder for LogFormat::BINARY streams
+ *
+ * Rebuilds Rich, TEXT or JSON output from a binary log written by
+ * debug_log.h. Portable C++17 - decode on Windows or on a Linux box.
+ *
+ * Build:
+ *   cl /EHsc /O2 /utf-8 decode_log.cpp
+ *   g++ -std=c++17 -O2 decode_log.cpp -o decode_log
+ *
+ * Run:
+ *   decode_log [--format rich|text|json] [--no-delta] [--width N] input.rdbl [output]
+ *   decode_log crash.dmp             # flight recorder embedded in a minidump
+ *
+ * Raw text records (banners, section boxes) are skipped in JSON output so
+ * every line stays parseable. Compressed dumps (.dmp.rdz) must be expanded
+ * with tools/dump-decompress first.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../src/binary_log_format.h"
+
+using namespace rippled_debug;
+
+namespace {
+
+// ============================================================================
+// Output options (mirror LogConfig)
+// ============================================================================
+
+enum class OutFormat { RICH, TEXT, JSON };
+
+struct Options {
+    OutFormat format = OutFormat::RICH;
+    bool includeDeltaTime = true;
+    int boxWidth = 76;
+};
+
+// Same palette as debug_log.h
+namespace colors {
+    const char* RESET        = "\033[0m";
+    const char* LVL_DEBUG    = "\033[38;5;244m";
+    const char* LVL_INFO     = "\033[38;5;39m";
+    const char* LVL_WARN     = "\033[38;5;214m";
+    const char* LVL_ERROR    = "\033[38;5;196m";
+    const char* LVL_CRITICAL = "\033[38;5;196m\033[1m";
+    const char* TIMESTAMP    = "\033[38;5;242m";
+    const char* DELTA        = "\033[38;5;240m";
+    const char* LOCATION     = "\033[38;5;245m";
+}
+
+// ============================================================================
+// Stream reading
+// ============================================================================
+
+struct Header {
+    uint64_t qpcFrequency = 10000000;
+    uint64_t qpcOrigin = 0;
+    uint64_t wallOrigin = 0;
+    uint32_t pid = 0;
+};
+
+struct Site {
+    uint32_t line = 0;
+    std::vector<uint8_t> argTypes;
+    std::string level;
+    std::string file;
+    std::string fmt;
+};
+
+class Reader {
+public:
+    explicit Reader(FILE* f) : file_(f) {}
+
+    bool read(void* dst, size_t len) {
+        return fread(dst, 1, len, file_) == len;
+    }
+
+    template <typename T>
+    bool get(T& value) { return read(&value, sizeof(value)); }
+
+    bool getString(std::string& out) {
+        uint16_t len;
+        if (!get(len)) return false;
+        out.resize(len);
+        return len == 0 || read(&out[0], len);
+    }
+
+private:
+    FILE* file_;
+};
+
+// Cursor over an 'L' payload
+struct Payload {
+    const uint8_t* data;
+    size_t length;
+    size_t pos = 0;
+
+    template <typename T>
+    bool get(T& value) {
+        if (pos + sizeof(T) > length) return false;
+        memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool getString(std::string& out) {
+        uint16_t len;
+        if (!get(len) || pos + len > length) return false;
+        out.assign((const char*)data + pos, len);
+        pos += len;
+        return true;
+    }
+};
+
+// ============================================================================
+// Deferred printf
+// ============================================================================
+
+// Rebuild one conversion spec with '*' values substituted and length
+// modifiers normalised for the decoding platform.
+std::string rebuildSpec(const char* start, const char* end, const int* stars, char lengthMod) {
+    std::string spec = "%";
+    const char* p = start;
+    int star = 0;
+
+    while (p < end && strchr("-+ #0'", *p)) spec += *p++;
+
+    if (p < end && *p == '*') { spec += std::to_string(stars[star++]); p++; }
+    else while (p < end && *p >= '0' && *p <= '9') spec += *p++;
+
+    if (p < end && *p == '.') {
+        p++;
+        if (p < end && *p == '*') {
+            if (stars[star] >= 0) spec += "." + std::to_string(stars[star]);
+            star++;
+            p++;
+        } else {
+            spec += '.';
+            while (p < end && *p >= '0' && *p <= '9') spec += *p++;
+        }
+    }
+
+    if (lengthMod == 'L') spec += "ll";
+    spec += end[-1];
+    return spec;
+}
+
+std::string formatMessage(const Site& site, Payload payload) {
+    std::string out;
+    char buf[1024];
+    size_t argIndex = 0;
+
+    for (const char* p = site.fmt.c_str(); *p; ) {
+        if (*p != '%') {
+            out += *p++;
+            continue;
+        }
+
+        const char* specStart = ++p;
+        binlog::FormatSpec spec;
+        p = binlog::parseFormatSpec(p, spec);
+        if (spec.conversion == '%') {
+            out += '%';
+            continue;
+        }
+
+        int stars[2] = {0, -1};
+        bool ok = true;
+        for (int i = 0; i < spec.starCount && ok; i++) {
+            int32_t v = 0;
+            ok = argIndex < site.argTypes.size() && payload.get(v);
+            stars[i] = v;
+            argIndex++;
+        }
+        if (!ok || argIndex >= site.argTypes.size()) {
+            out += "<?>";
+            continue;
+        }
+
+        uint8_t type = site.argTypes[argIndex++];
+        switch (type) {
+            case binlog::ARG_INT32:
+            case binlog::ARG_INT64: {
+                long long value = 0;
+                if (type == binlog::ARG_INT32) {
+                    int32_t v;
+                    if (!payload.get(v)) { out += "<?>"; continue; }
+                    value = spec.isSigned ? (long long)v : (long long)(uint32_t)v;
+                } else {
+                    int64_t v;
+                    if (!payload.get(v)) { out += "<?>"; continue; }
+                    value = v;
+                }
+                if (spec.conversion == 'c') {
+                    snprintf(buf, sizeof(buf), rebuildSpec(specStart, p, stars, 0).c_str(), (int)value);
+                } else {
+                    snprintf(buf, sizeof(buf), rebuildSpec(specStart, p, stars, 'L').c_str(), value);
+                }
+                out += buf;
+                break;
+            }
+            case binlog::ARG_DOUBLE: {
+                double v;
+                if (!payload.get(v)) { out += "<?>"; continue; }
+                snprintf(buf, sizeof(buf), rebuildSpec(specStart, p, stars, 0).c_str(), v);
+                out += buf;
+                break;
+            }
+            case binlog::ARG_POINTER: {
+                uint64_t v;
+                if (!payload.get(v)) { out += "<?>"; continue; }
+                // Match the MSVC %p rendering
+                snprintf(buf, sizeof(buf), "%016llX", (unsigned long long)v);
+                out += buf;
+                break;
+            }
+            case binlog::ARG_STRING: {
+                std::string v;
+                if (!payload.getString(v)) { out += "<?>"; continue; }
+                std::string s = rebuildSpec(specStart, p, stars, 0);
+                snprintf(buf, sizeof(buf), s.c_str(), v.c_str());
+                out += (v.size() >= sizeof(buf) && s == "%s") ? v : std::string(buf);
+                break;
+            }
+            default:
+                out += "<?>";
+                break;
+        }
+    }
+    return out;
+}
+
+// ============================================================================
+// Rendering (same layout as formatLogLine in debug_log.h)
+// ============================================================================
+
+const char* levelColor(const std::string& level) {
+    if (level == "DEBUG") return colors::LVL_DEBUG;
+    if (level == "INFO")  return colors::LVL_INFO;
+    if (level == "WARN")  return colors::LVL_WARN;
+    if (level == "ERROR") return colors::LVL_ERROR;
+    if (level == "CRIT")  return colors::LVL_CRITICAL;
+    return colors::RESET;
+}
+
+std::string extractFilename(const std::string& path, int maxLen = 20) {
+    size_t slash = path.find_last_of("\\/");
+    std::string result = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+    if ((int)result.length() > maxLen && maxLen > 3) {
+        size_t dotPos = result.rfind('.');
+        if (dotPos != std::string::npos && dotPos > 0) {
+            std::string ext = result.substr(dotPos);
+            int nameLen = maxLen - (int)ext.length() - 2;
+            if (nameLen > 0) {
+                result = result.substr(0, nameLen) + ".." + ext;
+            }
+        } else {
+            result = result.substr(0, maxLen - 2) + "..";
+        }
+    }
+    return result;
+}
+
+// Length of the well-formed UTF-8 sequence at p (RFC 3629), 0 if invalid
+size_t utf8SequenceLength(const unsigned char* p, size_t len) {
+    unsigned char c = p[0];
+    unsigned char lo = 0x80, hi = 0xBF;
+    size_t n;
+    if (c >= 0xC2 && c <= 0xDF) {
+        n = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        n = 3;
+        if (c == 0xE0) lo = 0xA0;
+        if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        n = 4;
+        if (c == 0xF0) lo = 0x90;
+        if (c == 0xF4) hi = 0x8F;
+    } else {
+        return 0;
+    }
+    if (len < n || p[1] < lo || p[1] > hi) return 0;
+    for (size_t k = 2; k < n; k++) {
+        if ((p[k] & 0xC0) != 0x80) return 0;
+    }
+    return n;
+}
+
+// RFC 8259 escaping, matching appendJsonEscaped in debug_log.h
+std::string escapeJson(const std::string& str) {
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char* p = (const unsigned char*)str.data();
+    std::string out;
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++) {
+        unsigned char c = p[i];
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0xF];
+                } else if (c >= 0x80) {
+                    size_t n = utf8SequenceLength(p + i, str.size() - i);
+                    if (n == 0) {
+                        out += "\\ufffd";
+                    } else {
+                        out.append(str, i, n);
+                        i += n - 1;
+                    }
+                } else {
+                    out += (char)c;
+                }
+                break;
+        }
+    }
+    return out;
+}
+
+std::string formatDelta(double deltaMs) {
+    char buffer[16];
+    if (deltaMs < 1.0) {
+        snprintf(buffer, sizeof(buffer), "+%.0fus", deltaMs * 1000);
+    } else if (deltaMs < 1000.0) {
+        snprintf(buffer, sizeof(buffer), "+%.1fms", deltaMs);
+    } else if (deltaMs < 60000.0) {
+        snprintf(buffer, sizeof(buffer), "+%.2fs", deltaMs / 1000);
+    } else {
+        snprintf(buffer, sizeof(buffer), "+%.1fm", deltaMs / 60000);
+    }
+    return buffer;
+}
+
+struct Event {
+    uint64_t qpc;
+    uint32_t tid;
+    uint64_t cid;
+    uint32_t line;
+    std::string level;
+    std::string file;
+    std::string message;
+};
+
+class Renderer {
+public:
+    Renderer(const Options& opts, FILE* out) : opts_(opts), out_(out) {}
+
+    void setHeader(const Header& h) {
+        header_ = h;
+        lastByThread_.clear();
+        lastByCid_.clear();
+    }
+
+    void text(const std::string& raw) {
+        if (opts_.format == OutFormat::JSON) return;
+        fwrite(raw.data(), 1, raw.size(), out_);
+    }
+
+    void log(const Event& ev) {
+        double ms = (double)((int64_t)(ev.qpc - header_.qpcOrigin)) / header_.qpcFrequency * 1000.0;
+        double delta = updateDelta(ev, ms);
+
+        std::string filename = extractFilename(ev.file);
+
+        if (opts_.format == OutFormat::JSON) {
+            fprintf(out_,
+                "{\"ts\":%.3f,\"delta\":%.3f,\"level\":\"%s\",\"tid\":%u,\"cid\":%llu,"
+                "\"file\":\"%s\",\"line\":%u,\"msg\":\"%s\"}\n",
+                ms, delta, ev.level.c_str(), ev.tid, (unsigned long long)ev.cid,
+                escapeJson(filename).c_str(), ev.line, escapeJson(ev.message).c_str());
+            return;
+        }
+
+        std::string timeStr = wallClock(ev.qpc);
+        std::string deltaStr = opts_.includeDeltaTime ? formatDelta(delta) : "";
+
+        if (opts_.format == OutFormat::TEXT) {
+            fprintf(out_, "[%s]", timeStr.c_str());
+            if (opts_.includeDeltaTime) fprintf(out_, " [%7s]", deltaStr.c_str());
+            fprintf(out_, " %-8s %s    %s:%u\n",
+                ev.level.c_str(), ev.message.c_str(), filename.c_str(), ev.line);
+            return;
+        }
+
+        char location[64];
+        snprintf(location, sizeof(location), "%s:%u", filename.c_str(), ev.line);
+
+        int baseLen = (int)timeStr.length() + 3;
+        if (opts_.includeDeltaTime) baseLen += (int)deltaStr.length() + 3;
+        baseLen += 9;
+        baseLen += (int)ev.message.length();
+        baseLen += (int)strlen(location) + 2;
+
+        int padding = opts_.boxWidth - baseLen;
+        if (padding < 1) padding = 1;
+
+        fprintf(out_, "%s[%s]%s ", colors::TIMESTAMP, timeStr.c_str(), colors::RESET);
+        if (opts_.includeDeltaTime) {
+            fprintf(out_, "%s[%7s]%s ", colors::DELTA, deltaStr.c_str(), colors::RESET);
+        }
+        fprintf(out_, "%s%-8s%s ", levelColor(ev.level), ev.level.c_str(), colors::RESET);
+        fprintf(out_, "%s", ev.message.c_str());
+        fprintf(out_, "%*s%s%s%s\n", padding, "", colors::LOCATION, location, colors::RESET);
+    }
+
+private:
+    // Local HH:MM:SS.mmm from the header's wall-clock anchor
+    std::string wallClock(uint64_t qpc) {
+        int64_t ticks = (int64_t)(qpc - header_.qpcOrigin);
+        uint64_t wall = header_.wallOrigin +
+            (uint64_t)((double)ticks / header_.qpcFrequency * 10000000.0);
+        uint64_t ms = wall / 10000;
+        uint64_t daySec = (ms / 1000) % 86400;
+
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d.%03d",
+            (int)(daySec / 3600), (int)(daySec / 60 % 60), (int)(daySec % 60), (int)(ms % 1000));
+        return buffer;
+    }
+
+    Options opts_;
+    FILE* out_;
+    Header header_;
+    // Same semantics as the live logger: since the previous record with the
+    // same cid, otherwise since the previous record on the same thread
+    double updateDelta(const Event& ev, double ms) {
+        double previous = 0;
+        bool known = false;
+        if (ev.cid != 0) {
+            auto it = lastByCid_.find(ev.cid);
+            if (it != lastByCid_.end()) { previous = it->second; known = true; }
+            lastByCid_[ev.cid] = ms;
+        }
+        auto& threadLast = lastByThread_[ev.tid];
+        if (!known) previous = threadLast;
+        threadLast = ms;
+        return ms - previous;
+    }
+
+    std::map<uint32_t, double> lastByThread_;
+    std::map<uint64_t, double> lastByCid_;
+};
+
+// ============================================================================
+// Decoding
+// ============================================================================
+
+using SiteKey = std::pair<int, uint32_t>;   // (header index, site id)
+
+// Walk every record. Pass 1 only collects headers and site definitions;
+// pass 2 renders. Returns false on a malformed stream.
+bool walk(FILE* in, bool render, std::vector<Header>& headers,
+          std::map<SiteKey, Site>& sites, Renderer* renderer) {
+    Reader r(in);
+    int headerIndex = -1;
+    uint8_t tag;
+
+    while (r.get(tag)) {
+        switch (tag) {
+            case binlog::TAG_HEADER: {
+                char magic[4];
+                uint16_t version;
+                uint8_t pointerSize, reserved;
+                Header h;
+                if (!r.read(magic, 4) || memcmp(magic, binlog::kMagic, 4) != 0) return false;
+                if (!r.get(version) || !r.get(pointerSize) || !r.get(reserved)) return false;
+                if (!r.get(h.qpcFrequency) || !r.get(h.qpcOrigin) ||
+                    !r.get(h.wallOrigin) || !r.get(h.pid)) return false;
+                if (version > binlog::kVersion) {
+                    fprintf(stderr, "decode_log: stream version %u is newer than this decoder\n", version);
+                    return false;
+                }
+                if (h.qpcFrequency == 0) h.qpcFrequency = 1;
+                headerIndex++;
+                if (render) renderer->setHeader(headers[headerIndex]);
+                else headers.push_back(h);
+                break;
+            }
+            case binlog::TAG_SITE: {
+                uint32_t id;
+                uint8_t argCount;
+                Site site;
+                if (!r.get(id) || !r.get(site.line) || !r.get(argCount)) return false;
+                site.argTypes.resize(argCount);
+                if (argCount && !r.read(site.argTypes.data(), argCount)) return false;
+                if (!r.getString(site.level) || !r.getString(site.file) ||
+                    !r.getString(site.fmt)) return false;
+                if (!render) sites[SiteKey(headerIndex, id)] = site;
+                break;
+            }
+            case binlog::TAG_LOG: {
+                uint32_t id;
+                uint16_t payloadLen;
+                Event ev;
+                if (!r.get(id) || !r.get(ev.qpc) || !r.get(ev.tid) || !r.get(ev.cid) ||
+                    !r.get(payloadLen)) return false;
+                std::vector<uint8_t> payload(payloadLen);
+                if (payloadLen && !r.read(payload.data(), payloadLen)) return false;
+                if (!render) break;
+
+                auto it = sites.find(SiteKey(headerIndex, id));
+                if (it == sites.end()) {
+                    ev.level = "?";
+                    ev.file = "?";
+                    ev.line = 0;
+                    ev.message = "<unknown call site " + std::to_string(id) + ">";
+                } else {
+                    ev.level = it->second.level;
+                    ev.file = it->second.file;
+                    ev.line = it->second.line;
+                    ev.message = formatMessage(it->second, Payload{payload.data(), payload.size()});
+                }
+                renderer->log(ev);
+                break;
+            }
+            case binlog::TAG_MESSAGE: {
+                Event ev;
+                if (!r.get(ev.qpc) || !r.get(ev.tid) || !r.get(ev.cid) || !r.get(ev.line)) return false;
+                if (!r.getString(ev.level) || !r.getString(ev.file) ||
+                    !r.getString(ev.message)) return false;
+                if (render) renderer->log(ev);
+                break;
+            }
+            case binlog::TAG_TEXT: {
+                uint32_t len;
+                if (!r.get(len)) return false;
+                std::string raw(len, '\0');
+                if (len && !r.read(&raw[0], len)) return false;
+                if (render) renderer->text(raw);
+                break;
+            }
+            case 0: {
+                // A mapped log file (log_file.h) left by a crash is
+                // zero-padded to the end of its last segment
+                long at = ftell(in) - 1;
+                uint8_t byte;
+                while (r.get(byte)) {
+                    if (byte != 0) {
+                        fprintf(stderr, "decode_log: unknown record tag 0x00 at offset %ld\n", at);
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default:
+                fprintf(stderr, "decode_log: unknown record tag 0x%02X at offset %ld\n",
+                    tag, ftell(in) - 1);
+                return false;
+        }
+    }
+    return true;
+}
+
+// A minidump written with the flight recorder on carries a complete stream
+// as a user stream; copy it out so it decodes like any other binary log.
+// MINIDUMP_HEADER: signature, version, stream count, directory RVA, ...;
+// each directory entry: type, size, RVA.
+FILE* openFlightRecorderStream(FILE* dump) {
+    uint32_t header[4];
+    if (fseek(dump, 0, SEEK_SET) != 0 || fread(header, sizeof(header), 1, dump) != 1) return nullptr;
+
+    for (uint32_t i = 0; i < header[2]; i++) {
+        uint32_t entry[3];
+        if (fseek(dump, (long)(header[3] + i * sizeof(entry)), SEEK_SET) != 0 ||
+            fread(entry, sizeof(entry), 1, dump) != 1) return nullptr;
+        if (entry[0] != binlog::kFlightRecorderStreamType) continue;
+
+        FILE* stream = tmpfile();
+        if (!stream || fseek(dump, (long)entry[2], SEEK_SET) != 0) return nullptr;
+        std::vector<char> data(entry[1]);
+        if (!data.empty() && fread(data.data(), 1, data.size(), dump) != data.size()) {
+            fclose(stream);
+            return nullptr;
+        }
+        fwrite(data.data(), 1, data.size(), stream);
+        rewind(stream);
+        return stream;
+    }
+    return nullptr;
+}
+
+void printUsage() {
+    fprintf(stderr,
+        "Usage: decode_log [--format rich|text|json] [--no-delta] [--width N] input [output]\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    const char* inputPath = nullptr;
+    const char* outputPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            std::string f = argv[++i];
+            if (f == "rich") opts.format = OutFormat::RICH;
+            else if (f == "text") opts.format = OutFormat::TEXT;
+            else if (f == "json") opts.format = OutFormat::JSON;
+            else { printUsage(); return 1; }
+        } else if (arg == "--no-delta") {
+            opts.includeDeltaTime = false;
+        } else if (arg == "--width" && i + 1 < argc) {
+            opts.boxWidth = atoi(argv[++i]);
+        } else if (!inputPath) {
+            inputPath = argv[i];
+        } else if (!outputPath) {
+            outputPath = argv[i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (!inputPath) {
+        printUsage();
+        return 1;
+    }
+
+    FILE* in = fopen(inputPath, "rb");
+    if (!in) {
+        fprintf(stderr, "decode_log: cannot open %s\n", inputPath);
+        return 1;
+    }
+
+    char magic[4];
+    if (fread(magic, 1, sizeof(magic), in) == sizeof(magic) && memcmp(magic, "MDMP", 4) == 0) {
+        FILE* stream = openFlightRecorderStream(in);
+        fclose(in);
+        if (!stream) {
+            fprintf(stderr, "decode_log: %s has no flight recorder stream\n", inputPath);
+            return 1;
+        }
+        in = stream;
+    }
+    rewind(in);
+
+    FILE* out = outputPath ? fopen(outputPath, "wb") : stdout;
+    if (!out) {
+        fprintf(stderr, "decode_log: cannot create %s\n", outputPath);
+        fclose(in);
+        return 1;
+    }
+
+    // Site definitions may follow their first use, so collect them first
+    std::vector<Header> headers;
+    std::map<SiteKey, Site> sites;
+    bool ok = walk(in, false, headers, sites, nullptr);
+
+    Renderer renderer(opts, out);
+    rewind(in);
+    ok = walk(in, true, headers, sites, &renderer) && ok;
+
+    if (!ok) fprintf(stderr, "decode_log: stream truncated or corrupt, output may be incomplete\n");
+
+    fclose(in);
+    if (out != stdout) fclose(out);
+    return ok ? 0 : 2;
+}